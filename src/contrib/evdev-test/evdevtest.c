@@ -0,0 +1,164 @@
+/*
+ * Regression test for the evdev mouse driver (drivers/mou_evdev.c).
+ *
+ * Events are written to a pipe opened through EVDEV_MOUSE.  The capability
+ * ioctls fail on a pipe, so the device type is taken from the events.
+ * The server reads the mouse only while the fd is readable and each Read
+ * reports a change, so every queued press, release or scroll must be
+ * returned by the Read that drains the pipe.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include "../../drivers/mou_evdev.c"
+
+SCREENDEVICE scrdev;
+static int pipefd[2];
+static int failed;
+
+int
+GdError(const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	return 0;
+}
+
+int
+GdHideCursor(PSD psd)
+{
+	return 0;
+}
+
+static void
+ev(int type, int code, int value)
+{
+	struct input_event e;
+
+	memset(&e, 0, sizeof(e));
+	e.type = type;
+	e.code = code;
+	e.value = value;
+	if (write(pipefd[1], &e, sizeof(e)) != sizeof(e))
+		exit(2);
+}
+
+static void
+syn(void)
+{
+	ev(EV_SYN, SYN_REPORT, 0);
+}
+
+/* return TRUE if the pipe has unread data*/
+static int
+readable(void)
+{
+	fd_set rfds;
+	struct timeval tv = { 0, 0 };
+
+	FD_ZERO(&rfds);
+	FD_SET(mouse_fd, &rfds);
+	return select(mouse_fd + 1, &rfds, NULL, NULL, &tv) > 0;
+}
+
+static void
+check(const char *name, int status, int wantstatus, int x, int wantx,
+	int y, int wanty, int b, int wantb)
+{
+	if (status != wantstatus || x != wantx || y != wanty || b != wantb) {
+		printf("FAIL %s: got %d %d,%d b=%x, want %d %d,%d b=%x\n", name,
+			status, x, y, b, wantstatus, wantx, wanty, wantb);
+		failed++;
+	} else
+		printf("ok   %s\n", name);
+}
+
+/* open driver on a new pipe*/
+static void
+start(void)
+{
+	char path[32];
+
+	if (pipe(pipefd) < 0)
+		exit(2);
+	sprintf(path, "/dev/fd/%d", pipefd[0]);
+	setenv("EVDEV_MOUSE", path, 1);
+	if (EV_Open(&mousedev) < 0)
+		exit(2);
+}
+
+static void
+stop(void)
+{
+	EV_Close();
+	close(pipefd[0]);
+	close(pipefd[1]);
+}
+
+int
+main(int ac, char **av)
+{
+	MWCOORD x, y, z;
+	int b, status, i;
+
+	scrdev.xres = 640;
+	scrdev.yres = 480;
+
+	/* motion followed by press: press returned with the motion*/
+	start();
+	ev(EV_REL, REL_X, -5); syn();
+	ev(EV_KEY, BTN_LEFT, 1); syn();
+	status = EV_Read(&x, &y, &z, &b);
+	check("rel motion then press", status, MOUSE_RELPOS, x, -5, y, 0, b, MWBUTTON_L);
+	if (readable())
+		check("rel pipe drained", 1, 0, 0, 0, 0, 0, 0, 0);
+	status = EV_Read(&x, &y, &z, &b);
+	check("rel nothing left", status, MOUSE_NODATA, 0, 0, 0, 0, 0, 0);
+	stop();
+
+	/* motion samples merged, wheel returned with the motion*/
+	start();
+	for (i = 0; i < 10; i++) {
+		ev(EV_REL, REL_X, 1); ev(EV_REL, REL_Y, 2); syn();
+	}
+	ev(EV_REL, REL_WHEEL, 1); syn();
+	status = EV_Read(&x, &y, &z, &b);
+	check("rel motion then wheel", status, MOUSE_RELPOS, x, 10, y, 20, b, MWBUTTON_SCROLLUP);
+	stop();
+
+	/* press and release in one read: returned by successive Reads*/
+	start();
+	ev(EV_KEY, BTN_RIGHT, 1); syn();
+	ev(EV_KEY, BTN_RIGHT, 0); syn();
+	status = EV_Read(&x, &y, &z, &b);
+	check("press", status, MOUSE_RELPOS, x, 0, y, 0, b, MWBUTTON_R);
+	status = EV_Read(&x, &y, &z, &b);
+	check("release", status, MOUSE_RELPOS, x, 0, y, 0, b, 0);
+	stop();
+
+	/* multitouch drag: release reported at last contact position*/
+	start();
+	ev(EV_ABS, ABS_MT_SLOT, 0);
+	ev(EV_ABS, ABS_MT_TRACKING_ID, 1);
+	ev(EV_ABS, ABS_MT_POSITION_X, 100);
+	ev(EV_ABS, ABS_MT_POSITION_Y, 200); syn();
+	status = EV_Read(&x, &y, &z, &b);
+	check("touch down", status, MOUSE_ABSPOS, x, 100, y, 200, b, MWBUTTON_L);
+	for (i = 1; i < 200; i++) {
+		ev(EV_ABS, ABS_MT_POSITION_X, 100 + i); syn();
+	}
+	ev(EV_ABS, ABS_MT_TRACKING_ID, -1); syn();
+	status = EV_Read(&x, &y, &z, &b);
+	check("drag then release", status, MOUSE_ABSPOS, x, 299, y, 200, b, 0);
+	stop();
+
+	printf("%s\n", failed? "FAILED": "passed");
+	return failed != 0;
+}
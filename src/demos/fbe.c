@@ -72,6 +72,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/mman.h>
+#include <sys/select.h>
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
@@ -123,6 +124,8 @@ int repaint;
 Pixmap pixmap;
 int mouse_fd;
 int keyboard_fd;
+int wakeup_fd = -1;
+FBEDAMAGE *damage;		/* changed tiles from scr_fbe.c*/
 
 uint32_t crcs[(MAX_CRTX + CHUNKX - 1) / CHUNKX][(MAX_CRTY + CHUNKY - 1) / CHUNKY];
 uint32_t colors_X11[256];	/* contains X11 variants, either 8,16 or 24 bits */
@@ -691,62 +694,43 @@ calc_patch_crc(int ix, int iy)
 	return crc;
 }
 
+/* repaint area of framebuffer, w and h no larger than CHUNKX and CHUNKY*/
 void
-check_and_paint(int ix, int iy)
+paint_area(int x0, int y0, int w, int h)
 {
-	uint32_t crc;
 	int x, y, off;
 	int color;
 
-	crc = calc_patch_crc(ix, iy);
-	if (!repaint && crc == crcs[ix][iy])
-		return;
-	crcs[ix][iy] = crc;
-
-	switch (BITS_PER_PIXEL) {
-	default:
-		off = ix * (CHUNKX / PIXELS_PER_BYTE) + iy * CHUNKY * (CRTX_TOTAL / PIXELS_PER_BYTE);
-		break;
-	case 15:
-	case 16:
-		off = (ix * CHUNKX + iy * CHUNKY * CRTX_TOTAL) * 2;
-		break;
-	case 24:
-		off = (ix * CHUNKX + iy * CHUNKY * CRTX_TOTAL) * 3;
-		break;
-	case 32:
-		off = (ix * CHUNKX + iy * CHUNKY * CRTX_TOTAL) * 4;
-		break;
-	}
-
 	XSetForeground(display, gc, 0x000000);
-	XFillRectangle(display, pixmap, gc, 0, 0, CHUNKX * ZOOM, CHUNKY * ZOOM);
+	XFillRectangle(display, pixmap, gc, 0, 0, w * ZOOM, h * ZOOM);
 
-	for (y = 0; y < CHUNKY; y++) {
-		if (iy == CRTY/CHUNKY && y >= CRTY%CHUNKY)
-			continue;
-		for (x = 0; x < CHUNKX; x++) {
-			if (ix == CRTX/CHUNKX && x >= CRTX%CHUNKX)
-				continue;
+	for (y = 0; y < h; y++) {
+		if (y0 + y >= CRTY)
+			break;
+		for (x = 0; x < w; x++) {
+			if (x0 + x >= CRTX)
+				break;
 			if (BITS_PER_PIXEL <= 8) {
-				unsigned char data =
-					((unsigned char *)crtbuf)[off + x/PIXELS_PER_BYTE + y*(CRTX_TOTAL/PIXELS_PER_BYTE)];
+				unsigned char data;
 
+				off = (x0 + x)/PIXELS_PER_BYTE + (y0 + y)*(CRTX_TOTAL/PIXELS_PER_BYTE);
+				data = ((unsigned char *)crtbuf)[off];
 				if (rev_bitorder)
 					color = (data >> 
-						((x & (PIXELS_PER_BYTE-1))) * BITS_PER_PIXEL) & PIXEL_MASK;
+						(((x0 + x) & (PIXELS_PER_BYTE-1))) * BITS_PER_PIXEL) & PIXEL_MASK;
 				else
 					color = (data >>
-						(((PIXELS_PER_BYTE-1) - (x & (PIXELS_PER_BYTE-1)))*BITS_PER_PIXEL)) & PIXEL_MASK;
+						(((PIXELS_PER_BYTE-1) - ((x0 + x) & (PIXELS_PER_BYTE-1)))*BITS_PER_PIXEL)) & PIXEL_MASK;
 				XSetForeground(display, gc, colors_X11[color]);
 			} else {
 				unsigned char *data;
 				unsigned char a, r, g, b, h, l;
 				uint32_t dat;
 				
+				off = (x0 + x) + (y0 + y)*CRTX_TOTAL;
 				switch (BITS_PER_PIXEL) {
 				case 15:
-					data = ((unsigned char *)crtbuf) + off + (x + y*CRTX_TOTAL)*2;
+					data = ((unsigned char *)crtbuf) + off*2;
 					l = *data++;
 					h = *data;
 					dat = l | (h<<8);
@@ -756,7 +740,7 @@ check_and_paint(int ix, int iy)
 					dat = b | (g<<8) | (r<<16);
 					break;
 				case 16:
-					data = ((unsigned char *)crtbuf) + off + (x + y*CRTX_TOTAL)*2;
+					data = ((unsigned char *)crtbuf) + off*2;
 					l = *data++;
 					h = *data;
 					dat = l | (h<<8);
@@ -766,14 +750,14 @@ check_and_paint(int ix, int iy)
 					dat = b | (g<<8) | (r<<16);
 					break;
 				case 24:
-					data = ((unsigned char *)crtbuf) + off + (x + y*CRTX_TOTAL)*3;
+					data = ((unsigned char *)crtbuf) + off*3;
 					b = *data++;
 					g = *data++;
 					r = *data++;
 					dat = b | (g<<8) | (r<<16);
 					break;
 				case 32:
-					data = ((unsigned char *)crtbuf) + off + (x + y*CRTX_TOTAL)*4;
+					data = ((unsigned char *)crtbuf) + off*4;
 #if MWPIXEL_FORMAT == MWPF_TRUECOLORABGR
 					r = *data++;
 					g = *data++;
@@ -796,8 +780,43 @@ check_and_paint(int ix, int iy)
 				XDrawPoint(display, pixmap, gc, x, y);
 		}
 	}
-	XCopyArea(display, pixmap, window, gc, 0, 0, CHUNKX * ZOOM, CHUNKY * ZOOM,
-		ix * CHUNKX * ZOOM, iy * CHUNKY * ZOOM);
+	XCopyArea(display, pixmap, window, gc, 0, 0, w * ZOOM, h * ZOOM,
+		x0 * ZOOM, y0 * ZOOM);
+}
+
+void
+check_and_paint(int ix, int iy)
+{
+	uint32_t crc;
+
+	crc = calc_patch_crc(ix, iy);
+	if (!repaint && crc == crcs[ix][iy])
+		return;
+	crcs[ix][iy] = crc;
+
+	paint_area(ix * CHUNKX, iy * CHUNKY, CHUNKX, CHUNKY);
+}
+
+/* repaint tiles marked changed by scr_fbe.c*/
+void
+paint_damage(void)
+{
+	char buf[64];
+	int x, y;
+
+	/* clear wakeups before tiles, so tiles changed from now on signal again*/
+	while (read(wakeup_fd, buf, sizeof(buf)) > 0)
+		continue;
+	damage->signalled = 0;
+	__sync_synchronize();
+
+	for (y = 0; y < (CRTY+FBE_TILESIZE-1) / FBE_TILESIZE; y++)
+		for (x = 0; x < (CRTX+FBE_TILESIZE-1) / FBE_TILESIZE; x++) {
+			if (damage->tiles[y][x]) {
+				damage->tiles[y][x] = 0;
+				paint_area(x * FBE_TILESIZE, y * FBE_TILESIZE, FBE_TILESIZE, FBE_TILESIZE);
+			}
+		}
 }
 
 static void
@@ -1115,16 +1134,39 @@ fbe_loop(void)
 			}
 		}
 
-		/* 
-		   Sample all chunks for changes in shared memory buffer and
-		   eventually repaint individual chunks. Repaint everything if
-		   repaint is true (see above)
+		/*
+		   If scr_fbe.c is reporting damage, repaint only changed tiles,
+		   then sleep until more damage or X events arrive.
 		 */
-		for (y = 0; y < (CRTY+CHUNKY-1) / CHUNKY; y++)
-			for (x = 0; x < (CRTX+CHUNKX-1) / CHUNKX; x++)
-				check_and_paint(x, y);
-		repaint = 0;
-		usleep(2000);
+		if (damage && damage->active && !repaint) {
+			fd_set rfds;
+			struct timeval tv;
+			int xfd = ConnectionNumber(display);
+
+			paint_damage();
+			XFlush(display);
+			if (XPending(display) > 0)
+				continue;
+
+			/* timeout rechecks active in case nano-X exits*/
+			FD_ZERO(&rfds);
+			FD_SET(xfd, &rfds);
+			FD_SET(wakeup_fd, &rfds);
+			tv.tv_sec = 0;
+			tv.tv_usec = 100000;
+			select(MWMAX(xfd, wakeup_fd) + 1, &rfds, NULL, NULL, &tv);
+		} else {
+			/* 
+			   Sample all chunks for changes in shared memory buffer and
+			   eventually repaint individual chunks. Repaint everything if
+			   repaint is true (see above)
+			 */
+			for (y = 0; y < (CRTY+CHUNKY-1) / CHUNKY; y++)
+				for (x = 0; x < (CRTX+CHUNKX-1) / CHUNKX; x++)
+					check_and_paint(x, y);
+			repaint = 0;
+			usleep(2000);
+		}
 
 		/* re-set color map */
 		if (redocmap) {
@@ -1144,7 +1186,7 @@ usr1_handler(int sig)
 int
 main(int argc, char **argv)
 {
-	int fd = -1, cfd;
+	int fd = -1, cfd, dfd;
 	int i, extra, size;
 	int leave, ok = 1, help, bpp = 0;
 	char *arg, *argp, buf[64];
@@ -1292,6 +1334,8 @@ main(int argc, char **argv)
 		unlink(MW_PATH_FBE_COLORMAP);
 		unlink(MW_PATH_FBE_MOUSE);
 		unlink(MW_PATH_FBE_KEYBOARD);
+		unlink(MW_PATH_FBE_DAMAGE);
+		unlink(MW_PATH_FBE_WAKEUP);
 	}
 
 	/* open and mmap virtual framebuffer, but recreate if missing or wrong size*/
@@ -1339,6 +1383,26 @@ main(int argc, char **argv)
 	if ((keyboard_fd = open(MW_PATH_FBE_KEYBOARD, O_RDWR | O_NONBLOCK)) < 0)
 		fprintf(stderr, PROGNAME ": open %s error %d ('%s')\n", MW_PATH_FBE_KEYBOARD, errno, strerror(errno));
 
+	/* open and mmap damage tiles, but recreate if wrong size*/
+	if (stat(MW_PATH_FBE_DAMAGE, &st) || st.st_size != sizeof(FBEDAMAGE))
+		unlink(MW_PATH_FBE_DAMAGE);
+	if ((dfd = open(MW_PATH_FBE_DAMAGE, O_CREAT | O_RDWR, 0666)) >= 0) {
+		if (ftruncate(dfd, sizeof(FBEDAMAGE)) == 0) {
+			damage = mmap(NULL, sizeof(FBEDAMAGE), PROT_READ | PROT_WRITE, MAP_SHARED, dfd, 0);
+			if (damage == MAP_FAILED)
+				damage = NULL;
+		}
+		close(dfd);
+	}
+
+	/* open damage wakeup named pipe, framebuffer is polled if unavailable*/
+	if (mkfifo(MW_PATH_FBE_WAKEUP, 0666) < 0 && errno != EEXIST)
+		fprintf(stderr, PROGNAME ": mkfifo %s error %d ('%s')\n", MW_PATH_FBE_WAKEUP, errno, strerror(errno));
+	if ((wakeup_fd = open(MW_PATH_FBE_WAKEUP, O_RDWR | O_NONBLOCK)) < 0) {
+		fprintf(stderr, PROGNAME ": open %s error %d ('%s')\n", MW_PATH_FBE_WAKEUP, errno, strerror(errno));
+		damage = NULL;
+	}
+
 	X11_init();
 	fbe_setcolors();
 	fbe_calcX11colors();
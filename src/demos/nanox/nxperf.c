@@ -0,0 +1,628 @@
+/*
+ * nxperf - nano-X rendering benchmark, modelled on x11perf
+ *
+ * Times rectangles, rounded rectangles, lines, wide lines, polygons, ellipses, text in each font renderer,
+ * blits per raster op and pixel format, stretch blits, alpha blending,
+ * image decoding and window moves.  Each test is repeated in batches,
+ * waiting for the server to finish each batch, for the given time.
+ *
+ * Results are printed one test per line as whitespace separated columns,
+ * with comment lines starting with '#', for trend tracking scripts:
+ *	test  ops  secs  ops/s  MB/s
+ * MB/s counts destination pixels drawn at the screen's bytes per pixel.
+ *
+ * Run against a server built with SCREEN=MEM for headless results without
+ * display cost, or link with LINK_APP_INTO_SERVER=Y to time the engine
+ * without the client/server path.  Text tests are reported unavailable
+ * when the server can't load the font, images need HAVE_BMP_SUPPORT and
+ * HAVE_PNM_SUPPORT.
+ *
+ * Usage: nxperf [-l] [-t seconds] [test-prefix ...]
+ *	-l	list tests and exit
+ *	-t	seconds to run each test (default 1)
+ *	test-prefix	run only tests whose names start with a prefix
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#define MWINCLUDECOLORS
+#include "nano-X.h"
+
+#define WIDTH		640		/* test window size*/
+#define HEIGHT		520
+#define MAXSIZE		500		/* largest primitive size*/
+#define IMAGESIZE	100		/* decoded image width and height*/
+
+#define SKIPPED		(-1)	/* setup return if test can't run in window*/
+#define UNAVAILABLE	(-2)	/* setup return if font can't be loaded*/
+
+typedef struct {
+	const char *name;
+	long	(*func)(int n, int size, int arg);	/* n == 0 for setup, returns pixels per op or SKIPPED*/
+	int		size;
+	int		arg;
+} TEST;
+
+static GR_WINDOW_ID wid;
+static GR_WINDOW_ID movewid;
+static GR_WINDOW_ID pixmap;			/* screen format source pixmap*/
+static GR_WINDOW_ID rgbapixmap;		/* RGBA8888 source pixmap with alpha*/
+static GR_GC_ID gc;
+static GR_FONT_ID textfont;			/* font loaded by text test setup*/
+static GR_SCREEN_INFO si;
+static int winwidth = WIDTH;
+static int winheight = HEIGHT;
+static unsigned long seed = 1;
+static uint32_t *pixels;			/* MAXSIZE square 32bpp source pixels*/
+static unsigned char *bmpbuf, *ppmbuf;
+static int bmpsize, ppmsize;
+
+static const char *text = "The quick brown fox jumps over the lazy dog";
+
+static const struct {
+	const char *font;
+	int		height;
+	int		antialias;
+} fonts[] = {
+	{ MWFONT_SYSTEM_VAR, 0, 0 },		/* builtin compiled in*/
+	{ MWFONT_SYSTEM_FIXED, 0, 0 },
+	{ "helvB12.fnt", 0, 0 },			/* HAVE_FNT_SUPPORT*/
+	{ "6x13.pcf.gz", 0, 0 },			/* HAVE_PCF_SUPPORT*/
+	{ "DejaVuSans.ttf", 16, 0 },		/* HAVE_FREETYPE_2_SUPPORT*/
+	{ "DejaVuSans.ttf", 16, 1 },
+};
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* wait until server has processed all requests*/
+static void
+waitserver(void)
+{
+	GR_SCREEN_INFO info;
+
+	GrGetScreenInfo(&info);
+}
+
+/* repeatable pseudo-random number below max*/
+static int
+rnd(int max)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) % max;
+}
+
+/* random position keeping size x size primitive within window*/
+static void
+randpos(int size, int *x, int *y)
+{
+	*x = rnd(winwidth - size);
+	*y = rnd(winheight - size);
+}
+
+static long
+fillrect(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrFillRect(wid, gc, x, y, size, size);
+	}
+	return (long)size * size;
+}
+
+static long
+rect(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrRect(wid, gc, x, y, size, size);
+	}
+	return 4L * size;
+}
+
+/* arg is corner radius*/
+static long
+roundrect(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrRoundRect(wid, gc, x, y, size, size, arg, arg);
+	}
+	return 4L * size;
+}
+
+/* arg is corner radius*/
+static long
+fillroundrect(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrFillRoundRect(wid, gc, x, y, size, size, arg, arg);
+	}
+	return (long)size * size;
+}
+
+/* arg is 0 for horizontal, 1 for vertical, 2 for diagonal lines*/
+static long
+line(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		switch (arg) {
+		case 0:
+			GrLine(wid, gc, x, y, x + size - 1, y);
+			break;
+		case 1:
+			GrLine(wid, gc, x, y, x, y + size - 1);
+			break;
+		default:
+			GrLine(wid, gc, x, y, x + size - 1, y + rnd(size));
+			break;
+		}
+	}
+	return size;
+}
+
+/* arg is line width, diagonal lines with round caps*/
+static long
+wideline(int n, int size, int arg)
+{
+	int i, x, y;
+
+	if (n == 0)
+		GrSetGCLineAttributesEx(gc, arg, GR_LINE_SOLID, GR_CAP_ROUND, GR_JOIN_MITER);
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrLine(wid, gc, x, y, x + size - 1, y + rnd(size));
+	}
+	return (long)size * arg;
+}
+
+/* arg is line width, zigzag polyline of 8 segments with mitered joins*/
+static long
+widepoly(int n, int size, int arg)
+{
+	GR_POINT pts[9];
+	int i, j, x, y;
+
+	if (n == 0)
+		GrSetGCLineAttributesEx(gc, arg, GR_LINE_SOLID, GR_CAP_BUTT, GR_JOIN_MITER);
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		for (j = 0; j < 9; j++) {
+			pts[j].x = x + j * (size - 1) / 8;
+			pts[j].y = (j & 1)? y + size - 1: y;
+		}
+		GrPoly(wid, gc, 9, pts);
+	}
+	return 8L * size * arg;
+}
+
+static long
+fillpoly(int n, int size, int arg)
+{
+	GR_POINT pts[3];
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		pts[0].x = x;
+		pts[0].y = y;
+		pts[1].x = x + size - 1;
+		pts[1].y = y;
+		pts[2].x = x + size / 2;
+		pts[2].y = y + size - 1;
+		GrFillPoly(wid, gc, 3, pts);
+	}
+	return (long)size * size / 2;
+}
+
+static long
+fillellipse(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrFillEllipse(wid, gc, x + size/2, y + size/2, size/2, size/2);
+	}
+	return (long)size * size * 355 / 452;	/* pi/4*/
+}
+
+/*
+ * Return TRUE if font is a builtin font.  The server substitutes the
+ * closest builtin font, or returns 0, when a font file can't be loaded.
+ */
+static int
+isbuiltin(GR_FONT_ID font)
+{
+	GR_FONT_INFO fi, bi;
+	GR_FONT_ID builtin;
+	int i, same = 0;
+
+	if (font == 0)
+		return 1;
+	GrGetFontInfo(font, &fi);
+	for (i = 0; i < 2 && !same; i++) {		/* fonts[0..1] are the builtins*/
+		builtin = GrCreateFontEx(fonts[i].font, 0, 0, NULL);
+		GrGetFontInfo(builtin, &bi);
+		GrDestroyFont(builtin);
+		same = !memcmp(&fi, &bi, sizeof(fi));
+	}
+	return same;
+}
+
+/* arg is index into fonts[]*/
+static long
+drawtext(int n, int size, int arg)
+{
+	static GR_SIZE w, h, b;
+	int i, x, y;
+
+	if (n == 0) {
+		textfont = GrCreateFontEx(fonts[arg].font, fonts[arg].height,
+			fonts[arg].height, NULL);
+		if (arg >= 2 && isbuiltin(textfont))
+			return UNAVAILABLE;
+
+		if (fonts[arg].antialias)
+			GrSetFontAttr(textfont, GR_TFANTIALIAS, 0);
+		else GrSetFontAttr(textfont, 0, GR_TFANTIALIAS);
+		GrSetGCFont(gc, textfont);
+		GrGetGCTextSize(gc, (void *)text, -1, GR_TFASCII, &w, &h, &b);
+		if (w >= winwidth || h >= winheight)
+			return SKIPPED;
+		return (long)w * h;
+	}
+
+	for (i = 0; i < n; i++) {
+		x = rnd(winwidth - w);
+		y = rnd(winheight - h);
+		GrText(wid, gc, x, y, (void *)text, -1, GR_TFASCII | GR_TFTOP);
+	}
+	return 0;
+}
+
+/* window to window copy, arg is raster op*/
+static long
+copywin(int n, int size, int arg)
+{
+	int i, x, y, sx, sy;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		randpos(size, &sx, &sy);
+		GrCopyArea(wid, gc, x, y, size, size, wid, sx, sy, arg);
+	}
+	return (long)size * size;
+}
+
+/* screen format pixmap to window copy, arg is raster op*/
+static long
+copypix(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrCopyArea(wid, gc, x, y, size, size, pixmap, 0, 0, arg);
+	}
+	return (long)size * size;
+}
+
+/* RGBA8888 pixmap to window, format conversion or alpha blend with arg rop*/
+static long
+copyrgba(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrCopyArea(wid, gc, x, y, size, size, rgbapixmap, 0, 0, arg);
+	}
+	return (long)size * size;
+}
+
+/* client pixels to window, arg is pixel format*/
+static long
+area(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrArea(wid, gc, x, y, size, size, pixels, arg);
+	}
+	return (long)size * size;
+}
+
+/* stretch IMAGESIZE square pixmap to size square*/
+static long
+stretch(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrStretchArea(wid, gc, x, y, x + size - 1, y + size - 1,
+			pixmap, 0, 0, IMAGESIZE - 1, IMAGESIZE - 1, MWROP_COPY);
+	}
+	return (long)size * size;
+}
+
+/* decode and draw image, arg is 0 for BMP, 1 for PPM*/
+static long
+image(int n, int size, int arg)
+{
+	int i, x, y;
+
+	for (i = 0; i < n; i++) {
+		randpos(IMAGESIZE, &x, &y);
+		if (arg == 0)
+			GrDrawImageFromBuffer(wid, gc, x, y, -1, -1, bmpbuf, bmpsize, 0);
+		else GrDrawImageFromBuffer(wid, gc, x, y, -1, -1, ppmbuf, ppmsize, 0);
+	}
+	return (long)IMAGESIZE * IMAGESIZE;
+}
+
+/* move size square child window*/
+static long
+movewin(int n, int size, int arg)
+{
+	int i, x, y;
+
+	if (n == 0) {
+		if (movewid)
+			GrDestroyWindow(movewid);
+		movewid = GrNewWindow(wid, 0, 0, size, size, 0, BLUE, WHITE);
+		GrMapWindow(movewid);
+		GrFillRect(movewid, gc, size/4, size/4, size/2, size/2);
+		return (long)size * size;
+	}
+
+	for (i = 0; i < n; i++) {
+		randpos(size, &x, &y);
+		GrMoveWindow(movewid, x, y);
+	}
+	return 0;
+}
+
+static TEST tests[] = {
+	{ "fillrect-1",		fillrect, 1, 0 },
+	{ "fillrect-10",	fillrect, 10, 0 },
+	{ "fillrect-100",	fillrect, 100, 0 },
+	{ "fillrect-500",	fillrect, 500, 0 },
+	{ "rect-10",		rect, 10, 0 },
+	{ "rect-100",		rect, 100, 0 },
+	{ "roundrect-100r10", roundrect, 100, 10 },
+	{ "fillroundrect-10r3", fillroundrect, 10, 3 },
+	{ "fillroundrect-100r10", fillroundrect, 100, 10 },
+	{ "hline-10",		line, 10, 0 },
+	{ "hline-500",		line, 500, 0 },
+	{ "vline-10",		line, 10, 1 },
+	{ "vline-500",		line, 500, 1 },
+	{ "line-10",		line, 10, 2 },
+	{ "line-100",		line, 100, 2 },
+	{ "line-500",		line, 500, 2 },
+	{ "wideline-10w2",	wideline, 10, 2 },
+	{ "wideline-100w10", wideline, 100, 10 },
+	{ "widepoly-100w10", widepoly, 100, 10 },
+	{ "fillpoly-10",	fillpoly, 10, 0 },
+	{ "fillpoly-100",	fillpoly, 100, 0 },
+	{ "fillellipse-10",	fillellipse, 10, 0 },
+	{ "fillellipse-100", fillellipse, 100, 0 },
+	{ "text-core",		drawtext, 0, 0 },
+	{ "text-corefixed",	drawtext, 0, 1 },
+	{ "text-fnt",		drawtext, 0, 2 },
+	{ "text-pcf",		drawtext, 0, 3 },
+	{ "text-ttf",		drawtext, 0, 4 },
+	{ "text-ttf-aa",	drawtext, 0, 5 },
+	{ "copywin-10",		copywin, 10, MWROP_COPY },
+	{ "copywin-100",	copywin, 100, MWROP_COPY },
+	{ "copywin-500",	copywin, 500, MWROP_COPY },
+	{ "copypix-100",	copypix, 100, MWROP_COPY },
+	{ "copypix-500",	copypix, 500, MWROP_COPY },
+	{ "copypix-xor-100", copypix, 100, MWROP_XOR },
+	{ "copypix-and-100", copypix, 100, MWROP_AND },
+	{ "copypix-srctrans-100", copypix, 100, MWROP_SRCTRANSCOPY },
+	{ "copyrgba-100",	copyrgba, 100, MWROP_COPY },
+	{ "blend-100",		copyrgba, 100, MWROP_SRC_OVER },
+	{ "blend-500",		copyrgba, 500, MWROP_SRC_OVER },
+	{ "area-rgb-100",	area, 100, MWPF_RGB },
+	{ "area-argb-100",	area, 100, MWPF_TRUECOLORARGB },
+	{ "area-565-100",	area, 100, MWPF_TRUECOLOR565 },
+	{ "area-pixelval-100", area, 100, MWPF_PIXELVAL },
+	{ "stretch-up-200",	stretch, 200, 0 },
+	{ "stretch-down-50", stretch, 50, 0 },
+	{ "image-bmp",		image, 0, 0 },
+	{ "image-ppm",		image, 0, 1 },
+	{ "movewin-100",	movewin, 100, 0 },
+	{ "movewin-400",	movewin, 400, 0 },
+	{ NULL }
+};
+
+/* create source pixels, pixmaps and image files in memory*/
+static int
+setup(void)
+{
+	unsigned char *p;
+	int x, y;
+
+	pixels = malloc(MAXSIZE * MAXSIZE * sizeof(uint32_t));
+	bmpsize = 54 + IMAGESIZE * IMAGESIZE * 3;
+	bmpbuf = calloc(1, bmpsize);
+	ppmsize = 15 + IMAGESIZE * IMAGESIZE * 3;
+	ppmbuf = malloc(ppmsize);
+	if (!pixels || !bmpbuf || !ppmbuf)
+		return 0;
+
+	/* gradient, half transparent for blending*/
+	for (y = 0; y < MAXSIZE; y++)
+		for (x = 0; x < MAXSIZE; x++)
+			pixels[y * MAXSIZE + x] = MWARGB(0x80, x & 255, y & 255, (x + y) & 255);
+
+	/* screen format and RGBA8888 source pixmaps*/
+	pixmap = GrNewPixmap(MAXSIZE, MAXSIZE, NULL);
+	GrArea(pixmap, gc, 0, 0, MAXSIZE, MAXSIZE, pixels, MWPF_RGB);
+	rgbapixmap = GrNewPixmapEx(MAXSIZE, MAXSIZE, MWIF_RGBA8888, NULL);
+	GrArea(rgbapixmap, gc, 0, 0, MAXSIZE, MAXSIZE, pixels, MWPF_RGB);
+
+	/* 24bpp bottom-up BMP*/
+	p = bmpbuf;
+	*p++ = 'B'; *p++ = 'M';
+	p[0] = bmpsize; p[1] = bmpsize >> 8; p[2] = bmpsize >> 16;
+	p[8] = 54;									/* offset to bits*/
+	p += 12;
+	p[0] = 40;									/* info header size*/
+	p[4] = IMAGESIZE; p[8] = IMAGESIZE;			/* width, height*/
+	p[12] = 1; p[14] = 24;						/* planes, bpp*/
+	p = bmpbuf + 54;
+	for (y = 0; y < IMAGESIZE; y++)
+		for (x = 0; x < IMAGESIZE; x++) {
+			*p++ = (x + y) & 255;
+			*p++ = y & 255;
+			*p++ = x & 255;
+		}
+
+	/* binary PPM*/
+	p = ppmbuf + sprintf((char *)ppmbuf, "P6\n%d %d\n255\n", IMAGESIZE, IMAGESIZE);
+	ppmsize = (p - ppmbuf) + IMAGESIZE * IMAGESIZE * 3;
+	for (y = 0; y < IMAGESIZE; y++)
+		for (x = 0; x < IMAGESIZE; x++) {
+			*p++ = x & 255;
+			*p++ = y & 255;
+			*p++ = (x + y) & 255;
+		}
+	return 1;
+}
+
+static void
+runtest(TEST *t, double duration)
+{
+	long pixelsperop;
+	long n = 1, ops = 0;
+	double start, secs;
+
+	if (t->size >= winwidth || t->size >= winheight) {
+		printf("# %s skipped, window too small\n", t->name);
+		return;
+	}
+	GrSetGCForeground(gc, WHITE);
+	GrSetGCMode(gc, GR_MODE_COPY);
+	GrSetGCLineAttributesEx(gc, 0, GR_LINE_SOLID, GR_CAP_BUTT, GR_JOIN_MITER);
+	GrClearWindow(wid, GR_FALSE);
+	pixelsperop = t->func(0, t->size, t->arg);
+	if (pixelsperop < 0) {
+		printf("# %s %s\n", t->name, (pixelsperop == UNAVAILABLE)? "unavailable": "skipped");
+		return;
+	}
+
+	/* find batch size taking at least 20ms, so round trips don't dominate*/
+	for (;;) {
+		start = now();
+		t->func(n, t->size, t->arg);
+		waitserver();
+		secs = now() - start;
+		if (secs >= 0.02 || n >= 1000000)
+			break;
+		n *= (secs < 0.002)? 10: 2;
+	}
+
+	start = now();
+	do {
+		t->func(n, t->size, t->arg);
+		waitserver();
+		ops += n;
+		secs = now() - start;
+	} while (secs < duration);
+
+	printf("%-24s %10ld %8.3f %12.1f %10.2f\n", t->name, ops, secs, ops / secs,
+		ops / secs * pixelsperop * ((si.bpp + 7) / 8) / 1e6);
+	fflush(stdout);
+}
+
+int
+main(int ac, char **av)
+{
+	TEST *t;
+	double duration = 1.0;
+	int i, list = 0;
+
+	while (ac > 1 && av[1][0] == '-') {
+		if (av[1][1] == 'l')
+			list = 1;
+		else if (av[1][1] == 't' && ac > 2) {
+			duration = atof(av[2]);
+			++av; --ac;
+		} else {
+			fprintf(stderr, "Usage: nxperf [-l] [-t seconds] [test-prefix ...]\n");
+			return 1;
+		}
+		++av; --ac;
+	}
+
+	if (list) {
+		for (t = tests; t->name; t++)
+			printf("%s\n", t->name);
+		return 0;
+	}
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "nxperf: cannot open graphics\n");
+		return 1;
+	}
+
+	GrGetScreenInfo(&si);
+	winwidth = MWMIN(WIDTH, si.cols);
+	winheight = MWMIN(HEIGHT, si.rows);
+	wid = GrNewWindowEx(GR_WM_PROPS_NODECORATE, "nxperf", GR_ROOT_WINDOW_ID,
+		0, 0, winwidth, winheight, BLACK);
+	GrMapWindow(wid);
+	gc = GrNewGC();
+	if (!setup()) {
+		fprintf(stderr, "nxperf: out of memory\n");
+		return 1;
+	}
+	waitserver();
+
+	printf("# nxperf %dx%d %dbpp pixtype %d, window %dx%d, %.1fs per test\n",
+		si.cols, si.rows, si.bpp, si.pixtype, winwidth, winheight, duration);
+	printf("# %-22s %10s %8s %12s %10s\n", "test", "ops", "secs", "ops/s", "MB/s");
+	for (t = tests; t->name; t++) {
+		if (ac > 1) {
+			for (i = 1; i < ac; i++)
+				if (!strncmp(t->name, av[i], strlen(av[i])))
+					break;
+			if (i == ac)
+				continue;
+		}
+		runtest(t, duration);
+
+		/* free font from text test setup*/
+		if (textfont) {
+			GrSetGCFont(gc, 0);
+			GrDestroyFont(textfont);
+			textfont = 0;
+		}
+	}
+
+	GrClose();
+	return 0;
+}
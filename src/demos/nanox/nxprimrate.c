@@ -0,0 +1,149 @@
+/*
+ * nxprimrate - compare nano-X primitive rates for single and batched requests
+ *
+ * Draws the same lines and rectangles using one request per primitive
+ * (GrLine, GrRect, GrFillRect) and using the batched requests (GrPolyLine,
+ * GrSegments, GrRects, GrFillRects), and prints primitives per second.
+ *
+ * Usage: nxprimrate [count [size]]
+ *	count	primitives per test (default 20000)
+ *	size	primitive size in pixels (default 10)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#define MWINCLUDECOLORS
+#include "nano-X.h"
+
+#define WIDTH	400
+#define HEIGHT	300
+
+static GR_WINDOW_ID wid;
+static GR_GC_ID gc;
+static int count = 20000;
+static int size = 10;
+static GR_POINT *points;
+static GR_SEGMENT *segs;
+static GR_RECT *rects;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* wait until server has processed all requests*/
+static void
+waitserver(void)
+{
+	GR_SCREEN_INFO si;
+
+	GrGetScreenInfo(&si);
+}
+
+static void
+report(const char *name, double start)
+{
+	double secs;
+
+	waitserver();
+	secs = now() - start;
+	printf("%-24s %10.0f/s\n", name, count / secs);
+}
+
+int
+main(int ac, char **av)
+{
+	double start;
+	int i;
+
+	if (ac > 1)
+		count = atoi(av[1]);
+	if (ac > 2)
+		size = atoi(av[2]);
+	if (count <= 0 || size <= 0) {
+		fprintf(stderr, "Usage: nxprimrate [count [size]]\n");
+		return 1;
+	}
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "nxprimrate: cannot open graphics\n");
+		return 1;
+	}
+
+	points = malloc((count + 1) * sizeof(GR_POINT));
+	segs = malloc(count * sizeof(GR_SEGMENT));
+	rects = malloc(count * sizeof(GR_RECT));
+	if (!points || !segs || !rects) {
+		fprintf(stderr, "nxprimrate: out of memory\n");
+		return 1;
+	}
+
+	/* pseudo-random primitives within window*/
+	srand(1);
+	for (i = 0; i <= count; i++) {
+		points[i].x = rand() % WIDTH;
+		points[i].y = rand() % HEIGHT;
+	}
+	for (i = 0; i < count; i++) {
+		segs[i].x1 = points[i].x;
+		segs[i].y1 = points[i].y;
+		segs[i].x2 = points[i].x + size;
+		segs[i].y2 = points[i].y + size / 2;
+		rects[i].x = points[i].x;
+		rects[i].y = points[i].y;
+		rects[i].width = size;
+		rects[i].height = size;
+	}
+
+	wid = GrNewWindowEx(GR_WM_PROPS_APPWINDOW, "nxprimrate", GR_ROOT_WINDOW_ID,
+		10, 10, WIDTH, HEIGHT, BLACK);
+	GrMapWindow(wid);
+	gc = GrNewGC();
+	GrSetGCForeground(gc, WHITE);
+	waitserver();
+
+	printf("%d primitives, size %d\n", count, size);
+
+	start = now();
+	for (i = 0; i < count; i++)
+		GrLine(wid, gc, points[i].x, points[i].y, points[i+1].x, points[i+1].y);
+	report("GrLine polyline", start);
+
+	start = now();
+	GrPolyLine(wid, gc, count + 1, points);
+	report("GrPolyLine", start);
+
+	start = now();
+	for (i = 0; i < count; i++)
+		GrLine(wid, gc, segs[i].x1, segs[i].y1, segs[i].x2, segs[i].y2);
+	report("GrLine segments", start);
+
+	start = now();
+	GrSegments(wid, gc, count, segs);
+	report("GrSegments", start);
+
+	start = now();
+	for (i = 0; i < count; i++)
+		GrRect(wid, gc, rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+	report("GrRect", start);
+
+	start = now();
+	GrRects(wid, gc, count, rects);
+	report("GrRects", start);
+
+	start = now();
+	for (i = 0; i < count; i++)
+		GrFillRect(wid, gc, rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+	report("GrFillRect", start);
+
+	start = now();
+	GrFillRects(wid, gc, count, rects);
+	report("GrFillRects", start);
+
+	GrClose();
+	return 0;
+}
@@ -65,6 +65,7 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <termios.h>
 #define NSIG 	_NSIG
 #define UNIX98	1		/* use new-style /dev/ptmx, /dev/pts/0*/
@@ -86,8 +87,6 @@
 #define	KBDBUF          10240
 #endif
 
-#define	LINEBUF         stdcol
-
 #define debug_screen 0
 #define debug_kbd 0
 
@@ -133,16 +132,43 @@ int	termtype = ANSI;
 int	bgmode, escstate, curx, cury, curon, curvis;
 int	savx, savy, wrap, style;
 int	col, row, colmask = 0x7f, rowmask = 0x7f;
-int	sbufcnt = 0;
-int	sbufx, sbufy;
-char    lineBuffer[LINEBUF+1];
-char	*sbuf = lineBuffer;
+
+/*
+ * Output from the pty only updates the cell grid below.  The window is
+ * brought up to date at most once per frame interval by render(), which
+ * moves the pending net scroll with a single GrCopyArea and then draws
+ * each run of changed cells with the same colors using one GrText.
+ * shadow[] holds what is currently drawn in the window.
+ */
+#define FRAMEMS		16		/* minimum msecs between screen updates*/
+
+typedef struct {
+	unsigned char	ch;
+	GR_COLOR		fg, bg;
+} CELL;
+
+CELL	screen[stdrow][stdcol];	/* terminal contents*/
+CELL	shadow[stdrow][stdcol];	/* contents drawn in window*/
+char	dirty[stdrow];			/* line changed since last render*/
+int		needrender;				/* any line dirty or scroll pending*/
+int		scrollpend;				/* net lines scrolled up, down if negative*/
+int		scrollptop, scrollpbot;	/* region of pending scroll*/
+GR_COLOR curfg, curbg;			/* current text colors*/
+GR_COLOR gcfg, gcbg;			/* colors last set in gc1*/
+int		cursx, cursy;			/* position cursor was drawn at*/
+struct timeval lastframe;
 
 void sigchild(int signo);
 int term_init(void);
-void sflush(void);
-void lineRedraw(void);
 void sadd(char c);
+void erase(int x, int y, int n);
+void eraselines(int y, int n);
+void scrollregion(int top, int bottom, int lines);
+void invalidate(void);
+int framewait(void);
+void render(void);
+void setfg(GR_COLOR c);
+void setbg(GR_COLOR c);
 void show_cursor(void);
 void draw_cursor(void);
 void hide_cursor(void);
@@ -167,44 +193,194 @@ void rendition(int escvalue);
 
 /* **************************************************************************/
 
-void sflush(void)
+/* store a character at the cursor position*/
+void sadd(char c)
+{
+	CELL *cp;
+
+	if (cury < 0 || cury >= row || curx < 0 || curx >= col)
+		return;
+	cp = &screen[cury][curx];
+	cp->ch = c;
+	cp->fg = curfg;
+	cp->bg = curbg;
+	dirty[cury] = 1;
+	needrender = 1;
+}
+
+/* erase n cells of line y starting at column x to the current background*/
+void erase(int x, int y, int n)
+{
+	CELL *cp;
+
+	if (y < 0 || y >= row)
+		return;
+	if (x < 0) {
+		n += x;
+		x = 0;
+	}
+	if (n > col - x)
+		n = col - x;
+	if (n <= 0)
+		return;
+	for (cp = &screen[y][x]; --n >= 0; cp++) {
+		cp->ch = ' ';
+		cp->fg = gi.foreground;
+		cp->bg = gi.background;
+	}
+	dirty[y] = 1;
+	needrender = 1;
+}
+
+void eraselines(int y, int n)
+{
+	while (--n >= 0)
+		erase(0, y++, col);
+}
+
+/*
+ * Scroll lines top to bottom-1 up by lines, or down if negative, erasing
+ * the lines uncovered.  Successive scrolls of the same region are
+ * accumulated and drawn as one GrCopyArea by render().
+ */
+void scrollregion(int top, int bottom, int lines)
 {
-	if (sbufcnt) {
-		GrText(w1,gc1, sbufx*fonw, sbufy*fonh, sbuf, sbufcnt, GR_TFTOP);
-		sbufcnt = 0;
+	int n, y;
+
+	if (top < 0)
+		top = 0;
+	if (bottom > row)
+		bottom = row;
+	n = bottom - top;
+	if (lines == 0 || n <= 0)
+		return;
+	if (lines >= n || -lines >= n) {
+		eraselines(top, n);
+		return;
 	}
+
+	if (lines > 0) {
+		memmove(screen[top], screen[top+lines], (n - lines) * sizeof(screen[0]));
+		eraselines(bottom - lines, lines);
+	} else {
+		memmove(screen[top-lines], screen[top], (n + lines) * sizeof(screen[0]));
+		eraselines(top, -lines);
+	}
+	for (y = top; y < bottom; y++)
+		dirty[y] = 1;
+	needrender = 1;
+
+	/* only one region can be pending, others are just redrawn*/
+	if (scrollpend == 0) {
+		scrollptop = top;
+		scrollpbot = bottom;
+	}
+	if (top == scrollptop && bottom == scrollpbot)
+		scrollpend += lines;
 }
 
-void lineRedraw(void)
+/* force all cells to be redrawn, as after an exposure*/
+void invalidate(void)
 {
-	GrSetGCForeground(gc1,gi.background);
-	GrFillRect(w1, gc1, curx*fonw, cury*fonh, (col-curx)*fonw, fonh);
-	GrSetGCForeground(gc1,gi.foreground);
+	int y;
 
-	if (sbufcnt) {
-		sbuf[sbufcnt] = 0;
-		GrText(w1,gc1, sbufx*fonw, sbufy*fonh, sbuf, sbufcnt, GR_TFTOP);
+	for (y = 0; y < row; y++) {
+		memset(shadow[y], 0, sizeof(shadow[0]));
+		dirty[y] = 1;
 	}
+	scrollpend = 0;
+	needrender = 1;
 }
 
-void sadd(char c)
+/* return msecs until the next screen update is allowed*/
+int framewait(void)
 {
-    if (sbufcnt == LINEBUF)
-		sflush ();
-
-    if (!sbufcnt) { 
-		sbufx = curx; 
-		sbufy = cury; 
-    } 
-    sbuf[sbufcnt++] = c;
+	struct timeval now;
+	long msecs;
+
+	gettimeofday(&now, NULL);
+	msecs = (now.tv_sec - lastframe.tv_sec) * 1000 +
+		(now.tv_usec - lastframe.tv_usec) / 1000;
+	if (msecs < 0 || msecs >= FRAMEMS)
+		return 0;
+	return FRAMEMS - msecs;
+}
+
+/* bring the window up to date with the cell grid*/
+void render(void)
+{
+	int x, y, start, end, n;
+	CELL *cp, *sp;
+	char text[stdcol];
+
+	hide_cursor();
+
+	n = scrollpend;
+	if (n > 0 && n < scrollpbot - scrollptop) {
+		GrCopyArea(w1, gc1, 0, scrollptop*fonh, winw, (scrollpbot-scrollptop-n)*fonh,
+			w1, 0, (scrollptop+n)*fonh, MWROP_COPY);
+		memmove(shadow[scrollptop], shadow[scrollptop+n],
+			(scrollpbot - scrollptop - n) * sizeof(shadow[0]));
+	} else if (n < 0 && -n < scrollpbot - scrollptop) {
+		GrCopyArea(w1, gc1, 0, (scrollptop-n)*fonh, winw, (scrollpbot-scrollptop+n)*fonh,
+			w1, 0, scrollptop*fonh, MWROP_COPY);
+		memmove(shadow[scrollptop-n], shadow[scrollptop],
+			(scrollpbot - scrollptop + n) * sizeof(shadow[0]));
+	}
+	scrollpend = 0;
+
+	for (y = 0; y < row; y++) {
+		if (!dirty[y])
+			continue;
+		dirty[y] = 0;
+		cp = screen[y];
+		sp = shadow[y];
+
+		/* draw each run of changed cells having the same colors*/
+		for (x = 0; x < col; ) {
+			if (cp[x].ch == sp[x].ch && cp[x].fg == sp[x].fg && cp[x].bg == sp[x].bg) {
+				x++;
+				continue;
+			}
+			start = x;
+			end = x;
+			for (x++; x < col && cp[x].fg == cp[start].fg && cp[x].bg == cp[start].bg; x++)
+				if (cp[x].ch != sp[x].ch || cp[x].fg != sp[x].fg || cp[x].bg != sp[x].bg)
+					end = x;
+			x = end + 1;
+			for (n = start; n < x; n++)
+				text[n - start] = cp[n].ch;
+			memcpy(&sp[start], &cp[start], (x - start) * sizeof(CELL));
+
+			if (cp[start].fg != gcfg)
+				GrSetGCForeground(gc1, gcfg = cp[start].fg);
+			if (cp[start].bg != gcbg)
+				GrSetGCBackground(gc1, gcbg = cp[start].bg);
+			GrText(w1, gc1, start*fonw, y*fonh, text, x - start, GR_TFTOP);
+		}
+	}
+
+	needrender = 0;
+	gettimeofday(&lastframe, NULL);
+}
+
+/* set text colors, gc1 is updated when drawn*/
+void setfg(GR_COLOR c)
+{
+	curfg = c;
+}
+
+void setbg(GR_COLOR c)
+{
+	curbg = c;
 }
 
 void show_cursor(void)
 {
 	GrSetGCMode(gc1,GR_MODE_XOR);
 	GrSetGCForeground(gc1, WHITE);
-	GrFillRect(w1, gc1, curx*fonw, cury*fonh+1, fonw, fonh-1);
-	GrSetGCForeground(gc1, gi.foreground);
+	GrFillRect(w1, gc1, cursx*fonw, cursy*fonh+1, fonw, fonh-1);
+	GrSetGCForeground(gc1, gcfg);
 	GrSetGCMode(gc1,GR_MODE_COPY);
 }
 
@@ -214,6 +390,8 @@ void draw_cursor (void)
 	if(curon)
 		if(!curvis) {
 			curvis = 1;
+			cursx = curx;
+			cursy = cury;
 			show_cursor();
 		}
 }
@@ -229,41 +407,25 @@ void hide_cursor (void)
 //VVV
 void vscrollup(int lines)
 {
-    hide_cursor();
-    GrCopyArea(w1, gc1,
-        0, scrolltop*fonh,
-        winw, (scrollbottom-(scrolltop-1)-lines-1)*fonh,
-        w1, 0, (scrolltop+lines)*fonh, MWROP_COPY);
-    GrSetGCForeground(gc1,gi.background);    
-    GrFillRect(w1, gc1, 0, (scrollbottom-lines)*fonh, winw, lines*fonh);
-    GrSetGCForeground(gc1,gi.foreground);    
-
+	scrollregion(scrolltop, scrollbottom, lines);
 }
 
 void vscrolldown(int lines)
 {
-    hide_cursor();
-    //FIXME add for loop
-    GrCopyArea(w1,gc1,
-        0, (scrolltop+lines)*fonh,
-        winw, (scrollbottom-scrolltop-lines)*fonh,
-        w1, 0, scrolltop*fonh, MWROP_COPY);
-    GrSetGCForeground(gc1,gi.background);    
-    GrFillRect(w1, gc1, 0, scrolltop*fonh, winw, lines*fonh);
-    GrSetGCForeground(gc1,gi.foreground);    
+	scrollregion(scrolltop, scrollbottom, -lines);
 }
 
 void esc5(unsigned char c)	/* setting background color */
 {
-    GrSetGCBackground(gc1, c);
-    GrGetGCInfo(gc1,&gi);
+    setbg(c);
+    gi.background = curbg;
     escstate = 0;
 }
 
 void esc4(unsigned char c)	/* setting foreground color */
 {
-    GrSetGCForeground(gc1,c);
-    GrGetGCInfo(gc1,&gi);
+    setfg(c);
+    gi.foreground = curfg;
     escstate = 0;
 }
 
@@ -341,7 +503,7 @@ void esc1(unsigned char c)	/* various control codes */
 		break;
 
     case 'E':/* clear screen & home */
-		GrClearWindow(w1, 0);
+		eraselines(0, row);
 		curx = 0;
 		cury = 0;
 	break;
@@ -360,20 +522,13 @@ void esc1(unsigned char c)	/* various control codes */
 		break;
 
     case 'J':/* erase to end of page */
- 		if (cury < row-1) {
-	    	GrSetGCForeground(gc1,gi.background);
-	    	GrFillRect(w1,gc1, 0,(cury+1)*fonh, winw, (row-1-cury)*fonh);
-	    	GrSetGCForeground(gc1,gi.foreground);
-		}
-		GrSetGCForeground(gc1,gi.background);
- 		GrFillRect(w1, gc1, curx*fonw, cury*fonh, (col-curx)*fonw, fonh);
-		GrSetGCForeground(gc1,gi.foreground);
+ 		if (cury < row-1)
+			eraselines(cury+1, row-1-cury);
+		erase(curx, cury, col-curx);
 		break;
 
     case 'K':/* erase to end of line */
-		GrSetGCForeground(gc1,gi.background);
-		GrFillRect(w1, gc1, curx*fonw, cury*fonh, (col-curx)*fonw, fonh);
-		GrSetGCForeground(gc1,gi.foreground);
+		erase(curx, cury, col-curx);
 		break;
 
     case 'L':/* insert line */
@@ -402,16 +557,10 @@ void esc1(unsigned char c)	/* various control codes */
 
     case 'd':/* erase beginning of display */
 		/* 	w_setmode(win, bgmode); */
- 		if (cury > 0) {
-			GrSetGCForeground(gc1,gi.background);
-			GrFillRect(w1,gc1, 0, 0, winw, cury*fonh);
-			GrSetGCForeground(gc1,gi.foreground);
-		}
- 		if (curx > 0) {
-	    	GrSetGCForeground(gc1,gi.background);
-	    	GrFillRect(w1,gc1, 0, cury*fonh, curx*fonw, fonh);
-	    	GrSetGCForeground(gc1,gi.foreground);
-		}
+ 		if (cury > 0)
+			eraselines(0, cury);
+ 		if (curx > 0)
+			erase(0, cury, curx);
 		break;
 
     case 'e':/* enable cursor */
@@ -433,32 +582,27 @@ void esc1(unsigned char c)	/* various control codes */
 		break;
 
     case 'l':/* erase entire line */
-		GrSetGCForeground(gc1,gi.background);
-		GrFillRect(w1,gc1, 0, cury*fonh, winw, fonh);
-		GrSetGCForeground(gc1,gi.foreground);
+		erase(0, cury, col);
 		curx = 0;
 		break;
 
     case 'o':/* erase beginning of line */
-		if (curx > 0) {
-	    	GrSetGCForeground(gc1,gi.background);
-	    	GrFillRect(w1,gc1,0, cury*fonh, curx*fonw, fonh);
-	    	GrSetGCForeground(gc1,gi.foreground);
-		}
+		if (curx > 0)
+			erase(0, cury, curx);
 		break;
 
     case 'p':/* enter reverse video mode */
 		if(!ReverseMode) {
-	    	GrSetGCForeground(gc1,gi.background);
-	    	GrSetGCBackground(gc1,gi.foreground);
+	    	setfg(gi.background);
+	    	setbg(gi.foreground);
  	    	ReverseMode=1; 
     	}
 		break;
 
     case 'q':/* exit reverse video mode */
 		if(ReverseMode) {
-	    	GrSetGCForeground(gc1,gi.foreground);
-	    	GrSetGCBackground(gc1,gi.background);
+	    	setfg(gi.foreground);
+	    	setbg(gi.background);
  	    	ReverseMode=0;
 		}
 		break;
@@ -542,79 +686,79 @@ void pos_yaxis(int c)	/* cursor position y axis for ansi */
 void rendition(int escvalue) {
 
 		if (escvalue==0) { //reset to default
-    			GrSetGCForeground(gc1, stdforeground);
-    			GrSetGCBackground(gc1, stdbackground);
+    			setfg(stdforeground);
+    			setbg(stdbackground);
 	 	    	ReverseMode=0; 
 		} else if (escvalue==7) { //inverse 
 			if(!ReverseMode) {
-		    	GrSetGCForeground(gc1,gi.background);
-		    	GrSetGCBackground(gc1,gi.foreground);
+		    	setfg(gi.background);
+		    	setbg(gi.foreground);
  	    		ReverseMode=1; 
 	    		}
 		} else if (escvalue==27) { //inverse off
 			if(ReverseMode) {
-		    	GrSetGCForeground(gc1,gi.foreground);
-		    	GrSetGCBackground(gc1,gi.background);
+		    	setfg(gi.foreground);
+		    	setbg(gi.background);
  	    		ReverseMode=0;
 			}
 		} else if ((escvalue>29) && (escvalue<38)){
     		switch(escvalue) {
 		    case 30:
-    			GrSetGCForeground(gc1, BLACK);
+    			setfg(BLACK);
     			break;
 		    case 31:
-    			GrSetGCForeground(gc1, RED);
+    			setfg(RED);
     			break;
 		    case 32:
-    			GrSetGCForeground(gc1, GREEN);
+    			setfg(GREEN);
     			break;
 		    case 33:
-    			GrSetGCForeground(gc1, BROWN);
+    			setfg(BROWN);
     			break;
 		    case 34:
-    			GrSetGCForeground(gc1, BLUE);
+    			setfg(BLUE);
     			break;
 		    case 35:
-    			GrSetGCForeground(gc1, MAGENTA);
+    			setfg(MAGENTA);
     			break;
 		    case 36:
-    			GrSetGCForeground(gc1, CYAN);
+    			setfg(CYAN);
     			break;
 		    case 37:
-    			GrSetGCForeground(gc1, WHITE);
+    			setfg(WHITE);
     			break;
 		    case 39:
-    			GrSetGCForeground(gc1, stdforeground); //default color
+    			setfg(stdforeground); //default color
     			break;
     		}
 		} else if ((escvalue>39) && (escvalue<49)){
     		switch(escvalue) {
 		    case 40:
-    			GrSetGCBackground(gc1, BLACK);
+    			setbg(BLACK);
     			break;
 		    case 41:
-    			GrSetGCBackground(gc1, RED);
+    			setbg(RED);
     			break;
 		    case 42:
-    			GrSetGCBackground(gc1, GREEN);
+    			setbg(GREEN);
     			break;
 		    case 43:
-    			GrSetGCBackground(gc1, BROWN);
+    			setbg(BROWN);
     			break;
 		    case 44:
-    			GrSetGCBackground(gc1, BLUE);
+    			setbg(BLUE);
     			break;
 		    case 45:
-    			GrSetGCBackground(gc1, MAGENTA);
+    			setbg(MAGENTA);
     			break;
 		    case 46:
-    			GrSetGCBackground(gc1, CYAN);
+    			setbg(CYAN);
     			break;
 		    case 47:
-    			GrSetGCBackground(gc1, WHITE);
+    			setbg(WHITE);
     			break;
 		    case 49:
-    			GrSetGCBackground(gc1, stdbackground); //default color
+    			setbg(stdbackground); //default color
     			break;
     		}
 		}
@@ -622,7 +766,6 @@ void rendition(int escvalue) {
 
 void esc100(unsigned char c)	/* various ANSI control codes */
 {
-    int y, yy;
 //leave escstate=10 till done. This states gets this function called.
 
 static int escvalue1,escvalue2,escvalue3;
@@ -776,91 +919,57 @@ scrolltop, scrollbottom = upper and lower scroll region limit in lines/rows
 
     case 'J':
     	if (escvalue1==0) { //erase from current cursor to end of page/scrollbottom
- 		if (cury < scrollbottom-1) { //erase area below current line
-	    	GrSetGCForeground(gc1,gi.background);
-	    	GrFillRect(w1,gc1, 0,(cury+1)*fonh, winw, (scrollbottom-1-cury)*fonh);
-	    	GrSetGCForeground(gc1,gi.foreground);
-		} //erase from cursor to end of line
-		GrSetGCForeground(gc1,gi.background);
- 		GrFillRect(w1, gc1, curx*fonw, cury*fonh, (col-curx)*fonw, fonh);
-		GrSetGCForeground(gc1,gi.foreground);
+ 		if (cury < scrollbottom-1) //erase area below current line
+			eraselines(cury+1, scrollbottom-1-cury);
+		//erase from cursor to end of line
+		erase(curx, cury, col-curx);
 		break;
     	} else if (escvalue1==1) { //erase from home/scrolltop to cursor
- 		if (cury < scrollbottom-1) { //erase area from top to line above current line
-	    	GrSetGCForeground(gc1,gi.background);
-	    	GrFillRect(w1,gc1, 0, scrolltop, winw, (cury+1)*fonh); 
-	    	GrSetGCForeground(gc1,gi.foreground);
-		} //erase from beginning of line to cursor position
-		GrSetGCForeground(gc1,gi.background);
- 		GrFillRect(w1, gc1, 0, cury*fonh, curx*fonw, fonh); 
-		GrSetGCForeground(gc1,gi.foreground);
+ 		if (cury > scrolltop) //erase area from top to line above current line
+			eraselines(scrolltop, cury-scrolltop);
+		//erase from beginning of line to cursor position
+		erase(0, cury, curx);
 		break;
    	} else if (escvalue1==2) { //erase entire page - leave cursor untouched
-		//GrClearWindow(w1, 0);
 		//erase just the scrolling area
-		GrSetGCForeground(gc1,gi.background);
-	    	GrFillRect(w1,gc1, 0, scrolltop, winw, (scrollbottom)*fonh); 
-	    	GrSetGCForeground(gc1,gi.foreground);
+		eraselines(scrolltop, scrollbottom-scrolltop);
 		break;
     	}
 
     case 'K':/* erase to end of line */
     	if (escvalue1==0) { //erase from current cursor to end of line
-		GrSetGCForeground(gc1,gi.background);
-		GrFillRect(w1, gc1, curx*fonw, cury*fonh, (col-curx)*fonw, fonh);
-		GrSetGCForeground(gc1,gi.foreground);
+		erase(curx, cury, col-curx);
 		break;
     	} else if (escvalue1==1) { //erase from beginning of line to cursor
-		GrSetGCForeground(gc1,gi.background);
-		GrFillRect(w1, gc1, 0, cury*fonh, curx*fonw, fonh);
-		GrSetGCForeground(gc1,gi.foreground);
+		erase(0, cury, curx);
 		break;
    	} else if (escvalue1==2) { //erase entire line - leave cursor untouched
-		GrSetGCForeground(gc1,gi.background);
-		GrFillRect(w1, gc1, 0, cury*fonh, winw, fonh);
-		GrSetGCForeground(gc1,gi.foreground);
+		erase(0, cury, col);
 		break;
 	}
 
     case 'P':/* erase number of characters after and including the cursor and move remaining to this position */
 		if (escvalue1==0) escvalue1=1;
-		GrSetGCForeground(gc1,gi.background);
 		//copy remaining chars on line to cursor position
-		GrCopyArea(w1,gc1, curx*fonw, cury*fonh, (col-curx-escvalue1)*fonw, fonh, w1, (curx+escvalue1)*fonw, cury*fonh, MWROP_COPY);
+		if (cury >= 0 && cury < row && curx+escvalue1 < col)
+			memmove(&screen[cury][curx], &screen[cury][curx+escvalue1],
+				(col-curx-escvalue1) * sizeof(CELL));
 		//clear space at end of line
-		GrFillRect(w1, gc1, (col-escvalue1)*fonw, cury*fonh, (escvalue1)*fonw, fonh);
-		GrSetGCForeground(gc1,gi.foreground);
+		erase(col-escvalue1, cury, escvalue1);
 		break;
 
 
     case 'L':/* insert lines */
         if (escvalue1==0) escvalue1=1;
-        y = cury;
-        yy = stdrow - 1;
-        //XXX
-        hide_cursor();
-        //copy from cursor the number of lines down
-        while (--yy >= y) {
-            GrCopyArea(w1,gc1,
-                0, (yy+escvalue1)*fonh,
-                winw-0, fonh,
-                w1, 0, yy*fonh, MWROP_COPY);
-            }
-        //clear number of lines starting at cursor position
-        GrSetGCForeground(gc1,gi.background);
-        GrFillRect(w1, gc1, 0, cury*fonh, winw, escvalue1*fonh);
-        GrSetGCForeground(gc1,gi.foreground);
+        //move lines from cursor down, clearing lines at cursor position
+        scrollregion(cury, scrollbottom, -escvalue1);
         break;
 
     case 'M':/* delete lines */
 
 		if (escvalue1==0) escvalue1=1; 
-		GrCopyArea(w1,gc1, 0, cury*fonh, winw, (scrollbottom-cury-escvalue1)*fonh, w1, 0, (cury+escvalue1)*fonh, MWROP_COPY);
-
-                //clear number of lines starting from scrollbottom up
-    		GrSetGCForeground(gc1,gi.background);
-    		GrFillRect(w1, gc1, 0, (scrollbottom-escvalue1)*fonh, winw, escvalue1*fonh);
-    		GrSetGCForeground(gc1,gi.foreground);
+		//move lines below up, clearing lines from scrollbottom up
+		scrollregion(cury, scrollbottom, escvalue1);
 		break;
 
     case 'S':/* scroll page up number of lines */
@@ -928,7 +1037,8 @@ scrolltop, scrollbottom = upper and lower scroll region limit in lines/rows
 	escvalue1=0;
 	escvalue2=0;
 	escvalue3=0;	
-	GrGetGCInfo(gc1,&gi);
+	gi.foreground = curfg;
+	gi.background = curbg;
 	break;
 
 
@@ -951,12 +1061,15 @@ scrolltop, scrollbottom = upper and lower scroll region limit in lines/rows
 
     case 'h':/* enable private modes - e.g. wrap at end of line */
 		if (escvalue1==7) wrap = 1;
-		if (escvalue1==25) show_cursor();
+		if (escvalue1==25) curon = 1;
 		break;
 
     case 'l':/* disable private modes - e.g. wrap at end of line */
 		if (escvalue1==7) wrap = 0;
-		if (escvalue1==25) hide_cursor();
+		if (escvalue1==25) {
+			curon = 0;
+			hide_cursor();
+		}
 		break;
 
     default: /* unknown escape sequence */
@@ -1007,22 +1120,20 @@ void esc0 (unsigned char c)
 
     case 9: /* tab */
     	{
-		int borg,i;
+		int borg;
 
 		borg = (((curx >> 3) + 1) << 3);
 		if(borg >= col)
 	    	borg = col-1;
-		borg = borg-curx;
-		for(i=0; i < borg; ++i)
+		while (curx < borg) {
 			sadd(' ');
- 		if ((curx = ((curx >> 3) + 1) << 3) >= col) 
- 	    	curx = col - 1; 
+			curx++;
+		}
 		pos_xaxis(curx);
     	}
 		break;
 
     case 10: /* line feed */
-		sflush();
 		if (++cury >= scrollbottom) {
 		//have to scroll before moving cursor, so reduce and add again
 		cury--;
@@ -1036,13 +1147,11 @@ void esc0 (unsigned char c)
 		break;
 
     case 13: /* carriage return */
-		sflush();
 		curx = 0;
 		pos_xaxis(curx);
 		break;
 
     case 27: /* escape */
-		sflush();
 		semicolonflag=0;
 		escstate = 1;
 		break;
@@ -1053,13 +1162,14 @@ void esc0 (unsigned char c)
     default: /* any printable char */
 		sadd(c);
 		if (++curx >= col) {
-	    	sflush();
 	    	if (!wrap) 
 				curx = col-1;
 	    	else {
 				curx = 0;
-				if (++cury >= scrollbottom) 
+				if (++cury >= scrollbottom) {
 		    		vscrollup(1);
+					cury = scrollbottom-1;
+				}
 	    	}
 		}
 		break;
@@ -1078,32 +1188,26 @@ void printc(unsigned char c)
 		break;
 
     case 1:
-		sflush();
 		esc1(c);
 		break;
 
     case 2:
-		sflush();
 		esc2(c);
 		break;
 
     case 3:
-		sflush();
 		esc3(c);
 		break;
 
     case 4:
-		sflush();
 		esc4(c);
 		break;
 
     case 5:
-		sflush();
 		esc5(c);
 		break;
 
     case 10:
-		sflush();
 		esc100(c);
 		break;
 
@@ -1122,6 +1226,7 @@ void init(void)
     curon = 1;
     curvis = 0;
     escstate = 0;
+    eraselines(0, row);
 }
 
 
@@ -1133,7 +1238,7 @@ term(void)
 {
 	long 		in, l;
 	GR_EVENT_KEYSTROKE *kp;
-	int		bufflen;
+	int		bufflen, wait;
 	int		gotexpose = 0;
 	GR_EVENT 	wevent;
 	unsigned char 	buf[KBDBUF];
@@ -1144,10 +1249,20 @@ term(void)
 	}
 
 	while (42) {
-		if (havefocus)
+		/* update the window once per frame interval while output is pending*/
+		wait = 0;
+		if (needrender && (wait = framewait()) == 0)
+			render();
+		if (havefocus && !needrender) {
+			if (cursx != curx || cursy != cury)
+				hide_cursor();
 			draw_cursor();
+		}
 
-		GrGetNextEvent(&wevent);
+		if (needrender)
+			GrGetNextEventTimeout(&wevent, wait);
+		else
+			GrGetNextEvent(&wevent);
 
 		switch(wevent.type) {
 		case GR_EVENT_TYPE_CLOSE_REQ:
@@ -1195,16 +1310,19 @@ term(void)
 				GrRegisterInput(termfd);
 				gotexpose = GR_TRUE;
 			}
+			curvis = 0;		/* cursor is redrawn with the cells*/
+			invalidate();
 			break;
 
 		case GR_EVENT_TYPE_FDINPUT:
 			if (!gotexpose) break;	/* wait until mapped before reading */
-			hide_cursor();
 			while ((in = read(termfd, buf, sizeof(buf))) > 0) {
 				for (l=0; l<in; l++) {
 					printc(buf[l]); 
 				}
-				sflush();
+				/* stop reading when a frame is due, the rest is read next event*/
+				if (needrender && framewait() == 0)
+					break;
 			}
 			break;
 		case GR_EVENT_TYPE_NONE:
@@ -1619,6 +1737,7 @@ int main(int argc, char **argv)
     char *shell = NULL, *cptr;
     GR_CURSOR_ID c1;
     char thesh[128];
+    char numbuf[16];
     GR_BITMAP	bitmap1fg[7];	/* mouse cursor */
     GR_BITMAP	bitmap1bg[7];
 
@@ -1739,6 +1858,8 @@ int main(int argc, char **argv)
     GrSetGCBackground(gc1, stdbackground);
     GrGetWindowInfo(w1,&wi);
     GrGetGCInfo(gc1,&gi);
+    curfg = gcfg = gi.foreground;
+    curbg = gcbg = gi.background;
 
 #if UNIX && !ELKS
     /* set TERM and TERMCAP for vt52 only - default is ANSI or "linux" */
@@ -1760,10 +1881,10 @@ int main(int argc, char **argv)
      * and everything seems to work correctly...). Unlike putenv(),
      * setenv() allocates also the given string not just a pointer.
      */
-    sprintf(sbuf, "%d", col);
-    setenv("COLUMNS", sbuf, 1);
-    sprintf(sbuf, "%d", row);
-    setenv("LINES", sbuf, 1);
+    sprintf(numbuf, "%d", col);
+    setenv("COLUMNS", numbuf, 1);
+    sprintf(numbuf, "%d", row);
+    setenv("LINES", numbuf, 1);
 #endif
 
     termfd = term_init();       /* create pty */
@@ -1894,7 +2015,7 @@ again:
 
 #elif defined(__FreeBSD)
 #include <libutil.h>
-static char pty[LINEBUF];
+static char pty[80];
 static struct winsize winsz;
 
 term_init(void)
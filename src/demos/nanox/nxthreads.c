@@ -0,0 +1,260 @@
+/*
+ * nxthreads - multithreaded pixmap rendering benchmark
+ *
+ * Each thread draws rectangles, lines, ellipses and polygons into its own
+ * pixmap with its own GC.  The test is run with 1, 2, 4 ... threads up to
+ * the given count, printing total drawing calls per second and the speedup
+ * over one thread:
+ *	threads  ops  secs  ops/s  speedup
+ *
+ * With -s all threads share one pixmap and one GC, and also draw text,
+ * stippled fills, copies within the pixmap and read it back, mixing
+ * drawing that runs with only the pixmap lock with drawing under the
+ * server lock, for checking locking with a thread sanitizer.
+ *
+ * Built with LINK_APP_INTO_SERVER=Y and THREADSAFE=Y, drawing into
+ * pixmaps holds only the pixmap's lock, so threads render in parallel.
+ * Otherwise all drawing is serialized through the server and the
+ * results show the locking overhead.  The pixmaps are then shown in a
+ * window, until closed or with -q exit immediately.
+ *
+ * Usage: nxthreads [-q] [-s] [-n threads] [-t seconds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#define MWINCLUDECOLORS
+#include "nano-X.h"
+
+#define MAXTHREADS	16
+#define PIXSIZE		256		/* pixmap width and height*/
+#define TILES		4		/* pixmaps shown per window row*/
+
+typedef struct {
+	pthread_t	thread;
+	GR_WINDOW_ID pixmap;
+	GR_GC_ID	gc;
+	unsigned int seed;
+	long		ops;			/* drawing calls made*/
+} WORKER;
+
+static WORKER workers[MAXTHREADS];
+static int shared;					/* all threads use workers[0] pixmap and GC*/
+static int stop;					/* set by main thread, protected by stoplock*/
+static pthread_mutex_t stoplock = PTHREAD_MUTEX_INITIALIZER;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+setstop(int value)
+{
+	pthread_mutex_lock(&stoplock);
+	stop = value;
+	pthread_mutex_unlock(&stoplock);
+}
+
+static int
+stopped(void)
+{
+	int value;
+
+	pthread_mutex_lock(&stoplock);
+	value = stop;
+	pthread_mutex_unlock(&stoplock);
+	return value;
+}
+
+/* draw with the server lock into the shared pixmap, changing the shared GC*/
+static void
+drawshared(WORKER *w, int x, int y, int s)
+{
+	GR_BITMAP stipple[8];
+	GR_PIXELVAL pixels[16 * 16];
+	int i;
+
+	switch (rand_r(&w->seed) & 3) {
+	case 0:
+		GrText(w->pixmap, w->gc, x, y, "nxthreads", -1, GR_TFASCII | GR_TFBASELINE);
+		break;
+	case 1:
+		GrCopyArea(w->pixmap, w->gc, x, y, s, s, w->pixmap,
+			rand_r(&w->seed) % PIXSIZE, rand_r(&w->seed) % PIXSIZE, MWROP_COPY);
+		break;
+	case 2:
+		for (i = 0; i < 8; i++)
+			stipple[i] = rand_r(&w->seed) << 8;
+		GrSetGCStipple(w->gc, stipple, 8, 8);
+		GrSetGCFillMode(w->gc, GR_FILL_STIPPLE);
+		GrFillRect(w->pixmap, w->gc, x, y, s, s);
+		GrSetGCFillMode(w->gc, GR_FILL_SOLID);
+		break;
+	case 3:
+		GrReadArea(w->pixmap, x, y, 16, 16, pixels);
+		break;
+	}
+}
+
+/* draw random primitives into this thread's pixmap until stopped*/
+static void *
+render(void *arg)
+{
+	WORKER *w = arg;
+	GR_POINT pts[3];
+	int i, x, y, s;
+
+	while (!stopped()) {
+		for (i = 0; i < 16; i++) {
+			x = rand_r(&w->seed) % PIXSIZE;
+			y = rand_r(&w->seed) % PIXSIZE;
+			s = rand_r(&w->seed) % 64 + 1;
+			GrSetGCForeground(w->gc, MWARGB(255, rand_r(&w->seed) & 255,
+				rand_r(&w->seed) & 255, rand_r(&w->seed) & 255));
+			switch (i & 3) {
+			case 0:
+				GrFillRect(w->pixmap, w->gc, x - s/2, y - s/2, s, s);
+				break;
+			case 1:
+				GrLine(w->pixmap, w->gc, x, y, x + s, y + s/2);
+				break;
+			case 2:
+				GrFillEllipse(w->pixmap, w->gc, x, y, s/2, s/3 + 1);
+				break;
+			case 3:
+				pts[0].x = x; pts[0].y = y;
+				pts[1].x = x + s; pts[1].y = y + s/2;
+				pts[2].x = x + s/3; pts[2].y = y + s;
+				GrFillPoly(w->pixmap, w->gc, 3, pts);
+				break;
+			}
+			if (shared)
+				drawshared(w, x, y, s);
+		}
+		w->ops += shared? 32: 16;
+	}
+	return NULL;
+}
+
+/* run the test with n threads, returning ops per second*/
+static double
+runtest(int n, double duration)
+{
+	double start, secs;
+	long ops = 0;
+	int i;
+
+	setstop(0);
+	for (i = 0; i < n; i++) {
+		workers[i].ops = 0;
+		if (pthread_create(&workers[i].thread, NULL, render, &workers[i]) != 0) {
+			fprintf(stderr, "nxthreads: can't create thread\n");
+			exit(1);
+		}
+	}
+	start = now();
+	while (now() - start < duration)
+		usleep(10000);		/* GrDelay would hold the server lock*/
+	setstop(1);
+	for (i = 0; i < n; i++) {
+		pthread_join(workers[i].thread, NULL);
+		ops += workers[i].ops;
+	}
+	GrFlush();
+	secs = now() - start;
+	return ops / secs;
+}
+
+int
+main(int ac, char **av)
+{
+	GR_WINDOW_ID wid;
+	GR_GC_ID gc;
+	GR_EVENT event;
+	double duration = 1.0;
+	double rate, base = 0;
+	int nthreads = 4;
+	int quit = 0;
+	int i, n, npixmaps;
+
+	while (ac > 1 && av[1][0] == '-') {
+		if (av[1][1] == 'q')
+			quit = 1;
+		else if (av[1][1] == 's')
+			shared = 1;
+		else if (av[1][1] == 'n' && ac > 2) {
+			nthreads = atoi(av[2]);
+			++av; --ac;
+		} else if (av[1][1] == 't' && ac > 2) {
+			duration = atof(av[2]);
+			++av; --ac;
+		} else {
+			fprintf(stderr, "Usage: nxthreads [-q] [-s] [-n threads] [-t seconds]\n");
+			return 1;
+		}
+		++av; --ac;
+	}
+	nthreads = MWMAX(1, MWMIN(nthreads, MAXTHREADS));
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "nxthreads: cannot open graphics\n");
+		return 1;
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		workers[i].seed = i + 1;
+		if (shared && i > 0) {
+			workers[i].pixmap = workers[0].pixmap;
+			workers[i].gc = workers[0].gc;
+			continue;
+		}
+		workers[i].pixmap = GrNewPixmap(PIXSIZE, PIXSIZE, NULL);
+		workers[i].gc = GrNewGC();
+		GrFillRect(workers[i].pixmap, workers[i].gc, 0, 0, PIXSIZE, PIXSIZE);
+	}
+	npixmaps = shared? 1: nthreads;
+
+	printf("# threads ops secs ops/s speedup\n");
+	for (n = 1; ; n = MWMIN(n * 2, nthreads)) {
+		rate = runtest(n, duration);
+		if (n == 1)
+			base = rate;
+		printf("%d %ld %.2f %.0f %.2f\n", n, (long)(rate * duration), duration,
+			rate, rate / base);
+		fflush(stdout);
+		if (n == nthreads)
+			break;
+	}
+
+	if (!quit) {
+		wid = GrNewWindowEx(GR_WM_PROPS_APPWINDOW, "nxthreads", GR_ROOT_WINDOW_ID,
+			0, 0, MWMIN(npixmaps, TILES) * PIXSIZE,
+			(npixmaps + TILES - 1) / TILES * PIXSIZE, BLACK);
+		GrSelectEvents(wid, GR_EVENT_MASK_EXPOSURE | GR_EVENT_MASK_CLOSE_REQ);
+		GrMapWindow(wid);
+		gc = GrNewGC();
+		for (;;) {
+			GrGetNextEvent(&event);
+			if (event.type == GR_EVENT_TYPE_CLOSE_REQ)
+				break;
+			if (event.type == GR_EVENT_TYPE_EXPOSURE)
+				for (i = 0; i < npixmaps; i++)
+					GrCopyArea(wid, gc, i % TILES * PIXSIZE, i / TILES * PIXSIZE,
+						PIXSIZE, PIXSIZE, workers[i].pixmap, 0, 0, MWROP_COPY);
+		}
+	}
+
+	for (i = 0; i < npixmaps; i++) {
+		GrDestroyGC(workers[i].gc);
+		GrDestroyWindow(workers[i].pixmap);
+	}
+	GrClose();
+	return 0;
+}
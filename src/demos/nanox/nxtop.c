@@ -0,0 +1,180 @@
+/*
+ * nxtop - display nano-X server request profile, like top(1)
+ *
+ * Shows the request types and clients using the most server time
+ * over each interval.  Requires the server be built with NANOXPROFILE=Y.
+ *
+ * Usage: nxtop [-1] [-n lines] [interval]
+ *	-1	print totals since server start once and exit
+ *	-n	number of request types to show (default 20)
+ *	interval seconds between updates (default 2)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "nano-X.h"
+
+#define MAXREQS		256		/* max request types*/
+#define MAXCLIENTS	64		/* max clients shown*/
+
+typedef struct {
+	int		type;
+	GR_REQUEST_PROFILE prof;	/* current totals*/
+	uint32_t count;			/* counts since last update*/
+	uint64_t bytes;
+	uint64_t ns;
+} REQ;
+
+static REQ reqs[MAXREQS];
+static REQ *sorted[MAXREQS];
+static int numreqs;
+
+/* sort by time used, then by count*/
+static int
+cmpreq(const void *a, const void *b)
+{
+	REQ *ra = *(REQ **)a;
+	REQ *rb = *(REQ **)b;
+
+	if (ra->ns != rb->ns)
+		return ra->ns < rb->ns? 1: -1;
+	if (ra->count != rb->count)
+		return ra->count < rb->count? 1: -1;
+	return ra->type - rb->type;
+}
+
+/* read all request profiles, computing deltas from last read*/
+static int
+readreqs(void)
+{
+	GR_REQUEST_PROFILE prof;
+	int i;
+
+	for (i = 0; i < MAXREQS; i++) {
+		if (!GrGetRequestProfile(i, &prof))
+			break;
+		reqs[i].type = i;
+		reqs[i].count = prof.count - reqs[i].prof.count;
+		reqs[i].bytes = prof.bytes - reqs[i].prof.bytes;
+		reqs[i].ns = prof.totalns - reqs[i].prof.totalns;
+		reqs[i].prof = prof;
+		sorted[i] = &reqs[i];
+	}
+	numreqs = i;
+	return i;
+}
+
+/* return approximate latency in us below which pct percent of requests completed*/
+static unsigned long
+percentile(GR_REQUEST_PROFILE *prof, int pct)
+{
+	uint32_t n = 0;
+	uint32_t want = ((uint64_t)prof->count * pct + 99) / 100;
+	int i;
+
+	for (i = 0; i < GR_PROFILE_BUCKETS-1; i++) {
+		n += prof->hist[i];
+		if (n >= want)
+			break;
+	}
+	return 1UL << i;
+}
+
+static void
+display(int lines, double interval, int once)
+{
+	GR_CLIENT_PROFILE cprof;
+	uint64_t totalns = 0;
+	uint32_t totalcount = 0;
+	int i;
+
+	qsort(sorted, numreqs, sizeof(REQ *), cmpreq);
+	for (i = 0; i < numreqs; i++) {
+		totalns += sorted[i]->ns;
+		totalcount += sorted[i]->count;
+	}
+
+	if (!once)
+		printf("\033[H\033[J");		/* home cursor and clear screen*/
+	if (once)
+		printf("nano-X totals since server start: %lu requests, %.1f ms\n\n",
+			(unsigned long)totalcount, totalns / 1e6);
+	else printf("nano-X: %.0f requests/s, server busy %.1f%%\n\n",
+			totalcount / interval, totalns / 1e7 / interval);
+
+	printf("%-28s %9s %9s %8s %8s %7s %7s %6s\n", "REQUEST",
+		once? "COUNT": "REQ/S", once? "KBYTES": "KB/S",
+		"AVG us", "MAX us", "p50 <us", "p99 <us", "%TIME");
+	for (i = 0; i < numreqs && i < lines; i++) {
+		REQ *rp = sorted[i];
+
+		if (!rp->count)
+			break;
+		printf("%-28.28s %9.0f %9.1f %8.1f %8.1f %7lu %7lu %5.1f%%\n",
+			rp->prof.name,
+			once? (double)rp->count: rp->count / interval,
+			once? rp->bytes / 1024.0: rp->bytes / 1024.0 / interval,
+			rp->ns / 1000.0 / rp->count,
+			rp->prof.maxns / 1000.0,
+			percentile(&rp->prof, 50), percentile(&rp->prof, 99),
+			totalns? rp->ns * 100.0 / totalns: 0.0);
+	}
+
+	printf("\n%-8s %8s %12s %12s %12s\n", "CLIENT", "PID", "REQUESTS", "KBYTES", "TIME ms");
+	for (i = 0; i < MAXCLIENTS; i++) {
+		if (!GrGetClientProfile(i, &cprof))
+			break;
+		printf("%-8d %8d %12lu %12.1f %12.1f\n", cprof.id, cprof.processid,
+			(unsigned long)cprof.count, cprof.bytes / 1024.0, cprof.totalns / 1e6);
+	}
+	fflush(stdout);
+}
+
+int
+main(int ac, char **av)
+{
+	int once = 0;
+	int lines = 20;
+	double interval = 2;
+
+	while (ac > 1 && av[1][0] == '-') {
+		if (av[1][1] == '1')
+			once = 1;
+		else if (av[1][1] == 'n' && ac > 2) {
+			lines = atoi(av[2]);
+			++av; --ac;
+		} else {
+			fprintf(stderr, "Usage: nxtop [-1] [-n lines] [interval]\n");
+			return 1;
+		}
+		++av; --ac;
+	}
+	if (ac > 1)
+		interval = atof(av[1]);
+	if (interval <= 0)
+		interval = 2;
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "nxtop: cannot open graphics\n");
+		return 1;
+	}
+
+	if (!readreqs()) {
+		fprintf(stderr, "nxtop: server not built with request profiling (NANOXPROFILE=Y)\n");
+		GrClose();
+		return 1;
+	}
+
+	if (once) {
+		display(lines, interval, once);
+		GrClose();
+		return 0;
+	}
+
+	for (;;) {
+		usleep(interval * 1000000);
+		readreqs();
+		display(lines, interval, once);
+	}
+}
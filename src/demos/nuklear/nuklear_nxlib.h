@@ -92,8 +92,6 @@ GR_TIMEOUT nk_nxlib_timeout;
 #define NK_NANOX_DOUBLE_CLICK_HI 200
 #endif
 
-#define GrSetGCLineAttributesEx(gc, thickness, line_type, cap_type, join_type)	/* not implemented yet*/
-
 struct NXFont {
 	GR_FONT_ID fontid;
     GR_GC_ID gc;
@@ -162,90 +160,10 @@ nk_nxsurf_stroke_line(NXSurface *surf, short x0, short y0, short x1,
 {
     unsigned long c = nk_color_from_byte(&col.r);
     GrSetGCForeground(surf->gc, c);
-    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINESOLID, GR_CAPBUTT, GR_JOINMITER);
+    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINE_SOLID, GR_CAP_BUTT, GR_JOIN_MITER);
     GrLine(surf->wid, surf->gc, (int)x0, (int)y0, (int)x1, (int)y1);
 }
 
-/*
- * X11 compatible DrawArc and FillArc translation routine
- * X11 angle1=start, angle2=distance (negative=clockwise)
- */
-NK_INTERN void
-GrDrawArcPie(GR_DRAW_ID d, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height,
-	GR_COORD angle1, GR_COORD angle2, int mode)
-{
-	GR_SIZE rx, ry;
-	GR_COORD startAngle, endAngle;
-	const GR_COORD FULLCIRCLE = 360 * 64;
-
-	/* don't draw anything if no arc requested*/
-	if (angle2 == 0)
-		return;
-
-#if 0
-	/*
-	 * Convert X11 width/height to Nano-X radius required
-	 * for arc drawing.
-	 * This causes problems when width is even, so we
-	 * punt for the time being.  This causes smaller
-	 * arcs to be drawn than required, but always within
-	 * the width/height bounding box.
-	 */
-	if (!(width & 1))
-		--width;
-	if (!(height & 1))
-		--height;
-#endif
-	rx = width / 2;
-	ry = height / 2;
-	/*
-	 * Convert X11 start/distance angles to Nano-X start/end angles.
-	 */
-	if (angle1 == 0 && angle2 >= FULLCIRCLE) {
-		startAngle = 0;
-		endAngle = 0;
-	} else {
-		if (angle2 > FULLCIRCLE)
-			angle2 = FULLCIRCLE;
-		else if (angle2 < -FULLCIRCLE)
-			angle2 = -FULLCIRCLE;
-		if (angle2 < 0) {
-			startAngle = angle1 + angle2;
-			endAngle = angle1;
-		} else {
-			startAngle = angle1;
-			endAngle = angle1 + angle2;
-		}
-		if (startAngle < 0)
-			startAngle = FULLCIRCLE - (-startAngle) % FULLCIRCLE;
-		if (startAngle >= FULLCIRCLE)
-			startAngle = startAngle % FULLCIRCLE;
-		if (endAngle < 0)
-			endAngle = FULLCIRCLE - (-endAngle) % FULLCIRCLE;
-		if (endAngle >= FULLCIRCLE)
-			endAngle = endAngle % FULLCIRCLE;
-	}
-	GrArcAngle(d, gc, x+rx, y+ry, rx, ry, startAngle, endAngle, mode);
-}
-
-/* X11 compatible DrawArc*/
-NK_INTERN void
-GrDrawArc(GR_DRAW_ID d, GR_GC_ID gc, GR_COORD x, GR_COORD y,
-	GR_SIZE width, GR_SIZE height, GR_COORD angle1, GR_COORD angle2)
-{
-	/* X11 width/height is one less than Nano-X width/height*/
-	GrDrawArcPie(d, gc, x, y, width+1, height+1, angle1, angle2, GR_ARC);
-}
-
-/* X11 compatible FillArc*/
-NK_INTERN void
-GrFillArc(GR_DRAW_ID d, GR_GC_ID gc, GR_COORD x, GR_COORD y,
-	GR_SIZE width, GR_SIZE height, GR_COORD angle1, GR_COORD angle2)
-{
-	/* X11 width/height is one less than Nano-X width/height*/
-	GrDrawArcPie(d, gc, x, y, width+1, height+1, angle1, angle2, GR_PIE);
-}
-
 NK_INTERN void
 nk_nxsurf_stroke_rect(NXSurface* surf, short x, short y, unsigned short w,
     unsigned short h, unsigned short r, unsigned short line_thickness, struct nk_color col)
@@ -253,30 +171,10 @@ nk_nxsurf_stroke_rect(NXSurface* surf, short x, short y, unsigned short w,
     unsigned long c = nk_color_from_byte(&col.r);
 
     GrSetGCForeground(surf->gc, c);
-    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINESOLID, GR_CAPBUTT, GR_JOINMITER);
-    if (r == 0) {
+    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINE_SOLID, GR_CAP_BUTT, GR_JOIN_MITER);
+    if (r == 0)
 		GrRect(surf->wid, surf->gc, x, y, w+1, h+1);	/* FIXME note +1 for width/height*/
-		return;
-	}
-
-    {short xc = x + r;
-    short yc = y + r;
-    short wc = (short)(w - 2 * r);
-    short hc = (short)(h - 2 * r);
-
-    GrLine(surf->wid, surf->gc, xc, y, xc+wc, y);
-    GrLine(surf->wid, surf->gc, x+w, yc, x+w, yc+hc);
-    GrLine(surf->wid, surf->gc, xc, y+h, xc+wc, y+h);
-    GrLine(surf->wid, surf->gc, x, yc, x, yc+hc);
-
-    GrDrawArc(surf->wid, surf->gc, xc + wc - r, y,
-        (unsigned)r*2, (unsigned)r*2, 0 * 64, 90 * 64);
-    GrDrawArc(surf->wid, surf->gc, x, y,
-        (unsigned)r*2, (unsigned)r*2, 90 * 64, 90 * 64);
-    GrDrawArc(surf->wid, surf->gc, x, yc + hc - r,
-        (unsigned)r*2, (unsigned)2*r, 180 * 64, 90 * 64);
-    GrDrawArc(surf->wid, surf->gc, xc + wc - r, yc + hc - r,
-        (unsigned)r*2, (unsigned)2*r, -90 * 64, 90 * 64);}
+	else GrRoundRect(surf->wid, surf->gc, x, y, w+1, h+1, r, r);
 }
 
 NK_INTERN void
@@ -288,54 +186,9 @@ nk_nxsurf_fill_rect(NXSurface* surf, short x, short y, unsigned short w,
 
 	w--, h--;			/* required for exact roundrect fill*/
 
-    if (r == 0) {
+    if (r == 0)
 		GrFillRect(surf->wid, surf->gc, x, y, w, h);
-		return;
-	}
-
-    {short xc = x + r;
-    short yc = y + r;
-    short wc = (short)(w - 2 * r);
-    short hc = (short)(h - 2 * r);
-
-    GR_POINT pnts[12];
-    pnts[0].x = x;
-    pnts[0].y = yc;
-    pnts[1].x = xc;
-    pnts[1].y = yc;
-    pnts[2].x = xc;
-    pnts[2].y = y;
-
-    pnts[3].x = xc + wc;
-    pnts[3].y = y;
-    pnts[4].x = xc + wc;
-    pnts[4].y = yc;
-    pnts[5].x = x + w;
-    pnts[5].y = yc;
-
-    pnts[6].x = x + w;
-    pnts[6].y = yc + hc;
-    pnts[7].x = xc + wc;
-    pnts[7].y = yc + hc;
-    pnts[8].x = xc + wc;
-    pnts[8].y = y + h;
-
-    pnts[9].x = xc;
-    pnts[9].y = y + h;
-    pnts[10].x = xc;
-    pnts[10].y = yc + hc;
-    pnts[11].x = x;
-    pnts[11].y = yc + hc;
-
-    GrFillPoly(surf->wid, surf->gc, 12, pnts);
-    GrFillArc(surf->wid, surf->gc, xc + wc - r, y,
-        (unsigned)r*2, (unsigned)r*2, 0 * 64, 90 * 64);
-    GrFillArc(surf->wid, surf->gc, x, y,
-        (unsigned)r*2, (unsigned)r*2, 90 * 64, 90 * 64);
-    GrFillArc(surf->wid, surf->gc, x, yc + hc - r,
-        (unsigned)r*2, (unsigned)2*r, 180 * 64, 90 * 64);
-    GrFillArc(surf->wid, surf->gc, xc + wc - r, yc + hc - r,
-        (unsigned)r*2, (unsigned)2*r, -90 * 64, 90 * 64);}
+	else GrFillRoundRect(surf->wid, surf->gc, x, y, w, h, r, r);
 }
 
 NK_INTERN void
@@ -359,13 +212,19 @@ NK_INTERN void
 nk_nxsurf_stroke_triangle(NXSurface *surf, short x0, short y0, short x1,
     short y1, short x2, short y2, unsigned short line_thickness, struct nk_color col)
 {
+    GR_POINT pnts[4];
     unsigned long c = nk_color_from_byte(&col.r);
 
+    pnts[0].x = x0;
+    pnts[0].y = y0;
+    pnts[1].x = x1;
+    pnts[1].y = y1;
+    pnts[2].x = x2;
+    pnts[2].y = y2;
+    pnts[3] = pnts[0];		/* closed, so wide lines are joined at every corner*/
     GrSetGCForeground(surf->gc, c);
-    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINESOLID, GR_CAPBUTT, GR_JOINMITER);
-    GrLine(surf->wid, surf->gc, x0, y0, x1, y1);
-    GrLine(surf->wid, surf->gc, x1, y1, x2, y2);
-    GrLine(surf->wid, surf->gc, x2, y2, x0, y0);
+    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINE_SOLID, GR_CAP_BUTT, GR_JOIN_MITER);
+    GrPolyLine(surf->wid, surf->gc, 4, pnts);
 }
 
 NK_INTERN void
@@ -391,13 +250,21 @@ nk_nxsurf_stroke_polygon(NXSurface *surf, const struct nk_vec2i *pnts, int count
     unsigned short line_thickness, struct nk_color col)
 {
     int i = 0;
+    #define MAX_POINTS 128
+    GR_POINT xpnts[MAX_POINTS+1];
     unsigned long c = nk_color_from_byte(&col.r);
 
+    if (count > MAX_POINTS)
+        count = MAX_POINTS;
+    for (i = 0; i < count; ++i) {
+        xpnts[i].x = pnts[i].x;
+        xpnts[i].y = pnts[i].y;
+    }
+    xpnts[count++] = xpnts[0];	/* closed, so wide lines are joined at every corner*/
     GrSetGCForeground(surf->gc, c);
-    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINESOLID, GR_CAPBUTT, GR_JOINMITER);
-    for (i = 1; i < count; ++i)
-        GrLine(surf->wid, surf->gc, pnts[i-1].x, pnts[i-1].y, pnts[i].x, pnts[i].y);
-    GrLine(surf->wid, surf->gc, pnts[count-1].x, pnts[count-1].y, pnts[0].x, pnts[0].y);
+    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINE_SOLID, GR_CAP_BUTT, GR_JOIN_MITER);
+    GrPolyLine(surf->wid, surf->gc, count, xpnts);
+    #undef MAX_POINTS
 }
 
 NK_INTERN void
@@ -405,12 +272,20 @@ nk_nxsurf_stroke_polyline(NXSurface *surf, const struct nk_vec2i *pnts,
     int count, unsigned short line_thickness, struct nk_color col)
 {
     int i = 0;
+    #define MAX_POINTS 128
+    GR_POINT xpnts[MAX_POINTS];
     unsigned long c = nk_color_from_byte(&col.r);
 
-    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINESOLID, GR_CAPBUTT, GR_JOINMITER);
+    if (count > MAX_POINTS)
+        count = MAX_POINTS;
+    for (i = 0; i < count; ++i) {
+        xpnts[i].x = pnts[i].x;
+        xpnts[i].y = pnts[i].y;
+    }
+    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINE_SOLID, GR_CAP_BUTT, GR_JOIN_MITER);
     GrSetGCForeground(surf->gc, c);
-    for (i = 0; i < count-1; ++i)
-        GrLine(surf->wid, surf->gc, pnts[i].x, pnts[i].y, pnts[i+1].x, pnts[i+1].y);
+    GrPolyLine(surf->wid, surf->gc, count, xpnts);
+    #undef MAX_POINTS
 }
 
 NK_INTERN void
@@ -434,8 +309,32 @@ nk_nxsurf_stroke_circle(NXSurface *surf, short x, short y, unsigned short w,
 	int ry = h/2 - 1;
 
     GrSetGCForeground(surf->gc, c);
-    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINESOLID, GR_CAPBUTT, GR_JOINMITER);
-	GrEllipse(surf->wid, surf->gc, x+rx, y+ry, rx, ry);
+    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINE_SOLID, GR_CAP_BUTT, GR_JOIN_MITER);
+    if (line_thickness <= 1) {
+		GrEllipse(surf->wid, surf->gc, x+rx, y+ry, rx, ry);
+		return;
+	}
+
+	/* GrEllipse ignores line width, so draw wide circles as a closed polyline*/
+    {
+    #define CIRCLE_SEGMENTS 32
+    const float cosd = 0.98078528f;		/* cos(2pi/CIRCLE_SEGMENTS)*/
+    const float sind = 0.19509032f;		/* sin(2pi/CIRCLE_SEGMENTS)*/
+    GR_POINT pnts[CIRCLE_SEGMENTS+1];
+    float cx = 1.0f, sx = 0.0f, t;
+    int i;
+
+    for (i = 0; i < CIRCLE_SEGMENTS; ++i) {
+        pnts[i].x = (GR_COORD)(x + rx + rx * cx + 0.5f);
+        pnts[i].y = (GR_COORD)(y + ry + ry * sx + 0.5f);
+        t = cx * cosd - sx * sind;
+        sx = sx * cosd + cx * sind;
+        cx = t;
+    }
+    pnts[CIRCLE_SEGMENTS] = pnts[0];
+    GrPolyLine(surf->wid, surf->gc, CIRCLE_SEGMENTS+1, pnts);
+    #undef CIRCLE_SEGMENTS
+    }
 }
 
 NK_INTERN void
@@ -445,11 +344,14 @@ nk_nxsurf_stroke_curve(NXSurface *surf, struct nk_vec2i p1,
 {
     unsigned int i_step;
     float t_step;
-    struct nk_vec2i last = p1;
+    #define MAX_SEGMENTS 64
+    GR_POINT pnts[MAX_SEGMENTS+1];
+    unsigned long c = nk_color_from_byte(&col.r);
 
-    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINESOLID, GR_CAPBUTT, GR_JOINMITER);
-    num_segments = NK_MAX(num_segments, 1);
+    num_segments = NK_CLAMP(1, num_segments, MAX_SEGMENTS);
     t_step = 1.0f/(float)num_segments;
+    pnts[0].x = p1.x;
+    pnts[0].y = p1.y;
     for (i_step = 1; i_step <= num_segments; ++i_step) {
         float t = t_step * (float)i_step;
         float u = 1.0f - t;
@@ -459,9 +361,15 @@ nk_nxsurf_stroke_curve(NXSurface *surf, struct nk_vec2i p1,
         float w4 = t * t *t;
         float x = w1 * p1.x + w2 * p2.x + w3 * p3.x + w4 * p4.x;
         float y = w1 * p1.y + w2 * p2.y + w3 * p3.y + w4 * p4.y;
-        nk_nxsurf_stroke_line(surf, last.x, last.y, (short)x, (short)y, line_thickness,col);
-        last.x = (short)x; last.y = (short)y;
+        pnts[i_step].x = (short)x;
+        pnts[i_step].y = (short)y;
     }
+
+    /* one polyline, so wide curves are joined between segments*/
+    GrSetGCForeground(surf->gc, c);
+    GrSetGCLineAttributesEx(surf->gc, line_thickness, GR_LINE_SOLID, GR_CAP_BUTT, GR_JOIN_ROUND);
+    GrPolyLine(surf->wid, surf->gc, num_segments+1, pnts);
+    #undef MAX_SEGMENTS
 }
 
 NK_INTERN void
@@ -208,9 +208,6 @@ static inline int applyOpR(int op, unsigned char src, unsigned char dst)	\
 	}					\
 }
 
-/* global vars*/
-extern int 	gr_mode;	/* temp kluge*/
-
 /* entry points*/
 /* scr_fb.c*/
 void ioctl_getpalette(int start, int len, short *red, short *green,short *blue);
@@ -21,10 +21,19 @@ GdCreatePixmap(PSD rootpsd, MWCOORD width, MWCOORD height, MWIMGDATFMT format, v
 	int 	bpp, planes, pixtype;
     MWIMGDATFMT data_format;
 	unsigned int size, pitch;
+#if MW_FEATURE_IMAGES && MW_FEATURE_ASYNCIMAGES
+	PSD		asyncpsd;
+#endif
    
 	if (width <= 0 || height <= 0)
 		return NULL;
 
+#if MW_FEATURE_IMAGES && MW_FEATURE_ASYNCIMAGES
+	/* image decode threads copy the screen device saved when the image was queued*/
+	if (rootpsd == &scrdev && (asyncpsd = GdGetAsyncImageScreen()) != NULL)
+		rootpsd = asyncpsd;
+#endif
+
 	bpp = rootpsd->bpp;
 	data_format = rootpsd->data_format;
 	pixtype = rootpsd->pixtype;
@@ -142,7 +151,7 @@ gen_allocatememgc(PSD psd)
 {
 	PSD	mempsd;
 
-	assert(psd == &scrdev);
+	assert(psd == &scrdev || (psd->flags & PSF_SCREEN));	/* or image decode thread's copy*/
 
 	mempsd = malloc(sizeof(SCREENDEVICE));
 	if (!mempsd)
@@ -156,6 +165,7 @@ gen_allocatememgc(PSD psd)
 	mempsd->portrait = MWPORTRAIT_NONE; /* don't rotate offscreen pixmaps*/
 	mempsd->addr = NULL;
 	mempsd->Update = NULL;				/* no external updates required for mem device*/
+	mempsd->CopyArea = NULL;
 	mempsd->palette = NULL;				/* don't copy any palette*/
 	mempsd->palsize = 0;
 	mempsd->transcolor = MWNOCOLOR;		/* no transparent colors unless set by image loader*/
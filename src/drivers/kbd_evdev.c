@@ -0,0 +1,296 @@
+/*
+ * Linux evdev (/dev/input/eventN) keyboard driver
+ *
+ * Events are read in bulk and returned one key at a time.  Key codes are
+ * translated with the standard kernel keymap and a US shift table, since
+ * no console keymap is available from an event device.
+ *
+ * The device is set with EVDEV_KBD=/dev/input/eventN, otherwise the
+ * first keyboard found is used.  Uinput virtual devices work the same
+ * way as real ones.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include "device.h"
+#include "keymap_standard.h"
+
+#define EVDEV_DIR	"/dev/input/event"
+#define MAXDEVS		32		/* event devices searched*/
+#define NUMEVENTS	64		/* events read at once*/
+
+#define BITS_PER_LONG		(sizeof(long) * 8)
+#define NLONGS(n)			(((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define TESTBIT(bit, array)	((array[(bit) / BITS_PER_LONG] >> ((bit) % BITS_PER_LONG)) & 1)
+
+static int  EV_Open(KBDDEVICE *pkd);
+static void EV_Close(void);
+static void EV_GetModifierInfo(MWKEYMOD *modifiers, MWKEYMOD *curmodifiers);
+static int  EV_Read(MWKEY *kbuf, MWKEYMOD *modifiers, MWSCANCODE *scancode);
+
+KBDDEVICE kbddev = {
+	EV_Open,
+	EV_Close,
+	EV_GetModifierInfo,
+	EV_Read,
+	NULL
+};
+
+static int		kbd_fd = -1;
+static MWKEYMOD	key_modstate;
+static struct input_event evbuf[NUMEVENTS];
+static int		evcount, evpos;		/* events in evbuf, next event*/
+
+/* shifted characters for US keyboard*/
+static const char unshifted[] = "1234567890-=[];'`\\,./";
+static const char shifted[]   = "!@#$%^&*()_+{}:\"~|<>?";
+
+static int		EV_IsKeyboard(int fd);
+static void		EV_SetLEDs(void);
+static MWKEYMOD	EV_ModifierBit(MWKEY mwkey);
+static MWKEY	EV_Translate(MWKEY mwkey, MWKEYMOD modstate);
+
+/*
+ * Open the keyboard.
+ */
+static int
+EV_Open(KBDDEVICE *pkd)
+{
+	int		i;
+	char	*dev;
+	char	path[64];
+	unsigned long ledbits[NLONGS(LED_MAX + 1)];
+
+	if ((dev = getenv("EVDEV_KBD")) != NULL) {
+		/* write access is needed only to set the LEDs*/
+		kbd_fd = open(dev, O_RDWR | O_NONBLOCK);
+		if (kbd_fd < 0)
+			kbd_fd = open(dev, O_RDONLY | O_NONBLOCK);
+		if (kbd_fd < 0) {
+			EPRINTF("Error %d opening evdev keyboard %s\n", errno, dev);
+			return DRIVER_FAIL;
+		}
+	} else {
+		for (i = 0; i < MAXDEVS; i++) {
+			sprintf(path, EVDEV_DIR "%d", i);
+			kbd_fd = open(path, O_RDWR | O_NONBLOCK);
+			if (kbd_fd < 0)
+				kbd_fd = open(path, O_RDONLY | O_NONBLOCK);
+			if (kbd_fd < 0)
+				continue;
+			if (EV_IsKeyboard(kbd_fd))
+				break;
+			close(kbd_fd);
+			kbd_fd = -1;
+		}
+		if (kbd_fd < 0) {
+			EPRINTF("No evdev keyboard found\n");
+			return DRIVER_FAIL;
+		}
+	}
+
+	/* keep keystrokes from also going to the console*/
+	ioctl(kbd_fd, EVIOCGRAB, 1);
+
+	evcount = evpos = 0;
+	key_modstate = MWKMOD_NONE;
+
+	/* preset CAPSLOCK and NUMLOCK from startup LED state*/
+	memset(ledbits, 0, sizeof(ledbits));
+	if (ioctl(kbd_fd, EVIOCGLED(sizeof(ledbits)), ledbits) >= 0) {
+		if (TESTBIT(LED_CAPSL, ledbits))
+			key_modstate |= MWKMOD_CAPS;
+		if (TESTBIT(LED_NUML, ledbits))
+			key_modstate |= MWKMOD_NUM;
+	}
+	return kbd_fd;
+}
+
+/* return TRUE if device has letter keys*/
+static int
+EV_IsKeyboard(int fd)
+{
+	unsigned long keybits[NLONGS(KEY_MAX + 1)];
+
+	memset(keybits, 0, sizeof(keybits));
+	if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits) < 0)
+		return FALSE;
+	return TESTBIT(KEY_A, keybits) && TESTBIT(KEY_Z, keybits) && TESTBIT(KEY_ENTER, keybits);
+}
+
+/*
+ * Close the keyboard.
+ */
+static void
+EV_Close(void)
+{
+	if (kbd_fd >= 0)
+		close(kbd_fd);
+	kbd_fd = -1;
+}
+
+/*
+ * Return the possible modifiers and current modifiers for the keyboard.
+ */
+static void
+EV_GetModifierInfo(MWKEYMOD *modifiers, MWKEYMOD *curmodifiers)
+{
+	if (modifiers)
+		*modifiers = MWKMOD_CTRL | MWKMOD_SHIFT | MWKMOD_ALT |
+			MWKMOD_META | MWKMOD_CAPS | MWKMOD_NUM | MWKMOD_SCR;
+	if (curmodifiers)
+		*curmodifiers = key_modstate;
+}
+
+/*
+ * This reads one keystroke from the keyboard, and the current state of
+ * the modifier keys (ALT, SHIFT, etc).  Returns -1 on error, 0 if no data
+ * is ready, 1 on a keypress, and 2 on keyrelease.
+ * This is a non-blocking call.
+ */
+static int
+EV_Read(MWKEY *kbuf, MWKEYMOD *modifiers, MWSCANCODE *pscancode)
+{
+	int		n;
+	MWKEY	mwkey;
+	MWKEYMOD mod;
+	struct input_event *ev;
+
+	for (;;) {
+		if (evpos >= evcount) {
+			n = read(kbd_fd, evbuf, sizeof(evbuf));
+			if (n < (int)sizeof(struct input_event)) {
+				if (n < 0 && errno != EINTR && errno != EAGAIN)
+					return KBD_FAIL;
+				return KBD_NODATA;
+			}
+			evcount = n / sizeof(struct input_event);
+			evpos = 0;
+		}
+		ev = &evbuf[evpos++];
+
+		/* value is 0 on release, 1 on press and 2 on autorepeat*/
+		if (ev->type != EV_KEY || ev->code >= sizeof(keymap)/sizeof(keymap[0]))
+			continue;
+		mwkey = keymap[ev->code];
+		if (mwkey == MWKEY_UNKNOWN)
+			continue;
+
+		/* update modifier state, locks toggle on press*/
+		if ((mod = EV_ModifierBit(mwkey)) != 0) {
+			if (mod & (MWKMOD_CAPS | MWKMOD_NUM | MWKMOD_SCR)) {
+				if (ev->value == 1) {
+					key_modstate ^= mod;
+					EV_SetLEDs();
+				}
+			} else if (ev->value)
+				key_modstate |= mod;
+			else
+				key_modstate &= ~mod;
+		} else
+			mwkey = EV_Translate(mwkey, key_modstate);
+
+		*kbuf = mwkey;
+		*modifiers = key_modstate;
+		*pscancode = ev->code;
+		return ev->value ? KBD_KEYPRESS : KBD_KEYRELEASE;
+	}
+}
+
+/* return modifier bit for a modifier key, 0 otherwise*/
+static MWKEYMOD
+EV_ModifierBit(MWKEY mwkey)
+{
+	switch (mwkey) {
+	case MWKEY_LSHIFT:		return MWKMOD_LSHIFT;
+	case MWKEY_RSHIFT:		return MWKMOD_RSHIFT;
+	case MWKEY_LCTRL:		return MWKMOD_LCTRL;
+	case MWKEY_RCTRL:		return MWKMOD_RCTRL;
+	case MWKEY_LALT:		return MWKMOD_LALT;
+	case MWKEY_RALT:		return MWKMOD_RALT;
+	case MWKEY_LMETA:		return MWKMOD_LMETA;
+	case MWKEY_RMETA:		return MWKMOD_RMETA;
+	case MWKEY_CAPSLOCK:	return MWKMOD_CAPS;
+	case MWKEY_NUMLOCK:		return MWKMOD_NUM;
+	case MWKEY_SCROLLOCK:	return MWKMOD_SCR;
+	}
+	return 0;
+}
+
+/* set keyboard LEDs from lock state, ignored if opened read-only*/
+static void
+EV_SetLEDs(void)
+{
+	struct input_event ev[4];
+
+	memset(ev, 0, sizeof(ev));
+	ev[0].type = EV_LED;
+	ev[0].code = LED_CAPSL;
+	ev[0].value = (key_modstate & MWKMOD_CAPS) != 0;
+	ev[1].type = EV_LED;
+	ev[1].code = LED_NUML;
+	ev[1].value = (key_modstate & MWKMOD_NUM) != 0;
+	ev[2].type = EV_LED;
+	ev[2].code = LED_SCROLLL;
+	ev[2].value = (key_modstate & MWKMOD_SCR) != 0;
+	ev[3].type = EV_SYN;
+	ev[3].code = SYN_REPORT;
+	if (write(kbd_fd, ev, sizeof(ev)) < 0)
+		return;
+}
+
+/* translate a key and modifier state to an MWKEY*/
+static MWKEY
+EV_Translate(MWKEY mwkey, MWKEYMOD modstate)
+{
+	const char *p;
+
+	if (mwkey >= 'a' && mwkey <= 'z') {
+		if (modstate & MWKMOD_CTRL)
+			return mwkey & 0x1f;
+		if (!(modstate & MWKMOD_SHIFT) != !(modstate & MWKMOD_CAPS))
+			return mwkey - 'a' + 'A';
+		return mwkey;
+	}
+	if (mwkey < 128) {
+		if ((modstate & MWKMOD_SHIFT) && (p = strchr(unshifted, mwkey)) != NULL)
+			return shifted[p - unshifted];
+		return mwkey;
+	}
+
+	if (modstate & MWKMOD_NUM) {
+		switch (mwkey) {
+		case MWKEY_KP0:
+		case MWKEY_KP1:
+		case MWKEY_KP2:
+		case MWKEY_KP3:
+		case MWKEY_KP4:
+		case MWKEY_KP5:
+		case MWKEY_KP6:
+		case MWKEY_KP7:
+		case MWKEY_KP8:
+		case MWKEY_KP9:
+			return mwkey - MWKEY_KP0 + '0';
+		case MWKEY_KP_PERIOD:
+			return '.';
+		}
+	}
+	switch (mwkey) {
+	case MWKEY_KP_DIVIDE:
+		return '/';
+	case MWKEY_KP_MULTIPLY:
+		return '*';
+	case MWKEY_KP_MINUS:
+		return '-';
+	case MWKEY_KP_PLUS:
+		return '+';
+	case MWKEY_KP_ENTER:
+		return MWKEY_ENTER;
+	}
+	return mwkey;
+}
@@ -6,7 +6,7 @@ MWKEY_UNKNOWN, MWKEY_ESCAPE, '1', '2', '3',				/* 0*/
 '9', '0', '-', '=', MWKEY_BACKSPACE,					/* 10*/
 MWKEY_TAB, 'q', 'w', 'e', 'r',						/* 15*/
 't', 'y', 'u', 'i', 'o',						/* 20*/
-'o', '[', ']', MWKEY_ENTER, MWKEY_LCTRL,				/* 25*/
+'p', '[', ']', MWKEY_ENTER, MWKEY_LCTRL,				/* 25*/
 'a', 's', 'd', 'f', 'g',						/* 30*/
 'h', 'j', 'k', 'l', ';',						/* 35*/
 '\'', '`', MWKEY_LSHIFT, '\\', 'z',					/* 40*/
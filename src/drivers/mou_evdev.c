@@ -0,0 +1,483 @@
+/*
+ * Linux evdev (/dev/input/eventN) mouse and touchscreen driver
+ *
+ * Events are read in bulk, and all REL/ABS/KEY events up to each
+ * SYN_REPORT are collapsed into one sample.  Successive samples that
+ * only move the pointer are merged, so a device reporting at several
+ * hundred Hz produces one mouse event per Read, not one per sample.
+ * A sample that changes the buttons or scrolls ends the merge and is
+ * returned together with the merged motion, so no press or release is
+ * lost or left waiting for the next device event.
+ *
+ * Multitouch (type B) slots are tracked in mt[].  The pointer follows
+ * ABS_X/ABS_Y, or the first active contact on devices that only report
+ * ABS_MT_POSITION_X/Y.
+ *
+ * The device is set with EVDEV_MOUSE=/dev/input/eventN, otherwise the
+ * first pointer device found is used.  Uinput virtual devices work the
+ * same way as real ones.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include "device.h"
+
+#define	SCALE		3	/* default scaling factor for acceleration */
+#define	THRESH		5	/* default threshhold for acceleration */
+
+#define EVDEV_DIR	"/dev/input/event"
+#define MAXDEVS		32		/* event devices searched*/
+#define NUMEVENTS	64		/* events read at once*/
+#define MAXSLOTS	10		/* multitouch contacts tracked*/
+
+#define BITS_PER_LONG		(sizeof(long) * 8)
+#define NLONGS(n)			(((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define TESTBIT(bit, array)	((array[(bit) / BITS_PER_LONG] >> ((bit) % BITS_PER_LONG)) & 1)
+
+static int  	EV_Open(MOUSEDEVICE *pmd);
+static void 	EV_Close(void);
+static int  	EV_GetButtonInfo(void);
+static void	EV_GetDefaultAccel(int *pscale,int *pthresh);
+static int  	EV_Read(MWCOORD *dx, MWCOORD *dy, MWCOORD *dz, int *bp);
+
+MOUSEDEVICE mousedev = {
+	EV_Open,
+	EV_Close,
+	EV_GetButtonInfo,
+	EV_GetDefaultAccel,
+	EV_Read,
+	NULL,
+	MOUSE_NORMAL	/* flags*/
+};
+
+/* multitouch contact*/
+typedef struct {
+	int		id;				/* tracking id, -1 if slot unused*/
+	int		x, y;
+} EVTOUCH;
+
+/* pointer state, updated by events and latched by SYN_REPORT*/
+typedef struct {
+	int		dx, dy;			/* relative motion*/
+	int		wheel;			/* scroll wheel motion*/
+	int		x, y;			/* absolute position*/
+	int		buttons;		/* MWBUTTON_xxx*/
+	int		touch;			/* BTN_TOUCH state*/
+	EVTOUCH	mt[MAXSLOTS];	/* multitouch contacts*/
+} EVSTATE;
+
+extern SCREENDEVICE scrdev;
+
+static int			mouse_fd = -1;
+static int			probed;			/* capabilities read from device*/
+static int			isabs;			/* device reports absolute positions*/
+static int			hasabsxy;		/* device reports ABS_X/ABS_Y*/
+static int			istouch;		/* touchscreen, pointer moves only on contact*/
+static struct input_absinfo xinfo, yinfo;	/* absolute axis ranges*/
+static struct input_event evbuf[NUMEVENTS];
+static int			evcount, evpos;	/* events in evbuf, next event*/
+static EVSTATE		cur;			/* state being built from events*/
+static EVSTATE		last;			/* state at last SYN_REPORT*/
+static int			dropping;		/* discarding events after SYN_DROPPED*/
+static int			slot;			/* current multitouch slot*/
+static int			posx, posy;		/* absolute position of last contact*/
+
+static int	EV_Probe(int fd);
+static void	EV_Sync(void);
+static int	EV_Buttons(EVSTATE *sp);
+static void	EV_Position(EVSTATE *sp, int *px, int *py);
+static int	EV_Scale(int v, struct input_absinfo *info, int res);
+
+/*
+ * Open up the mouse device.
+ * Returns the fd if successful, or negative if unsuccessful.
+ */
+static int
+EV_Open(MOUSEDEVICE *pmd)
+{
+	int		i;
+	char	*dev;
+	char	path[64];
+
+	if ((dev = getenv("EVDEV_MOUSE")) != NULL) {
+		mouse_fd = open(dev, O_RDONLY | O_NONBLOCK);
+		if (mouse_fd < 0) {
+			EPRINTF("Error %d opening evdev mouse %s\n", errno, dev);
+			return DRIVER_FAIL;
+		}
+		EV_Probe(mouse_fd);
+	} else {
+		for (i = 0; i < MAXDEVS; i++) {
+			sprintf(path, EVDEV_DIR "%d", i);
+			mouse_fd = open(path, O_RDONLY | O_NONBLOCK);
+			if (mouse_fd < 0)
+				continue;
+			if (EV_Probe(mouse_fd))
+				break;
+			close(mouse_fd);
+			mouse_fd = -1;
+		}
+		if (mouse_fd < 0) {
+			EPRINTF("No evdev mouse found\n");
+			return DRIVER_FAIL;
+		}
+	}
+
+	/* keep events from also going to the console*/
+	ioctl(mouse_fd, EVIOCGRAB, 1);
+
+	memset(&cur, 0, sizeof(cur));
+	evcount = evpos = 0;
+	dropping = 0;
+	slot = 0;
+	for (i = 0; i < MAXSLOTS; i++)
+		cur.mt[i].id = -1;
+	EV_Sync();
+	last = cur;
+	EV_Position(&last, &posx, &posy);
+
+	if (istouch)
+		GdHideCursor(&scrdev);
+	return mouse_fd;
+}
+
+/*
+ * Read device capabilities and absolute axis ranges.
+ * Returns TRUE if the device is a pointer.  The ioctls fail on a pipe
+ * or file of recorded events, which are then handled as they arrive.
+ */
+static int
+EV_Probe(int fd)
+{
+	unsigned long evbits[NLONGS(EV_MAX + 1)];
+	unsigned long relbits[NLONGS(REL_MAX + 1)];
+	unsigned long absbits[NLONGS(ABS_MAX + 1)];
+	int hasrel, hasmt;
+
+	probed = isabs = hasabsxy = istouch = FALSE;
+	memset(&xinfo, 0, sizeof(xinfo));
+	memset(&yinfo, 0, sizeof(yinfo));
+	memset(evbits, 0, sizeof(evbits));
+	memset(relbits, 0, sizeof(relbits));
+	memset(absbits, 0, sizeof(absbits));
+	if (ioctl(fd, EVIOCGBIT(0, sizeof(evbits)), evbits) < 0)
+		return FALSE;
+	probed = TRUE;
+	if (TESTBIT(EV_REL, evbits))
+		ioctl(fd, EVIOCGBIT(EV_REL, sizeof(relbits)), relbits);
+	if (TESTBIT(EV_ABS, evbits))
+		ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(absbits)), absbits);
+
+	hasrel = TESTBIT(REL_X, relbits) && TESTBIT(REL_Y, relbits);
+	hasabsxy = TESTBIT(ABS_X, absbits) && TESTBIT(ABS_Y, absbits);
+	hasmt = TESTBIT(ABS_MT_POSITION_X, absbits) && TESTBIT(ABS_MT_POSITION_Y, absbits);
+	isabs = !hasrel && (hasabsxy || hasmt);
+	if (TESTBIT(EV_KEY, evbits)) {
+		unsigned long keybits[NLONGS(KEY_MAX + 1)];
+
+		memset(keybits, 0, sizeof(keybits));
+		ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits);
+		istouch = TESTBIT(BTN_TOUCH, keybits);
+	}
+	istouch |= hasmt;
+
+	if (hasabsxy) {
+		ioctl(fd, EVIOCGABS(ABS_X), &xinfo);
+		ioctl(fd, EVIOCGABS(ABS_Y), &yinfo);
+	} else if (hasmt) {
+		ioctl(fd, EVIOCGABS(ABS_MT_POSITION_X), &xinfo);
+		ioctl(fd, EVIOCGABS(ABS_MT_POSITION_Y), &yinfo);
+	}
+	return hasrel || hasabsxy || hasmt;
+}
+
+/* reload button, position and contact state, after open or dropped events*/
+static void
+EV_Sync(void)
+{
+	unsigned long keybits[NLONGS(KEY_MAX + 1)];
+	struct input_absinfo info;
+	struct {
+		__u32	code;
+		__s32	values[MAXSLOTS];
+	} mt;
+	int i;
+
+	memset(keybits, 0, sizeof(keybits));
+	if (ioctl(mouse_fd, EVIOCGKEY(sizeof(keybits)), keybits) >= 0) {
+		cur.buttons = 0;
+		if (TESTBIT(BTN_LEFT, keybits))
+			cur.buttons |= MWBUTTON_L;
+		if (TESTBIT(BTN_MIDDLE, keybits))
+			cur.buttons |= MWBUTTON_M;
+		if (TESTBIT(BTN_RIGHT, keybits))
+			cur.buttons |= MWBUTTON_R;
+		cur.touch = TESTBIT(BTN_TOUCH, keybits);
+	}
+	if (hasabsxy) {
+		if (ioctl(mouse_fd, EVIOCGABS(ABS_X), &info) >= 0)
+			cur.x = info.value;
+		if (ioctl(mouse_fd, EVIOCGABS(ABS_Y), &info) >= 0)
+			cur.y = info.value;
+	}
+	if (ioctl(mouse_fd, EVIOCGABS(ABS_MT_SLOT), &info) >= 0 &&
+	    info.value >= 0 && info.value < MAXSLOTS) {
+		slot = info.value;
+		mt.code = ABS_MT_TRACKING_ID;
+		if (ioctl(mouse_fd, EVIOCGMTSLOTS(sizeof(mt)), &mt) >= 0)
+			for (i = 0; i < MAXSLOTS; i++)
+				cur.mt[i].id = mt.values[i];
+		mt.code = ABS_MT_POSITION_X;
+		if (ioctl(mouse_fd, EVIOCGMTSLOTS(sizeof(mt)), &mt) >= 0)
+			for (i = 0; i < MAXSLOTS; i++)
+				cur.mt[i].x = mt.values[i];
+		mt.code = ABS_MT_POSITION_Y;
+		if (ioctl(mouse_fd, EVIOCGMTSLOTS(sizeof(mt)), &mt) >= 0)
+			for (i = 0; i < MAXSLOTS; i++)
+				cur.mt[i].y = mt.values[i];
+	}
+	cur.dx = cur.dy = cur.wheel = 0;
+}
+
+/*
+ * Close the mouse device.
+ */
+static void
+EV_Close(void)
+{
+	if (mouse_fd >= 0)
+		close(mouse_fd);
+	mouse_fd = -1;
+}
+
+/*
+ * Get mouse buttons supported
+ */
+static int
+EV_GetButtonInfo(void)
+{
+	return MWBUTTON_L | MWBUTTON_M | MWBUTTON_R | MWBUTTON_SCROLLUP | MWBUTTON_SCROLLDN;
+}
+
+/*
+ * Get default mouse acceleration settings
+ */
+static void
+EV_GetDefaultAccel(int *pscale,int *pthresh)
+{
+	*pscale = SCALE;
+	*pthresh = THRESH;
+}
+
+/* scale absolute axis value to screen resolution*/
+static int
+EV_Scale(int v, struct input_absinfo *info, int res)
+{
+	if (info->maximum <= info->minimum)
+		return v;				/* range unknown, use as is*/
+	return (long)(v - info->minimum) * (res - 1) / (info->maximum - info->minimum);
+}
+
+/* update state from one event, returns TRUE at SYN_REPORT*/
+static int
+EV_Event(struct input_event *ev)
+{
+	int buttons;
+
+	if (dropping) {
+		/* discard events up to next SYN_REPORT, then reload state*/
+		if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+			dropping = 0;
+			EV_Sync();
+		}
+		return FALSE;
+	}
+
+	switch (ev->type) {
+	case EV_REL:
+		switch (ev->code) {
+		case REL_X:
+			cur.dx += ev->value;
+			break;
+		case REL_Y:
+			cur.dy += ev->value;
+			break;
+		case REL_WHEEL:
+			cur.wheel += ev->value;
+			break;
+		}
+		break;
+
+	case EV_ABS:
+		if (!probed)
+			isabs = TRUE;
+		switch (ev->code) {
+		case ABS_X:
+			cur.x = ev->value;
+			hasabsxy = TRUE;
+			break;
+		case ABS_Y:
+			cur.y = ev->value;
+			hasabsxy = TRUE;
+			break;
+		case ABS_MT_SLOT:
+			slot = ev->value;
+			istouch = TRUE;
+			break;
+		case ABS_MT_TRACKING_ID:
+			if (slot >= 0 && slot < MAXSLOTS)
+				cur.mt[slot].id = ev->value;
+			break;
+		case ABS_MT_POSITION_X:
+			if (slot >= 0 && slot < MAXSLOTS)
+				cur.mt[slot].x = ev->value;
+			break;
+		case ABS_MT_POSITION_Y:
+			if (slot >= 0 && slot < MAXSLOTS)
+				cur.mt[slot].y = ev->value;
+			break;
+		}
+		break;
+
+	case EV_KEY:
+		switch (ev->code) {
+		case BTN_LEFT:
+			buttons = MWBUTTON_L;
+			break;
+		case BTN_MIDDLE:
+			buttons = MWBUTTON_M;
+			break;
+		case BTN_RIGHT:
+			buttons = MWBUTTON_R;
+			break;
+		case BTN_TOUCH:
+			cur.touch = ev->value;
+			istouch = TRUE;
+			return FALSE;
+		default:
+			return FALSE;
+		}
+		if (ev->value)
+			cur.buttons |= buttons;
+		else
+			cur.buttons &= ~buttons;
+		break;
+
+	case EV_SYN:
+		if (ev->code == SYN_REPORT)
+			return TRUE;
+		if (ev->code == SYN_DROPPED)
+			dropping = 1;
+		break;
+	}
+	return FALSE;
+}
+
+/* buttons in a sample, a touch is the left button*/
+static int
+EV_Buttons(EVSTATE *sp)
+{
+	int i;
+
+	if (sp->touch)
+		return sp->buttons | MWBUTTON_L;
+	if (!hasabsxy) {
+		for (i = 0; i < MAXSLOTS; i++)
+			if (sp->mt[i].id >= 0)
+				return sp->buttons | MWBUTTON_L;
+	}
+	return sp->buttons;
+}
+
+/* absolute position in a sample, the first contact without ABS_X/ABS_Y*/
+static void
+EV_Position(EVSTATE *sp, int *px, int *py)
+{
+	int i;
+
+	*px = sp->x;
+	*py = sp->y;
+	if (!hasabsxy) {
+		for (i = 0; i < MAXSLOTS; i++) {
+			if (sp->mt[i].id >= 0) {
+				*px = sp->mt[i].x;
+				*py = sp->mt[i].y;
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * Read all available samples, merging those that only move the pointer.
+ * A sample changing buttons or scrolling ends the merge and is returned
+ * with the final position, so buffered events only remain after a Read
+ * that reports a change.  Returns MOUSE_NODATA if no sample was completed
+ * by a SYN_REPORT.
+ */
+static int
+EV_Read(MWCOORD *dx, MWCOORD *dy, MWCOORD *dz, int *bp)
+{
+	int		n;
+	int		samples = 0;
+	int		startbuttons = EV_Buttons(&last);
+	int		sumdx = 0, sumdy = 0, wheel = 0;
+
+	for (;;) {
+		if (evpos >= evcount) {
+			n = read(mouse_fd, evbuf, sizeof(evbuf));
+			if (n < (int)sizeof(struct input_event)) {
+				if (n < 0 && errno != EINTR && errno != EAGAIN && !samples)
+					return MOUSE_FAIL;
+				break;
+			}
+			evcount = n / sizeof(struct input_event);
+			evpos = 0;
+		}
+		if (!EV_Event(&evbuf[evpos++]))
+			continue;
+
+		/* SYN_REPORT: latch sample*/
+		sumdx += cur.dx;
+		sumdy += cur.dy;
+		wheel += cur.wheel;
+		cur.dx = cur.dy = cur.wheel = 0;
+		last = cur;
+		samples++;
+
+		/* touch release has no contact, keep position of last contact*/
+		if (isabs && (!istouch || (EV_Buttons(&last) & MWBUTTON_L)))
+			EV_Position(&last, &posx, &posy);
+
+		if (wheel || EV_Buttons(&last) != startbuttons)
+			break;
+	}
+	if (!samples)
+		return MOUSE_NODATA;
+
+	*bp = EV_Buttons(&last);
+	if (wheel > 0)
+		*bp |= MWBUTTON_SCROLLUP;
+	else if (wheel < 0)
+		*bp |= MWBUTTON_SCROLLDN;
+	*dz = 0;
+
+	if (!isabs) {
+		*dx = sumdx;
+		*dy = sumdy;
+		return MOUSE_RELPOS;
+	}
+
+	*dx = EV_Scale(posx, &xinfo, scrdev.xres);
+	*dy = EV_Scale(posy, &yinfo, scrdev.yres);
+
+	/* a release moves to the last contact, so a drag ends where it was lifted*/
+	if (istouch && !(*bp & MWBUTTON_L) && !(startbuttons & MWBUTTON_L))
+		return MOUSE_NOMOVE;	/* report position but don't move mouse cursor*/
+	return MOUSE_ABSPOS;
+}
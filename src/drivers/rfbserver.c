@@ -0,0 +1,1563 @@
+/*
+ * Native RFB (VNC) server for Microwindows and Nano-X
+ * Set RFBSERVER=Y in config.
+ *
+ * Wraps the open screen driver so any screen (FB, FBE, X11, SDL) can be
+ * viewed and controlled remotely by a standard VNC viewer, without any
+ * external libraries other than zlib.  Clients connect to TCP port
+ * RFB_PORT (default 5900, overridden by the RFBPORT environment variable).
+ *
+ * Only security type None is offered, so any viewer that can connect can
+ * see the screen and send keyboard and mouse input.  For this reason the
+ * server listens on the loopback interface only, for use through an ssh
+ * tunnel or similar.  Setting the RFBADDR environment variable to a local
+ * IPv4 address, or 0.0.0.0 for all interfaces, exposes it to other hosts,
+ * which should only be done on a trusted network.
+ *
+ * Changes are taken from the psd->Update path that all framebuffer
+ * subdrivers and conversion blits already call, and recorded as dirty
+ * RFB_TILE sized tiles for each client.  When a client asks for an update,
+ * each dirty tile is hashed and compared with the hash of the tile as it
+ * was last sent to that client, and skipped if unchanged, so redrawing
+ * identical pixels (expose handling, blinking cursors, repainted
+ * backgrounds) costs no bandwidth.  Changed tiles are merged into
+ * horizontal runs and sent using the client's preferred encoding of
+ * ZRLE, RRE or Raw.
+ *
+ * Screen to screen copies (window moves, GrCopyArea scrolls, mwin
+ * ScrollWindow) are reported by GdConvBlitInternal through the
+ * psd->CopyArea entry point and sent as RFB CopyRects, which the
+ * viewer performs locally, in order, before any changed tiles.  Tiles
+ * that were still unsent in the source of a copy make the destination
+ * tiles changed, so a tile not marked changed always matches the viewer
+ * once its pending copies are done.
+ *
+ * No data is sent until the client requests an update and has taken
+ * everything previously sent, so on slow links changes coalesce into
+ * fewer, larger updates rather than queueing.
+ *
+ * Pointer and key events from viewers are queued and returned ahead of
+ * the local mouse and keyboard driver Read() functions.
+ *
+ * The main loop calls GdRFBPrepareSelect and GdRFBServiceSelect around
+ * select() to accept connections, read client messages and flush output.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "uni_std.h"
+#include "device.h"
+
+#if MW_FEATURE_RFBSERVER	/* whole file*/
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <zlib.h>
+
+/* without MSG_NOSIGNAL, SO_NOSIGPIPE or ignoring SIGPIPE stops viewer disconnects killing us*/
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#define RFB_NEEDSIGPIPE	1
+#endif
+
+#define RFB_TILESHIFT	5
+#define RFB_TILE		(1 << RFB_TILESHIFT)	/* change detection tile size*/
+#define RFB_ZRLETILE	64			/* ZRLE tile size, fixed by protocol*/
+#define RFB_ZLIBLEVEL	3			/* ZRLE zlib compression level*/
+#define RFB_INBUFSIZE	1024		/* largest client message (SetEncodings)*/
+#define RFB_OUTBUFSIZE	65536		/* initial output buffer size*/
+#define RFB_MAXEVENTS	64			/* max queued pointer or key events*/
+#define RFB_MAXCOPIES	16			/* max CopyRects pending per client*/
+
+/* client states*/
+#define RFB_VERSION		0			/* waiting for ProtocolVersion*/
+#define RFB_SECURITY	1			/* waiting for security type*/
+#define RFB_INIT		2			/* waiting for ClientInit*/
+#define RFB_NORMAL		3			/* normal protocol messages*/
+
+/* encodings*/
+#define RFB_ENC_RAW		0
+#define RFB_ENC_COPYRECT 1
+#define RFB_ENC_RRE		2
+#define RFB_ENC_ZRLE	16
+
+typedef struct {
+	int		bpp;			/* bits per pixel, 8, 16 or 32*/
+	int		depth;
+	int		bigendian;
+	int		truecolor;
+	int		redmax, greenmax, bluemax;
+	int		redshift, greenshift, blueshift;
+} RFBPIXELFORMAT;
+
+typedef struct {
+	MWCOORD	x, y, w, h;		/* destination*/
+	MWCOORD	srcx, srcy;
+} RFBCOPY;
+
+typedef struct rfbclient {
+	struct rfbclient *next;
+	int		fd;
+	int		state;
+	int		minor;			/* protocol minor version, 3, 7 or 8*/
+	unsigned char in[RFB_INBUFSIZE];	/* partial client message*/
+	int		inlen;
+	unsigned long skip;		/* ClientCutText bytes to discard*/
+	unsigned char *out;		/* unsent output*/
+	int		outpos;			/* start of unsent output*/
+	int		outlen;			/* end of unsent output*/
+	int		outsize;
+	RFBPIXELFORMAT pf;		/* client pixel format*/
+	int		bytespp;		/* client bytes per pixel*/
+	int		cbytes;			/* ZRLE CPIXEL bytes*/
+	int		coffset;		/* ZRLE CPIXEL offset in pixel*/
+	uint32_t rtab[256];		/* 8 bit component to client pixel bits*/
+	uint32_t gtab[256];
+	uint32_t btab[256];
+	int		encoding;		/* preferred encoding*/
+	int		copyrect;		/* client accepts CopyRect*/
+	int		updatereq;		/* client has requested an update*/
+	unsigned char *dirty;	/* tiles changed since last sent*/
+	uint64_t *hash;			/* tile contents as last sent, 0 if unknown*/
+	RFBCOPY	copies[RFB_MAXCOPIES];	/* CopyRects waiting to be sent, in order*/
+	int		ncopies;
+	z_stream zs;			/* ZRLE zlib stream, persists for connection*/
+	int		zsinit;
+} RFBCLIENT;
+
+typedef struct {
+	MWCOORD	x, y;			/* pointer position*/
+	int		buttons;
+	MWKEY	key;			/* key, 0 for pointer event*/
+	int		down;
+} RFBEVENT;
+
+static PSD		rfbpsd;			/* wrapped screen device*/
+static int		listenfd = -1;
+static RFBCLIENT *clients;
+static int		ntilesx, ntilesy, ntiles;
+static unsigned char *tilesnap;	/* dirty tiles before a copy*/
+static unsigned char *sendtile;	/* changed tiles to send in update*/
+static uint32_t	*pixbuf;		/* client pixels of a rect being encoded*/
+static unsigned char *zbuf;		/* uncompressed ZRLE data*/
+static int		zbufsize;
+static RFBEVENT	events[RFB_MAXEVENTS];	/* queued viewer input*/
+static int		evhead, evtail;
+static MWKEYMOD	keymods;		/* viewer modifier state*/
+
+/* wrapped driver entry points*/
+static void	(*orgUpdate)(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+static int	(*orgPreSelect)(PSD psd);
+static int	(*orgMouseRead)(MWCOORD *dx, MWCOORD *dy, MWCOORD *dz, int *bp);
+static int	(*orgKbdRead)(MWKEY *buf, MWKEYMOD *modifiers, MWSCANCODE *scancode);
+
+extern MWPALENTRY gr_palette[256];
+
+static void rfb_drop(RFBCLIENT *c);
+
+/* mark tiles intersecting rectangle as changed for one client*/
+static void
+rfb_dirtyrect(RFBCLIENT *c, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h, int unknown)
+{
+	int tx1, ty1, tx2, ty2, ty;
+
+	if (x < 0) { w += x; x = 0; }
+	if (y < 0) { h += y; y = 0; }
+	if (x + w > rfbpsd->xres) w = rfbpsd->xres - x;
+	if (y + h > rfbpsd->yres) h = rfbpsd->yres - y;
+	if (w <= 0 || h <= 0)
+		return;
+
+	tx1 = x >> RFB_TILESHIFT;
+	ty1 = y >> RFB_TILESHIFT;
+	tx2 = (x + w - 1) >> RFB_TILESHIFT;
+	ty2 = (y + h - 1) >> RFB_TILESHIFT;
+	for (ty = ty1; ty <= ty2; ty++) {
+		memset(&c->dirty[ty * ntilesx + tx1], 1, tx2 - tx1 + 1);
+		if (unknown) {
+			int tx;
+			for (tx = tx1; tx <= tx2; tx++)
+				c->hash[ty * ntilesx + tx] = 0;
+		}
+	}
+}
+
+/* screen driver Update() wrapper, record changed area for each client*/
+static void
+rfb_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	RFBCLIENT *c;
+
+	if (orgUpdate)
+		orgUpdate(psd, x, y, width, height);
+
+	for (c = clients; c; c = c->next)
+		if (c->state == RFB_NORMAL)
+			rfb_dirtyrect(c, x, y, width, height, 0);
+}
+
+/*
+ * Screen driver CopyArea() entry point, called by GdConvBlitInternal
+ * after a screen to screen copy, instead of Update().
+ * Queues a CopyRect for each client that accepts them.  Source tiles
+ * not yet sent are stale in the viewer, so their destination is
+ * marked changed to be sent after the copy.
+ */
+static void
+rfb_copyarea(PSD psd, MWCOORD dstx, MWCOORD dsty, MWCOORD w, MWCOORD h,
+	MWCOORD srcx, MWCOORD srcy)
+{
+	RFBCLIENT *c;
+	MWCOORD dx = dstx - srcx;
+	MWCOORD dy = dsty - srcy;
+	RFBCOPY *cp;
+	int tx1, ty1, tx2, ty2, tx, ty, i;
+
+	if (orgUpdate)
+		orgUpdate(psd, dstx, dsty, w, h);
+
+	/* copies partly off screen are just sent as changed tiles*/
+	if (dstx < 0 || dsty < 0 || srcx < 0 || srcy < 0 ||
+		dstx + w > psd->xres || dsty + h > psd->yres ||
+		srcx + w > psd->xres || srcy + h > psd->yres) {
+		for (c = clients; c; c = c->next)
+			if (c->state == RFB_NORMAL)
+				rfb_dirtyrect(c, dstx, dsty, w, h, 1);
+		return;
+	}
+	if (w <= 0 || h <= 0)
+		return;
+
+	tx1 = dstx >> RFB_TILESHIFT;
+	ty1 = dsty >> RFB_TILESHIFT;
+	tx2 = (dstx + w - 1) >> RFB_TILESHIFT;
+	ty2 = (dsty + h - 1) >> RFB_TILESHIFT;
+
+	for (c = clients; c; c = c->next) {
+		if (c->state != RFB_NORMAL)
+			continue;
+		if (!c->copyrect) {
+			rfb_dirtyrect(c, dstx, dsty, w, h, 1);
+			continue;
+		}
+
+		/* too many copies, send results of all pending copies as tiles*/
+		if (c->ncopies == RFB_MAXCOPIES) {
+			for (i = 0; i < c->ncopies; i++)
+				rfb_dirtyrect(c, c->copies[i].x, c->copies[i].y,
+					c->copies[i].w, c->copies[i].h, 1);
+			c->ncopies = 0;
+		}
+
+		/* destination tile is changed if any of its source was unsent*/
+		memcpy(tilesnap, c->dirty, ntiles);
+		for (ty = ty1; ty <= ty2; ty++) {
+			for (tx = tx1; tx <= tx2; tx++) {
+				MWCOORD x1 = MWMAX(tx << RFB_TILESHIFT, dstx);
+				MWCOORD y1 = MWMAX(ty << RFB_TILESHIFT, dsty);
+				MWCOORD x2 = MWMIN((tx + 1) << RFB_TILESHIFT, dstx + w) - 1;
+				MWCOORD y2 = MWMIN((ty + 1) << RFB_TILESHIFT, dsty + h) - 1;
+				int sx, sy, d = 0;
+
+				i = ty * ntilesx + tx;
+
+				/* part of tile outside copy keeps its state*/
+				if (x1 != tx << RFB_TILESHIFT || y1 != ty << RFB_TILESHIFT ||
+					x2 != ((tx + 1) << RFB_TILESHIFT) - 1 ||
+					y2 != ((ty + 1) << RFB_TILESHIFT) - 1)
+						d = tilesnap[i];
+
+				for (sy = (y1 - dy) >> RFB_TILESHIFT; !d && sy <= (y2 - dy) >> RFB_TILESHIFT; sy++)
+					for (sx = (x1 - dx) >> RFB_TILESHIFT; sx <= (x2 - dx) >> RFB_TILESHIFT; sx++)
+						if (tilesnap[sy * ntilesx + sx]) {
+							d = 1;
+							break;
+						}
+				c->dirty[i] = d;
+				c->hash[i] = 0;		/* viewer contents no longer known*/
+			}
+		}
+
+		cp = &c->copies[c->ncopies++];
+		cp->x = dstx;
+		cp->y = dsty;
+		cp->w = w;
+		cp->h = h;
+		cp->srcx = srcx;
+		cp->srcy = srcy;
+	}
+}
+
+/* build component tables for client pixel format*/
+static void
+rfb_setpixelformat(RFBCLIENT *c, unsigned char *p)
+{
+	RFBPIXELFORMAT *pf = &c->pf;
+	uint32_t mask;
+	int i;
+
+	pf->bpp = p[0];
+	pf->depth = p[1];
+	pf->bigendian = p[2];
+	pf->truecolor = p[3];
+	pf->redmax = (p[4] << 8) | p[5];
+	pf->greenmax = (p[6] << 8) | p[7];
+	pf->bluemax = (p[8] << 8) | p[9];
+	pf->redshift = p[10];
+	pf->greenshift = p[11];
+	pf->blueshift = p[12];
+
+	if ((pf->bpp != 8 && pf->bpp != 16 && pf->bpp != 32) || !pf->truecolor) {
+		EPRINTF("rfbserver: unsupported client pixel format, using 32bpp truecolor\n");
+		pf->bpp = 32;
+		pf->depth = 24;
+		pf->bigendian = 0;
+		pf->truecolor = 1;
+		pf->redmax = pf->greenmax = pf->bluemax = 255;
+		pf->redshift = 16;
+		pf->greenshift = 8;
+		pf->blueshift = 0;
+	}
+	c->bytespp = pf->bpp / 8;
+
+	for (i = 0; i < 256; i++) {
+		c->rtab[i] = (uint32_t)((i * pf->redmax + 127) / 255) << pf->redshift;
+		c->gtab[i] = (uint32_t)((i * pf->greenmax + 127) / 255) << pf->greenshift;
+		c->btab[i] = (uint32_t)((i * pf->bluemax + 127) / 255) << pf->blueshift;
+	}
+
+	/* ZRLE CPIXEL is 3 bytes if 32bpp pixel values fit in 3 bytes*/
+	c->cbytes = c->bytespp;
+	c->coffset = 0;
+	if (pf->bpp == 32 && pf->depth <= 24) {
+		mask = ((uint32_t)pf->redmax << pf->redshift) |
+			((uint32_t)pf->greenmax << pf->greenshift) |
+			((uint32_t)pf->bluemax << pf->blueshift);
+		if (!(mask & 0xff000000)) {
+			c->cbytes = 3;
+			c->coffset = pf->bigendian? 1: 0;
+		} else if (!(mask & 0x000000ff)) {
+			c->cbytes = 3;
+			c->coffset = pf->bigendian? 0: 1;
+		}
+	}
+}
+
+/* read screen rectangle as client pixel values into pixbuf*/
+static void
+rfb_readrect(RFBCLIENT *c, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
+{
+	PSD psd = rfbpsd;
+	uint32_t *dst = pixbuf;
+	uint32_t *rtab = c->rtab, *gtab = c->gtab, *btab = c->btab;
+	int i;
+
+	while (--h >= 0) {
+		unsigned char *src = psd->addr + y++ * psd->pitch + x * (psd->bpp >> 3);
+
+		switch (psd->pixtype) {
+		case MWPF_TRUECOLORARGB:
+			for (i = 0; i < w; i++) {
+				uint32_t v = ((uint32_t *)src)[i];
+				*dst++ = rtab[PIXEL8888RED8(v)] | gtab[PIXEL8888GREEN8(v)] | btab[PIXEL8888BLUE8(v)];
+			}
+			break;
+		case MWPF_TRUECOLORABGR:
+			for (i = 0; i < w; i++) {
+				uint32_t v = ((uint32_t *)src)[i];
+				*dst++ = rtab[PIXELABGRRED8(v)] | gtab[PIXELABGRGREEN8(v)] | btab[PIXELABGRBLUE8(v)];
+			}
+			break;
+		case MWPF_TRUECOLORRGB:
+			for (i = 0; i < w; i++, src += 3)
+				*dst++ = rtab[src[2]] | gtab[src[1]] | btab[src[0]];
+			break;
+		case MWPF_TRUECOLOR565:
+			for (i = 0; i < w; i++) {
+				unsigned short v = ((unsigned short *)src)[i];
+				*dst++ = rtab[PIXEL565RED8(v)] | gtab[PIXEL565GREEN8(v)] | btab[PIXEL565BLUE8(v)];
+			}
+			break;
+		case MWPF_TRUECOLOR555:
+			for (i = 0; i < w; i++) {
+				unsigned short v = ((unsigned short *)src)[i];
+				*dst++ = rtab[PIXEL555RED8(v)] | gtab[PIXEL555GREEN8(v)] | btab[PIXEL555BLUE8(v)];
+			}
+			break;
+		case MWPF_TRUECOLOR1555:
+			for (i = 0; i < w; i++) {
+				unsigned short v = ((unsigned short *)src)[i];
+				*dst++ = rtab[PIXEL1555RED8(v)] | gtab[PIXEL1555GREEN8(v)] | btab[PIXEL1555BLUE8(v)];
+			}
+			break;
+		case MWPF_TRUECOLOR332:
+			for (i = 0; i < w; i++)
+				*dst++ = rtab[PIXEL332RED8(src[i])] | gtab[PIXEL332GREEN8(src[i])] | btab[PIXEL332BLUE8(src[i])];
+			break;
+		case MWPF_TRUECOLOR233:
+			for (i = 0; i < w; i++)
+				*dst++ = rtab[PIXEL233RED8(src[i])] | gtab[PIXEL233GREEN8(src[i])] | btab[PIXEL233BLUE8(src[i])];
+			break;
+		case MWPF_PALETTE:
+		default:
+			for (i = 0; i < w; i++) {
+				MWPALENTRY *pe = &gr_palette[src[i]];
+				*dst++ = rtab[pe->r] | gtab[pe->g] | btab[pe->b];
+			}
+			break;
+		}
+	}
+}
+
+/* hash screen tile contents, never returns 0*/
+static uint64_t
+rfb_hashtile(int tx, int ty)
+{
+	PSD psd = rfbpsd;
+	MWCOORD x = tx << RFB_TILESHIFT;
+	MWCOORD y = ty << RFB_TILESHIFT;
+	int bytes = MWMIN(RFB_TILE, psd->xres - x) * (psd->bpp >> 3);
+	int h = MWMIN(RFB_TILE, psd->yres - y);
+	uint64_t hash = 14695981039346656037ULL;	/* FNV-1a*/
+
+	while (--h >= 0) {
+		unsigned char *p = psd->addr + y++ * psd->pitch + x * (psd->bpp >> 3);
+		int n = bytes;
+
+		for (; n >= 4; n -= 4, p += 4) {
+			uint32_t v;
+			memcpy(&v, p, 4);
+			hash = (hash ^ v) * 1099511628211ULL;
+		}
+		while (--n >= 0)
+			hash = (hash ^ *p++) * 1099511628211ULL;
+	}
+	return hash | 1;
+}
+
+/* make room for len more output bytes, return pointer to them*/
+static unsigned char *
+rfb_reserve(RFBCLIENT *c, int len)
+{
+	if (c->outpos && c->outpos == c->outlen)
+		c->outpos = c->outlen = 0;
+	if (c->outlen + len > c->outsize) {
+		int size = c->outsize;
+		unsigned char *p;
+
+		while (c->outlen + len > size)
+			size *= 2;
+		if ((p = realloc(c->out, size)) == NULL)
+			return NULL;
+		c->out = p;
+		c->outsize = size;
+	}
+	return c->out + c->outlen;
+}
+
+static void
+rfb_write(RFBCLIENT *c, const void *buf, int len)
+{
+	unsigned char *p = rfb_reserve(c, len);
+
+	if (p) {
+		memcpy(p, buf, len);
+		c->outlen += len;
+	}
+}
+
+static void
+rfb_write8(RFBCLIENT *c, int v)
+{
+	unsigned char b = v;
+
+	rfb_write(c, &b, 1);
+}
+
+static void
+rfb_write16(RFBCLIENT *c, int v)
+{
+	unsigned char b[2];
+
+	b[0] = v >> 8;
+	b[1] = v;
+	rfb_write(c, b, 2);
+}
+
+static void
+rfb_write32(RFBCLIENT *c, uint32_t v)
+{
+	unsigned char b[4];
+
+	b[0] = v >> 24;
+	b[1] = v >> 16;
+	b[2] = v >> 8;
+	b[3] = v;
+	rfb_write(c, b, 4);
+}
+
+/* store client pixel value at p, return bytes stored*/
+static int
+rfb_putpixel(RFBCLIENT *c, unsigned char *p, uint32_t pixel)
+{
+	switch (c->bytespp) {
+	case 1:
+		p[0] = pixel;
+		break;
+	case 2:
+		if (c->pf.bigendian) {
+			p[0] = pixel >> 8;
+			p[1] = pixel;
+		} else {
+			p[0] = pixel;
+			p[1] = pixel >> 8;
+		}
+		break;
+	default:
+		if (c->pf.bigendian) {
+			p[0] = pixel >> 24;
+			p[1] = pixel >> 16;
+			p[2] = pixel >> 8;
+			p[3] = pixel;
+		} else {
+			p[0] = pixel;
+			p[1] = pixel >> 8;
+			p[2] = pixel >> 16;
+			p[3] = pixel >> 24;
+		}
+		break;
+	}
+	return c->bytespp;
+}
+
+static void
+rfb_writepixel(RFBCLIENT *c, uint32_t pixel)
+{
+	unsigned char *p = rfb_reserve(c, 4);
+
+	if (p)
+		c->outlen += rfb_putpixel(c, p, pixel);
+}
+
+static void
+rfb_writerecthdr(RFBCLIENT *c, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h, int encoding)
+{
+	rfb_write16(c, x);
+	rfb_write16(c, y);
+	rfb_write16(c, w);
+	rfb_write16(c, h);
+	rfb_write32(c, encoding);
+}
+
+/* send pixbuf as Raw encoding*/
+static void
+rfb_sendraw(RFBCLIENT *c, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
+{
+	unsigned char *p;
+	int i, n = w * h;
+
+	rfb_writerecthdr(c, x, y, w, h, RFB_ENC_RAW);
+	if ((p = rfb_reserve(c, n * c->bytespp)) == NULL)
+		return;
+	for (i = 0; i < n; i++)
+		p += rfb_putpixel(c, p, pixbuf[i]);
+	c->outlen += n * c->bytespp;
+}
+
+/*
+ * Send pixbuf as RRE encoding, background is the majority pixel and
+ * each row's runs of other pixels are subrectangles.
+ * Falls back to Raw if that would be smaller.
+ */
+static void
+rfb_sendrre(RFBCLIENT *c, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
+{
+	uint32_t bg = pixbuf[0];
+	int i, n = w * h, votes = 0, nsub = 0;
+	int row, col;
+
+	/* Boyer-Moore majority vote for background pixel*/
+	for (i = 0; i < n; i++) {
+		if (votes == 0) {
+			bg = pixbuf[i];
+			votes = 1;
+		} else if (pixbuf[i] == bg)
+			votes++;
+		else votes--;
+	}
+
+	/* count subrectangles*/
+	for (row = 0; row < h; row++) {
+		uint32_t *p = &pixbuf[row * w];
+		for (col = 0; col < w; ) {
+			uint32_t pix = p[col];
+			if (pix == bg) {
+				col++;
+				continue;
+			}
+			while (col < w && p[col] == pix)
+				col++;
+			nsub++;
+		}
+	}
+
+	if (4 + c->bytespp + nsub * (c->bytespp + 8) >= n * c->bytespp) {
+		rfb_sendraw(c, x, y, w, h);
+		return;
+	}
+
+	rfb_writerecthdr(c, x, y, w, h, RFB_ENC_RRE);
+	rfb_write32(c, nsub);
+	rfb_writepixel(c, bg);
+	for (row = 0; row < h; row++) {
+		uint32_t *p = &pixbuf[row * w];
+		for (col = 0; col < w; ) {
+			uint32_t pix = p[col];
+			int start = col;
+			if (pix == bg) {
+				col++;
+				continue;
+			}
+			while (col < w && p[col] == pix)
+				col++;
+			rfb_writepixel(c, pix);
+			rfb_write16(c, start);
+			rfb_write16(c, row);
+			rfb_write16(c, col - start);
+			rfb_write16(c, 1);
+		}
+	}
+}
+
+/* append to uncompressed ZRLE data*/
+static unsigned char *
+rfb_zreserve(int *zlen, int len)
+{
+	if (*zlen + len > zbufsize) {
+		int size = zbufsize? zbufsize: RFB_OUTBUFSIZE;
+		unsigned char *p;
+
+		while (*zlen + len > size)
+			size *= 2;
+		if ((p = realloc(zbuf, size)) == NULL)
+			return NULL;
+		zbuf = p;
+		zbufsize = size;
+	}
+	return zbuf + *zlen;
+}
+
+/* store ZRLE CPIXEL*/
+static unsigned char *
+rfb_putcpixel(RFBCLIENT *c, unsigned char *p, uint32_t pixel)
+{
+	unsigned char tmp[4];
+
+	if (c->cbytes == c->bytespp)
+		return p + rfb_putpixel(c, p, pixel);
+	rfb_putpixel(c, tmp, pixel);
+	memcpy(p, tmp + c->coffset, 3);
+	return p + 3;
+}
+
+/* store ZRLE run length*/
+static unsigned char *
+rfb_putrunlength(unsigned char *p, int len)
+{
+	len--;
+	while (len >= 255) {
+		*p++ = 255;
+		len -= 255;
+	}
+	*p++ = len;
+	return p;
+}
+
+/* encode one ZRLE tile from pixbuf, choosing the smallest subencoding*/
+static void
+rfb_zrletile(RFBCLIENT *c, int *zlen, uint32_t *pix, int stride, int w, int h)
+{
+	uint32_t palette[127];
+	unsigned char hashidx[256];		/* palette index+1 by pixel hash*/
+	int npal = 0, runs = 0, lenbytes = 0, longruns = 0;
+	int rawsize, rlesize, palrlesize, packedsize, bits;
+	int x, y, i, runlen = 0;
+	uint32_t prev = pix[0];
+	unsigned char *p, *start;
+
+	memset(hashidx, 0, sizeof(hashidx));
+
+	/* find palette of up to 127 colors and count runs in raster order*/
+	for (y = 0; y < h; y++) {
+		uint32_t *row = &pix[y * stride];
+		for (x = 0; x < w; x++) {
+			uint32_t v = row[x];
+
+			if (npal >= 0) {
+				unsigned int hv = (v ^ (v >> 8) ^ (v >> 16)) & 255;
+				while (hashidx[hv] && palette[hashidx[hv]-1] != v)
+					hv = (hv + 1) & 255;
+				if (!hashidx[hv]) {
+					if (npal < 127) {
+						palette[npal++] = v;
+						hashidx[hv] = npal;
+					} else npal = -1;	/* too many colors for palette*/
+				}
+			}
+			if (v == prev && (x || y))
+				runlen++;
+			else {
+				if (x || y) {
+					runs++;
+					lenbytes += (runlen - 1) / 255 + 1;
+					if (runlen > 1)
+						longruns++;
+				}
+				prev = v;
+				runlen = 1;
+			}
+		}
+	}
+	runs++;
+	lenbytes += (runlen - 1) / 255 + 1;
+	if (runlen > 1)
+		longruns++;
+
+	if ((start = rfb_zreserve(zlen, 1 + w * h * c->cbytes + 1)) == NULL)
+		return;
+	p = start;
+
+	/* solid tile*/
+	if (npal == 1) {
+		*p++ = 1;
+		p = rfb_putcpixel(c, p, palette[0]);
+		*zlen += p - start;
+		return;
+	}
+
+	rawsize = w * h * c->cbytes;
+	rlesize = runs * c->cbytes + lenbytes;
+	palrlesize = packedsize = rawsize + 1;
+	bits = 0;
+	if (npal > 0) {
+		/* index byte per run, plus run length for runs longer than one*/
+		palrlesize = npal * c->cbytes + runs + lenbytes - (runs - longruns);
+		bits = (npal <= 2)? 1: (npal <= 4)? 2: (npal <= 16)? 4: 0;
+		if (bits)
+			packedsize = npal * c->cbytes + ((w * bits + 7) / 8) * h;
+	}
+
+	if (bits && packedsize <= palrlesize && packedsize <= rlesize && packedsize <= rawsize) {
+		/* packed palette, rows padded to byte*/
+		*p++ = npal;
+		for (i = 0; i < npal; i++)
+			p = rfb_putcpixel(c, p, palette[i]);
+		for (y = 0; y < h; y++) {
+			uint32_t *row = &pix[y * stride];
+			int byte = 0, nbits = 0;
+			for (x = 0; x < w; x++) {
+				uint32_t v = row[x];
+				unsigned int hv = (v ^ (v >> 8) ^ (v >> 16)) & 255;
+				while (palette[hashidx[hv]-1] != v)
+					hv = (hv + 1) & 255;
+				byte = (byte << bits) | (hashidx[hv] - 1);
+				nbits += bits;
+				if (nbits == 8) {
+					*p++ = byte;
+					byte = nbits = 0;
+				}
+			}
+			if (nbits)
+				*p++ = byte << (8 - nbits);
+		}
+	} else if (npal > 0 && palrlesize <= rlesize && palrlesize <= rawsize) {
+		/* palette RLE*/
+		*p++ = 128 + npal;
+		for (i = 0; i < npal; i++)
+			p = rfb_putcpixel(c, p, palette[i]);
+		for (i = 0; i < w * h; ) {
+			uint32_t v = pix[(i / w) * stride + i % w];
+			unsigned int hv = (v ^ (v >> 8) ^ (v >> 16)) & 255;
+			int len = 1;
+
+			while (i + len < w * h && pix[((i + len) / w) * stride + (i + len) % w] == v)
+				len++;
+			while (palette[hashidx[hv]-1] != v)
+				hv = (hv + 1) & 255;
+			if (len == 1)
+				*p++ = hashidx[hv] - 1;
+			else {
+				*p++ = (hashidx[hv] - 1) | 128;
+				p = rfb_putrunlength(p, len);
+			}
+			i += len;
+		}
+	} else if (rlesize < rawsize) {
+		/* plain RLE*/
+		*p++ = 128;
+		for (i = 0; i < w * h; ) {
+			uint32_t v = pix[(i / w) * stride + i % w];
+			int len = 1;
+
+			while (i + len < w * h && pix[((i + len) / w) * stride + (i + len) % w] == v)
+				len++;
+			p = rfb_putcpixel(c, p, v);
+			p = rfb_putrunlength(p, len);
+			i += len;
+		}
+	} else {
+		/* raw*/
+		*p++ = 0;
+		for (y = 0; y < h; y++)
+			for (x = 0; x < w; x++)
+				p = rfb_putcpixel(c, p, pix[y * stride + x]);
+	}
+	*zlen += p - start;
+}
+
+/* send pixbuf as ZRLE encoding*/
+static void
+rfb_sendzrle(RFBCLIENT *c, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
+{
+	int tx, ty, zlen = 0, lenpos, ret;
+
+	if (!c->zsinit) {
+		memset(&c->zs, 0, sizeof(c->zs));
+		if (deflateInit(&c->zs, RFB_ZLIBLEVEL) != Z_OK) {
+			c->encoding = RFB_ENC_RAW;
+			rfb_sendraw(c, x, y, w, h);
+			return;
+		}
+		c->zsinit = 1;
+	}
+
+	for (ty = 0; ty < h; ty += RFB_ZRLETILE)
+		for (tx = 0; tx < w; tx += RFB_ZRLETILE)
+			rfb_zrletile(c, &zlen, &pixbuf[ty * w + tx], w,
+				MWMIN(RFB_ZRLETILE, w - tx), MWMIN(RFB_ZRLETILE, h - ty));
+
+	rfb_writerecthdr(c, x, y, w, h, RFB_ENC_ZRLE);
+	lenpos = c->outlen;
+	rfb_write32(c, 0);
+
+	c->zs.next_in = zbuf;
+	c->zs.avail_in = zlen;
+	do {
+		int room = deflateBound(&c->zs, c->zs.avail_in) + 64;
+		unsigned char *p = rfb_reserve(c, room);
+
+		if (!p)
+			break;
+		c->zs.next_out = p;
+		c->zs.avail_out = room;
+		ret = deflate(&c->zs, Z_SYNC_FLUSH);
+		c->outlen += room - c->zs.avail_out;
+	} while (ret == Z_OK && c->zs.avail_out == 0);
+
+	zlen = c->outlen - lenpos - 4;
+	c->out[lenpos] = zlen >> 24;
+	c->out[lenpos+1] = zlen >> 16;
+	c->out[lenpos+2] = zlen >> 8;
+	c->out[lenpos+3] = zlen;
+}
+
+/* send one rectangle of screen in client's preferred encoding*/
+static void
+rfb_sendrect(RFBCLIENT *c, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
+{
+	rfb_readrect(c, x, y, w, h);
+	switch (c->encoding) {
+	case RFB_ENC_ZRLE:
+		rfb_sendzrle(c, x, y, w, h);
+		break;
+	case RFB_ENC_RRE:
+		rfb_sendrre(c, x, y, w, h);
+		break;
+	default:
+		rfb_sendraw(c, x, y, w, h);
+		break;
+	}
+}
+
+/*
+ * Send FramebufferUpdate of pending copy and changed tiles.
+ * Dirty tiles whose contents hash matches what the client already
+ * has are skipped, the rest are sent as horizontal runs of tiles.
+ */
+static void
+rfb_sendupdate(RFBCLIENT *c)
+{
+	int tx, ty, i, nrects = 0;
+
+	for (ty = 0; ty < ntilesy; ty++) {
+		int inrun = 0;
+		for (tx = 0; tx < ntilesx; tx++) {
+			i = ty * ntilesx + tx;
+
+			sendtile[i] = 0;
+			if (c->dirty[i]) {
+				uint64_t hash = rfb_hashtile(tx, ty);
+
+				c->dirty[i] = 0;
+				if (hash != c->hash[i]) {
+					c->hash[i] = hash;
+					sendtile[i] = 1;
+				}
+			}
+			if (sendtile[i] && !inrun)
+				nrects++;
+			inrun = sendtile[i];
+		}
+	}
+	nrects += c->ncopies;
+	if (nrects == 0)
+		return;		/* nothing changed, keep request pending*/
+
+	rfb_write8(c, 0);		/* FramebufferUpdate*/
+	rfb_write8(c, 0);
+	rfb_write16(c, nrects);
+
+	/* copies must be first and in order, changed tiles assume they have been done*/
+	for (i = 0; i < c->ncopies; i++) {
+		rfb_writerecthdr(c, c->copies[i].x, c->copies[i].y, c->copies[i].w,
+			c->copies[i].h, RFB_ENC_COPYRECT);
+		rfb_write16(c, c->copies[i].srcx);
+		rfb_write16(c, c->copies[i].srcy);
+	}
+	c->ncopies = 0;
+
+	for (ty = 0; ty < ntilesy; ty++) {
+		for (tx = 0; tx < ntilesx; ) {
+			int start;
+			MWCOORD x, y, w, h;
+
+			if (!sendtile[ty * ntilesx + tx]) {
+				tx++;
+				continue;
+			}
+			start = tx;
+			while (tx < ntilesx && sendtile[ty * ntilesx + tx])
+				tx++;
+			x = start << RFB_TILESHIFT;
+			y = ty << RFB_TILESHIFT;
+			w = MWMIN(tx << RFB_TILESHIFT, rfbpsd->xres) - x;
+			h = MWMIN((ty + 1) << RFB_TILESHIFT, rfbpsd->yres) - y;
+			rfb_sendrect(c, x, y, w, h);
+		}
+	}
+	c->updatereq = 0;
+}
+
+/* send as much output as socket will take, return < 0 on error*/
+static int
+rfb_flush(RFBCLIENT *c)
+{
+	while (c->outpos < c->outlen) {
+		int n = send(c->fd, c->out + c->outpos, c->outlen - c->outpos, MSG_NOSIGNAL);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			return -1;
+		}
+		c->outpos += n;
+	}
+	c->outpos = c->outlen = 0;
+	return 0;
+}
+
+/* queue viewer input event*/
+static void
+rfb_queueevent(MWCOORD x, MWCOORD y, int buttons, MWKEY key, int down)
+{
+	int next = (evtail + 1) % RFB_MAXEVENTS;
+	int last = (evtail + RFB_MAXEVENTS - 1) % RFB_MAXEVENTS;
+
+	/* coalesce pointer motion*/
+	if (!key && evhead != evtail && !events[last].key && events[last].buttons == buttons) {
+		events[last].x = x;
+		events[last].y = y;
+		return;
+	}
+	if (next == evhead)
+		return;		/* queue full, drop event*/
+	events[evtail].x = x;
+	events[evtail].y = y;
+	events[evtail].buttons = buttons;
+	events[evtail].key = key;
+	events[evtail].down = down;
+	evtail = next;
+}
+
+/* convert X11 keysym to MWKEY, updating modifiers*/
+static MWKEY
+rfb_keysym(uint32_t sym, int down)
+{
+	MWKEYMOD mod = 0;
+	MWKEY mwkey;
+
+	if (sym >= 0x20 && sym <= 0xff)
+		mwkey = sym;		/* Latin-1*/
+	else if (sym >= 0xffbe && sym <= 0xffc9)
+		mwkey = MWKEY_F1 + (sym - 0xffbe);
+	else if (sym >= 0xffb0 && sym <= 0xffb9)
+		mwkey = MWKEY_KP0 + (sym - 0xffb0);
+	else switch (sym) {
+	case 0xff08: mwkey = MWKEY_BACKSPACE; break;
+	case 0xff09: mwkey = MWKEY_TAB; break;
+	case 0xff0d: mwkey = MWKEY_ENTER; break;
+	case 0xff1b: mwkey = MWKEY_ESCAPE; break;
+	case 0xffff: mwkey = MWKEY_DELETE; break;
+	case 0xff50: mwkey = MWKEY_HOME; break;
+	case 0xff51: mwkey = MWKEY_LEFT; break;
+	case 0xff52: mwkey = MWKEY_UP; break;
+	case 0xff53: mwkey = MWKEY_RIGHT; break;
+	case 0xff54: mwkey = MWKEY_DOWN; break;
+	case 0xff55: mwkey = MWKEY_PAGEUP; break;
+	case 0xff56: mwkey = MWKEY_PAGEDOWN; break;
+	case 0xff57: mwkey = MWKEY_END; break;
+	case 0xff63: mwkey = MWKEY_INSERT; break;
+	case 0xff13: mwkey = MWKEY_PAUSE; break;
+	case 0xff61: mwkey = MWKEY_PRINT; break;
+	case 0xff67: mwkey = MWKEY_MENU; break;
+	case 0xff8d: mwkey = MWKEY_KP_ENTER; break;
+	case 0xffaa: mwkey = MWKEY_KP_MULTIPLY; break;
+	case 0xffab: mwkey = MWKEY_KP_PLUS; break;
+	case 0xffad: mwkey = MWKEY_KP_MINUS; break;
+	case 0xffae: mwkey = MWKEY_KP_PERIOD; break;
+	case 0xffaf: mwkey = MWKEY_KP_DIVIDE; break;
+	case 0xffbd: mwkey = MWKEY_KP_EQUALS; break;
+	case 0xffe1: mwkey = MWKEY_LSHIFT; mod = MWKMOD_LSHIFT; break;
+	case 0xffe2: mwkey = MWKEY_RSHIFT; mod = MWKMOD_RSHIFT; break;
+	case 0xffe3: mwkey = MWKEY_LCTRL; mod = MWKMOD_LCTRL; break;
+	case 0xffe4: mwkey = MWKEY_RCTRL; mod = MWKMOD_RCTRL; break;
+	case 0xffe7: mwkey = MWKEY_LMETA; mod = MWKMOD_LMETA; break;
+	case 0xffe8: mwkey = MWKEY_RMETA; mod = MWKMOD_RMETA; break;
+	case 0xffe9: mwkey = MWKEY_LALT; mod = MWKMOD_LALT; break;
+	case 0xffea: mwkey = MWKEY_RALT; mod = MWKMOD_RALT; break;
+	case 0xff7e: mwkey = MWKEY_ALTGR; mod = MWKMOD_ALTGR; break;
+	case 0xffe5:
+		if (down)
+			keymods ^= MWKMOD_CAPS;
+		return MWKEY_CAPSLOCK;
+	case 0xff7f:
+		if (down)
+			keymods ^= MWKMOD_NUM;
+		return MWKEY_NUMLOCK;
+	case 0xff14:
+		if (down)
+			keymods ^= MWKMOD_SCR;
+		return MWKEY_SCROLLOCK;
+	default:
+		return MWKEY_UNKNOWN;
+	}
+
+	if (mod) {
+		if (down)
+			keymods |= mod;
+		else keymods &= ~mod;
+	}
+
+	/* control codes like kbd_x11*/
+	if ((keymods & MWKMOD_CTRL) && mwkey >= 0x40 && mwkey < 0x80)
+		mwkey &= 0x1f;
+	return mwkey;
+}
+
+/* send ServerInit*/
+static void
+rfb_serverinit(RFBCLIENT *c)
+{
+	static const char name[] = "Microwindows";
+	unsigned char pf[16];
+
+	/* default client format is 32bpp 8/8/8 truecolor little endian*/
+	memset(pf, 0, sizeof(pf));
+	pf[0] = 32;
+	pf[1] = 24;
+	pf[3] = 1;
+	pf[5] = pf[7] = pf[9] = 255;
+	pf[10] = 16;
+	pf[11] = 8;
+	rfb_setpixelformat(c, pf);
+
+	rfb_write16(c, rfbpsd->xres);
+	rfb_write16(c, rfbpsd->yres);
+	rfb_write(c, pf, 16);
+	rfb_write32(c, sizeof(name) - 1);
+	rfb_write(c, name, sizeof(name) - 1);
+
+	c->encoding = RFB_ENC_RAW;
+	memset(c->dirty, 1, ntiles);
+	memset(c->hash, 0, ntiles * sizeof(uint64_t));
+}
+
+/* handle one complete client message, return bytes used, 0 if incomplete, <0 on error*/
+static int
+rfb_message(RFBCLIENT *c, unsigned char *p, int len)
+{
+	int n, i;
+
+	switch (c->state) {
+	case RFB_VERSION:
+		if (len < 12)
+			return 0;
+		if (memcmp(p, "RFB 003.", 8) != 0)
+			return -1;
+		c->minor = atoi((char *)p + 8);
+		if (c->minor >= 8)
+			c->minor = 8;
+		else if (c->minor != 7)
+			c->minor = 3;
+		if (c->minor == 3) {
+			rfb_write32(c, 1);		/* security None*/
+			c->state = RFB_INIT;
+		} else {
+			rfb_write8(c, 1);		/* one security type*/
+			rfb_write8(c, 1);		/* None*/
+			c->state = RFB_SECURITY;
+		}
+		return 12;
+
+	case RFB_SECURITY:
+		if (p[0] != 1)
+			return -1;
+		if (c->minor == 8)
+			rfb_write32(c, 0);		/* SecurityResult ok*/
+		c->state = RFB_INIT;
+		return 1;
+
+	case RFB_INIT:					/* ClientInit shared flag ignored*/
+		rfb_serverinit(c);
+		c->state = RFB_NORMAL;
+		return 1;
+	}
+
+	switch (p[0]) {
+	case 0:							/* SetPixelFormat*/
+		if (len < 20)
+			return 0;
+		rfb_setpixelformat(c, p + 4);
+		memset(c->dirty, 1, ntiles);	/* resend everything in new format*/
+		memset(c->hash, 0, ntiles * sizeof(uint64_t));
+		c->ncopies = 0;
+		return 20;
+
+	case 2:							/* SetEncodings*/
+		if (len < 4)
+			return 0;
+		n = (p[2] << 8) | p[3];
+		if (4 + n * 4 > RFB_INBUFSIZE)
+			return -1;
+		if (len < 4 + n * 4)
+			return 0;
+		c->encoding = -1;
+		c->copyrect = 0;
+		for (i = 0; i < n; i++) {
+			unsigned char *e = p + 4 + i * 4;
+			int32_t enc = (int32_t)(((uint32_t)e[0] << 24) | (e[1] << 16) | (e[2] << 8) | e[3]);
+
+			if (enc == RFB_ENC_COPYRECT)
+				c->copyrect = 1;
+			else if (c->encoding < 0 &&
+				(enc == RFB_ENC_ZRLE || enc == RFB_ENC_RRE || enc == RFB_ENC_RAW))
+					c->encoding = enc;
+		}
+		if (c->encoding < 0)
+			c->encoding = RFB_ENC_RAW;
+		return 4 + n * 4;
+
+	case 3:							/* FramebufferUpdateRequest*/
+		if (len < 10)
+			return 0;
+		if (!p[1]) {
+			/* non-incremental, client doesn't have contents*/
+			rfb_dirtyrect(c, (p[2] << 8) | p[3], (p[4] << 8) | p[5],
+				(p[6] << 8) | p[7], (p[8] << 8) | p[9], 1);
+		}
+		c->updatereq = 1;
+		return 10;
+
+	case 4:							/* KeyEvent*/
+		if (len < 8) return 0;
+		{
+			uint32_t sym = ((uint32_t)p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7];
+			MWKEY key = rfb_keysym(sym, p[1]);
+
+			if (key != MWKEY_UNKNOWN)
+				rfb_queueevent(0, 0, 0, key, p[1]);
+		}
+		return 8;
+
+	case 5:							/* PointerEvent*/
+		if (len < 6)
+			return 0;
+		{
+			int mask = p[1];
+			int buttons = 0;
+
+			if (mask & 0x01) buttons |= MWBUTTON_L;
+			if (mask & 0x02) buttons |= MWBUTTON_M;
+			if (mask & 0x04) buttons |= MWBUTTON_R;
+			if (mask & 0x08) buttons |= MWBUTTON_SCROLLUP;
+			if (mask & 0x10) buttons |= MWBUTTON_SCROLLDN;
+			rfb_queueevent((p[2] << 8) | p[3], (p[4] << 8) | p[5], buttons, 0, 0);
+		}
+		return 6;
+
+	case 6:							/* ClientCutText, ignored*/
+		if (len < 8)
+			return 0;
+		c->skip = ((uint32_t)p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7];
+		return 8;
+	}
+
+	EPRINTF("rfbserver: unknown client message %d\n", p[0]);
+	return -1;
+}
+
+/* read and handle client messages, return < 0 if connection closed*/
+static int
+rfb_readclient(RFBCLIENT *c)
+{
+	int n, used, pos = 0;
+
+	n = recv(c->fd, c->in + c->inlen, RFB_INBUFSIZE - c->inlen, 0);
+	if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK))
+		return -1;
+	if (n < 0)
+		return 0;
+	c->inlen += n;
+
+	for (;;) {
+		if (c->skip) {
+			n = MWMIN((unsigned long)(c->inlen - pos), c->skip);
+			c->skip -= n;
+			pos += n;
+		}
+		if (pos >= c->inlen)
+			break;
+		used = rfb_message(c, c->in + pos, c->inlen - pos);
+		if (used < 0)
+			return -1;
+		if (used == 0)
+			break;
+		pos += used;
+	}
+	memmove(c->in, c->in + pos, c->inlen - pos);
+	c->inlen -= pos;
+	return 0;
+}
+
+static void
+rfb_accept(void)
+{
+	RFBCLIENT *c;
+	int fd, one = 1;
+
+	if ((fd = accept(listenfd, NULL, NULL)) < 0)
+		return;
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+	if ((c = calloc(1, sizeof(RFBCLIENT))) == NULL)
+		goto err;
+	c->fd = fd;
+	c->state = RFB_VERSION;
+	c->outsize = RFB_OUTBUFSIZE;
+	c->out = malloc(c->outsize);
+	c->dirty = malloc(ntiles);
+	c->hash = malloc(ntiles * sizeof(uint64_t));
+	if (!c->out || !c->dirty || !c->hash) {
+		free(c->out);
+		free(c->dirty);
+		free(c->hash);
+		free(c);
+		goto err;
+	}
+	c->next = clients;
+	clients = c;
+
+	rfb_write(c, "RFB 003.008\n", 12);
+	rfb_flush(c);
+	return;
+
+err:
+	EPRINTF("rfbserver: out of memory\n");
+	close(fd);
+}
+
+static void
+rfb_drop(RFBCLIENT *c)
+{
+	RFBCLIENT **pp;
+
+	for (pp = &clients; *pp; pp = &(*pp)->next) {
+		if (*pp == c) {
+			*pp = c->next;
+			break;
+		}
+	}
+	close(c->fd);
+	if (c->zsinit)
+		deflateEnd(&c->zs);
+	free(c->out);
+	free(c->dirty);
+	free(c->hash);
+	free(c);
+}
+
+/* screen driver PreSelect() wrapper, send updates to waiting clients*/
+static int
+rfb_preselect(PSD psd)
+{
+	RFBCLIENT *c, *next;
+	int n = 0;
+
+	if (orgPreSelect)
+		n = orgPreSelect(psd);
+
+	for (c = clients; c; c = next) {
+		next = c->next;
+		if (c->state == RFB_NORMAL && c->updatereq && c->outpos == c->outlen) {
+			rfb_sendupdate(c);
+			if (rfb_flush(c) < 0)
+				rfb_drop(c);
+		}
+	}
+
+	/* return # pending events, GsSelect then reads them through mouse/kbd drivers*/
+	return n + (evhead != evtail);
+}
+
+/* mouse driver Read() wrapper, return viewer pointer events first*/
+static int
+rfb_mouseread(MWCOORD *dx, MWCOORD *dy, MWCOORD *dz, int *bp)
+{
+	while (evhead != evtail) {
+		RFBEVENT *ev = &events[evhead];
+
+		if (ev->key)
+			break;			/* key event next, wait for kbd read*/
+		evhead = (evhead + 1) % RFB_MAXEVENTS;
+		*dx = ev->x;
+		*dy = ev->y;
+		*dz = 0;
+		*bp = ev->buttons;
+		return MOUSE_ABSPOS;
+	}
+	return orgMouseRead(dx, dy, dz, bp);
+}
+
+/* keyboard driver Read() wrapper, return viewer key events first*/
+static int
+rfb_kbdread(MWKEY *buf, MWKEYMOD *modifiers, MWSCANCODE *scancode)
+{
+	while (evhead != evtail) {
+		RFBEVENT *ev = &events[evhead];
+
+		if (!ev->key)
+			break;			/* pointer event next, wait for mouse read*/
+		evhead = (evhead + 1) % RFB_MAXEVENTS;
+		*buf = ev->key;
+		*modifiers = keymods;
+		*scancode = 0;
+		return ev->down? KBD_KEYPRESS: KBD_KEYRELEASE;
+	}
+	return orgKbdRead(buf, modifiers, scancode);
+}
+
+/**
+ * Start RFB server on the opened screen device.
+ * Wraps the screen driver Update, PreSelect and CopyArea entry points
+ * and the mouse and keyboard driver Read functions.
+ *
+ * @param psd Screen device, must be opened.
+ * @return Listening socket descriptor, or -1 on error.
+ */
+int
+GdOpenRFBServer(PSD psd)
+{
+	struct sockaddr_in sin;
+	struct in_addr addr;
+	char *env;
+	int port = RFB_PORT;
+	int one = 1;
+
+	if (listenfd >= 0)
+		return listenfd;
+
+	if (psd->bpp < 8) {
+		EPRINTF("rfbserver: %dbpp screens not supported\n", psd->bpp);
+		return -1;
+	}
+
+	if ((env = getenv("RFBPORT")) != NULL)
+		port = atoi(env);
+
+	/* no authentication, so listen on loopback unless told otherwise*/
+	addr.s_addr = htonl(INADDR_LOOPBACK);
+	if ((env = getenv("RFBADDR")) != NULL) {
+		if (!inet_aton(env, &addr)) {
+			EPRINTF("rfbserver: bad RFBADDR %s\n", env);
+			return -1;
+		}
+		if (addr.s_addr != htonl(INADDR_LOOPBACK))
+			EPRINTF("rfbserver: WARNING: listening on %s, no VNC authentication\n", env);
+	}
+
+	ntilesx = (psd->xres + RFB_TILE - 1) >> RFB_TILESHIFT;
+	ntilesy = (psd->yres + RFB_TILE - 1) >> RFB_TILESHIFT;
+	ntiles = ntilesx * ntilesy;
+	tilesnap = malloc(ntiles);
+	sendtile = malloc(ntiles);
+	pixbuf = malloc(ntilesx * RFB_TILE * RFB_TILE * sizeof(uint32_t));
+	if (!tilesnap || !sendtile || !pixbuf) {
+		EPRINTF("rfbserver: out of memory\n");
+		goto err;
+	}
+
+	if ((listenfd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+		goto err;
+	setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr = addr;
+	sin.sin_port = htons(port);
+	if (bind(listenfd, (struct sockaddr *)&sin, sizeof(sin)) < 0 || listen(listenfd, 4) < 0) {
+		EPRINTF("rfbserver: can't listen on port %d\n", port);
+		close(listenfd);
+		listenfd = -1;
+		goto err;
+	}
+	fcntl(listenfd, F_SETFL, O_NONBLOCK);
+#if RFB_NEEDSIGPIPE && !defined(SO_NOSIGPIPE)
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	rfbpsd = psd;
+	orgUpdate = psd->Update;
+	orgPreSelect = psd->PreSelect;
+	psd->Update = rfb_update;
+	psd->PreSelect = rfb_preselect;
+	psd->CopyArea = rfb_copyarea;
+	orgMouseRead = mousedev.Read;
+	orgKbdRead = kbddev.Read;
+	mousedev.Read = rfb_mouseread;
+	kbddev.Read = rfb_kbdread;
+	return listenfd;
+
+err:
+	free(tilesnap);
+	free(sendtile);
+	free(pixbuf);
+	tilesnap = sendtile = NULL;
+	pixbuf = NULL;
+	return -1;
+}
+
+/**
+ * Stop RFB server, disconnecting all clients and restoring driver entry points.
+ */
+void
+GdCloseRFBServer(void)
+{
+	if (listenfd < 0)
+		return;
+
+	while (clients)
+		rfb_drop(clients);
+	close(listenfd);
+	listenfd = -1;
+
+	rfbpsd->Update = orgUpdate;
+	rfbpsd->PreSelect = orgPreSelect;
+	rfbpsd->CopyArea = NULL;
+	mousedev.Read = orgMouseRead;
+	kbddev.Read = orgKbdRead;
+
+	free(tilesnap);
+	free(sendtile);
+	free(pixbuf);
+	free(zbuf);
+	tilesnap = sendtile = zbuf = NULL;
+	pixbuf = NULL;
+	zbufsize = 0;
+}
+
+/**
+ * Add RFB server descriptors to select() sets.
+ *
+ * @param maxfd Current highest descriptor in sets.
+ * @param rfdset Read fd_set, descriptors added.
+ * @param wfdset Write fd_set for clients with unsent output, may be NULL.
+ * @return New highest descriptor.
+ */
+int
+GdRFBPrepareSelect(int maxfd, void *rfdset, void *wfdset)
+{
+	fd_set *rfds = rfdset;
+	fd_set *wfds = wfdset;
+	RFBCLIENT *c;
+
+	if (listenfd < 0)
+		return maxfd;
+
+	FD_SET(listenfd, rfds);
+	if (listenfd > maxfd)
+		maxfd = listenfd;
+	for (c = clients; c; c = c->next) {
+		FD_SET(c->fd, rfds);
+		if (wfds && c->outpos < c->outlen)
+			FD_SET(c->fd, wfds);
+		if (c->fd > maxfd)
+			maxfd = c->fd;
+	}
+	return maxfd;
+}
+
+/**
+ * Service RFB server descriptors after select().
+ * Accepts connections, reads client messages and flushes output.
+ *
+ * @param rfdset Read fd_set returned by select().
+ * @param wfdset Write fd_set returned by select(), may be NULL.
+ * @return Nonzero if viewer input events are waiting to be read
+ * through the mouse and keyboard drivers.
+ */
+int
+GdRFBServiceSelect(void *rfdset, void *wfdset)
+{
+	fd_set *rfds = rfdset;
+	RFBCLIENT *c, *next;
+
+	if (listenfd < 0)
+		return 0;
+
+	for (c = clients; c; c = next) {
+		next = c->next;
+		if (FD_ISSET(c->fd, rfds) && rfb_readclient(c) < 0) {
+			rfb_drop(c);
+			continue;
+		}
+		if (c->outpos < c->outlen && rfb_flush(c) < 0)
+			rfb_drop(c);
+	}
+
+	if (FD_ISSET(listenfd, rfds))
+		rfb_accept();
+
+	return evhead != evtail;
+}
+#endif /* MW_FEATURE_RFBSERVER - whole file*/
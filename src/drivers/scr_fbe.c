@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include "device.h"
 #include "genfont.h"
@@ -25,6 +26,7 @@
 #if !TESTDRIVER
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 
 #if !defined(SCREEN_DEPTH) && (MWPIXEL_FORMAT == MWPF_PALETTE)
@@ -33,12 +35,20 @@
 #endif
 
 static int fb = -1;						/* Framebuffer file handle*/
+#if !TESTDRIVER
+static FBEDAMAGE *damage;				/* tiles shared with fbe, NULL if not supported*/
+static int wakeup_fd = -1;				/* damage wakeup fifo*/
+#endif
 
 static PSD  fbe_open(PSD psd);
 static void fbe_close(PSD psd);
 static void fbe_setpalette(PSD psd,int first,int count,MWPALENTRY *pal);
 static int fbe_preselect(PSD psd);
 static void fbe_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+#if !TESTDRIVER
+static void fbe_opendamage(PSD psd);
+static void fbe_damage(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+#endif
 
 SCREENDEVICE scrdev = {
 	0, 0, 0, 0, 0, 0, 0, NULL, 0, NULL, 0, 0, 0, 0, 0, 0,
@@ -99,6 +109,10 @@ fbe_open(PSD psd)
 			close(fb);
 			return NULL;
 		}
+
+		/* tell fbe which areas change rather than have it poll framebuffer*/
+		if (!strcmp(env, MW_PATH_FBE_FRAMEBUFFER))
+			fbe_opendamage(psd);
 	}
 	else {
 		EPRINTF("Error opening %s\n", env);
@@ -114,6 +128,14 @@ static void
 fbe_close(PSD psd)
 {
 #if !TESTDRIVER
+	if (damage) {
+		damage->active = 0;
+		munmap((void *)damage, sizeof(FBEDAMAGE));
+		damage = NULL;
+	}
+	if (wakeup_fd >= 0)
+		close(wakeup_fd);
+	wakeup_fd = -1;
 	if (fb >= 0)
 		close(fb);
 	fb = -1;
@@ -128,6 +150,76 @@ fbe_setpalette(PSD psd,int first,int count,MWPALENTRY *pal)
 {
 }
 
+#if !TESTDRIVER
+/*
+ * Open damage tiles and wakeup fifo created by fbe.  If found, Update()
+ * marks changed tiles, and fbe sleeps until woken rather than comparing
+ * the framebuffer every few milliseconds.  An older fbe has neither file.
+ */
+static void
+fbe_opendamage(PSD psd)
+{
+	int fd;
+	struct stat st;
+
+	if ((fd = open(MW_PATH_FBE_DAMAGE, O_RDWR)) < 0)
+		return;
+	if (fstat(fd, &st) < 0 || st.st_size < sizeof(FBEDAMAGE)) {
+		close(fd);
+		return;
+	}
+	damage = mmap(NULL, sizeof(FBEDAMAGE), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (damage == MAP_FAILED) {
+		damage = NULL;
+		return;
+	}
+
+	/* open read/write so writes never fail with no reader, only one byte is pending*/
+	if ((wakeup_fd = open(MW_PATH_FBE_WAKEUP, O_RDWR | O_NONBLOCK)) < 0) {
+		munmap((void *)damage, sizeof(FBEDAMAGE));
+		damage = NULL;
+		return;
+	}
+
+	psd->Update = fbe_damage;
+	damage->active = 1;
+	fbe_damage(psd, 0, 0, psd->xres, psd->yres);
+}
+
+/* called from framebuffer drivers with bounding rect of updated framebuffer region*/
+static void
+fbe_damage(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	int tx, ty, tx2, ty2;
+
+	/* clip to screen origin*/
+	if (x < 0) {
+		width += x;
+		x = 0;
+	}
+	if (y < 0) {
+		height += y;
+		y = 0;
+	}
+	if (width <= 0 || height <= 0)
+		return;
+	tx2 = MWMIN(x + width - 1, FBE_MAXTILESX * FBE_TILESIZE - 1) / FBE_TILESIZE;
+	ty2 = MWMIN(y + height - 1, FBE_MAXTILESY * FBE_TILESIZE - 1) / FBE_TILESIZE;
+	for (ty = y / FBE_TILESIZE; ty <= ty2; ty++)
+		for (tx = x / FBE_TILESIZE; tx <= tx2; tx++)
+			damage->tiles[ty][tx] = 1;
+
+	/* tiles must be visible to fbe before it can see signalled cleared*/
+	__sync_synchronize();
+	if (!damage->signalled) {
+		damage->signalled = 1;
+		if (write(wakeup_fd, "", 1) < 0)
+			return;			/* fifo full, fbe already has wakeups pending*/
+	}
+}
+#endif /* !TESTDRIVER*/
+
 #if TESTDRIVER
 /*
  * The following routines are not required for FBE framebuffer, but
@@ -0,0 +1,288 @@
+/*
+ * Microwindows headless memory screen driver
+ * Set SCREEN=MEM in config, usually with MOUSE=NOMOUSE and KEYBOARD=NOKBD.
+ *
+ * Draws into a malloc'd framebuffer with no display, for running the
+ * engine, nano-X and mwin demos in automated tests and benchmarks.
+ * The pixel format is SCREEN_PIXTYPE, the size SCREEN_WIDTH x SCREEN_HEIGHT.
+ *
+ * Environment variables:
+ *	MEMSCREEN=640x480			override screen size
+ *	MEMSCREEN_DUMP=file%04d.ppm	write frames, %d is frame number, .png for PNG
+ *	MEMSCREEN_INTERVAL=n		write every n'th frame, otherwise only on
+ *								SIGUSR2 and when the screen is closed
+ *	MEMSCREEN_STATS=1			print Update() damage for each frame to stderr
+ *
+ * A frame is all drawing between two PreSelect calls, that is each time
+ * the server or application finishes drawing and waits for input.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "device.h"
+#include "genfont.h"
+#include "genmem.h"
+#include "fb.h"
+#if HAVE_PNG_SUPPORT
+#include <png.h>
+#endif
+
+#if !defined(SCREEN_DEPTH) && (MWPIXEL_FORMAT == MWPF_PALETTE)
+/* SCREEN_DEPTH is used only for palette modes*/
+#error SCREEN_DEPTH not defined - must be set for palette modes
+#endif
+
+static PSD  mem_open(PSD psd);
+static void mem_close(PSD psd);
+static void mem_setpalette(PSD psd,int first,int count,MWPALENTRY *pal);
+static void mem_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+static int  mem_preselect(PSD psd);
+
+SCREENDEVICE scrdev = {
+	0, 0, 0, 0, 0, 0, 0, NULL, 0, NULL, 0, 0, 0, 0, 0, 0,
+	gen_fonts,
+	mem_open,
+	mem_close,
+	mem_setpalette,
+	gen_getscreeninfo,
+	gen_allocatememgc,
+	gen_mapmemgc,
+	gen_freememgc,
+	gen_setportrait,
+	mem_update,
+	mem_preselect
+};
+
+static char *dumpfile;					/* frame file name pattern*/
+static int dumpinterval;				/* write every n'th frame, 0 for none*/
+static int showstats;					/* print damage per frame*/
+static volatile sig_atomic_t dumpnow;	/* set by SIGUSR2*/
+
+/* damage since last PreSelect*/
+static long frame;						/* frames drawn*/
+static long updates;					/* Update() calls this frame*/
+static long pixels;						/* pixels updated this frame*/
+static MWCOORD upminX, upminY, upmaxX, upmaxY;
+
+/* totals for all frames*/
+static long totalupdates;
+static long long totalpixels;
+
+static void
+mem_dumpsignal(int sig)
+{
+	dumpnow = 1;
+}
+
+/* allocate framebuffer in memory*/
+static PSD
+mem_open(PSD psd)
+{
+	char *env;
+	int xres = SCREEN_WIDTH;
+	int yres = SCREEN_HEIGHT;
+
+	if ((env = getenv("MEMSCREEN")) != NULL) {
+		if (sscanf(env, "%dx%d", &xres, &yres) != 2 || xres <= 0 || yres <= 0) {
+			EPRINTF("Invalid MEMSCREEN=%s, must be WIDTHxHEIGHT\n", env);
+			return NULL;
+		}
+	}
+
+	if (!gen_initpsd(psd, MWPIXEL_FORMAT, xres, yres, PSF_SCREEN))
+		return NULL;
+
+	/* psd->size is calculated by subdriver init*/
+	if ((psd->addr = calloc(1, psd->size)) == NULL)
+		return NULL;
+	psd->flags |= PSF_ADDRMALLOC;
+
+	dumpfile = getenv("MEMSCREEN_DUMP");
+	if ((env = getenv("MEMSCREEN_INTERVAL")) != NULL)
+		dumpinterval = atoi(env);
+	showstats = getenv("MEMSCREEN_STATS") != NULL;
+	if (dumpfile)
+		signal(SIGUSR2, mem_dumpsignal);
+
+	frame = updates = pixels = totalupdates = totalpixels = 0;
+	upminX = upminY = MAX_MWCOORD;
+	upmaxX = upmaxY = MIN_MWCOORD;
+
+	return psd;	/* success*/
+}
+
+/* write screen as binary PPM*/
+static int
+mem_writeppm(PSD psd, FILE *fp)
+{
+	MWCOORD x, y;
+
+	fprintf(fp, "P6\n%d %d\n255\n", psd->xvirtres, psd->yvirtres);
+	for (y = 0; y < psd->yvirtres; y++) {
+		for (x = 0; x < psd->xvirtres; x++) {
+			MWCOLORVAL c = GdGetColorRGB(psd, psd->ReadPixel(psd, x, y));
+
+			putc(REDVALUE(c), fp);
+			putc(GREENVALUE(c), fp);
+			putc(BLUEVALUE(c), fp);
+		}
+	}
+	return ferror(fp)? -1: 0;
+}
+
+#if HAVE_PNG_SUPPORT
+/* write screen as RGB PNG*/
+static int
+mem_writepng(PSD psd, FILE *fp)
+{
+	png_structp png;
+	png_infop info;
+	unsigned char *row;
+	MWCOORD x, y;
+
+	if ((row = malloc(psd->xvirtres * 3)) == NULL)
+		return -1;
+	png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	info = png? png_create_info_struct(png): NULL;
+	if (!info || setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, info? &info: NULL);
+		free(row);
+		return -1;
+	}
+
+	png_init_io(png, fp);
+	png_set_compression_level(png, 1);	/* fast, tests write many frames*/
+	png_set_IHDR(png, info, psd->xvirtres, psd->yvirtres, 8, PNG_COLOR_TYPE_RGB,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+	for (y = 0; y < psd->yvirtres; y++) {
+		unsigned char *p = row;
+
+		for (x = 0; x < psd->xvirtres; x++) {
+			MWCOLORVAL c = GdGetColorRGB(psd, psd->ReadPixel(psd, x, y));
+
+			*p++ = REDVALUE(c);
+			*p++ = GREENVALUE(c);
+			*p++ = BLUEVALUE(c);
+		}
+		png_write_row(png, row);
+	}
+	png_write_end(png, info);
+	png_destroy_write_struct(&png, &info);
+	free(row);
+	return 0;
+}
+#endif
+
+/* write current frame to MEMSCREEN_DUMP file*/
+static void
+mem_dump(PSD psd)
+{
+	FILE *fp;
+	char *ext;
+	int ret;
+	char *pct;
+	int width = 0;
+	char path[256];
+
+	/* substitute frame number for first %d or %0Nd, never use pattern as format*/
+	for (pct = strchr(dumpfile, '%'); pct; pct = strchr(pct + 1, '%')) {
+		char *p = pct + 1;
+
+		width = 0;
+		while (*p >= '0' && *p <= '9')
+			width = width * 10 + *p++ - '0';
+		if (*p == 'd' && width < 32)
+			break;
+	}
+	if (pct)
+		snprintf(path, sizeof(path), "%.*s%0*d%s", (int)(pct - dumpfile), dumpfile,
+			width, (int)frame, strchr(pct, 'd') + 1);
+	else
+		snprintf(path, sizeof(path), "%s", dumpfile);
+	if ((fp = fopen(path, "wb")) == NULL) {
+		EPRINTF("Can't create %s\n", path);
+		return;
+	}
+	ext = strrchr(path, '.');
+#if HAVE_PNG_SUPPORT
+	if (ext && !strcmp(ext, ".png"))
+		ret = mem_writepng(psd, fp);
+	else
+#endif
+		ret = mem_writeppm(psd, fp);
+	if (fclose(fp) != 0 || ret < 0)
+		EPRINTF("Error writing %s\n", path);
+}
+
+/* end current frame if anything drawn*/
+static void
+mem_endframe(PSD psd)
+{
+	if (!updates)
+		return;
+
+	frame++;
+	totalupdates += updates;
+	totalpixels += pixels;
+	if (showstats)
+		EPRINTF("memscreen: frame %ld updates %ld pixels %ld bounds %d,%d %dx%d\n",
+			frame, updates, pixels, upminX, upminY, upmaxX-upminX+1, upmaxY-upminY+1);
+
+	if (dumpfile && dumpinterval > 0 && frame % dumpinterval == 0)
+		mem_dump(psd);
+
+	/* reset update region*/
+	updates = pixels = 0;
+	upminX = upminY = MAX_MWCOORD;
+	upmaxX = upmaxY = MIN_MWCOORD;
+}
+
+/* write last frame and print totals*/
+static void
+mem_close(PSD psd)
+{
+	mem_endframe(psd);
+	if (dumpfile)
+		mem_dump(psd);
+	if (showstats)
+		EPRINTF("memscreen: total frames %ld updates %ld pixels %lld\n",
+			frame, totalupdates, totalpixels);
+
+	if ((psd->flags & PSF_ADDRMALLOC))
+		free(psd->addr);
+	psd->addr = NULL;
+}
+
+/* palette is kept in gr_palette by engine*/
+static void
+mem_setpalette(PSD psd,int first,int count,MWPALENTRY *pal)
+{
+}
+
+/* called from framebuffer drivers with bounding rect of updated framebuffer region*/
+static void
+mem_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	updates++;
+	pixels += (long)width * height;
+	upminX = MWMIN(x, upminX);
+	upminY = MWMIN(y, upminY);
+	upmaxX = MWMAX(upmaxX, x+width-1);
+	upmaxY = MWMAX(upmaxY, y+height-1);
+}
+
+/* called before select(), returns # pending events*/
+static int
+mem_preselect(PSD psd)
+{
+	mem_endframe(psd);
+
+	/* SIGUSR2 writes current frame*/
+	if (dumpnow) {
+		dumpnow = 0;
+		mem_dump(psd);
+	}
+	return 0;
+}
@@ -21,8 +21,6 @@
 
 #define NEWARCANGLE	1	/* =1 uses new integer-only GdArcAngle*/
 
-extern int        gr_fillmode;
-
 #if NEWARCANGLE
 
 /* integer sin/cos tables*/
@@ -403,9 +401,6 @@ drawarcsegment(SLICE *slice, MWCOORD xp, MWCOORD yp, int drawon)
 static void
 drawarc(SLICE *slice)
 {
-	extern uint32_t gr_dashmask;     
-	extern uint32_t gr_dashcount;    
-
 	MWCOORD xp, yp;		/* current point (based on center) */
 	MWCOORD rx, ry;
 	long Asquared;		/* square of x semi axis */
@@ -640,6 +635,203 @@ GdEllipse(PSD psd, MWCOORD x, MWCOORD y, MWCOORD rx, MWCOORD ry, MWBOOL fill)
 	GdFixCursor(psd);
 }
 
+/* rounded rectangle, corners are quarter ellipses with centers rx,ry inside*/
+typedef struct {
+	MWCOORD	x, y, w, h;
+	MWCOORD	rx, ry;
+} RRECT;
+
+/*
+ * Return the inset from the left and right sides of row y of a rounded rectangle,
+ * or the width if y is outside it.  A pixel is inside a corner if its center
+ * is inside the ellipse with radii rx+1/2, ry+1/2.
+ */
+static MWCOORD
+rrinset(RRECT *r, MWCOORD y)
+{
+	int64_t a, b, d;
+
+	if (y < r->y || y >= r->y + r->h)
+		return r->w;
+
+	d = r->y + r->ry - y;			/* rows above top corner centers*/
+	if (d <= 0) {
+		d = y - (r->y + r->h - 1 - r->ry);	/* rows below bottom centers*/
+		if (d <= 0)
+			return 0;
+	}
+	a = 2 * r->rx + 1;
+	b = 2 * r->ry + 1;
+	d *= 2;
+	return r->rx - (MWCOORD)(GdIntSqrt(a * a * (b * b - d * d)) / (2 * b));
+}
+
+/* draw row y from x1 to x2 as a line or with the fill pattern*/
+static void
+rrdrawrow(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y, MWBOOL pattern)
+{
+	if (x1 > x2)
+		return;
+	if (pattern)
+		ts_drawrow(psd, x1, x2, y);
+	else
+		drawrow(psd, x1, x2, y);
+}
+
+/* draw the left and right outline spans of row y with insets a to b*/
+static void
+rrdrawedges(PSD psd, RRECT *r, MWCOORD a, MWCOORD b, MWCOORD y)
+{
+	MWCOORD x2 = r->x + r->w - 1;
+
+	if (r->w - 1 - b <= b + 1)		/* left and right meet*/
+		drawrow(psd, r->x + a, x2 - a, y);
+	else {
+		drawrow(psd, r->x + a, r->x + b, y);
+		drawrow(psd, x2 - b, x2 - a, y);
+	}
+}
+
+/* fill rows y1 to y2 of the full rectangle width*/
+static void
+rrfillrows(PSD psd, RRECT *r, MWCOORD y1, MWCOORD y2, MWBOOL pattern)
+{
+	MWCOORD x2 = r->x + r->w - 1;
+
+	if (y1 > y2)
+		return;
+	if (pattern) {
+		ts_fillrect(psd, r->x, y1, r->w, y2 - y1 + 1);
+		return;
+	}
+
+	switch (GdClipArea(psd, r->x, y1, x2, y2)) {
+	case CLIP_VISIBLE:
+		psd->FillRect(psd, r->x, y1, x2, y2, gr_foreground);
+		return;
+
+	case CLIP_INVISIBLE:
+		return;
+	}
+	while (y1 <= y2)
+		drawrow(psd, r->x, x2, y1++);
+}
+
+/**
+ * Draw a rectangle with rounded corners using the current clipping region
+ * and foreground color.  The outline uses the current line width, the fill
+ * uses the current fill mode.  Each pixel is drawn once, so XOR is correct.
+ * Integer only routine.
+ *
+ * @param psd Destination surface.
+ * @param x Left edge of rectangle.
+ * @param y Top edge of rectangle.
+ * @param w Width of rectangle.
+ * @param h Height of rectangle.
+ * @param rx Radius of corners in X direction.
+ * @param ry Radius of corners in Y direction.
+ * @param fill Nonzero for a filled rectangle, zero for an outline.
+ */
+void
+GdRoundRect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h, MWCOORD rx, MWCOORD ry,
+	MWBOOL fill)
+{
+	RRECT	r, in;
+	MWCOORD	yy, a, b;
+	MWCOORD	lw = (!fill && gr_linewidth > 1)? gr_linewidth: 0;
+	MWBOOL	pattern = FALSE;
+	uint32_t dm = 0;
+	int dc = 0;
+
+	if (w <= 0 || h <= 0)
+		return;
+
+	/* corner ellipses must fit, and radii this large would overflow rrinset*/
+	rx = MWMAX(0, MWMIN(rx, MWMIN((w - 1) / 2, 16383)));
+	ry = MWMAX(0, MWMIN(ry, MWMIN((h - 1) / 2, 16383)));
+
+	/* wide outline is centered on the rectangle edges like GdRect*/
+	if (lw) {
+		x -= lw / 2;
+		y -= lw / 2;
+		w += lw / 2 * 2;
+		h += lw / 2 * 2;
+		rx += lw / 2;
+		ry += lw / 2;
+	}
+	r.x = x;
+	r.y = y;
+	r.w = w;
+	r.h = h;
+	r.rx = rx;
+	r.ry = ry;
+
+	if (GdClipArea(psd, x, y, x + w - 1, y + h - 1) == CLIP_INVISIBLE)
+		return;
+	GdCheckCursor(psd, x, y, x + w - 1, y + h - 1);
+
+	GdSetDash(&dm, &dc);		/* drawn as solid spans*/
+	if ((fill || lw) && gr_fillmode != MWFILL_SOLID) {
+		pattern = TRUE;
+		set_ts_origin(x, y);
+	}
+
+	if (fill) {
+		/* corner rows, then the rectangle between the corners*/
+		for (yy = 0; yy < ry; yy++) {
+			a = rrinset(&r, y + yy);
+			rrdrawrow(psd, x + a, x + w - 1 - a, y + yy, pattern);
+			rrdrawrow(psd, x + a, x + w - 1 - a, y + h - 1 - yy, pattern);
+		}
+		rrfillrows(psd, &r, y + ry, y + h - 1 - ry, pattern);
+	} else if (lw) {
+		/* wide outline is the rectangle less the inner rectangle*/
+		in.x = x + lw;
+		in.y = y + lw;
+		in.w = w - 2 * lw;
+		in.h = h - 2 * lw;
+		in.rx = MWMAX(0, rx - lw);
+		in.ry = MWMAX(0, ry - lw);
+		if (in.w <= 0 || in.h <= 0)
+			in.h = 0;
+		for (yy = y; yy < y + h; yy++) {
+			a = rrinset(&r, yy);
+			if (yy < in.y || yy >= in.y + in.h) {
+				rrdrawrow(psd, x + a, x + w - 1 - a, yy, pattern);
+				continue;
+			}
+			b = lw + rrinset(&in, yy);
+			rrdrawrow(psd, x + a, x + b - 1, yy, pattern);
+			rrdrawrow(psd, x + w - b, x + w - 1 - a, yy, pattern);
+		}
+	} else {
+		/* thin outline corner rows, top and bottom rows mirrored*/
+		MWCOORD prev = w;
+		MWCOORD next = rrinset(&r, y);
+
+		for (yy = 0; yy <= ry; yy++) {
+			a = next;
+			next = rrinset(&r, y + yy + 1);
+			/* extend each row to meet the row further from the center*/
+			b = MWMAX(a, MWMAX(prev, next) - 1);
+			prev = a;
+			rrdrawedges(psd, &r, a, b, y + yy);
+			if (y + h - 1 - yy > y + yy)
+				rrdrawedges(psd, &r, a, b, y + h - 1 - yy);
+		}
+
+		/* straight sides between the corners*/
+		if (y + ry + 1 <= y + h - 2 - ry) {
+			drawcol(psd, x, y + ry + 1, y + h - 2 - ry);
+			if (w > 1)
+				drawcol(psd, x + w - 1, y + ry + 1, y + h - 2 - ry);
+		}
+	}
+
+	GdSetDash(&dm, &dc);
+	GdFixCursor(psd);
+}
+
 #if !NEWARCANGLE		/* was HAVE_FLOAT*/
 #define HIGHPRECISION	0	/* =1 for high precision angles, uses mathlib*/
 
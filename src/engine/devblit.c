@@ -125,8 +125,8 @@ BlitFallback(PSD psd, PMWBLITPARMS gc)
 }
 
 /* find a framebuffer blit based on source data format and blit op*/
-/* used by GdBlit*/
-static MWBLITFUNC
+/* used by GdBlit and tile fills*/
+MWBLITFUNC
 GdFindFrameBlit(PSD psd, MWIMGDATFMT src_data_format, int op)
 {
 	/*DPRINTF("GdFindFrameBlit format %x, op %d\n", src_data_format, op);*/
@@ -568,6 +568,21 @@ GdStretchBlit(PSD dstpsd, MWCOORD dx1, MWCOORD dy1, MWCOORD dx2,
 }
 #endif
 
+/*
+ * Screen to screen copy for drivers with a CopyArea entry point (RFB CopyRect).
+ * The driver is told about the copy instead of the changed destination.
+ */
+static void
+GdCopyAreaBlit(PSD psd, PMWBLITPARMS gc, MWBLITFUNC convblit)
+{
+	void (*Update)(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height) = psd->Update;
+
+	psd->Update = NULL;
+	convblit(psd, gc);
+	psd->Update = Update;
+	psd->CopyArea(psd, gc->dstx, gc->dsty, gc->width, gc->height, gc->srcx, gc->srcy);
+}
+
 /* call conversion blit with clipping and cursor fix*/
 void
 GdConvBlitInternal(PSD psd, PMWBLITPARMS gc, MWBLITFUNC convblit)
@@ -578,7 +593,7 @@ GdConvBlitInternal(PSD psd, PMWBLITPARMS gc, MWBLITFUNC convblit)
 	MWCOORD height = gc->height;
 	MWCOORD srcx = gc->srcx;
 	MWCOORD srcy = gc->srcy;
-	int count, clipresult, checksrc;
+	int count, clipresult, checksrc, copyarea;
 #if DYNAMICREGIONS
 	MWRECT *prc;
 #else
@@ -595,6 +610,10 @@ GdConvBlitInternal(PSD psd, PMWBLITPARMS gc, MWBLITFUNC convblit)
 	if ((checksrc = (gc->srcpsd != NULL && gc->srcpsd != psd)) != 0)
 		GdCheckCursor(gc->srcpsd, srcx, srcy, srcx + width - 1, srcy + height - 1);
 
+	/* report unrotated screen copies to driver*/
+	copyarea = (gc->srcpsd == psd && psd->CopyArea && gc->op == MWROP_COPY &&
+		psd->portrait == MWPORTRAIT_NONE);
+
 	if (clipresult == CLIP_VISIBLE) {
 #if DEBUG_BLIT
 GdSetFillMode(MWFILL_SOLID);
@@ -603,7 +622,9 @@ GdSetForegroundColor(psd, MWRGB(128,64,0));	/* brown*/
 GdFillRect(psd, gc->dstx, gc->dsty, gc->width, gc->height);
 usleep(200000);
 #endif
-		convblit(psd, gc);
+		if (copyarea)
+			GdCopyAreaBlit(psd, gc, convblit);
+		else convblit(psd, gc);
 		GdFixCursor(psd);
 		if (checksrc)
 			GdFixCursor(gc->srcpsd);
@@ -657,7 +678,9 @@ GdSetForegroundColor(psd, MWRGB(128,64,0));	/* brown*/
 GdFillRect(psd, gc->dstx, gc->dsty, gc->width, gc->height);
 usleep(200000);
 #endif
-			convblit(psd, gc);
+			if (copyarea)
+				GdCopyAreaBlit(psd, gc, convblit);
+			else convblit(psd, gc);
 		}
 		prc++;
 	}
@@ -11,14 +11,14 @@
  * specified point (among others), and all points in the rectangle are
  * plottable or not according to the value of clipresult.
  */
-MWCOORD clipminx;		/* minimum x value of cache rectangle */
-MWCOORD clipminy;		/* minimum y value of cache rectangle */
-MWCOORD clipmaxx;		/* maximum x value of cache rectangle */
-MWCOORD clipmaxy;		/* maximum y value of cache rectangle */
+MWTHREADVAR MWCOORD clipminx;	/* minimum x value of cache rectangle */
+MWTHREADVAR MWCOORD clipminy;	/* minimum y value of cache rectangle */
+MWTHREADVAR MWCOORD clipmaxx;	/* maximum x value of cache rectangle */
+MWTHREADVAR MWCOORD clipmaxy;	/* maximum y value of cache rectangle */
 
-static MWBOOL	clipresult;	/* whether clip rectangle is plottable */
-int 	clipcount;		/* number of clip rectangles */
-MWCLIPRECT cliprects[MAX_CLIPRECTS];	/* clip rectangles */
+static MWTHREADVAR MWBOOL	clipresult;	/* whether clip rectangle is plottable */
+MWTHREADVAR int 	clipcount;		/* number of clip rectangles */
+MWTHREADVAR MWCLIPRECT cliprects[MAX_CLIPRECTS];	/* clip rectangles */
 
 /**
  * Set an array of clip rectangles for future drawing actions.
@@ -12,13 +12,21 @@
  * specified point (among others), and all points in the rectangle are
  * plottable or not according to the value of clipresult.
  */
-MWCOORD clipminx;		/* minimum x value of cache rectangle */
-MWCOORD clipminy;		/* minimum y value of cache rectangle */
-MWCOORD clipmaxx;		/* maximum x value of cache rectangle */
-MWCOORD clipmaxy;		/* maximum y value of cache rectangle */
+MWTHREADVAR MWCOORD clipminx;	/* minimum x value of cache rectangle */
+MWTHREADVAR MWCOORD clipminy;	/* minimum y value of cache rectangle */
+MWTHREADVAR MWCOORD clipmaxx;	/* maximum x value of cache rectangle */
+MWTHREADVAR MWCOORD clipmaxy;	/* maximum y value of cache rectangle */
 
-static MWBOOL	clipresult;	/* whether clip rectangle is plottable */
-MWCLIPREGION *clipregion = NULL;
+static MWTHREADVAR MWBOOL	clipresult;	/* whether clip rectangle is plottable */
+MWTHREADVAR MWCLIPREGION *clipregion = NULL;
+
+/* Last few visible clip rectangles found, checked before searching the
+ * region, for drawing that moves back and forth between rectangles.
+ */
+#define CLIPHITS	4
+static MWTHREADVAR MWRECT	cliphits[CLIPHITS];
+static MWTHREADVAR int	clipnhits;	/* valid entries in cliphits*/
+static MWTHREADVAR int	clipnexthit;	/* next entry to replace*/
 
 /**
  * Set a clip region for future drawing actions.
@@ -40,6 +48,7 @@ GdSetClipRegion(PSD psd, MWCLIPREGION *reg)
 	  reg = GdAllocRegion();
 
   clipregion = reg;
+  clipnhits = clipnexthit = 0;
 
 
 #if 0
@@ -118,9 +127,8 @@ GdSetClipRegion(PSD psd, MWCLIPREGION *reg)
 MWBOOL
 GdClipPoint(PSD psd,MWCOORD x,MWCOORD y)
 {
-  int count;
+  int count, band, i;
   MWRECT *rp;
-  MWCOORD temp;
 
   /* First see whether the point lies within the current clip cache
    * rectangle.  If so, then we already know the result.
@@ -183,14 +191,9 @@ GdClipPoint(PSD psd,MWCOORD x,MWCOORD y)
 	return TRUE;
   }
 
-  /* We need to scan the list of clip rectangles to calculate a new
-   * clip cache rectangle containing this point, and the result. First
-   * see if the point lies within any of the clip rectangles. If so,
-   * then it is plottable and use that clip rectangle as the cache
-   * rectangle.  This is not necessarily the best result, but works ok
-   * and is fast.
-   */
-  for (rp = clipregion->rects; count-- > 0; rp++) {
+  /* Check the recently hit clip rectangles first.*/
+  for (i = 0; i < clipnhits; i++) {
+	rp = &cliphits[i];
 	if ((x >= rp->left) && (y >= rp->top) && (x < rp->right) && (y < rp->bottom)) {
 		clipminx = rp->left;
 		clipminy = rp->top;
@@ -202,26 +205,48 @@ GdClipPoint(PSD psd,MWCOORD x,MWCOORD y)
 	}
   }
 
-  /* The point is not plottable. Scan the clip rectangles again to
-   * determine a rectangle containing more non-plottable points.
-   * Simply pick the largest rectangle whose area doesn't contain any
-   * of the same coordinates as appropriate sides of the clip
-   * rectangles.  This is not necessarily the best result, but works ok
-   * and is fast.
+  /* Search the y-x banded clip rectangles for the band containing y,
+   * then within the band for the rectangle containing x.  If found,
+   * the point is plottable and that clip rectangle is the cache rectangle.
    */
-  clipminx = MIN_MWCOORD;
-  clipminy = MIN_MWCOORD;
-  clipmaxx = MAX_MWCOORD;
-  clipmaxy = MAX_MWCOORD;
-  count = clipregion->numRects;
-  for (rp = clipregion->rects; count-- > 0; rp++) {
-	if ((x < rp->left) && (rp->left <= clipmaxx)) clipmaxx = rp->left - 1;
-	temp = rp->right - 1;
-	if ((x > temp) && (temp >= clipminx)) clipminx = temp + 1;
-	if ((y < rp->top) && (rp->top <= clipmaxy)) clipmaxy = rp->top - 1;
-	temp = rp->bottom - 1;
-	if ((y > temp) && (temp >= clipminy)) clipminy = temp + 1;
+  band = GdRegionFindBand(clipregion, y);
+  if (band >= count || clipregion->rects[band].top > y) {
+	/* The point lies between bands, the cache rectangle is the
+	 * gap between the bands, across the whole width.
+	 */
+	clipminx = MIN_MWCOORD;
+	clipmaxx = MAX_MWCOORD;
+	clipminy = (band > 0)? clipregion->rects[band-1].bottom: MIN_MWCOORD;
+	clipmaxy = (band < count)? clipregion->rects[band].top - 1: MAX_MWCOORD;
+	clipresult = FALSE;
+	return FALSE;
   }
+
+  rp = &clipregion->rects[band];
+  clipminy = rp->top;
+  clipmaxy = rp->bottom - 1;
+  i = GdRegionFindX(clipregion, band, x);
+  if (i < count && clipregion->rects[i].top == rp->top) {
+	rp = &clipregion->rects[i];
+	if (x >= rp->left) {
+		clipminx = rp->left;
+		clipmaxx = rp->right - 1;
+		clipresult = TRUE;
+		cliphits[clipnexthit] = *rp;
+		clipnexthit = (clipnexthit + 1) % CLIPHITS;
+		if (clipnhits < CLIPHITS)
+			clipnhits++;
+		GdCheckCursor(psd, x, y, x, y);
+		return TRUE;
+	}
+	clipmaxx = rp->left - 1;
+  } else
+	clipmaxx = MAX_MWCOORD;
+
+  /* The point is not plottable and lies between two rectangles of the
+   * band, the cache rectangle is the gap between them.
+   */
+  clipminx = (i > band)? clipregion->rects[i-1].right: MIN_MWCOORD;
   clipresult = FALSE;
   return FALSE;
 }
@@ -263,7 +288,6 @@ GdClipArea(PSD psd,MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2)
 void
 GdPrintClipRects(PMWBLITPARMS gc)
 {
-	extern MWCLIPREGION *clipregion;
 	MWRECT *prc = clipregion->rects;
 	int count = clipregion->numRects;
 	int n = 1;
@@ -16,17 +16,10 @@
 #include "device.h"
 #include "convblit.h"
 
-extern int 	  gr_mode; 	      /* drawing mode */
 extern MWPALENTRY gr_palette[256];    /* current palette*/
 extern int	  gr_firstuserpalentry;/* first user-changable palette entry*/
 extern int 	  gr_nextpalentry;    /* next available palette entry*/
 
-/* These support drawing dashed lines */
-extern uint32_t gr_dashmask;     /* An actual bitmask of the dash values */
-extern uint32_t gr_dashcount;    /* The number of bits defined in the dashmask */
-
-extern int        gr_fillmode;
-
 /**
  * Set the drawing mode for future calls.
  *
@@ -158,6 +151,47 @@ GdSetDash(uint32_t *mask, int *count)
 	if (count) *count = oldc;
 }
 
+/**
+ * Set the line width, cap and join style for future line drawing.
+ * Widths of 0 and 1 draw thin lines.
+ *
+ * @param width Line width in pixels.
+ * @param capstyle MWCAP_* end style of wide lines.
+ * @param joinstyle MWJOIN_* corner style of wide lines.
+ */
+void
+GdSetLineAttributes(int width, int capstyle, int joinstyle)
+{
+	gr_linewidth = width;
+	gr_capstyle = capstyle;
+	gr_joinstyle = joinstyle;
+}
+
+/**
+ * Integer square root, rounded down.
+ *
+ * @param n Value.
+ * @return Largest integer whose square is not greater than n.
+ */
+uint32_t
+GdIntSqrt(uint64_t n)
+{
+	uint64_t r = 0;
+	uint64_t b = (uint64_t)1 << 62;
+
+	while (b > n)
+		b >>= 2;
+	while (b) {
+		if (n >= r + b) {
+			n -= r + b;
+			r = (r >> 1) + b;
+		} else
+			r >>= 1;
+		b >>= 2;
+	}
+	return (uint32_t)r;
+}
+
 /**
  * Draw a point using the current clipping region and foreground color.
  *
@@ -174,25 +208,9 @@ GdPoint(PSD psd, MWCOORD x, MWCOORD y)
 	}
 }
 
-/**
- * Draw an arbitrary line using the current clipping region and foreground color
- * If bDrawLastPoint is FALSE, draw up to but not including point x2, y2.
- *
- * This routine is the only routine that adjusts coordinates for supporting
- * two different types of upper levels, those that draw the last point
- * in a line, and those that draw up to the last point.  All other local
- * routines draw the last point.  This gives this routine a bit more overhead,
- * but keeps overall complexity down.
- *
- * @param psd Drawing surface.
- * @param x1 Start X co-ordinate
- * @param y1 Start Y co-ordinate
- * @param x2 End X co-ordinate
- * @param y2 End Y co-ordinate
- * @param bDrawLastPoint TRUE to draw the point at (x2, y2).  FALSE to omit it.
- */
-void
-GdLine(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2,
+/* Draw a line, without restoring the cursor, see GdLine*/
+static void
+drawline(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2,
        MWBOOL bDrawLastPoint) 
 {
 	int xdelta;		/* width of rectangle around line */
@@ -221,7 +239,6 @@ GdLine(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2,
 
 		/* call faster line drawing routine */
 		drawrow(psd, x1, x2, y1);
-		GdFixCursor(psd);
 		return;
 	}
 	if (x1 == x2) {
@@ -239,7 +256,6 @@ GdLine(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2,
 
 		/* call faster line drawing routine */
 		drawcol(psd, x1, y1, y2);
-		GdFixCursor(psd);
 		return;
 	}
 
@@ -331,6 +347,40 @@ GdLine(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2,
 				break;
 		}
 	}
+}
+
+/**
+ * Draw an arbitrary line using the current clipping region and foreground color
+ * If bDrawLastPoint is FALSE, draw up to but not including point x2, y2.
+ *
+ * This routine is the only routine that adjusts coordinates for supporting
+ * two different types of upper levels, those that draw the last point
+ * in a line, and those that draw up to the last point.  All other local
+ * routines draw the last point.  This gives this routine a bit more overhead,
+ * but keeps overall complexity down.
+ *
+ * @param psd Drawing surface.
+ * @param x1 Start X co-ordinate
+ * @param y1 Start Y co-ordinate
+ * @param x2 End X co-ordinate
+ * @param y2 End Y co-ordinate
+ * @param bDrawLastPoint TRUE to draw the point at (x2, y2).  FALSE to omit it.
+ */
+void
+GdLine(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2,
+       MWBOOL bDrawLastPoint) 
+{
+	if (gr_linewidth > 1) {
+		MWPOINT pts[2];
+
+		pts[0].x = x1;
+		pts[0].y = y1;
+		pts[1].x = x2;
+		pts[1].y = y2;
+		GdWidePolyLine(psd, 2, pts, FALSE);
+		return;
+	}
+	drawline(psd, x1, y1, x2, y2, bDrawLastPoint);
 	GdFixCursor(psd);
 }
 
@@ -436,19 +486,9 @@ drawcol(PSD psd, MWCOORD x,MWCOORD y1,MWCOORD y2)
 	}
 }
 
-/**
- * Draw a rectangle in the foreground color, applying clipping if necessary.
- * This is careful to not draw points multiple times in case the rectangle
- * is being drawn using XOR.
- *
- * @param psd Drawing surface.
- * @param x Left edge of rectangle.
- * @param y Top edge of rectangle.
- * @param width Width of rectangle.
- * @param height Height of rectangle.
- */
-void
-GdRect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+/* Draw a rectangle, without restoring the cursor, see GdRect*/
+static void
+drawrect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 {
 	MWCOORD maxx;
 	MWCOORD maxy;
@@ -467,21 +507,48 @@ GdRect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 	drawcol(psd, x, y, maxy);
 	if (width > 1)
 		drawcol(psd, maxx, y, maxy);
-	GdFixCursor(psd);
+}
+
+/* Draw a wide rectangle outline, centred on the thin outline*/
+static void
+widerect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	MWPOINT pts[4];
+
+	if (width <= 0 || height <= 0)
+		return;
+	pts[0].x = pts[3].x = x;
+	pts[1].x = pts[2].x = x + width - 1;
+	pts[0].y = pts[1].y = y;
+	pts[2].y = pts[3].y = y + height - 1;
+	GdWidePolyLine(psd, 4, pts, TRUE);
 }
 
 /**
- * Draw a filled in rectangle in the foreground color, applying
- * clipping if necessary.
+ * Draw a rectangle in the foreground color, applying clipping if necessary.
+ * This is careful to not draw points multiple times in case the rectangle
+ * is being drawn using XOR.
  *
  * @param psd Drawing surface.
- * @param x1 Left edge of rectangle.
- * @param y1 Top edge of rectangle.
+ * @param x Left edge of rectangle.
+ * @param y Top edge of rectangle.
  * @param width Width of rectangle.
  * @param height Height of rectangle.
  */
 void
-GdFillRect(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD width, MWCOORD height)
+GdRect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	if (gr_linewidth > 1) {
+		widerect(psd, x, y, width, height);
+		return;
+	}
+	drawrect(psd, x, y, width, height);
+	GdFixCursor(psd);
+}
+
+/* Fill a rectangle, without restoring the cursor, see GdFillRect*/
+static void
+fillrect(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD width, MWCOORD height)
 {
 	uint32_t dm = 0;
 	int dc = 0;
@@ -498,7 +565,6 @@ GdFillRect(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD width, MWCOORD height)
 		set_ts_origin(x1, y1);
 
 		ts_fillrect(psd, x1, y1, width, height);
-		GdFixCursor(psd);
 		return;
 	}
 #endif
@@ -509,7 +575,6 @@ GdFillRect(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD width, MWCOORD height)
 	switch (GdClipArea(psd, x1, y1, x2, y2)) {
 	case CLIP_VISIBLE:
 		psd->FillRect(psd, x1, y1, x2, y2, gr_foreground);
-		GdFixCursor(psd);
 		return;
 
 	case CLIP_INVISIBLE:
@@ -526,7 +591,168 @@ GdFillRect(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD width, MWCOORD height)
 
 	/* Restore the dash settings */
 	GdSetDash(&dm, &dc);
+}
+
+/**
+ * Draw a filled in rectangle in the foreground color, applying
+ * clipping if necessary.
+ *
+ * @param psd Drawing surface.
+ * @param x1 Left edge of rectangle.
+ * @param y1 Top edge of rectangle.
+ * @param width Width of rectangle.
+ * @param height Height of rectangle.
+ */
+void
+GdFillRect(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD width, MWCOORD height)
+{
+	fillrect(psd, x1, y1, width, height);
+	GdFixCursor(psd);
+}
+
+/* check cursor once for the bounding box of an array of points*/
+static void
+checkcursorpoints(PSD psd, int count, MWPOINT *points)
+{
+	MWCOORD minx, miny, maxx, maxy;
+
+	minx = maxx = points->x;
+	miny = maxy = points->y;
+	while (--count > 0) {
+		++points;
+		if (points->x < minx) minx = points->x;
+		if (points->x > maxx) maxx = points->x;
+		if (points->y < miny) miny = points->y;
+		if (points->y > maxy) maxy = points->y;
+	}
+	GdCheckCursor(psd, minx, miny, maxx, maxy);
+}
+
+/* check cursor once for the bounding box of an array of rectangles*/
+static void
+checkcursorrects(PSD psd, int count, MWCLIPRECT *rects)
+{
+	MWCOORD minx, miny, maxx, maxy;
+
+	minx = miny = MAX_MWCOORD;
+	maxx = maxy = MIN_MWCOORD;
+	for (; count > 0; --count, ++rects) {
+		if (rects->width <= 0 || rects->height <= 0)
+			continue;
+		if (rects->x < minx) minx = rects->x;
+		if (rects->y < miny) miny = rects->y;
+		if (rects->x + rects->width - 1 > maxx) maxx = rects->x + rects->width - 1;
+		if (rects->y + rects->height - 1 > maxy) maxy = rects->y + rects->height - 1;
+	}
+	if (minx <= maxx)
+		GdCheckCursor(psd, minx, miny, maxx, maxy);
+}
+
+/**
+ * Draw an open polyline in the foreground color, applying clipping if necessary.
+ * Unlike GdPoly, each point is drawn only once, so XOR joins are correct,
+ * and the last point is not drawn if it repeats the first.  The cursor
+ * is checked once for the whole polyline.
+ *
+ * @param psd Drawing surface.
+ * @param count Number of points.
+ * @param points The array of points.
+ * @param bDrawLastPoint TRUE to draw the last point.  FALSE to omit it.
+ */
+void
+GdPolyLine(PSD psd, int count, MWPOINT *points, MWBOOL bDrawLastPoint)
+{
+	MWPOINT *first = points;
+	MWPOINT *last;
+
+	if (count <= 0)
+		return;
+	if (gr_linewidth > 1) {
+		last = &points[count-1];
+		GdWidePolyLine(psd, count, points,
+			count > 2 && last->x == first->x && last->y == first->y);
+		return;
+	}
+	checkcursorpoints(psd, count, points);
+
+	last = &points[count-1];
+	for (; points < last; points++) {
+		/* skip zero length segments, the point is drawn by the next segment*/
+		if (points[0].x != points[1].x || points[0].y != points[1].y)
+			drawline(psd, points[0].x, points[0].y, points[1].x, points[1].y, FALSE);
+	}
+	if (count == 1 || (bDrawLastPoint && (last->x != first->x || last->y != first->y)))
+		drawpoint(psd, last->x, last->y);
+	GdFixCursor(psd);
+}
+
+/**
+ * Draw an array of unconnected lines in the foreground color, applying
+ * clipping if necessary.  The cursor is checked once for all the lines.
+ *
+ * @param psd Drawing surface.
+ * @param count Number of lines.
+ * @param points Line endpoints, two points per line.
+ */
+void
+GdSegments(PSD psd, int count, MWPOINT *points)
+{
+	if (count <= 0)
+		return;
+	if (gr_linewidth > 1) {
+		for (; count > 0; --count, points += 2)
+			GdWidePolyLine(psd, 2, points, FALSE);
+		return;
+	}
+	checkcursorpoints(psd, count * 2, points);
+
+	for (; count > 0; --count, points += 2)
+		drawline(psd, points[0].x, points[0].y, points[1].x, points[1].y, TRUE);
+	GdFixCursor(psd);
+}
+
+/**
+ * Draw an array of rectangle outlines in the foreground color, applying
+ * clipping if necessary.  The cursor is checked once for all rectangles.
+ *
+ * @param psd Drawing surface.
+ * @param count Number of rectangles.
+ * @param rects The array of rectangles.
+ */
+void
+GdRects(PSD psd, int count, MWCLIPRECT *rects)
+{
+	if (count <= 0)
+		return;
+	if (gr_linewidth > 1) {
+		for (; count > 0; --count, ++rects)
+			widerect(psd, rects->x, rects->y, rects->width, rects->height);
+		return;
+	}
+	checkcursorrects(psd, count, rects);
+
+	for (; count > 0; --count, ++rects)
+		drawrect(psd, rects->x, rects->y, rects->width, rects->height);
+	GdFixCursor(psd);
+}
+
+/**
+ * Fill an array of rectangles in the foreground color, applying
+ * clipping if necessary.  The cursor is checked once for all rectangles.
+ *
+ * @param psd Drawing surface.
+ * @param count Number of rectangles.
+ * @param rects The array of rectangles.
+ */
+void
+GdFillRects(PSD psd, int count, MWCLIPRECT *rects)
+{
+	if (count <= 0)
+		return;
+	checkcursorrects(psd, count, rects);
 
+	for (; count > 0; --count, ++rects)
+		fillrect(psd, rects->x, rects->y, rects->width, rects->height);
 	GdFixCursor(psd);
 }
 
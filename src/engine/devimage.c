@@ -27,6 +27,9 @@
 #if HAVE_MMAP
 #include <sys/mman.h>
 #endif
+#if MW_FEATURE_ASYNCIMAGES
+#include <pthread.h>
+#endif
 
 #ifndef O_BINARY
 #define O_BINARY    0
@@ -34,7 +37,17 @@
 
 #if MW_FEATURE_IMAGES /* whole file */
 
-static PSD GdDecodeImage(buffer_t *src, char *path, int flags);
+#if MW_FEATURE_ASYNCIMAGES
+/* serialize decoders that keep state in static variables, for async decode threads*/
+static pthread_mutex_t decodemutex = PTHREAD_MUTEX_INITIALIZER;
+#define DECODE_LOCK()	pthread_mutex_lock(&decodemutex)
+#define DECODE_UNLOCK()	pthread_mutex_unlock(&decodemutex)
+#else
+#define DECODE_LOCK()
+#define DECODE_UNLOCK()
+#endif
+
+static PSD GdDecodeImage(buffer_t *src, char *path, int flags, MWCOORD width, MWCOORD height);
 
 /*
  * Buffered input functions to replace stdio functions
@@ -119,11 +132,31 @@ GdImageBufferEOF(buffer_t *buffer)
  */
 PSD
 GdLoadImageFromBuffer(void *buffer, int size, int flags)
+{
+	return GdLoadImageFromBufferScaled(buffer, size, -1, -1, flags);
+}
+
+/**
+ * Load an image from a memory buffer, decoding at reduced size if possible.
+ *
+ * JPEG images are decoded using DCT scaling and PNG images are downscaled
+ * row by row while decoding, so that the full size image is never allocated.
+ * The returned image may be larger than width/height, but never smaller
+ * unless the image itself is smaller.
+ *
+ * @param buffer The buffer containing the image data.
+ * @param size The size of the buffer.
+ * @param width If >0, desired minimum image width.
+ * @param height If >0, desired minimum image height.
+ * @param flags If nonzero, JPEG images will be loaded as grayscale.  Yuck!
+ */
+PSD
+GdLoadImageFromBufferScaled(void *buffer, int size, MWCOORD width, MWCOORD height, int flags)
 {
 	buffer_t src;
 
 	GdImageBufferInit(&src, buffer, size);
-	return GdDecodeImage(&src, NULL, flags);
+	return GdDecodeImage(&src, NULL, flags, width, height);
 }
 
 /**
@@ -148,7 +181,7 @@ GdDrawImageFromBuffer(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width,
 	buffer_t src;
 
 	GdImageBufferInit(&src, buffer, size);
-	pmd = GdDecodeImage(&src, NULL, flags);
+	pmd = GdDecodeImage(&src, NULL, flags, width, height);
 
 	if (pmd) {
 		GdDrawImagePartToFit(psd, x, y, width, height, 0, 0, 0, 0, pmd);
@@ -176,7 +209,11 @@ GdDrawImageFromFile(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height
 {
 	PSD	pmd;
 
-	pmd = GdLoadImageFromFile(path, flags);
+	/* use decoded image cache if enabled*/
+	if (GdDrawCachedImageFromFile(psd, x, y, width, height, path, flags))
+		return;
+
+	pmd = GdLoadImageFromFileScaled(path, width, height, flags);
 	if (pmd) {
 		GdDrawImagePartToFit(psd, x, y, width, height, 0, 0, 0, 0, pmd);
 		pmd->FreeMemGC(pmd);
@@ -191,6 +228,21 @@ GdDrawImageFromFile(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height
  */
 PSD
 GdLoadImageFromFile(char *path, int flags)
+{
+	return GdLoadImageFromFileScaled(path, -1, -1, flags);
+}
+
+/**
+ * Load an image from a file, decoding at reduced size if possible.
+ * See GdLoadImageFromBufferScaled.
+ *
+ * @param path The file containing the image data.
+ * @param width If >0, desired minimum image width.
+ * @param height If >0, desired minimum image height.
+ * @param flags If nonzero, JPEG images will be loaded as grayscale.  Yuck!
+ */
+PSD
+GdLoadImageFromFileScaled(char *path, MWCOORD width, MWCOORD height, int flags)
 {
 	int fd;
 	PSD	pmd;
@@ -227,7 +279,7 @@ GdLoadImageFromFile(char *path, int flags)
 #endif
 
 	GdImageBufferInit(&src, buffer, s.st_size);
-	pmd = GdDecodeImage(&src, path, flags);
+	pmd = GdDecodeImage(&src, path, flags, width, height);
 	if (!pmd)
 		EPRINTF("GdLoadImageFromFile: No decoder for image: %s\n", path);
 
@@ -416,50 +468,105 @@ DPRINTF("Converting %dbpp image to RGBA\n", pmd->bpp);
 	return rgba;
 }
 
+/* image types returned by GdImageType*/
+#define IMAGE_UNKNOWN	0
+#define IMAGE_BMP		1
+#define IMAGE_GIF		2
+#define IMAGE_JPEG		3
+#define IMAGE_PNG		4
+#define IMAGE_PNM		5
+#define IMAGE_XPM		6
+#define IMAGE_TIFF		7
+
+/*
+ * Determine image type from the magic bytes at the start of the image,
+ * so that only the matching decoder need be called.
+ */
+static int
+GdImageType(buffer_t *src)
+{
+	unsigned char *p = src->start;
+	unsigned long size = src->size;
+
+	if (size >= 8 && p[0] == 0x89 && p[1] == 'P' && p[2] == 'N' && p[3] == 'G')
+		return IMAGE_PNG;
+	if (size >= 3 && p[0] == 0xFF && p[1] == 0xD8 && p[2] == 0xFF)
+		return IMAGE_JPEG;
+	if (size >= 6 && !memcmp(p, "GIF8", 4))
+		return IMAGE_GIF;
+	if (size >= 2 && p[0] == 'B' && p[1] == 'M')
+		return IMAGE_BMP;
+	if (size >= 3 && p[0] == 'P' && p[1] >= '1' && p[1] <= '6')
+		return IMAGE_PNM;
+	if (size >= 9 && !memcmp(p, "/* XPM */", 9))
+		return IMAGE_XPM;
+	if (size >= 4 && (!memcmp(p, "II*\0", 4) || !memcmp(p, "MM\0*", 4)))
+		return IMAGE_TIFF;
+	return IMAGE_UNKNOWN;
+}
+
 /*
  * GdDecodeImage:
  * @src: The image data.
+ * @path: The image file path, or NULL if decoding from buffer.
  * @flags: If nonzero, JPEG images will be loaded as grayscale.  Yuck!
+ * @width: If >0, JPEG and PNG images may be decoded at reduced width.
+ * @height: If >0, JPEG and PNG images may be decoded at reduced height.
  *
- * Load an image into a pixmap.
+ * Load an image into a pixmap, using the decoder matching the image signature.
  */
 static PSD
-GdDecodeImage(buffer_t *src, char *path, int flags)
+GdDecodeImage(buffer_t *src, char *path, int flags, MWCOORD width, MWCOORD height)
 {
 	PSD	pmd = NULL;
 	int	op;
 
-	do {
-#if HAVE_TIFF_SUPPORT
-	/* must be first... no buffer support yet*/
-	if (path && (pmd = GdDecodeTIFF(path)) != NULL)
-		break;
-#endif
+	switch (GdImageType(src)) {
 #if HAVE_BMP_SUPPORT
-	if ((pmd = GdDecodeBMP(src, TRUE)) != NULL)
+	case IMAGE_BMP:
+		DECODE_LOCK();
+		pmd = GdDecodeBMP(src, TRUE);
+		DECODE_UNLOCK();
 		break;
 #endif
 #if HAVE_GIF_SUPPORT
-	if ((pmd = GdDecodeGIF(src)) != NULL)
+	case IMAGE_GIF:
+		DECODE_LOCK();
+		pmd = GdDecodeGIF(src);
+		DECODE_UNLOCK();
 		break;
 #endif
 #if HAVE_JPEG_SUPPORT
-	if ((pmd = GdDecodeJPEG(src, flags)) != NULL)
+	case IMAGE_JPEG:
+		pmd = GdDecodeJPEG(src, flags, width, height);
 		break;
 #endif
 #if HAVE_PNG_SUPPORT
-	if ((pmd = GdDecodePNG(src)) != NULL)
+	case IMAGE_PNG:
+		pmd = GdDecodePNG(src, width, height);
 		break;
 #endif
 #if HAVE_PNM_SUPPORT
-	if ((pmd = GdDecodePNM(src)) != NULL)
+	case IMAGE_PNM:
+		pmd = GdDecodePNM(src);
 		break;
 #endif
 #if HAVE_XPM_SUPPORT
-	if ((pmd = GdDecodeXPM(src)) != NULL)
+	case IMAGE_XPM:
+		pmd = GdDecodeXPM(src);
 		break;
 #endif
-	} while (0);
+#if HAVE_TIFF_SUPPORT
+	case IMAGE_TIFF:
+		/* no buffer support yet*/
+		if (path) {
+			DECODE_LOCK();
+			pmd = GdDecodeTIFF(path);
+			DECODE_UNLOCK();
+		}
+		break;
+#endif
+	}
 
 	if (!pmd)
 		return NULL;
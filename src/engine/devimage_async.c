@@ -0,0 +1,311 @@
+/*
+ * Asynchronous image decoding.
+ *
+ * GdLoadImageFromFileAsync queues an image file to be decoded by a small
+ * pool of worker threads, so that decoding large images doesn't stall
+ * input handling and drawing in the main loop.
+ *
+ * Completed images are signalled by writing a byte to a pipe, whose read
+ * end is returned by GdOpenAsyncImage for use in select().  When the pipe
+ * is readable, the main loop calls GdGetAsyncImage until it returns FALSE
+ * to collect each decoded image.
+ *
+ * Pixmaps created while decoding copy the screen device saved when the
+ * image was queued, rather than scrdev, which other threads may change.
+ *
+ * Set ASYNCIMAGES=Y in config to enable, requires pthreads.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "uni_std.h"
+#include "device.h"
+#include "../drivers/genmem.h"
+
+#if MW_FEATURE_IMAGES && HAVE_FILEIO && MW_FEATURE_ASYNCIMAGES	/* whole file */
+#include <fcntl.h>
+#include <pthread.h>
+
+typedef struct asyncimage {
+	struct asyncimage *next;
+	int			id;			/* caller's id for image*/
+	char *		path;		/* image file path*/
+	MWCOORD		width;		/* desired minimum width, <0 for image width*/
+	MWCOORD		height;		/* desired minimum height, <0 for image height*/
+	int			flags;		/* decoder flags*/
+	PSD			pmd;		/* decoded image, NULL on error*/
+	SCREENDEVICE screen;	/* scrdev when queued, for GdCreatePixmap*/
+} ASYNCIMAGE;
+
+typedef struct {
+	ASYNCIMAGE *head;
+	ASYNCIMAGE *tail;
+} ASYNCQUEUE;
+
+static pthread_mutex_t asyncmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t asynccond = PTHREAD_COND_INITIALIZER;	/* signalled when work queued*/
+static ASYNCQUEUE pending;			/* waiting for a worker thread*/
+static ASYNCQUEUE done;				/* decoded, waiting for GdGetAsyncImage*/
+static pthread_t workers[IMAGE_DECODE_THREADS];
+static int numworkers;				/* worker threads started*/
+static int quit;					/* set to stop worker threads*/
+static int donepipe[2] = { -1, -1 };
+static pthread_key_t screenkey;		/* worker's ASYNCIMAGE screen*/
+static int havescreenkey;
+
+static void
+async_put(ASYNCQUEUE *q, ASYNCIMAGE *ai)
+{
+	ai->next = NULL;
+	if (q->tail)
+		q->tail->next = ai;
+	else q->head = ai;
+	q->tail = ai;
+}
+
+static ASYNCIMAGE *
+async_get(ASYNCQUEUE *q)
+{
+	ASYNCIMAGE *ai = q->head;
+
+	if (ai) {
+		q->head = ai->next;
+		if (!q->head)
+			q->tail = NULL;
+	}
+	return ai;
+}
+
+static void
+async_free(ASYNCIMAGE *ai)
+{
+	if (ai->pmd)
+		GdFreePixmap(ai->pmd);
+	free(ai->path);
+	free(ai);
+}
+
+/* worker thread, decode queued images until told to quit*/
+static void *
+async_worker(void *arg)
+{
+	ASYNCIMAGE *ai;
+	char c = 0;
+
+	pthread_mutex_lock(&asyncmutex);
+	for (;;) {
+		while (!pending.head && !quit)
+			pthread_cond_wait(&asynccond, &asyncmutex);
+		if (quit)
+			break;
+		ai = async_get(&pending);
+
+		/* decode without holding lock*/
+		pthread_mutex_unlock(&asyncmutex);
+		pthread_setspecific(screenkey, &ai->screen);
+		ai->pmd = GdLoadImageFromFileScaled(ai->path, ai->width, ai->height, ai->flags);
+		pthread_setspecific(screenkey, NULL);
+		pthread_mutex_lock(&asyncmutex);
+
+		async_put(&done, ai);
+		if (write(donepipe[1], &c, 1) < 0)
+			;	/* pipe full is ok, main loop already has wakeup pending*/
+	}
+	pthread_mutex_unlock(&asyncmutex);
+	return NULL;
+}
+
+/**
+ * Initialize asynchronous image decoding.
+ * Worker threads are started on first use.
+ *
+ * @return File descriptor to select() on for completed images, or -1 if unavailable.
+ */
+int
+GdOpenAsyncImage(void)
+{
+	if (donepipe[0] >= 0)
+		return donepipe[0];
+
+	if (!havescreenkey) {
+		if (pthread_key_create(&screenkey, NULL) != 0) {
+			EPRINTF("GdOpenAsyncImage: can't create thread key\n");
+			return -1;
+		}
+		havescreenkey = TRUE;
+	}
+	if (pipe(donepipe) < 0) {
+		EPRINTF("GdOpenAsyncImage: can't create pipe\n");
+		donepipe[0] = donepipe[1] = -1;
+		return -1;
+	}
+	fcntl(donepipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(donepipe[1], F_SETFL, O_NONBLOCK);
+	quit = 0;
+	return donepipe[0];
+}
+
+/**
+ * Stop worker threads and free all queued and undelivered images.
+ */
+void
+GdCloseAsyncImage(void)
+{
+	ASYNCIMAGE *ai;
+	int i;
+
+	if (donepipe[0] < 0)
+		return;
+
+	pthread_mutex_lock(&asyncmutex);
+	quit = 1;
+	pthread_cond_broadcast(&asynccond);
+	pthread_mutex_unlock(&asyncmutex);
+
+	for (i = 0; i < numworkers; i++)
+		pthread_join(workers[i], NULL);
+	numworkers = 0;
+
+	while ((ai = async_get(&pending)) != NULL)
+		async_free(ai);
+	while ((ai = async_get(&done)) != NULL)
+		async_free(ai);
+
+	close(donepipe[0]);
+	close(donepipe[1]);
+	donepipe[0] = donepipe[1] = -1;
+}
+
+/**
+ * Queue an image file for decoding by a worker thread.
+ * The decoded image is returned later by GdGetAsyncImage.
+ *
+ * @param id Caller's id for the image, returned by GdGetAsyncImage.
+ * @param path The file containing the image data.
+ * @param width If >0, desired minimum image width.
+ * @param height If >0, desired minimum image height.
+ * @param flags If nonzero, JPEG images will be loaded as grayscale.
+ * @return FALSE if the image couldn't be queued, the caller should decode synchronously.
+ */
+MWBOOL
+GdLoadImageFromFileAsync(int id, char *path, MWCOORD width, MWCOORD height, int flags)
+{
+	ASYNCIMAGE *ai;
+
+	if (donepipe[0] < 0)
+		return FALSE;
+
+	ai = (ASYNCIMAGE *)malloc(sizeof(ASYNCIMAGE));
+	if (!ai)
+		return FALSE;
+	if ((ai->path = strdup(path)) == NULL) {
+		free(ai);
+		return FALSE;
+	}
+	ai->id = id;
+	ai->width = width;
+	ai->height = height;
+	ai->flags = flags;
+	ai->pmd = NULL;
+	ai->screen = scrdev;		/* copied on the caller's thread, holding the server lock*/
+
+	pthread_mutex_lock(&asyncmutex);
+
+	/* start another worker if all are busy*/
+	if (numworkers < IMAGE_DECODE_THREADS && (numworkers == 0 || pending.head)) {
+		if (pthread_create(&workers[numworkers], NULL, async_worker, NULL) == 0)
+			numworkers++;
+	}
+	if (numworkers == 0) {
+		pthread_mutex_unlock(&asyncmutex);
+		free(ai->path);
+		free(ai);
+		return FALSE;
+	}
+
+	async_put(&pending, ai);
+	pthread_cond_signal(&asynccond);
+	pthread_mutex_unlock(&asyncmutex);
+	return TRUE;
+}
+
+/**
+ * Return next completed asynchronous image.
+ * Call repeatedly when the GdOpenAsyncImage descriptor is readable.
+ *
+ * @param pid Returns caller's id passed to GdLoadImageFromFileAsync.
+ * @param ppmd Returns decoded image, owned by caller, or NULL if decoding failed.
+ * @return FALSE if no more completed images.
+ */
+MWBOOL
+GdGetAsyncImage(int *pid, PSD *ppmd)
+{
+	ASYNCIMAGE *ai;
+	char buf[64];
+
+	if (donepipe[0] < 0)
+		return FALSE;
+
+	/* drain wakeups before checking queue so none are lost*/
+	while (read(donepipe[0], buf, sizeof(buf)) > 0)
+		continue;
+
+	pthread_mutex_lock(&asyncmutex);
+	ai = async_get(&done);
+	pthread_mutex_unlock(&asyncmutex);
+	if (!ai)
+		return FALSE;
+
+	*pid = ai->id;
+	*ppmd = ai->pmd;
+	ai->pmd = NULL;
+	async_free(ai);
+	return TRUE;
+}
+
+/**
+ * Return the screen device for pixmaps created by a decode thread.
+ *
+ * @return Copy of scrdev saved when the image being decoded was queued,
+ * or NULL if not called from a decode thread.
+ */
+PSD
+GdGetAsyncImageScreen(void)
+{
+	if (!havescreenkey)
+		return NULL;
+	return (PSD)pthread_getspecific(screenkey);
+}
+
+#else /* !(MW_FEATURE_IMAGES && HAVE_FILEIO && MW_FEATURE_ASYNCIMAGES)*/
+
+#if MW_FEATURE_IMAGES
+int
+GdOpenAsyncImage(void)
+{
+	return -1;
+}
+
+void
+GdCloseAsyncImage(void)
+{
+}
+
+MWBOOL
+GdLoadImageFromFileAsync(int id, char *path, MWCOORD width, MWCOORD height, int flags)
+{
+	return FALSE;
+}
+
+MWBOOL
+GdGetAsyncImage(int *pid, PSD *ppmd)
+{
+	return FALSE;
+}
+
+PSD
+GdGetAsyncImageScreen(void)
+{
+	return NULL;
+}
+#endif /* MW_FEATURE_IMAGES*/
+#endif /* MW_FEATURE_IMAGES && HAVE_FILEIO && MW_FEATURE_ASYNCIMAGES - whole file */
@@ -0,0 +1,314 @@
+/*
+ * Decoded image cache for GdDrawImageFromFile.
+ *
+ * Images drawn from files are kept decoded, resized to the requested
+ * width/height and, when possible, converted to the screen pixel format,
+ * so that repeated draws of the same icon or background become a single
+ * blit rather than a full mmap/decode/convert/stretch cycle.
+ *
+ * Entries are keyed by (path, mtime, file size, width, height, flags, screen format)
+ * and kept in most-recently-used order.  When the total size of the cached
+ * pixmaps exceeds the cache budget, least-recently-used entries are freed.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "device.h"
+#include "convblit.h"
+#include "../drivers/genmem.h"
+
+#if MW_FEATURE_IMAGES && HAVE_FILEIO && IMAGECACHE_SIZE	/* whole file */
+
+typedef struct imagecache {
+	struct imagecache *next;	/* LRU list, most recently used first*/
+	struct imagecache *prev;
+	unsigned int hash;		/* path hash for fast compare*/
+	char *		path;		/* image file path*/
+	time_t		mtime;		/* file modification time when decoded*/
+	off_t		filesize;	/* file size when decoded*/
+	MWCOORD		width;		/* requested width, <0 for image width*/
+	MWCOORD		height;		/* requested height, <0 for image height*/
+	int			flags;		/* decoder flags*/
+	MWIMGDATFMT	scr_format;	/* screen data format when converted*/
+	PSD			pmd;		/* decoded, resized and converted image*/
+	unsigned int bytes;		/* memory held by pmd*/
+} IMAGECACHE;
+
+static IMAGECACHE *cachehead;	/* most recently used*/
+static IMAGECACHE *cachetail;	/* least recently used*/
+static MWIMAGECACHESTATS cachestats = { 0, 0, 0, 0, 0, IMAGECACHE_SIZE };
+
+static unsigned int
+cache_hash(const char *path)
+{
+	unsigned int h = 5381;
+
+	while (*path)
+		h = (h << 5) + h + (unsigned char)*path++;
+	return h;
+}
+
+static void
+cache_unlink(IMAGECACHE *ic)
+{
+	if (ic->prev)
+		ic->prev->next = ic->next;
+	else cachehead = ic->next;
+	if (ic->next)
+		ic->next->prev = ic->prev;
+	else cachetail = ic->prev;
+	ic->next = ic->prev = NULL;
+}
+
+static void
+cache_insert_head(IMAGECACHE *ic)
+{
+	ic->prev = NULL;
+	ic->next = cachehead;
+	if (cachehead)
+		cachehead->prev = ic;
+	cachehead = ic;
+	if (!cachetail)
+		cachetail = ic;
+}
+
+static void
+cache_free_entry(IMAGECACHE *ic)
+{
+	cache_unlink(ic);
+	cachestats.bytes -= ic->bytes;
+	cachestats.entries--;
+	GdFreePixmap(ic->pmd);
+	free(ic->path);
+	free(ic);
+}
+
+/* free least recently used entries until size bytes fit within budget*/
+static void
+cache_shrink(unsigned int size)
+{
+	while (cachetail && cachestats.bytes + size > cachestats.maxbytes) {
+		cache_free_entry(cachetail);
+		cachestats.evictions++;
+	}
+}
+
+/*
+ * Resize image to width/height and convert to screen pixel format if it
+ * has no alpha or transparent color.  Always returns a usable image,
+ * falling back to the passed image if resize or conversion fails.
+ */
+static PSD
+cache_prepare_image(PSD pmd, MWCOORD width, MWCOORD height)
+{
+	PSD			pmd2;
+	MWBLITFUNC	convblit;
+	MWBLITPARMS	parms;
+	MWCLIPRECT	rcDst;
+
+	if (width < 0)
+		width = pmd->xvirtres;
+	if (height < 0)
+		height = pmd->yvirtres;
+
+	/* stretch once now rather than on each draw*/
+	if (width != pmd->xvirtres || height != pmd->yvirtres) {
+		pmd2 = GdCreatePixmap(&scrdev, width, height, pmd->data_format, NULL, pmd->palsize);
+		if (!pmd2)
+			return pmd;
+		pmd2->transcolor = pmd->transcolor;
+		if (pmd->palsize && pmd->palette)
+			memcpy(pmd2->palette, pmd->palette, pmd->palsize * sizeof(MWPALENTRY));
+
+		rcDst.x = 0;
+		rcDst.y = 0;
+		rcDst.width = width;
+		rcDst.height = height;
+		// FIXME casting MWIMAGEHDR
+		GdStretchImage((PMWIMAGEHDR)pmd, NULL, (PMWIMAGEHDR)pmd2, &rcDst);
+		GdFreePixmap(pmd);
+		pmd = pmd2;
+	}
+
+	/* images with alpha or transparency are blended at draw time*/
+	if ((pmd->data_format & MWIF_HASALPHA) || pmd->transcolor != MWNOCOLOR)
+		return pmd;
+	if (scrdev.pixtype == MWPF_PALETTE || pmd->data_format == scrdev.data_format)
+		return pmd;
+
+	/* convert to screen format so draws use frameblit*/
+	pmd2 = GdCreatePixmap(&scrdev, pmd->xvirtres, pmd->yvirtres, 0, NULL, 0);
+	if (!pmd2)
+		return pmd;
+	convblit = GdFindConvBlit(pmd2, pmd->data_format, MWROP_COPY);
+	if (!convblit) {
+		GdFreePixmap(pmd2);
+		return pmd;
+	}
+
+	/* no clipping in private pixmap, call convblit directly*/
+	memset(&parms, 0, sizeof(parms));
+	parms.op = MWROP_COPY;
+	parms.data_format = pmd->data_format;
+	parms.width = pmd->xvirtres;
+	parms.height = pmd->yvirtres;
+	parms.src_pitch = pmd->pitch;
+	parms.data = pmd->addr;
+	parms.dst_pitch = pmd2->pitch;
+	parms.data_out = pmd2->addr;
+	convblit(pmd2, &parms);
+
+	GdFreePixmap(pmd);
+	return pmd2;
+}
+
+/* draw a cached image, using frameblit if in destination format*/
+static void
+cache_draw_image(PSD psd, MWCOORD x, MWCOORD y, PSD pmd)
+{
+	if (pmd->data_format == psd->data_format && !(pmd->data_format & MWIF_HASALPHA) &&
+	    pmd->transcolor == MWNOCOLOR)
+		GdBlit(psd, x, y, pmd->xvirtres, pmd->yvirtres, pmd, 0, 0, MWROP_COPY);
+	else GdDrawImage(psd, x, y, (PMWIMAGEHDR)pmd);	// FIXME casting MWIMAGEHDR
+}
+
+/**
+ * Draw an image from a file using the decoded image cache.
+ *
+ * @return FALSE if the cache is disabled or the file can't be found,
+ * in which case the caller should draw the image uncached.
+ */
+MWBOOL
+GdDrawCachedImageFromFile(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height,
+	char *path, int flags)
+{
+	IMAGECACHE *ic;
+	PSD			pmd;
+	unsigned int hash;
+	struct stat s;
+
+	if (cachestats.maxbytes == 0 || stat(path, &s) < 0)
+		return FALSE;
+
+	hash = cache_hash(path);
+	for (ic = cachehead; ic; ic = ic->next) {
+		if (ic->hash != hash || ic->width != width || ic->height != height ||
+		    ic->flags != flags || strcmp(ic->path, path) != 0)
+			continue;
+
+		/* drop stale entry if file or screen format changed*/
+		if (ic->mtime != s.st_mtime || ic->filesize != s.st_size ||
+		    ic->scr_format != scrdev.data_format) {
+			cache_free_entry(ic);
+			break;
+		}
+
+		/* move to front of LRU list*/
+		if (ic != cachehead) {
+			cache_unlink(ic);
+			cache_insert_head(ic);
+		}
+		cachestats.hits++;
+		cache_draw_image(psd, x, y, ic->pmd);
+		return TRUE;
+	}
+	cachestats.misses++;
+
+	pmd = GdLoadImageFromFileScaled(path, width, height, flags);
+	if (!pmd)
+		return TRUE;		/* error already reported*/
+	pmd = cache_prepare_image(pmd, width, height);
+
+	/* don't flush the whole cache for an image that won't fit*/
+	if (pmd->size > cachestats.maxbytes ||
+	    (ic = (IMAGECACHE *)malloc(sizeof(IMAGECACHE))) == NULL) {
+		cache_draw_image(psd, x, y, pmd);
+		GdFreePixmap(pmd);
+		return TRUE;
+	}
+	if ((ic->path = strdup(path)) == NULL) {
+		free(ic);
+		cache_draw_image(psd, x, y, pmd);
+		GdFreePixmap(pmd);
+		return TRUE;
+	}
+
+	cache_shrink(pmd->size);
+	ic->hash = hash;
+	ic->mtime = s.st_mtime;
+	ic->filesize = s.st_size;
+	ic->width = width;
+	ic->height = height;
+	ic->flags = flags;
+	ic->scr_format = scrdev.data_format;
+	ic->pmd = pmd;
+	ic->bytes = pmd->size;
+	cache_insert_head(ic);
+	cachestats.bytes += ic->bytes;
+	cachestats.entries++;
+
+	cache_draw_image(psd, x, y, pmd);
+	return TRUE;
+}
+
+/**
+ * Set the decoded image cache memory budget, evicting entries if required.
+ *
+ * @param maxbytes Maximum bytes of decoded images to keep, 0 disables the cache.
+ */
+void
+GdSetImageCacheSize(unsigned int maxbytes)
+{
+	cachestats.maxbytes = maxbytes;
+	cache_shrink(0);
+}
+
+/**
+ * Free all cached images.
+ */
+void
+GdFlushImageCache(void)
+{
+	while (cachehead)
+		cache_free_entry(cachehead);
+}
+
+/**
+ * Return decoded image cache statistics.
+ *
+ * @param pstats Destination for cache statistics.
+ */
+void
+GdGetImageCacheStats(PMWIMAGECACHESTATS pstats)
+{
+	*pstats = cachestats;
+}
+
+#else /* !(MW_FEATURE_IMAGES && HAVE_FILEIO && IMAGECACHE_SIZE)*/
+
+#if MW_FEATURE_IMAGES
+MWBOOL
+GdDrawCachedImageFromFile(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height,
+	char *path, int flags)
+{
+	return FALSE;
+}
+
+void
+GdSetImageCacheSize(unsigned int maxbytes)
+{
+}
+
+void
+GdFlushImageCache(void)
+{
+}
+
+void
+GdGetImageCacheStats(PMWIMAGECACHESTATS pstats)
+{
+	memset(pstats, 0, sizeof(*pstats));
+}
+#endif /* MW_FEATURE_IMAGES*/
+#endif /* MW_FEATURE_IMAGES && HAVE_FILEIO && IMAGECACHE_SIZE - whole file */
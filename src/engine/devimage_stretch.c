@@ -64,6 +64,34 @@ static void copy_row3(unsigned char *src, int src_w, unsigned char *dst,
 	}
 }
 
+/**
+ * Stretch a single row of pixels, using the same sampling as GdStretchImage.
+ *
+ * @param src Source row.
+ * @param src_w Source width in pixels.
+ * @param dst Destination row.
+ * @param dst_w Destination width in pixels.
+ * @param bytesperpixel Bytes per pixel of both rows.
+ */
+void
+GdStretchImageRow(MWUCHAR *src, int src_w, MWUCHAR *dst, int dst_w, int bytesperpixel)
+{
+	switch (bytesperpixel) {
+	case 1:
+		copy_row1(src, src_w, dst, dst_w);
+		break;
+	case 2:
+		copy_row2((unsigned short *)src, src_w, (unsigned short *)dst, dst_w);
+		break;
+	case 3:
+		copy_row3(src, src_w, dst, dst_w);
+		break;
+	case 4:
+		copy_row4((uint32_t *)src, src_w, (uint32_t *)dst, dst_w);
+		break;
+	}
+}
+
 /**
  * Perform a stretch blit between two image structs of the same format.
  *
@@ -138,20 +166,7 @@ GdStretchImage(PMWIMAGEHDR src, MWCLIPRECT *srcrect, PMWIMAGEHDR dst, MWCLIPRECT
 			pos -= 0x10000L;
 		}
 
-		switch (bytesperpixel) {
-		case 1:
-			copy_row1(srcp, srcrect->width, dstp, dstrect->width);
-			break;
-		case 2:
-			copy_row2((unsigned short *)srcp, srcrect->width, (unsigned short *)dstp, dstrect->width);
-			break;
-		case 3:
-			copy_row3(srcp, srcrect->width, dstp, dstrect->width);
-			break;
-		case 4:
-			copy_row4((uint32_t *)srcp, srcrect->width, (uint32_t *)dstp, dstrect->width);
-			break;
-		}
+		GdStretchImageRow(srcp, srcrect->width, dstp, dstrect->width, bytesperpixel);
 
 		pos += inc;
 	}
@@ -39,8 +39,8 @@ GdListInsert(PMWLISTHEAD pHead,PMWLIST pItem)
 		pItem->next = NULL;
 	pItem->prev = NULL;
 	pHead->head = pItem;
-	if( !pHead->head)
-		pHead->head = pItem;
+	if( !pHead->tail)
+		pHead->tail = pItem;
 }
 
 void
@@ -54,8 +54,6 @@ static MWPIXELVALHW cursavbits[MWMAX_CURSOR_SIZE * MWMAX_CURSOR_SIZE];
 static MWIMAGEBITS cursormask[MWMAX_CURSOR_BUFLEN];
 static MWIMAGEBITS cursorcolor[MWMAX_CURSOR_BUFLEN];
 
-extern int gr_mode;
-
 /* Advance declarations */
 static int filter_relative(int, int, int, int *, int *, int, int);
 static int filter_transform(int, int *, int *);
@@ -12,6 +12,7 @@
  * without dragging in any other GdXXX routines.
  */
 #include <stdlib.h>
+#include <string.h>
 #include "device.h"
 
 #if MSDOS | ELKS
@@ -27,24 +28,13 @@
  */
 #define FIRSTUSERPALENTRY	24  /* first writable pal entry over 16 color*/
 
-MWPIXELVAL gr_foreground;	/* current foreground color */
-MWPIXELVAL gr_background;	/* current background color */
-MWBOOL 	gr_usebg;    	    /* TRUE if background drawn in pixmaps */
-int 	gr_mode = MWROP_COPY; 	    /* drawing mode */
 /*static*/ MWPALENTRY	gr_palette[256];    /* current palette*/
 /*static*/ int	gr_firstuserpalentry;/* first user-changable palette entry*/
 /*static*/ int 	gr_nextpalentry;    /* next available palette entry*/
-MWCOLORVAL gr_foreground_rgb;	/* current fg color in 0xAARRGGBB format for mono convblits*/
-MWCOLORVAL gr_background_rgb;	/* current background color */
 
-uint32_t gr_dashmask;     /* An actual bitmask of the dash values */
-uint32_t gr_dashcount;    /* The number of bits defined in the dashmask */
-
-int        gr_fillmode;
-MWSTIPPLE  gr_stipple;
-MWTILE     gr_tile;
-
-MWPOINT    gr_ts_offset;
+/* default draw context, used when no other is set*/
+static MWDRAWCTX gr_defaultctx = { 0, 0, 0, 0, FALSE, MWROP_COPY };
+MWTHREADVAR PMWDRAWCTX gr_drawctx = &gr_defaultctx;	/* current draw context*/
 
 MWCOORD    nxres;           /* requested server x resolution*/
 MWCOORD    nyres;           /* requested server y resolution*/
@@ -178,6 +168,83 @@ GdCloseScreen(PSD psd)
 	psd->Close(psd);
 }
 
+/**
+ * Initialize a draw context to the default drawing state.
+ *
+ * @param ctx Draw context.
+ */
+void
+GdInitDrawContext(PMWDRAWCTX ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->mode = MWROP_COPY;
+}
+
+/**
+ * Select the draw context used by all following drawing and GdSet calls
+ * in this thread.  Switching contexts keeps each one's colors, mode, line,
+ * dash and fill state, so nothing needs to be set again.
+ *
+ * @param ctx Draw context, or NULL for the default context.
+ * @return Previous draw context.
+ */
+PMWDRAWCTX
+GdSetDrawContext(PMWDRAWCTX ctx)
+{
+	PMWDRAWCTX oldctx = gr_drawctx;
+
+	gr_drawctx = ctx? ctx: &gr_defaultctx;
+	return oldctx;
+}
+
+/**
+ * Copy a draw context, including its stipple, so that the copy can be
+ * used while the source is changed or freed by another thread.  Memory
+ * previously allocated by the destination is freed.  If the stipple
+ * can't be copied, the destination has no stipple.
+ *
+ * @param dst Destination draw context.
+ * @param src Source draw context.
+ */
+void
+GdCopyDrawContext(PMWDRAWCTX dst, PMWDRAWCTX src)
+{
+	size_t size;
+
+	GdFreeDrawContext(dst);
+	*dst = *src;
+	dst->stipple.bitmap = NULL;
+	dst->ts_expand = NULL;
+	if (src->stipple.bitmap) {
+		size = MWIMAGE_SIZE(src->stipple.width, src->stipple.height) * sizeof(MWIMAGEBITS);
+		if ((dst->stipple.bitmap = malloc(size)) != NULL)
+			memcpy(dst->stipple.bitmap, src->stipple.bitmap, size);
+		else
+			dst->stipple.width = dst->stipple.height = 0;
+	}
+	if (src->ts_expand && dst->stipple.bitmap) {
+		size = src->ts_expandpitch * src->stipple.height * sizeof(MWIMAGEBITS);
+		if ((dst->ts_expand = malloc(size)) != NULL)
+			memcpy(dst->ts_expand, src->ts_expand, size);
+	}
+}
+
+/**
+ * Free memory allocated by a draw context.  The context must not be current.
+ *
+ * @param ctx Draw context.
+ */
+void
+GdFreeDrawContext(PMWDRAWCTX ctx)
+{
+	if (ctx->stipple.bitmap)
+		free(ctx->stipple.bitmap);
+	if (ctx->ts_expand)
+		free(ctx->ts_expand);
+	ctx->stipple.bitmap = NULL;
+	ctx->ts_expand = NULL;
+}
+
 /**
  * Set dynamic screen portrait mode, return new mode
  *
@@ -28,10 +28,6 @@
 #define X11POLYFILL	0	/* X11-derived polygon fill*/
 #define BASICPOLYFILL	0	/* very basic, small polygon fill*/
 
-/* extern definitions*/
-extern int 	  gr_mode; 	      /* drawing mode */
-extern int gr_fillmode;
-
 /**
  * Draw a polygon in the foreground color, applying clipping if necessary.
  * The polygon is only closed if the first point is repeated at the end.
@@ -52,6 +48,11 @@ GdPoly(PSD psd, int count, MWPOINT *points)
 
   if (count < 2)
 	  return;
+  if (gr_linewidth > 1) {
+	GdWidePolyLine(psd, count, points, points[count-1].x == points->x &&
+		points[count-1].y == points->y);
+	return;
+  }
   firstx = points->x;
   firsty = points->y;
   didline = FALSE;
@@ -130,6 +130,63 @@ typedef void (*REGION_NonOverlapBandFunctionPtr) (MWCLIPREGION * pReg, MWRECT *
         ( ((r).bottom >  y)) && \
         ( ((r).top <= y)) )
 
+/**
+ * Find the band of a region at or below a y co-ordinate.
+ * Region rectangles are kept y-x banded by REGION_RegionOp: sorted by top,
+ * all rectangles in a band share top and bottom, and within a band they
+ * are sorted by left and don't touch. So bottom never decreases through
+ * the list and a binary search finds the band.
+ *
+ * @param rgn Region.
+ * @param y Y co-ordinate.
+ * @return Index of first rectangle with bottom > y, numRects if none.
+ *	If that rectangle's top is > y, y lies between bands.
+ */
+int
+GdRegionFindBand(MWCLIPREGION *rgn, MWCOORD y)
+{
+    int lo = 0;
+    int hi = rgn->numRects;
+
+    while (lo < hi) {
+	int mid = (lo + hi) >> 1;
+
+	if (rgn->rects[mid].bottom <= y)
+	    lo = mid + 1;
+	else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Find the rectangle at or right of an x co-ordinate within a band.
+ *
+ * @param rgn Region.
+ * @param band Index of first rectangle in band, from GdRegionFindBand.
+ * @param x X co-ordinate.
+ * @return Index of first rectangle in band with right > x.  If none,
+ *	the index of the first rectangle of the next band or numRects.
+ */
+int
+GdRegionFindX(MWCLIPREGION *rgn, int band, MWCOORD x)
+{
+    int lo = band;
+    int hi = rgn->numRects;
+    MWCOORD top;
+
+    if (lo >= hi)
+	return hi;
+    top = rgn->rects[band].top;
+    while (lo < hi) {
+	int mid = (lo + hi) >> 1;
+
+	if (rgn->rects[mid].top == top && rgn->rects[mid].right <= x)
+	    lo = mid + 1;
+	else hi = mid;
+    }
+    return lo;
+}
+
 /**
  * return TRUE if point is in region
  *
@@ -143,10 +200,14 @@ GdPtInRegion(MWCLIPREGION *rgn, MWCOORD x, MWCOORD y)
 {
     int i;
 
-    if (rgn->numRects > 0 && INRECT(rgn->extents, x, y))
-	for (i = 0; i < rgn->numRects; i++)
-	    if (INRECT (rgn->rects[i], x, y))
+    if (rgn->numRects > 0 && INRECT(rgn->extents, x, y)) {
+	i = GdRegionFindBand(rgn, y);
+	if (i < rgn->numRects && rgn->rects[i].top <= y) {
+	    i = GdRegionFindX(rgn, i, x);
+	    if (i < rgn->numRects && INRECT(rgn->rects[i], x, y))
 		return TRUE;
+	}
+    }
     return FALSE;
 }
 
@@ -176,9 +237,11 @@ GdRectInRegion(MWCLIPREGION *rgn, const MWRECT *rect)
 
     /* 
      * can stop when both partOut and partIn are TRUE,
-     * or we reach rect->bottom
+     * or we reach rect->bottom.  Start at the first band reaching ry,
+     * the rectangles before it would all be skipped.
      */
-    for (pCurRect = rgn->rects, pRectEnd = pCurRect + rgn->numRects;
+    pRectEnd = rgn->rects + rgn->numRects;
+    for (pCurRect = rgn->rects + GdRegionFindBand(rgn, ry);
 		 pCurRect < pRectEnd; pCurRect++) {
 
 	if (pCurRect->bottom <= ry)
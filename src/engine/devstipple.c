@@ -9,13 +9,17 @@
 #include <string.h>
 #include "device.h"
 
-extern int gr_fillmode;			/* current fill mode        */
-extern MWSTIPPLE gr_stipple;		/* The current stipple as set by the GC */
-extern MWTILE gr_tile;			/* The current tile as set by the GC */
-extern MWPOINT gr_ts_offset;		/* The x and y offset of the tile / stipple */
+static MWTHREADVAR int ts_origin_x = 0;
+static MWTHREADVAR int ts_origin_y = 0;
 
-static int ts_origin_x = 0;
-static int ts_origin_y = 0;
+/* Stipple pre-expanded by GdSetStippleBitmap into the draw context, each
+ * row replicated across to at least TS_EXPANDWIDTH pixels, so fills draw
+ * long spans with one blit.
+ */
+#define TS_EXPANDWIDTH	128
+#define ts_expand		(gr_drawctx->ts_expand)		/* expanded stipple, MWIF_MONOWORDMSB*/
+#define ts_expandwidth	(gr_drawctx->ts_expandwidth)
+#define ts_expandpitch	(gr_drawctx->ts_expandpitch)
 
 /* Some useful macros */
 #define SPITCH ((gr_stipple.width + (MWIMAGE_BITSPERIMAGE - 1)) / MWIMAGE_BITSPERIMAGE)
@@ -28,6 +32,45 @@ static int ts_origin_y = 0;
 #define BIT_SET(data, w, h) \
 	(data[(h * SPITCH) + (w / MWIMAGE_BITSPERIMAGE)] & (1 << ((MWIMAGE_BITSPERIMAGE - 1) - (w % MWIMAGE_BITSPERIMAGE))))
 
+/* bit test in expanded stipple*/
+#define EXPAND_BIT_SET(x, y) \
+	(ts_expand[(y) * ts_expandpitch + (x) / MWIMAGE_BITSPERIMAGE] & \
+		MWIMAGE_FIRSTBIT >> ((x) % MWIMAGE_BITSPERIMAGE))
+
+/* offset into pattern, positive for points left of or above origin*/
+#define PATMOD(v, size)	((((v) % (size)) + (size)) % (size))
+
+/* replicate stipple rows across into ts_expand*/
+static void
+ts_expandstipple(void)
+{
+	int x, y, sx;
+
+	if (ts_expand)
+		free(ts_expand);
+	ts_expand = NULL;
+
+	ts_expandwidth = gr_stipple.width;
+	while (ts_expandwidth < TS_EXPANDWIDTH)
+		ts_expandwidth += gr_stipple.width;
+	ts_expandpitch = (ts_expandwidth + MWIMAGE_BITSPERIMAGE - 1) / MWIMAGE_BITSPERIMAGE;
+
+	ts_expand = calloc(ts_expandpitch * gr_stipple.height, sizeof(MWIMAGEBITS));
+	if (!ts_expand)
+		return;
+
+	for (y = 0; y < gr_stipple.height; y++) {
+		MWIMAGEBITS *row = ts_expand + y * ts_expandpitch;
+
+		for (x = 0, sx = 0; x < ts_expandwidth; x++) {
+			if (BIT_SET(gr_stipple.bitmap, sx, y))
+				row[x / MWIMAGE_BITSPERIMAGE] |= MWIMAGE_FIRSTBIT >> (x % MWIMAGE_BITSPERIMAGE);
+			if (++sx >= gr_stipple.width)
+				sx = 0;
+		}
+	}
+}
+
 void
 GdSetStippleBitmap(MWIMAGEBITS *stipple, MWCOORD width, MWCOORD height)
 {
@@ -35,11 +78,14 @@ GdSetStippleBitmap(MWIMAGEBITS *stipple, MWCOORD width, MWCOORD height)
 
 	if (gr_stipple.bitmap)
 		free(gr_stipple.bitmap);
+	if (ts_expand)
+		free(ts_expand);
+	ts_expand = NULL;
 
 	gr_stipple.width = 0;
 	gr_stipple.height = 0;
 
-	if (!stipple) {
+	if (!stipple || width <= 0 || height <= 0) {
 		gr_stipple.bitmap = 0;
 		return;
 	}
@@ -51,6 +97,7 @@ GdSetStippleBitmap(MWIMAGEBITS *stipple, MWCOORD width, MWCOORD height)
 	gr_stipple.width = width;
 	gr_stipple.height = height;
 	memcpy(gr_stipple.bitmap, stipple, size);
+	ts_expandstipple();
 
 #if 0
 	for (y = 0; y < height; y++) { /* debug output*/
@@ -73,8 +120,9 @@ GdSetTilePixmap(PSD src, MWCOORD width, MWCOORD height)
 		gr_tile.width = 0;
 		gr_tile.height = 0;
 	} else {
-		gr_tile.width = width;
-		gr_tile.height = height;
+		/* there's no source clipping when blitting tiles*/
+		gr_tile.width = MWMIN(width, src->xvirtres);
+		gr_tile.height = MWMIN(height, src->yvirtres);
 	}
 }
 
@@ -86,68 +134,169 @@ GdSetTSOffset(int x, int y)
 	gr_ts_offset.y = y;
 }
 
-/* Set the bounding rect for the stipple.  This also constructs a bitmap that gives us an easy
-   lookup when the time comes */
-
-/* This only works for tiles */
+/* Draw a run of expanded stipple row sy starting at bit sx, for raster ops
+ * the mask convblit doesn't do.  Runs of set bits are drawn as lines.
+ */
 static void
-tile_drawrect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
+stipple_drawrun(PSD psd, MWCOORD x, MWCOORD y, int w, int sx, int sy, int opaque)
 {
-	int sx = x, sy = y;
-	int px = 0, py = 0;
-	int dw = w;
-	int dh = h;
-
-	/* This is where the tile starts */
-	int tilex = x - ts_origin_x;
-	int tiley = y - ts_origin_y;
-
-	/* Sanity check */
-	if (!gr_tile.psd || !gr_tile.width || !gr_tile.height)
-		return;
-
-	/* Adjust the starting point to correspond with the tile offset */
-	if (tilex < 0) {
-		sx += -tilex;
-		dw -= -tilex;
-
-		if (sx > (x + w - 1))
-			return;
-		tilex = sx - ts_origin_x;
+	while (w > 0) {
+		int set = EXPAND_BIT_SET(sx, sy) != 0;
+		int n = 1;
+
+		while (n < w && (EXPAND_BIT_SET(sx + n, sy) != 0) == set)
+			n++;
+		if (set)
+			psd->DrawHorzLine(psd, x, x + n - 1, y, gr_foreground);
+		else if (opaque)
+			psd->DrawHorzLine(psd, x, x + n - 1, y, gr_background);
+		x += n;
+		sx += n;
+		w -= n;
 	}
+}
 
-	if (tiley < 0) {
-		sy += -tiley;
-		dh -= -tiley;
-
-		if (sy > (y + h - 1))
-			return;
-		tiley = sy - ts_origin_y;
+/* Fill a visible rectangle with the expanded stipple, no clipping.
+ * Each blit covers up to the width of the expanded stipple and the
+ * rows down to the bottom of the stipple.
+ */
+static void
+stipple_drawrect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
+{
+	MWBLITFUNC convblit = NULL;
+	MWBLITPARMS parms;
+	int opaque = (gr_fillmode == MWFILL_OPAQUE_STIPPLE);
+	int px = PATMOD(x - ts_origin_x, gr_stipple.width);
+	int sy = PATMOD(y - ts_origin_y, gr_stipple.height);
+
+	if (gr_mode == MWROP_COPY)
+		convblit = GdFindConvBlit(psd, MWIF_MONOWORDMSB, MWROP_COPY);
+	if (convblit) {
+		parms.op = MWROP_COPY;
+		parms.data_format = MWIF_MONOWORDMSB;
+		parms.src_pitch = ts_expandpitch * sizeof(MWIMAGEBITS);
+		parms.fg_colorval = gr_foreground_rgb;
+		parms.bg_colorval = gr_background_rgb;
+		parms.fg_pixelval = gr_foreground;	/* for palette mask convblit*/
+		parms.bg_pixelval = gr_background;
+		parms.usebg = opaque;
+		parms.data = (char *)ts_expand;
+		parms.dst_pitch = psd->pitch;
+		parms.data_out = psd->addr;
+		parms.srcpsd = NULL;
 	}
 
-	while (dh) {
-		int ch = gr_tile.height - ((tiley + py) % gr_tile.height);
-		if (ch > dh)
-			ch = dh;
-
-		dw = w;
-		px = 0;
+	while (h > 0) {
+		int ch = MWMIN(h, gr_stipple.height - sy);
+		MWCOORD dx = x;
+		int dw = w;
+		int sx = px;
+
+		while (dw > 0) {
+			int cw = MWMIN(dw, ts_expandwidth - sx);
+
+			if (convblit) {
+				parms.dstx = dx;
+				parms.dsty = y;
+				parms.width = cw;
+				parms.height = ch;
+				parms.srcx = sx;
+				parms.srcy = sy;
+				convblit(psd, &parms);
+			} else {
+				int i;
+
+				for (i = 0; i < ch; i++)
+					stipple_drawrun(psd, dx, y + i, cw, sx, sy + i, opaque);
+			}
+			dx += cw;
+			dw -= cw;
+			sx = 0;
+		}
+		y += ch;
+		h -= ch;
+		sy = 0;
+	}
+}
 
-		while (dw) {
-			int cw = gr_tile.width - ((tilex + px) % gr_tile.width);
-			if (cw > dw)
-				cw = dw;
+/* Fill a visible rectangle with the tile, no clipping.
+ * The tile pixmap may be drawn into after it's set in the GC, so it
+ * isn't copied, fragments are blitted straight from it.
+ */
+static void
+tile_drawrect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
+{
+	MWBLITFUNC frameblit;
+	MWBLITPARMS parms;
+	PSD srcpsd = gr_tile.psd;
+	int px = PATMOD(x - ts_origin_x, gr_tile.width);
+	int sy = PATMOD(y - ts_origin_y, gr_tile.height);
+
+	frameblit = GdFindFrameBlit(psd, srcpsd->data_format, MWROP_COPY);
+	if (!frameblit)
+		return;
 
-			GdBlit(psd, sx + px, sy + py, cw, ch, gr_tile.psd,
-			       (tilex + px) % gr_tile.width, (tiley + py) % gr_tile.height, MWROP_COPY);
+	parms.op = MWROP_COPY;
+	parms.data_format = psd->data_format;
+	parms.src_pitch = srcpsd->pitch;
+	parms.fg_colorval = gr_foreground_rgb;
+	parms.bg_colorval = gr_background_rgb;
+	parms.fg_pixelval = gr_foreground;
+	parms.bg_pixelval = gr_background;
+	parms.usebg = gr_usebg;
+	parms.data = srcpsd->addr;
+	parms.dst_pitch = psd->pitch;
+	parms.data_out = psd->addr;
+	parms.srcpsd = srcpsd;
+	parms.src_xvirtres = srcpsd->xvirtres;	/* used in frameblit for src rotation*/
+	parms.src_yvirtres = srcpsd->yvirtres;
+
+	while (h > 0) {
+		int ch = MWMIN(h, gr_tile.height - sy);
+		MWCOORD dx = x;
+		int dw = w;
+		int sx = px;
+
+		while (dw > 0) {
+			int cw = MWMIN(dw, gr_tile.width - sx);
+
+			parms.dstx = dx;
+			parms.dsty = y;
+			parms.width = cw;
+			parms.height = ch;
+			parms.srcx = sx;
+			parms.srcy = sy;
+			frameblit(psd, &parms);
+			dx += cw;
 			dw -= cw;
-			px += cw;
+			sx = 0;
 		}
-		dh -= ch;
-		py += ch;
+		y += ch;
+		h -= ch;
+		sy = 0;
 	}
 }
 
+/* Return TRUE if a stipple or tile is set for the current fill mode*/
+static MWBOOL
+ts_valid(void)
+{
+	/* FIXME:  X returns an error - Should we too?*/
+	if (gr_fillmode == MWFILL_STIPPLE || gr_fillmode == MWFILL_OPAQUE_STIPPLE)
+		return ts_expand && gr_stipple.width && gr_stipple.height;
+	return gr_tile.psd && gr_tile.width && gr_tile.height;
+}
+
+/* Fill a visible rectangle with the current stipple or tile*/
+static void
+ts_drawrect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
+{
+	if (gr_fillmode == MWFILL_TILE)
+		tile_drawrect(psd, x, y, w, h);
+	else
+		stipple_drawrect(psd, x, y, w, h);
+}
+
 /* This sets the origin of the stipple (we add the offset) */
 /* We use this in the following functions                  */
 void
@@ -161,74 +310,51 @@ set_ts_origin(int x, int y)
 void
 ts_drawpoint(PSD psd, MWCOORD x, MWCOORD y)
 {
-	int bx = x - ts_origin_x;
-	int by = y - ts_origin_y;
-
 	/* Sanity check - If no stipple / tile is set, then just ignore the request */
-	/* FIXME:  X returns an error - Should we too?                              */
-	if (gr_fillmode == MWFILL_STIPPLE || gr_fillmode == MWFILL_OPAQUE_STIPPLE) {
-		if (!gr_stipple.bitmap || !gr_stipple.width || !gr_stipple.height)
-		    	return;
-	} else {
-		if (!gr_tile.psd || !gr_tile.width || !gr_tile.height)
-			return;
-	}
-
-
-	if (!GdClipPoint(psd, x, y))
+	if (!ts_valid())
 		return;
 
-	/* If the bit offset is less than zero    */
-	/* Meaning that the pixel in question     */
-	/* is to the left or above the current    */
-	/* offset - Then just draw the foreground */
-	/* FIXME:  Should we just skip the pixel instead? */
-	if (bx < 0 || by < 0) {
-		psd->DrawPixel(psd, x, y, gr_foreground);
+	if (!GdClipPoint(psd, x, y))
 		return;
-	}
 
-	switch (gr_fillmode) {
-	case MWFILL_OPAQUE_STIPPLE:
-		if (!BIT_SET(gr_stipple.bitmap, (bx % gr_stipple.width), (by % gr_stipple.height)))
-			psd->DrawPixel(psd, x, y, gr_background);
-		else
-			psd->DrawPixel(psd, x, y, gr_foreground);
-		break;
-
-	case MWFILL_STIPPLE:
-		if (BIT_SET(gr_stipple.bitmap, (bx % gr_stipple.width), (by % gr_stipple.height)))
-			psd->DrawPixel(psd, x, y, gr_foreground);
-		break;
-
-	case MWFILL_TILE:
-		/* Read the bit from the PSD and write it to the current PSD */
-		/* FIXME:  This does no checks for depth correctness         */
-		psd->DrawPixel(psd, x, y,
-			gr_tile.psd->ReadPixel(gr_tile.psd, (bx % gr_tile.width), (by % gr_tile.height)));
-		break;
-	}
+	ts_drawrect(psd, x, y, 1, 1);
 }
 
-/* FIXME:  Optimize the stipple so it uses more bliting and less pixel by pixel stuff */
+/* Draw a horizontal span from x1 to and including x2, clipped in runs
+ * using the clip cache rectangle as in drawrow.
+ */
 void
 ts_drawrow(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y)
 {
-	int x;
-	int dstwidth = x2 - x1 + 1;
-
-	switch (gr_fillmode) {
-	case MWFILL_STIPPLE:
-	case MWFILL_OPAQUE_STIPPLE:
-		for (x = x1; x <= x2; x++)
-			ts_drawpoint(psd, x, y);
-		break;
-
-	case MWFILL_TILE:
-		tile_drawrect(psd, x1, y, dstwidth, 1);
+	MWCOORD temp;
+
+	if (!ts_valid())
+		return;
+
+	if (x1 > x2) {
+		temp = x1;
+		x1 = x2;
+		x2 = temp;
+	}
+	if (x1 < 0)
+		x1 = 0;
+	if (x2 >= psd->xvirtres)
+		x2 = psd->xvirtres - 1;
+
+	/* check cursor intersect once for whole line */
+	GdCheckCursor(psd, x1, y, x2, y);
+
+	while (x1 <= x2) {
+		MWBOOL visible = GdClipPoint(psd, x1, y);
+
+		temp = MWMIN(clipmaxx, x2);
+		if (visible)
+			ts_drawrect(psd, x1, y, temp - x1 + 1, 1);
+		x1 = temp + 1;
 	}
 }
 
+/* Fill a rectangle, drawing each visible part of it with whole pattern blits*/
 void
 ts_fillrect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
 {
@@ -236,13 +362,55 @@ ts_fillrect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h)
 	int x2 = x + w - 1;
 	int y1 = y;
 	int y2 = y + h - 1;
+	int count;
+#if DYNAMICREGIONS
+	MWRECT *prc;
+#else
+	MWCLIPRECT *prc;
+#endif
 
-	if (GdClipArea(psd, x1, y1, x2, y2) == CLIP_INVISIBLE)
+	if (!ts_valid())
 		return;
 
-	if (gr_fillmode == MWFILL_TILE)
-		tile_drawrect(psd, x, y, w, h);
-	else
-		for (; y1 <= y2; y1++)
-			ts_drawrow(psd, x1, x2, y1);
+	switch (GdClipArea(psd, x1, y1, x2, y2)) {
+	case CLIP_INVISIBLE:
+		return;
+
+	case CLIP_VISIBLE:
+		ts_drawrect(psd, x, y, w, h);
+		return;
+	}
+
+	/* partially visible, check cursor once and draw each visible part*/
+	GdCheckCursor(psd, x1, y1, x2, y2);
+
+#if DYNAMICREGIONS
+	prc = clipregion->rects;
+	count = clipregion->numRects;
+#else
+	prc = cliprects;
+	count = clipcount;
+#endif
+	while (count-- > 0) {
+		MWCOORD rx1, rx2, ry1, ry2;
+#if DYNAMICREGIONS
+		rx1 = prc->left;
+		ry1 = prc->top;
+		rx2 = prc->right;
+		ry2 = prc->bottom;
+#else
+		rx1 = prc->x;
+		ry1 = prc->y;
+		rx2 = prc->x + prc->width;
+		ry2 = prc->y + prc->height;
+#endif
+		if (rx1 < x) rx1 = x;
+		if (ry1 < y) ry1 = y;
+		if (rx2 > x + w) rx2 = x + w;
+		if (ry2 > y + h) ry2 = y + h;
+
+		if (rx1 < rx2 && ry1 < ry2)
+			ts_drawrect(psd, rx1, ry1, rx2 - rx1, ry2 - ry1);
+		prc++;
+	}
 }
@@ -0,0 +1,392 @@
+/*
+ * Microwindows wide line drawing
+ *
+ * Lines wider than one pixel are broken into convex pieces: a quadrilateral
+ * for each segment, plus square cap extensions, miter or bevel wedges and
+ * circles for round caps and joins.  Each piece is scan converted into
+ * horizontal spans, the spans are sorted and merged so every pixel is drawn
+ * once, then drawn through the clipped row fill.  Coordinates are fixed
+ * point with SUB fraction bits, pixel centres lie on whole coordinates.
+ *
+ * Dashed wide lines draw each dash as a separate capped segment with no joins.
+ */
+#include <stdlib.h>
+#include "device.h"
+
+#define SUB		8			/* vertex fraction bits*/
+#define ONE		(1 << SUB)
+#define CEIL(a)		(-((-(a)) >> SUB))	/* to whole pixel, round up*/
+#define NORM		14			/* unit vector fraction bits*/
+#define MITERLIMIT2	109			/* X11 miter limit 10.43 squared*/
+
+typedef struct {
+	int	x, y;				/* fixed point SUB*/
+} WPOINT;
+
+typedef struct {
+	MWCOORD	y, x1, x2;			/* row and inclusive span*/
+} WSPAN;
+
+static MWTHREADVAR WSPAN *spans;			/* span buffer, kept between calls*/
+static MWTHREADVAR int nspans;
+static MWTHREADVAR int maxspans;
+static MWTHREADVAR MWBOOL spanfail;			/* out of memory*/
+static MWTHREADVAR MWCOORD spanminx, spanminy, spanmaxx, spanmaxy;	/* span bounds*/
+
+static void
+addspan(MWCOORD y, MWCOORD x1, MWCOORD x2)
+{
+	if (nspans >= maxspans) {
+		int n = maxspans? maxspans * 2: 256;
+		WSPAN *p = realloc(spans, n * sizeof(WSPAN));
+
+		if (!p) {
+			spanfail = TRUE;
+			return;
+		}
+		spans = p;
+		maxspans = n;
+	}
+	spans[nspans].y = y;
+	spans[nspans].x1 = x1;
+	spans[nspans].x2 = x2;
+	nspans++;
+
+	if (x1 < spanminx) spanminx = x1;
+	if (x2 > spanmaxx) spanmaxx = x2;
+	if (y < spanminy) spanminy = y;
+	if (y > spanmaxy) spanmaxy = y;
+}
+
+/* Add spans of pixel centres within a convex polygon, left and top edges inclusive*/
+static void
+addconvex(WPOINT *p, int n)
+{
+	int i, ymin, ymax;
+	MWCOORD y;
+
+	ymin = ymax = p[0].y;
+	for (i = 1; i < n; i++) {
+		if (p[i].y < ymin) ymin = p[i].y;
+		if (p[i].y > ymax) ymax = p[i].y;
+	}
+
+	for (y = CEIL(ymin); y * ONE < ymax; y++) {
+		int yy = y * ONE;
+		int xl = MAX_MWCOORD;
+		int xr = MIN_MWCOORD;
+
+		for (i = 0; i < n; i++) {
+			WPOINT *a = &p[i];
+			WPOINT *b = &p[(i + 1) % n];
+			int x;
+
+			if (a->y == b->y || yy < MWMIN(a->y, b->y) || yy > MWMAX(a->y, b->y))
+				continue;
+			x = a->x + (int)((int64_t)(yy - a->y) * (b->x - a->x) / (b->y - a->y));
+			if (x < xl) xl = x;
+			if (x > xr) xr = x;
+		}
+		if (xl < xr && CEIL(xl) <= CEIL(xr) - 1)
+			addspan(y, CEIL(xl), CEIL(xr) - 1);
+	}
+}
+
+/* Add spans of a round cap or join*/
+static void
+addcircle(WPOINT *c, int r)
+{
+	MWCOORD y;
+
+	for (y = CEIL(c->y - r); y * ONE < c->y + r; y++) {
+		int64_t dy = y * ONE - c->y;
+		int64_t h2 = (int64_t)r * r - dy * dy;
+		int h;
+
+		if (h2 <= 0)
+			continue;
+		h = GdIntSqrt(h2);
+		if (CEIL(c->x - h) <= CEIL(c->x + h) - 1)
+			addspan(y, CEIL(c->x - h), CEIL(c->x + h) - 1);
+	}
+}
+
+/* Add a segment from a to b with caps, the segment must not be zero length*/
+static void
+addsegment(WPOINT *a, WPOINT *b, int hw, MWBOOL caps)
+{
+	WPOINT q[4];
+	int64_t dx = b->x - a->x;
+	int64_t dy = b->y - a->y;
+	int len = GdIntSqrt(dx * dx + dy * dy);
+	int nx, ny, ex = 0, ey = 0;
+
+	if (len == 0)
+		return;
+	nx = (int)(-dy * hw / len);		/* half width normal*/
+	ny = (int)(dx * hw / len);
+
+	if (caps && gr_capstyle == MWCAP_SQUARE) {
+		ex = (int)(dx * hw / len);	/* extend ends by half width*/
+		ey = (int)(dy * hw / len);
+	}
+	q[0].x = a->x - ex + nx; q[0].y = a->y - ey + ny;
+	q[1].x = b->x + ex + nx; q[1].y = b->y + ey + ny;
+	q[2].x = b->x + ex - nx; q[2].y = b->y + ey - ny;
+	q[3].x = a->x - ex - nx; q[3].y = a->y - ey - ny;
+	addconvex(q, 4);
+
+	if (caps && gr_capstyle == MWCAP_ROUND) {
+		addcircle(a, hw);
+		addcircle(b, hw);
+	}
+}
+
+/* Add a cap for a zero length line*/
+static void
+adddot(WPOINT *p, int hw)
+{
+	WPOINT q[4];
+
+	switch (gr_capstyle) {
+	case MWCAP_ROUND:
+		addcircle(p, hw);
+		break;
+	case MWCAP_SQUARE:
+		q[0].x = p->x - hw; q[0].y = p->y - hw;
+		q[1].x = p->x + hw; q[1].y = p->y - hw;
+		q[2].x = p->x + hw; q[2].y = p->y + hw;
+		q[3].x = p->x - hw; q[3].y = p->y + hw;
+		addconvex(q, 4);
+		break;
+	}
+}
+
+/* Add the join at p between segments a-p and p-b*/
+static void
+addjoin(WPOINT *a, WPOINT *p, WPOINT *b, int hw)
+{
+	WPOINT q[4];
+	int64_t dx1 = p->x - a->x, dy1 = p->y - a->y;
+	int64_t dx2 = b->x - p->x, dy2 = b->y - p->y;
+	int64_t cross = dx1 * dy2 - dy1 * dx2;
+	int len1 = GdIntSqrt(dx1 * dx1 + dy1 * dy1);
+	int len2 = GdIntSqrt(dx2 * dx2 + dy2 * dy2);
+	int n1x, n1y, n2x, n2y, dot;
+
+	if (cross == 0 && dx1 * dx2 + dy1 * dy2 >= 0)
+		return;				/* straight on*/
+
+	if (gr_joinstyle == MWJOIN_ROUND) {
+		addcircle(p, hw);
+		return;
+	}
+
+	/* unit normals on the outside of the turn*/
+	n1x = (int)((-dy1 << NORM) / len1);
+	n1y = (int)((dx1 << NORM) / len1);
+	n2x = (int)((-dy2 << NORM) / len2);
+	n2y = (int)((dx2 << NORM) / len2);
+	if (cross > 0) {
+		n1x = -n1x; n1y = -n1y;
+		n2x = -n2x; n2y = -n2y;
+	}
+
+	q[0] = *p;
+	q[1].x = p->x + (int)(((int64_t)n1x * hw) >> NORM);
+	q[1].y = p->y + (int)(((int64_t)n1y * hw) >> NORM);
+	q[3].x = p->x + (int)(((int64_t)n2x * hw) >> NORM);
+	q[3].y = p->y + (int)(((int64_t)n2y * hw) >> NORM);
+
+	/* miter tip is at (n1 + n2) * hw / (1 + n1.n2), bevel if too long*/
+	dot = (int)(((int64_t)n1x * n2x + (int64_t)n1y * n2y) >> NORM);
+	if (gr_joinstyle == MWJOIN_MITER &&
+	    (int64_t)((1 << NORM) + dot) * MITERLIMIT2 >= (2 << NORM)) {
+		q[2].x = p->x + (int)((int64_t)(n1x + n2x) * hw / ((1 << NORM) + dot));
+		q[2].y = p->y + (int)((int64_t)(n1y + n2y) * hw / ((1 << NORM) + dot));
+		addconvex(q, 4);
+	} else {
+		q[2] = q[3];
+		addconvex(q, 3);
+	}
+}
+
+/* Add each dash of segment a-b as a capped segment, dash state carries over*/
+static void
+adddashes(WPOINT *a, WPOINT *b, int hw, unsigned int *bit, int *used)
+{
+	int64_t dx = b->x - a->x;
+	int64_t dy = b->y - a->y;
+	int len = GdIntSqrt(dx * dx + dy * dy);
+	int pos = 0;
+	int start = -1;
+
+	while (pos < len) {
+		int step = MWMIN(ONE - *used, len - pos);
+
+		if (gr_dashmask & (1 << *bit)) {
+			if (start < 0)
+				start = pos;
+		} else if (start >= 0) {
+			WPOINT p, q;
+
+			p.x = a->x + (int)(dx * start / len); p.y = a->y + (int)(dy * start / len);
+			q.x = a->x + (int)(dx * pos / len);   q.y = a->y + (int)(dy * pos / len);
+			addsegment(&p, &q, hw, TRUE);
+			start = -1;
+		}
+		pos += step;
+		*used += step;
+		if (*used >= ONE) {
+			*used = 0;
+			*bit = (*bit + 1) % gr_dashcount;
+		}
+	}
+	if (start >= 0 && start < len) {
+		WPOINT p;
+
+		p.x = a->x + (int)(dx * start / len); p.y = a->y + (int)(dy * start / len);
+		addsegment(&p, b, hw, TRUE);
+	}
+}
+
+static int
+spancmp(const void *a, const void *b)
+{
+	const WSPAN *s1 = a;
+	const WSPAN *s2 = b;
+
+	if (s1->y != s2->y)
+		return s1->y - s2->y;
+	return s1->x1 - s2->x1;
+}
+
+/* Merge overlapping spans and draw each once*/
+static void
+drawspans(PSD psd)
+{
+	WSPAN *sp, *end;
+	uint32_t dm = 0;
+	int dc = 0;
+
+	if (nspans == 0)
+		return;
+	qsort(spans, nspans, sizeof(WSPAN), spancmp);
+
+	GdCheckCursor(psd, spanminx, spanminy, spanmaxx, spanmaxy);
+#if MW_FEATURE_SHAPES
+	if (gr_fillmode != MWFILL_SOLID)
+		set_ts_origin(spanminx, spanminy);
+#endif
+	GdSetDash(&dm, &dc);			/* spans are drawn solid*/
+
+	for (sp = spans, end = spans + nspans; sp < end; ) {
+		MWCOORD y = sp->y;
+		MWCOORD x1 = sp->x1;
+		MWCOORD x2 = sp->x2;
+
+		for (++sp; sp < end && sp->y == y && sp->x1 <= x2 + 1; ++sp)
+			if (sp->x2 > x2)
+				x2 = sp->x2;
+#if MW_FEATURE_SHAPES
+		if (gr_fillmode != MWFILL_SOLID)
+			ts_drawrow(psd, x1, x2, y);
+		else
+#endif
+			drawrow(psd, x1, x2, y);
+	}
+
+	GdSetDash(&dm, &dc);
+}
+
+/**
+ * Draw a connected wide line through an array of points using the current
+ * line width, cap and join styles, applying clipping and dashes.  Caps are
+ * drawn at both ends, or if closed the last point is joined to the first.
+ * Every pixel is drawn once, so XOR is correct.
+ *
+ * @param psd Drawing surface.
+ * @param count Number of points.
+ * @param points The array of points.
+ * @param closed TRUE to join the last point to the first.
+ */
+void
+GdWidePolyLine(PSD psd, int count, MWPOINT *points, MWBOOL closed)
+{
+	WPOINT *p;
+	int i, n, hw;
+	unsigned int bit = 0;
+	int used = 0;
+
+	if (count <= 0)
+		return;
+	if ((p = malloc(count * sizeof(WPOINT))) == NULL)
+		return;
+
+	/* convert to fixed point, dropping repeated points*/
+	for (i = 0, n = 0; i < count; i++) {
+		if (n && points[i].x * ONE == p[n-1].x && points[i].y * ONE == p[n-1].y)
+			continue;
+		p[n].x = points[i].x * ONE;
+		p[n].y = points[i].y * ONE;
+		n++;
+	}
+	if (closed && n > 1 && p[n-1].x == p[0].x && p[n-1].y == p[0].y)
+		n--;
+	if (n < 3)
+		closed = FALSE;
+
+	nspans = 0;
+	spanfail = FALSE;
+	spanminx = spanminy = MAX_MWCOORD;
+	spanmaxx = spanmaxy = MIN_MWCOORD;
+	hw = gr_linewidth * ONE / 2;
+
+	if (n == 1)
+		adddot(&p[0], hw);
+	else if (gr_dashcount) {
+		for (i = 0; i < n - 1; i++)
+			adddashes(&p[i], &p[i+1], hw, &bit, &used);
+		if (closed)
+			adddashes(&p[n-1], &p[0], hw, &bit, &used);
+	} else {
+		for (i = 0; i < n - 1; i++)
+			addsegment(&p[i], &p[i+1], hw, FALSE);
+		for (i = 1; i < n - 1; i++)
+			addjoin(&p[i-1], &p[i], &p[i+1], hw);
+		if (closed) {
+			addsegment(&p[n-1], &p[0], hw, FALSE);
+			addjoin(&p[n-2], &p[n-1], &p[0], hw);
+			addjoin(&p[n-1], &p[0], &p[1], hw);
+		} else if (gr_capstyle != MWCAP_BUTT) {
+			/* caps are the first and last segments extended or rounded*/
+			WPOINT q[2];
+			int64_t dx, dy;
+			int len;
+
+			if (gr_capstyle == MWCAP_ROUND) {
+				addcircle(&p[0], hw);
+				addcircle(&p[n-1], hw);
+			} else {
+				dx = p[1].x - p[0].x;
+				dy = p[1].y - p[0].y;
+				len = GdIntSqrt(dx * dx + dy * dy);
+				q[0].x = p[0].x - (int)(dx * hw / len);
+				q[0].y = p[0].y - (int)(dy * hw / len);
+				addsegment(&q[0], &p[0], hw, FALSE);
+
+				dx = p[n-1].x - p[n-2].x;
+				dy = p[n-1].y - p[n-2].y;
+				len = GdIntSqrt(dx * dx + dy * dy);
+				q[1].x = p[n-1].x + (int)(dx * hw / len);
+				q[1].y = p[n-1].y + (int)(dy * hw / len);
+				addsegment(&p[n-1], &q[1], hw, FALSE);
+			}
+		}
+	}
+	free(p);
+
+	if (!spanfail)
+		drawspans(psd);
+	GdFixCursor(psd);
+}
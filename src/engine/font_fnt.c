@@ -3,14 +3,20 @@
  * Copyright (c) 2003, 2005, 2010 Greg Haerr <greg@censoft.com>
  *
  * Load a .fnt/.fnt.gz (Microwindows native) binary font, store in incore format.
+ * Load a .mwf precompiled font, used in place from a read-only mapping.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "uni_std.h"
 #include "device.h"
 #include "devfont.h"
 #include "genfont.h"
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 /*
  * .fnt loadable font file format definition
@@ -39,6 +45,65 @@
 /* loadable font magic and version #*/
 #define VERSION		"RB11"
 
+/*
+ * .mwf precompiled font file format definition
+ *
+ * The font data is stored in the incore MWCFONT layout in native byte order,
+ * so the file can be mapped read-only and shared by all processes using it.
+ * Each section is 32-bit aligned, and all fields are native byte order.
+ *
+ * format                     len	description
+ * -------------------------  ----	------------------------------
+ * UCHAR magic[4]				4	magic number and version bytes
+ * ULONG byteorder				4	MWF_BYTEORDER in writer's byte order
+ * ULONG filesize				4	total file size in bytes
+ * UCHAR name[64]				64	font name, NUL terminated
+ * LONG maxwidth				4	font max width in pixels
+ * LONG height					4	font height in pixels
+ * LONG ascent					4	font ascent (baseline) in pixels
+ * LONG firstchar				4	first character code in font
+ * LONG defaultchar				4	default character code in font
+ * LONG size					4	# characters in font
+ * ULONG nbits					4	# words imagebits data in file
+ * ULONG noffset				4	# longs offset data in file, 0 or size
+ * ULONG nwidth					4	# bytes width data in file, 0 or size
+ * ULONG bitspos				4	file offset of imagebits data
+ * ULONG offsetpos				4	file offset of offset data, 0 if none
+ * ULONG widthpos				4	file offset of width data, 0 if none
+ *
+ * Converted from .bdf or .fnt files using fonts/tools/convbdf -m.
+ */
+#define MWF_VERSION		"MWF1"
+#define MWF_BYTEORDER	0x01020304
+
+typedef struct {
+	char		magic[4];
+	uint32_t	byteorder;
+	uint32_t	filesize;
+	char		name[64];
+	int32_t		maxwidth;
+	int32_t		height;
+	int32_t		ascent;
+	int32_t		firstchar;
+	int32_t		defaultchar;
+	int32_t		size;
+	uint32_t	nbits;
+	uint32_t	noffset;
+	uint32_t	nwidth;
+	uint32_t	bitspos;
+	uint32_t	offsetpos;
+	uint32_t	widthpos;
+} MWFHEADER;
+
+/* incore font with .mwf file mapping*/
+typedef struct {
+	MWCFONT		cfont;		/* must be first*/
+	void *		map;		/* mapped or read file data*/
+	size_t		maplen;		/* file size*/
+} MWFCFONT, *PMWFCFONT;
+
+static char mwfname[] = "MWF";	/* MWCOREFONT name for .mwf fonts*/
+
 /* The user hase the option including ZLIB and being able to    */
 /* directly read compressed .fnt files, or to omit it and save  */
 /* space.  The following defines make life much easier          */
@@ -61,6 +126,8 @@
 PMWFONT fnt_createfont(const char *filename, MWCOORD height, MWCOORD width, int attr);
 static void fnt_unloadfont(PMWFONT font);
 static PMWCFONT fnt_load_font(const char *path);
+static PMWCFONT mwf_load_font(const char *path);
+static void mwf_unload_font(PMWCFONT pfc);
 
 /* these procs used when font ASCII indexed*/
 MWFONTPROCS fnt_fontprocs = {
@@ -102,15 +169,28 @@ fnt_createfont(const char *name, MWCOORD height, MWCOORD width, int attr)
 {
 	PMWCOREFONT	pf;
 	PMWCFONT	cfont;
-	int		uc16;
-
-	/* try to open file and read in font data*/
-	cfont = fnt_load_font(name);
+	int		uc16, mapped;
+	char *		ext;
+	char		mwfpath[256];
+
+	/* try to map precompiled <name>.mwf, else open file and read in font data*/
+	cfont = NULL;
+	if ((ext = strstr(name, ".fnt")) != NULL && ext - name < (int)sizeof(mwfpath) - 5) {
+		sprintf(mwfpath, "%.*s.mwf", (int)(ext - name), name);
+		cfont = mwf_load_font(mwfpath);
+	}
+	if (!cfont)
+		cfont = mwf_load_font(name);
+	mapped = (cfont != NULL);
+	if (!cfont)
+		cfont = fnt_load_font(name);
 	if (!cfont)
 		return NULL;
 
 	if (!(pf = (MWCOREFONT *) malloc(sizeof(MWCOREFONT)))) {
-		free(cfont);
+		if (mapped)
+			mwf_unload_font(cfont);
+		else free(cfont);
 		return NULL;
 	}
 
@@ -119,7 +199,7 @@ fnt_createfont(const char *name, MWCOORD height, MWCOORD width, int attr)
 	pf->fontprocs = uc16? &fnt_fontprocs16: &fnt_fontprocs;
 
 	pf->fontsize = pf->fontrotation = pf->fontattr = 0;
-	pf->name = "FNT";
+	pf->name = mapped? mwfname: "FNT";
 	pf->cfont = cfont;
 	return (PMWFONT)pf;
 }
@@ -130,7 +210,9 @@ fnt_unloadfont(PMWFONT font)
 	PMWCOREFONT pf = (PMWCOREFONT)font;
 	PMWCFONT    pfc = pf->cfont;
 
-	if (pfc) {
+	if (pfc && pf->name == mwfname)
+		mwf_unload_font(pfc);
+	else if (pfc) {
 		if (pfc->width)
 			free((char *)pf->cfont->width);
 		if (pfc->offset)
@@ -368,3 +450,128 @@ errout:
 	free(pf);
 	return NULL;
 }
+
+/* load .mwf precompiled font, using font data in place from read-only file mapping*/
+static PMWCFONT
+mwf_load_font(const char *filename)
+{
+	PMWFCFONT pf;
+	MWFHEADER *hdr;
+	int fd;
+	int32_t i;
+	size_t len;
+	struct stat st;
+	char *map;
+	char *path;
+
+	path = mwfont_findpath(filename, FNT_FONT_DIR, ".mwf");
+	if (!path)
+		return NULL;
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(MWFHEADER)) {
+		close(fd);
+		return NULL;
+	}
+	len = st.st_size;
+
+#if HAVE_MMAP
+	map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == (char *)MAP_FAILED)
+		return NULL;
+#else
+	map = malloc(len);
+	if (!map || read(fd, map, len) != (int)len) {
+		free(map);
+		close(fd);
+		return NULL;
+	}
+	close(fd);
+#endif
+
+	/* validate header and that all font data is within file*/
+	hdr = (MWFHEADER *)map;
+	if (strncmp(hdr->magic, MWF_VERSION, 4) != 0 || hdr->byteorder != MWF_BYTEORDER) {
+		EPRINTF("mwf_load_font: %s not in native .mwf format\n", path);
+		goto errout;
+	}
+	if (hdr->filesize != len || hdr->size <= 0 || hdr->height <= 0 || hdr->maxwidth <= 0 ||
+	    hdr->defaultchar < hdr->firstchar ||
+	    (int64_t)hdr->defaultchar - hdr->firstchar >= hdr->size ||
+	    (hdr->noffset && hdr->noffset != (uint32_t)hdr->size) ||
+	    (hdr->nwidth && hdr->nwidth != (uint32_t)hdr->size) ||
+	    (hdr->bitspos & 3) || hdr->bitspos > len ||
+	    hdr->nbits > (len - hdr->bitspos) / sizeof(MWIMAGEBITS) ||
+	    (hdr->noffset && ((hdr->offsetpos & 3) || hdr->offsetpos > len ||
+	      hdr->noffset > (len - hdr->offsetpos) / sizeof(uint32_t))) ||
+	    (hdr->nwidth && (hdr->widthpos > len || hdr->nwidth > len - hdr->widthpos)))
+		goto badfont;
+	if (memchr(hdr->name, 0, sizeof(hdr->name)) == NULL)
+		goto badfont;
+
+	/* check glyph bits within bitmap data*/
+	if (hdr->noffset) {
+		const uint32_t *offset = (const uint32_t *)(map + hdr->offsetpos);
+		const unsigned char *width = (const unsigned char *)(map + hdr->widthpos);
+
+		for (i = 0; i < hdr->size; i++) {
+			int w = hdr->nwidth? width[i]: hdr->maxwidth;
+
+			if (offset[i] > hdr->nbits ||
+			    (uint64_t)hdr->height * MWIMAGE_WORDS((uint64_t)w) > hdr->nbits - offset[i])
+				goto badfont;
+		}
+	} else {
+		/* without offsets glyphs are one word per row, so no glyph may be wider*/
+		const unsigned char *width = (const unsigned char *)(map + hdr->widthpos);
+
+		if (hdr->maxwidth > (int32_t)MWIMAGE_BITSPERIMAGE ||
+		    (uint64_t)hdr->size * hdr->height > hdr->nbits)
+			goto badfont;
+		for (i = 0; i < (int32_t)hdr->nwidth; i++)
+			if (width[i] > MWIMAGE_BITSPERIMAGE)
+				goto badfont;
+	}
+
+	pf = (PMWFCFONT)calloc(1, sizeof(MWFCFONT));
+	if (!pf)
+		goto errout;
+	pf->cfont.name = hdr->name;
+	pf->cfont.maxwidth = hdr->maxwidth;
+	pf->cfont.height = hdr->height;
+	pf->cfont.ascent = hdr->ascent;
+	pf->cfont.firstchar = hdr->firstchar;
+	pf->cfont.size = hdr->size;
+	pf->cfont.defaultchar = hdr->defaultchar;
+	pf->cfont.bits = (const MWIMAGEBITS *)(map + hdr->bitspos);
+	pf->cfont.bits_size = hdr->nbits;
+	pf->cfont.offset = hdr->noffset? (const uint32_t *)(map + hdr->offsetpos): NULL;
+	pf->cfont.width = hdr->nwidth? (const unsigned char *)(map + hdr->widthpos): NULL;
+	pf->map = map;
+	pf->maplen = len;
+	return &pf->cfont;
+
+badfont:
+	EPRINTF("mwf_load_font: %s bad font data\n", path);
+errout:
+#if HAVE_MMAP
+	munmap(map, len);
+#else
+	free(map);
+#endif
+	return NULL;
+}
+
+static void
+mwf_unload_font(PMWCFONT pfc)
+{
+	PMWFCFONT pf = (PMWFCFONT)pfc;		/* MWCFONT is first member*/
+
+#if HAVE_MMAP
+	munmap(pf->map, pf->maplen);
+#else
+	free(pf->map);
+#endif
+	free(pf);
+}
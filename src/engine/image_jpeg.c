@@ -45,11 +45,17 @@
 
 #include "jpeglib.h"
 
-static buffer_t *inptr;
+/* source manager reading from image buffer, no static state for async decode threads*/
+typedef struct {
+	struct jpeg_source_mgr pub;
+	buffer_t *inptr;
+} buffer_source_mgr;
 
 static void
 init_source(j_decompress_ptr cinfo)
 {
+	buffer_t *inptr = ((buffer_source_mgr *)cinfo->src)->inptr;
+
 	cinfo->src->next_input_byte = inptr->start;
 	cinfo->src->bytes_in_buffer = inptr->size;
 }
@@ -63,7 +69,7 @@ fill_input_buffer(j_decompress_ptr cinfo)
 static void
 skip_input_data(j_decompress_ptr cinfo, long num_bytes)
 {
-	if (num_bytes >= inptr->size)
+	if (num_bytes >= ((buffer_source_mgr *)cinfo->src)->inptr->size)
 		return;
 	cinfo->src->next_input_byte += num_bytes;
 	cinfo->src->bytes_in_buffer -= num_bytes;
@@ -81,14 +87,19 @@ term_source(j_decompress_ptr cinfo)
 	return;
 }
 
+/*
+ * Decode JPEG image.
+ * If width/height > 0, use DCT scaling to decode the image at 1/2, 1/4 or 1/8
+ * size, choosing the smallest scale whose output is still at least width x height.
+ */
 PSD
-GdDecodeJPEG(buffer_t * src, MWBOOL fast_grayscale)
+GdDecodeJPEG(buffer_t * src, MWBOOL fast_grayscale, MWCOORD width, MWCOORD height)
 {
 	int i;
 	unsigned char magic[8];
 	PSD pmd = NULL;
 	int bpp, data_format, palsize;
-	struct jpeg_source_mgr smgr;
+	buffer_source_mgr smgr;
 	struct jpeg_decompress_struct cinfo;
 	struct jpeg_error_mgr jerr;
 #if USE_STD_PALETTE
@@ -116,13 +127,13 @@ GdDecodeJPEG(buffer_t * src, MWBOOL fast_grayscale)
 	jpeg_create_decompress(&cinfo);
 
 	/* Step 2:  Setup the source manager */
-	smgr.init_source = (void *) init_source;
-	smgr.fill_input_buffer = (void *) fill_input_buffer;
-	smgr.skip_input_data = (void *) skip_input_data;
-	smgr.resync_to_restart = (void *) resync_to_restart;
-	smgr.term_source = (void *) term_source;
-	cinfo.src = &smgr;
-	inptr = src;
+	smgr.pub.init_source = (void *) init_source;
+	smgr.pub.fill_input_buffer = (void *) fill_input_buffer;
+	smgr.pub.skip_input_data = (void *) skip_input_data;
+	smgr.pub.resync_to_restart = (void *) resync_to_restart;
+	smgr.pub.term_source = (void *) term_source;
+	smgr.inptr = src;
+	cinfo.src = &smgr.pub;
 
 	/* Step 2: specify data source (eg, a file) */
 	/* jpeg_stdio_src (&cinfo, fp); */
@@ -134,6 +145,16 @@ GdDecodeJPEG(buffer_t * src, MWBOOL fast_grayscale)
 	cinfo.out_color_space = fast_grayscale? JCS_GRAYSCALE: JCS_RGB;
 	cinfo.quantize_colors = FALSE;
 
+	/* decode at reduced size if requested, output is rounded up by libjpeg*/
+	if (width > 0 && height > 0) {
+		cinfo.scale_num = 1;
+		cinfo.scale_denom = 1;
+		while (cinfo.scale_denom < 8 &&
+		       (int)cinfo.image_width / (int)(cinfo.scale_denom * 2) >= width &&
+		       (int)cinfo.image_height / (int)(cinfo.scale_denom * 2) >= height)
+			cinfo.scale_denom *= 2;
+	}
+
 	if (!fast_grayscale) {
 		/* if running in palette mode, force pal8 output*/
 		if (scrdev.pixtype == MWPF_PALETTE) {
@@ -5,6 +5,8 @@
  * Image decode routine for PNG files
  *
  * Decode PNG images into 8 or 24 bpp with alpha if present.
+ * Non-interlaced images can be downscaled while decoding, one row at a time,
+ * so that the full size image is never allocated.
  *
  * 2007-Nov-15 - Vladimir Ananiev (vovan888 at gmail com)
  *		alpha channel, gamma correction added - ripped from pngm2pnm.c
@@ -36,14 +38,69 @@ png_read_buffer(png_structp pstruct, png_bytep pointer, png_size_t size)
 #endif
 }
 
+/* read rows one at a time, keeping only those needed for dwidth x dheight image*/
+static PSD
+png_decode_scaled(png_structp state, png_infop pnginfo, int width, int height,
+	int dwidth, int dheight, int channels)
+{
+	unsigned char *row;
+	int pos, inc, dst_row;
+	PSD pmd;
+
+	pmd = GdCreatePixmap(&scrdev, dwidth, dheight,
+		(channels == 4)? MWIF_RGBA8888: MWIF_RGB888, NULL, 0);
+	if (!pmd) {
+		png_destroy_read_struct(&state, &pnginfo, NULL);
+		EPRINTF("GdDecodePNG: Out of memory\n");
+		return NULL;
+	}
+	if (!(row = malloc(width * channels))) {
+		pmd->FreeMemGC(pmd);
+		png_destroy_read_struct(&state, &pnginfo, NULL);
+		EPRINTF("GdDecodePNG: Out of memory\n");
+		return NULL;
+	}
+
+	/* libpng longjmps here on decode error*/
+	if (setjmp(png_jmpbuf(state))) {
+		free(row);
+		pmd->FreeMemGC(pmd);
+		png_destroy_read_struct(&state, &pnginfo, NULL);
+		return NULL;
+	}
+
+	/* select source rows exactly as GdStretchImage would*/
+	pos = 0x10000;
+	inc = (height << 16) / dheight;
+	for (dst_row = 0; dst_row < dheight; ++dst_row) {
+		while (pos >= 0x10000L) {
+			png_read_row(state, row, NULL);
+			pos -= 0x10000L;
+		}
+		GdStretchImageRow(row, width, pmd->addr + dst_row * pmd->pitch, dwidth, channels);
+		pos += inc;
+	}
+
+	/* remaining rows aren't needed, don't decode them*/
+	free(row);
+	png_destroy_read_struct(&state, &pnginfo, NULL);
+	return pmd;
+}
+
+/*
+ * Decode PNG image.
+ * If dwidth/dheight > 0 and smaller than the image, the image is downscaled
+ * while decoding, keeping its aspect ratio, to the smallest size that is at
+ * least dwidth x dheight, using the same sampling as GdStretchImage.
+ */
 PSD
-GdDecodePNG(buffer_t * src)
+GdDecodePNG(buffer_t * src, MWCOORD dwidth, MWCOORD dheight)
 {
 	unsigned char hdr[8], **rows;
 	png_structp state;
 	png_infop pnginfo;
 	png_uint_32 width, height;
-	int bit_depth, color_type, i;
+	int bit_depth, color_type, interlace_type, i;
 	double file_gamma;
 	int channels, data_format;
 	PSD pmd;
@@ -76,7 +133,7 @@ GdDecodePNG(buffer_t * src)
 	png_set_sig_bytes(state, 8);
 
 	png_read_info(state, pnginfo);
-	png_get_IHDR(state, pnginfo, &width, &height, &bit_depth, &color_type, NULL, NULL, NULL);
+	png_get_IHDR(state, pnginfo, &width, &height, &bit_depth, &color_type, &interlace_type, NULL, NULL);
 
 	/* set-up the transformations */
 	/* transform paletted images into full-color rgb */
@@ -133,6 +190,17 @@ GdDecodePNG(buffer_t * src)
 	/* set image data format*/
 	data_format = (channels == 4)? MWIF_RGBA8888: MWIF_RGB888;
 
+	/* downscale non-interlaced images while decoding if smaller size requested,
+	 * by a single factor so that the result is at least dwidth x dheight*/
+	if (dwidth > 0 && dheight > 0 && dwidth < width && dheight < height &&
+	    interlace_type == PNG_INTERLACE_NONE) {
+		if ((uint64_t)dwidth * height >= (uint64_t)dheight * width)
+			dheight = ((uint64_t)height * dwidth + width - 1) / width;
+		else
+			dwidth = ((uint64_t)width * dheight + height - 1) / height;
+		return png_decode_scaled(state, pnginfo, width, height, dwidth, dheight, channels);
+	}
+
 	//pimage->pitch = width * channels * (bit_depth / 8);
 	//bpp = channels * 8;
 	pmd = GdCreatePixmap(&scrdev, width, height, data_format, NULL, 0);
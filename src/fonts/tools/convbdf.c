@@ -1,5 +1,6 @@
 /*
  * Convert BDF files to C source and/or Rockbox .fnt file format
+ * Convert BDF or .fnt files to .mwf precompiled mmap-able font format
  *
  * Copyright (c) 2002, 2005 by Greg Haerr <greg@censoft.com>
  *
@@ -18,6 +19,11 @@
 /* loadable font magic and version #*/
 #define VERSION		"RB11"
 
+/* precompiled native byte order font magic, see engine/font_fnt.c*/
+#define MWF_VERSION		"MWF1"
+#define MWF_BYTEORDER	0x01020304
+#define MWF_HDRSIZE		(4+4+4+64+12*4)
+
 /* MWIMAGEBITS helper macros*/
 #define MWIMAGE_WORDS(x)	(((x)+15)/16)	/* image size in words*/
 #define MWIMAGE_BYTES(x)	(MWIMAGE_WORDS(x)*sizeof(MWIMAGEBITS))
@@ -60,6 +66,7 @@ typedef struct {
 
 int gen_c = 0;
 int gen_fnt = 0;
+int gen_mwf = 0;
 int gen_map = 1;
 int start_char = 0;
 int limit_char = 65535;
@@ -72,6 +79,7 @@ int         convbdf(char *path);
 
 void        free_font(PMWCFONT pf);
 PMWCFONT    bdf_read_font(char *path);
+PMWCFONT    fnt_read_font(char *path);
 int         bdf_read_header(FILE *fp, PMWCFONT pf);
 int         bdf_read_bitmaps(FILE *fp, PMWCFONT pf);
 char *      bdf_getline(FILE *fp, char *buf, int len);
@@ -79,6 +87,7 @@ MWIMAGEBITS bdf_hexval(unsigned char *buf, int ndx1, int ndx2);
 
 int         gen_c_source(PMWCFONT pf, char *path);
 int         gen_fnt_file(PMWCFONT pf, char *path);
+int         gen_mwf_file(PMWCFONT pf, char *path);
 
 void
 usage(void)
@@ -89,6 +98,7 @@ usage(void)
 	"Options:\n"
 	"    -c     Convert .bdf to .c source file\n"
 	"    -f     Convert .bdf to .fnt font file\n"
+	"    -m     Convert .bdf or .fnt to .mwf precompiled font file\n"
 	"    -s N   Start output at character encodings >= N\n"
 	"    -l N   Limit output to character encodings <= N\n"
 	"    -n     Don't generate bitmaps as comments in .c file\n"
@@ -123,6 +133,9 @@ getopts(int *pac, char ***pav)
 		case 'f':			/* generate .fnt output*/
 			gen_fnt = 1;
 			break;
+		case 'm':			/* generate .mwf output*/
+			gen_mwf = 1;
+			break;
 		case 'n':			/* don't gen bitmap comments*/
 			gen_map = 0;
 			break;
@@ -198,7 +211,9 @@ convbdf(char *path)
 	PMWCFONT pf;
 	int ret = 0;
 
-	pf = bdf_read_font(path);
+	if (strstr(path, ".fnt"))
+		pf = fnt_read_font(path);
+	else pf = bdf_read_font(path);
 	if (!pf)
 		exit(1);
 
@@ -218,6 +233,14 @@ convbdf(char *path)
 		ret |= gen_fnt_file(pf, outfile);
 	}
 
+	if (gen_mwf) {
+		if (!oflag) {
+			strcpy(outfile, base_name(path));
+			strcat(outfile, ".mwf");
+		}
+		ret |= gen_mwf_file(pf, outfile);
+	}
+
 	free_font(pf);
 	return ret;
 }
@@ -230,12 +253,12 @@ main(int ac, char **av)
 	++av; --ac;		/* skip av[0]*/
 	getopts(&ac, &av);	/* read command line options*/
 
-	if (ac < 1 || (!gen_c && !gen_fnt)) {
+	if (ac < 1 || (!gen_c && !gen_fnt && !gen_mwf)) {
 		usage();
 		exit(1);
 	}
 	if (oflag) {
-		if (ac > 1 || (gen_c && gen_fnt)) {
+		if (ac > 1 || (gen_c + gen_fnt + gen_mwf) > 1) {
 			usage();
 			exit(1);
 		}
@@ -306,6 +329,120 @@ errout:
 	return NULL;
 }
 
+static int
+READSHORT(FILE *fp, unsigned short *sp)
+{
+	int c1, c2;
+
+	if ((c1 = getc(fp)) == EOF || (c2 = getc(fp)) == EOF)
+		return 0;
+	*sp = (c2 << 8) | c1;
+	return 1;
+}
+
+static int
+READLONG(FILE *fp, uint32_t *lp)
+{
+	unsigned short s1, s2;
+
+	if (!READSHORT(fp, &s1) || !READSHORT(fp, &s2))
+		return 0;
+	*lp = ((uint32_t)s2 << 16) | s1;
+	return 1;
+}
+
+/* read totlen bytes, return malloc'd string with blank pad removed*/
+static char *
+READSTRPAD(FILE *fp, int totlen)
+{
+	char *buf, *p;
+
+	buf = malloc(totlen+1);
+	if (!buf || fread(buf, 1, totlen, fp) != totlen) {
+		free(buf);
+		return NULL;
+	}
+	p = &buf[totlen];
+	*p-- = 0;
+	while (p >= buf && *p == ' ')
+		*p-- = '\0';
+	return buf;
+}
+
+/* build incore structure from uncompressed .fnt file*/
+PMWCFONT
+fnt_read_font(char *path)
+{
+	FILE *fp;
+	PMWCFONT pf;
+	int i;
+	unsigned short maxwidth, height, ascent, pad;
+	uint32_t firstchar, defaultchar, size;
+	uint32_t nbits, noffset, nwidth;
+	char version[4];
+
+	fp = fopen(path, "rb");
+	if (!fp) {
+		fprintf(stderr, "Error opening file: %s\n", path);
+		return NULL;
+	}
+
+	pf = (PMWCFONT)calloc(1, sizeof(MWCFONT));
+	if (!pf)
+		goto errout;
+
+	if (fread(version, 1, 4, fp) != 4 || strncmp(version, VERSION, 4) != 0) {
+		fprintf(stderr, "Error: %s not a .fnt file (.fnt.gz must be uncompressed)\n", path);
+		goto errout;
+	}
+	if (!(pf->name = READSTRPAD(fp, 64)) || !(pf->copyright = READSTRPAD(fp, 256)))
+		goto readerr;
+	if (!READSHORT(fp, &maxwidth) || !READSHORT(fp, &height) ||
+	    !READSHORT(fp, &ascent) || !READSHORT(fp, &pad) ||
+	    !READLONG(fp, &firstchar) || !READLONG(fp, &defaultchar) || !READLONG(fp, &size) ||
+	    !READLONG(fp, &nbits) || !READLONG(fp, &noffset) || !READLONG(fp, &nwidth))
+		goto readerr;
+	pf->maxwidth = maxwidth;
+	pf->height = height;
+	pf->ascent = ascent;
+	pf->firstchar = firstchar;
+	pf->defaultchar = defaultchar;
+	pf->size = size;
+	pf->bits_size = nbits;
+
+	pf->bits = (MWIMAGEBITS *)malloc(nbits * sizeof(MWIMAGEBITS) + 1);
+	if (noffset)
+		pf->offset = (uint32_t *)malloc(noffset * sizeof(uint32_t));
+	if (nwidth)
+		pf->width = (unsigned char *)malloc(nwidth);
+	if (!pf->bits || (noffset && !pf->offset) || (nwidth && !pf->width)) {
+		fprintf(stderr, "Error: out of memory\n");
+		goto errout;
+	}
+
+	for (i=0; i<nbits; ++i)
+		if (!READSHORT(fp, &pf->bits[i]))
+			goto readerr;
+	if (nbits & 01)
+		if (!READSHORT(fp, &pad))	/* pad to longword boundary*/
+			goto readerr;
+	for (i=0; i<noffset; ++i)
+		if (!READLONG(fp, &pf->offset[i]))
+			goto readerr;
+	if (nwidth && fread(pf->width, 1, nwidth, fp) != nwidth)
+		goto readerr;
+
+	fclose(fp);
+	return pf;
+
+readerr:
+	fprintf(stderr, "Error reading %s\n", path);
+errout:
+	fclose(fp);
+	free_font(pf);
+	return NULL;
+}
+
 /* read bdf font header information, return 0 on error*/
 int
 bdf_read_header(FILE *fp, PMWCFONT pf)
@@ -950,3 +1087,96 @@ gen_fnt_file(PMWCFONT pf, char *path)
 	fclose(ofp);
 	return 0;
 }
+
+static int
+WRITENATIVELONG(FILE *fp, uint32_t l)
+{
+	return fwrite(&l, sizeof(l), 1, fp) == 1;
+}
+
+/*
+ * Generate .mwf precompiled font file from in-core font.
+ * Font data is written in the incore layout and host byte order,
+ * for use in place from a read-only mapping by engine/font_fnt.c.
+ */
+int
+gen_mwf_file(PMWCFONT pf, char *path)
+{
+	FILE *ofp;
+	int i;
+	uint32_t *offset = pf->offset;
+	uint32_t noffset = pf->offset? pf->size: 0;
+	uint32_t nwidth = pf->width? pf->size: 0;
+	uint32_t bitspos, offsetpos, widthpos, filesize;
+	char name[64];
+
+	/* engine assumes one word per row when no offsets, so add them if needed*/
+	if (!offset && (pf->width || pf->maxwidth > 16)) {
+		uint32_t ofs = 0;
+
+		offset = (uint32_t *)malloc(pf->size * sizeof(uint32_t));
+		if (!offset) {
+			fprintf(stderr, "Error: out of memory\n");
+			return 1;
+		}
+		for (i=0; i<pf->size; ++i) {
+			offset[i] = ofs;
+			ofs += MWIMAGE_WORDS(pf->width? pf->width[i]: pf->maxwidth) * pf->height;
+		}
+		noffset = pf->size;
+	}
+
+	bitspos = MWF_HDRSIZE;
+	offsetpos = noffset? ((bitspos + pf->bits_size * sizeof(MWIMAGEBITS) + 3) & ~3): 0;
+	widthpos = nwidth? (noffset? offsetpos + noffset * sizeof(uint32_t):
+		bitspos + pf->bits_size * sizeof(MWIMAGEBITS)): 0;
+	filesize = nwidth? widthpos + nwidth:
+		(noffset? offsetpos + noffset * sizeof(uint32_t): bitspos + pf->bits_size * sizeof(MWIMAGEBITS));
+
+	ofp = fopen(path, "wb");
+	if (!ofp) {
+		fprintf(stderr, "Can't create %s\n", path);
+		if (offset != pf->offset)
+			free(offset);
+		return 1;
+	}
+	fprintf(stderr, "Generating %s\n", path);
+
+	/* header*/
+	WRITESTR(ofp, MWF_VERSION, 4);
+	WRITENATIVELONG(ofp, MWF_BYTEORDER);
+	WRITENATIVELONG(ofp, filesize);
+	memset(name, 0, sizeof(name));
+	strncpy(name, pf->name? pf->name: "", sizeof(name)-1);
+	WRITESTR(ofp, name, sizeof(name));
+	WRITENATIVELONG(ofp, pf->maxwidth);
+	WRITENATIVELONG(ofp, pf->height);
+	WRITENATIVELONG(ofp, pf->ascent);
+	WRITENATIVELONG(ofp, pf->firstchar);
+	WRITENATIVELONG(ofp, pf->defaultchar);
+	WRITENATIVELONG(ofp, pf->size);
+	WRITENATIVELONG(ofp, pf->bits_size);
+	WRITENATIVELONG(ofp, noffset);
+	WRITENATIVELONG(ofp, nwidth);
+	WRITENATIVELONG(ofp, bitspos);
+	WRITENATIVELONG(ofp, offsetpos);
+	WRITENATIVELONG(ofp, widthpos);
+
+	/* variable font data*/
+	fwrite(pf->bits, sizeof(MWIMAGEBITS), pf->bits_size, ofp);
+	if (noffset) {
+		while (ftell(ofp) < offsetpos)
+			putc(0, ofp);			/* pad to 32-bit boundary*/
+		fwrite(offset, sizeof(uint32_t), noffset, ofp);
+	}
+	if (nwidth)
+		fwrite(pf->width, 1, nwidth, ofp);
+
+	if (offset != pf->offset)
+		free(offset);
+	if (fclose(ofp) != 0) {
+		fprintf(stderr, "Error writing %s\n", path);
+		return 1;
+	}
+	return 0;
+}
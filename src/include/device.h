@@ -28,6 +28,23 @@ extern "C" {
 #define MW_PATH_FBE_COLORMAP		"/tmp/fbe-cmap"				/* framebuffer colormap for mmap()*/
 #define MW_PATH_FBE_MOUSE			"/tmp/fbe-mouse"			/* mouse fifo*/
 #define MW_PATH_FBE_KEYBOARD		"/tmp/fbe-keyboard"			/* keyboard fifo*/
+#define MW_PATH_FBE_DAMAGE			"/tmp/fbe-damage"			/* damaged tiles memory file for mmap()*/
+#define MW_PATH_FBE_WAKEUP			"/tmp/fbe-wakeup"			/* damage wakeup fifo*/
+
+/*
+ * FBE damage tiles, shared between scr_fbe.c and bin/fbe.
+ * The driver sets tiles[] for each changed FBE_TILESIZE square and writes
+ * a byte to the wakeup fifo when signalled is clear.  fbe clears signalled,
+ * then clears and repaints each changed tile, so it can block until damage.
+ */
+#define FBE_TILESIZE		64							/* damage tile width and height*/
+#define FBE_MAXTILESX		(2048/FBE_TILESIZE)			/* fbe max 2048x2048 screen*/
+#define FBE_MAXTILESY		(2048/FBE_TILESIZE)
+typedef struct {
+	volatile int32_t		active;		/* driver open and reporting damage*/
+	volatile int32_t		signalled;	/* wakeup written and not yet read*/
+	volatile unsigned char	tiles[FBE_MAXTILESY][FBE_MAXTILESX];	/* nonzero if changed*/
+} FBEDAMAGE;
 
 /* path for GR_WM_PROPS_BUFFER_MMAP mmap'd window*/
 #define MW_PATH_BUFFER_MMAP			"/tmp/.nano-fb%d"			/* window buffer file for mmap, %d=window id*/
@@ -96,6 +113,8 @@ typedef struct _mwscreendevice {
 	void	(*SetPortrait)(PSD psd,int portraitmode);
 	void	(*Update)(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
 	int		(*PreSelect)(PSD psd);
+	void	(*CopyArea)(PSD psd, MWCOORD dstx, MWCOORD dsty, MWCOORD width, MWCOORD height,
+				MWCOORD srcx, MWCOORD srcy);	/* screen to screen copy done, instead of Update()*/
 	int	portrait;	 /* screen portrait mode*/
 	PSUBDRIVER orgsubdriver; /* original subdriver for portrait modes*/
 	PSUBDRIVER left_subdriver;
@@ -215,6 +234,10 @@ void	GdPoint(PSD psd,MWCOORD x, MWCOORD y);
 void	GdLine(PSD psd,MWCOORD x1,MWCOORD y1,MWCOORD x2,MWCOORD y2, MWBOOL bDrawLastPoint);
 void	GdRect(PSD psd,MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
 void	GdFillRect(PSD psd,MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+void	GdPolyLine(PSD psd,int count, MWPOINT *points, MWBOOL bDrawLastPoint);
+void	GdSegments(PSD psd,int count, MWPOINT *points);
+void	GdRects(PSD psd,int count, MWCLIPRECT *rects);
+void	GdFillRects(PSD psd,int count, MWCLIPRECT *rects);
 MWBOOL	GdColorInPalette(MWCOLORVAL cr,MWPALENTRY *palette,int palsize);
 void	GdMakePaletteConversionTable(PSD psd,MWPALENTRY *palette,int palsize,
 		MWPIXELVALHW *convtable,int fLoadType);
@@ -231,15 +254,68 @@ void	GdTranslateArea(MWCOORD width, MWCOORD height, void *in, int inpixtype,
 void	drawpoint(PSD psd, MWCOORD x, MWCOORD y);
 void	drawrow(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y);
 void	drawcol(PSD psd,MWCOORD x,MWCOORD y1,MWCOORD y2);
+void	GdSetLineAttributes(int width, int capstyle, int joinstyle);
+uint32_t GdIntSqrt(uint64_t n);
+
+/* devwline.c*/
+void	GdWidePolyLine(PSD psd, int count, MWPOINT *points, MWBOOL closed);
 extern SCREENDEVICE scrdev;
-extern MWPIXELVAL gr_foreground;		/* current foreground color */
-extern MWPIXELVAL gr_background;		/* current background color */
-extern MWBOOL 	  gr_usebg;			/* TRUE if background drawn in pixmaps */
-extern MWCOLORVAL gr_foreground_rgb;/* current fg color in 0xAARRGGBB format*/
-extern MWCOLORVAL gr_background_rgb;
+
+/*
+ * Engine draw context, the state set by GdSetMode, GdSetForegroundColor
+ * and the other GdSet routines and used by all drawing.  Contexts are
+ * switched with GdSetDrawContext, a NULL context selects the default one.
+ * Clipping is not part of the context, as it depends on the drawable.
+ */
+typedef struct {
+	MWPIXELVAL	foreground;		/* current foreground color */
+	MWPIXELVAL	background;		/* current background color */
+	MWCOLORVAL	foreground_rgb;	/* current fg color in 0xAARRGGBB format for mono convblits*/
+	MWCOLORVAL	background_rgb;	/* current background color */
+	MWBOOL		usebg;			/* TRUE if background drawn in pixmaps */
+	int			mode;			/* drawing mode */
+	uint32_t	dashmask;		/* An actual bitmask of the dash values */
+	uint32_t	dashcount;		/* The number of bits defined in the dashmask */
+	int			linewidth;		/* line width, 0 or 1 for thin lines*/
+	int			capstyle;		/* MWCAP_* wide line cap style*/
+	int			joinstyle;		/* MWJOIN_* wide line join style*/
+	int			fillmode;		/* MWFILL_* fill mode*/
+	MWSTIPPLE	stipple;		/* malloc'd copy of stipple*/
+	MWTILE		tile;
+	MWPOINT		ts_offset;		/* The x and y offset of the tile / stipple */
+	MWIMAGEBITS *ts_expand;		/* stipple expanded to a wider pattern, see devstipple.c*/
+	int			ts_expandwidth;	/* width in pixels, multiple of stipple width*/
+	int			ts_expandpitch;	/* pitch in MWIMAGEBITS*/
+} MWDRAWCTX, *PMWDRAWCTX;
+
+extern MWTHREADVAR PMWDRAWCTX gr_drawctx;	/* current draw context*/
+
+/* current drawing state*/
+#define gr_foreground		(gr_drawctx->foreground)
+#define gr_background		(gr_drawctx->background)
+#define gr_foreground_rgb	(gr_drawctx->foreground_rgb)
+#define gr_background_rgb	(gr_drawctx->background_rgb)
+#define gr_usebg			(gr_drawctx->usebg)
+#define gr_mode				(gr_drawctx->mode)
+#define gr_dashmask			(gr_drawctx->dashmask)
+#define gr_dashcount		(gr_drawctx->dashcount)
+#define gr_linewidth		(gr_drawctx->linewidth)
+#define gr_capstyle			(gr_drawctx->capstyle)
+#define gr_joinstyle		(gr_drawctx->joinstyle)
+#define gr_fillmode			(gr_drawctx->fillmode)
+#define gr_stipple			(gr_drawctx->stipple)
+#define gr_tile				(gr_drawctx->tile)
+#define gr_ts_offset		(gr_drawctx->ts_offset)
+
+/* devopen.c*/
+void	GdInitDrawContext(PMWDRAWCTX ctx);
+PMWDRAWCTX GdSetDrawContext(PMWDRAWCTX ctx);
+void	GdCopyDrawContext(PMWDRAWCTX dst, PMWDRAWCTX src);
+void	GdFreeDrawContext(PMWDRAWCTX ctx);
 
 /* devblit.c*/
 MWBLITFUNC GdFindConvBlit(PSD psd, MWIMGDATFMT data_format, int op);
+MWBLITFUNC GdFindFrameBlit(PSD psd, MWIMGDATFMT src_data_format, int op);
 void	GdConversionBlit(PSD psd, PMWBLITPARMS parms);
 void	GdConvBlitInternal(PSD psd, PMWBLITPARMS gc, MWBLITFUNC convblit);
 void	GdBlit(PSD dstpsd, MWCOORD dstx, MWCOORD dsty, MWCOORD width, MWCOORD height,
@@ -256,6 +332,8 @@ void	GdArc(PSD psd, MWCOORD x0, MWCOORD y0, MWCOORD rx, MWCOORD ry,
 		MWCOORD ax, MWCOORD ay, MWCOORD bx, MWCOORD by, int type);
 void	GdEllipse(PSD psd,MWCOORD x, MWCOORD y, MWCOORD rx, MWCOORD ry,
 		MWBOOL fill);
+void	GdRoundRect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD w, MWCOORD h,
+		MWCOORD rx, MWCOORD ry, MWBOOL fill);
 
 /* devfont.c*/
 void	GdClearFontList(void);
@@ -287,12 +365,12 @@ char *mwfont_findalias(const char *fontname, int *height, int *width);
 MWBOOL	GdClipPoint(PSD psd,MWCOORD x,MWCOORD y);
 int		GdClipArea(PSD psd,MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2);
 #if DYNAMICREGIONS
-extern MWCLIPREGION *clipregion;
+extern MWTHREADVAR MWCLIPREGION *clipregion;
 #else
-extern MWCLIPRECT cliprects[];
-extern int	clipcount;
+extern MWTHREADVAR MWCLIPRECT cliprects[];
+extern MWTHREADVAR int	clipcount;
 #endif
-extern MWCOORD clipminx, clipminy, clipmaxx, clipmaxy;
+extern MWTHREADVAR MWCOORD clipminx, clipminy, clipmaxx, clipmaxy;
 
 /* devclip1.c only*/
 void 	GdSetClipRects(PSD psd,int count,MWCLIPRECT *table);
@@ -304,6 +382,8 @@ void	GdPrintClipRects(PMWBLITPARMS gc);
 /* devrgn.c - multi-rectangle region entry points*/
 MWBOOL GdPtInRegion(MWCLIPREGION *rgn, MWCOORD x, MWCOORD y);
 int    GdRectInRegion(MWCLIPREGION *rgn, const MWRECT *rect);
+int    GdRegionFindBand(MWCLIPREGION *rgn, MWCOORD y);
+int    GdRegionFindX(MWCLIPREGION *rgn, int band, MWCOORD x);
 MWBOOL GdEqualRegion(MWCLIPREGION *r1, MWCLIPREGION *r2);
 MWBOOL GdEmptyRegion(MWCLIPREGION *rgn);
 MWCLIPREGION *GdAllocRegion(void);
@@ -358,6 +438,9 @@ extern KBDDEVICE kbddev;
 #if MW_FEATURE_IMAGES
 PSD		GdLoadImageFromFile(char *path, int flags);
 PSD		GdLoadImageFromBuffer(void *buffer, int size, int flags);
+PSD		GdLoadImageFromFileScaled(char *path, MWCOORD width, MWCOORD height, int flags);
+PSD		GdLoadImageFromBufferScaled(void *buffer, int size, MWCOORD width, MWCOORD height,
+			int flags);
 void	GdDrawImageFromFile(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width,
 			MWCOORD height, char *path, int flags);
 void	GdDrawImageFromBuffer(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width,
@@ -366,6 +449,28 @@ void	GdDrawImagePartToFit(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD
 			MWCOORD sx, MWCOORD sy, MWCOORD swidth, MWCOORD sheight, PSD pmd);
 MWBOOL	GdGetImageInfo(PSD pmd, PMWIMAGEINFO pii);
 void	GdStretchImage(PMWIMAGEHDR src, MWCLIPRECT *srcrect, PMWIMAGEHDR dst, MWCLIPRECT *dstrect);
+void	GdStretchImageRow(MWUCHAR *src, int src_w, MWUCHAR *dst, int dst_w, int bytesperpixel);
+
+/* devimage_cache.c*/
+MWBOOL	GdDrawCachedImageFromFile(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width,
+			MWCOORD height, char *path, int flags);
+void	GdSetImageCacheSize(unsigned int maxbytes);
+void	GdFlushImageCache(void);
+void	GdGetImageCacheStats(PMWIMAGECACHESTATS pstats);
+
+/* devimage_async.c*/
+int		GdOpenAsyncImage(void);
+void	GdCloseAsyncImage(void);
+MWBOOL	GdLoadImageFromFileAsync(int id, char *path, MWCOORD width, MWCOORD height,
+			int flags);
+MWBOOL	GdGetAsyncImage(int *pid, PSD *ppmd);
+PSD		GdGetAsyncImageScreen(void);
+
+/* rfbserver.c*/
+int		GdOpenRFBServer(PSD psd);
+void	GdCloseRFBServer(void);
+int		GdRFBPrepareSelect(int maxfd, void *rfdset, void *wfdset);
+int		GdRFBServiceSelect(void *rfdset, void *wfdset);
 
 /* Buffered input functions to replace stdio functions*/
 typedef struct {  /* structure for reading images from buffer   */
@@ -389,10 +494,10 @@ PSD		GdConvertImageRGBA(PSD pmd);		/* convert palettized image to RGBA*/
 PSD	GdDecodeBMP(buffer_t *src, MWBOOL readfilehdr);
 #endif
 #if HAVE_JPEG_SUPPORT
-PSD	GdDecodeJPEG(buffer_t *src, MWBOOL fast_grayscale);
+PSD	GdDecodeJPEG(buffer_t *src, MWBOOL fast_grayscale, MWCOORD width, MWCOORD height);
 #endif
 #if HAVE_PNG_SUPPORT
-PSD	GdDecodePNG(buffer_t *src);
+PSD	GdDecodePNG(buffer_t *src, MWCOORD width, MWCOORD height);
 #endif
 #if HAVE_GIF_SUPPORT
 PSD	GdDecodeGIF(buffer_t *src);
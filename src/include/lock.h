@@ -64,6 +64,16 @@ typedef pthread_mutex_t	MWMUTEX;
 #endif
 #endif
 
+/* mutex in allocated memory, where LOCK_DECLARE's initializer can't be used*/
+#define LOCK_INIT_DYNAMIC(m)	\
+	{ \
+	pthread_mutexattr_t attr; \
+	pthread_mutexattr_init(&attr); \
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE); \
+	pthread_mutex_init((m), &attr); \
+	pthread_mutexattr_destroy(&attr); \
+	}
+
 #define LOCK_EXTERN(name)	extern MWMUTEX name
 #define LOCK_FREE(m)		pthread_mutex_destroy(m)
 #define LOCK(m)			pthread_mutex_lock(m)
@@ -77,6 +87,7 @@ typedef int		MWMUTEX;
 #define LOCK_DECLARE(name)	MWMUTEX name
 #define LOCK_EXTERN(name)	extern MWMUTEX name
 #define LOCK_INIT(m)
+#define LOCK_INIT_DYNAMIC(m)
 #define LOCK_FREE(m)
 #define LOCK(m)
 #define UNLOCK(m)
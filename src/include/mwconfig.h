@@ -144,6 +144,18 @@
 #define MW_FEATURE_IMAGES 1		/* =1 to enable GdLoadImage/GdDrawImage etc*/
 #endif
 
+#ifndef IMAGECACHE_SIZE
+#define IMAGECACHE_SIZE	(2*1024*1024L)	/* default decoded image cache bytes, 0 to disable*/
+#endif
+
+#ifndef IMAGE_DECODE_THREADS
+#define IMAGE_DECODE_THREADS	2		/* max worker threads for async image decoding*/
+#endif
+
+#ifndef RFB_PORT
+#define RFB_PORT		5900	/* RFBSERVER=Y loopback TCP port for VNC viewers, RFBPORT=, RFBADDR= override*/
+#endif
+
 /* the following enable/disable Microwindows features, set from config or Arch.rules*/
 #ifndef NONETWORK
 #define NONETWORK		0		/* =1 to link Nano-X apps with server for standalone*/
@@ -313,6 +325,33 @@
 #define THREADSAFE		0		/* =1 for thread safe nano-X server*/
 #endif
 
+/* engine drawing state is per thread when a threaded app is linked with the server*/
+#if THREADSAFE && NONETWORK
+#if defined(_MSC_VER)
+#define MWTHREADVAR		__declspec(thread)
+#else
+#define MWTHREADVAR		__thread
+#endif
+#else
+#define MWTHREADVAR
+#endif
+
+#ifndef MAXCLIENTEVENTS
+#define MAXCLIENTEVENTS	1024	/* nano-X events queued per client before motion is dropped, 0 for no limit*/
+#endif
+
+#ifndef MAXCLIENTREQUESTS
+#define MAXCLIENTREQUESTS 64	/* max nano-X requests handled per client before servicing others*/
+#endif
+
+#ifndef COALESCE_EVENTS
+#define COALESCE_EVENTS	1		/* =1 to merge repeated nano-X motion, update and exposure events*/
+#endif
+
+#ifndef NANOX_PROFILE
+#define NANOX_PROFILE	0		/* =1 to keep nano-X server per-request counts and latencies*/
+#endif
+
 #ifndef NOCLIPPING
 #define NOCLIPPING		0		/* =1 to generate engine with no clipping*/
 #endif
@@ -127,6 +127,16 @@
 #define MWLINE_ONOFF_DASH 1
 /* FUTURE: MWLINE_DOUBLE_DASH */
 
+/* Wide line cap styles*/
+#define MWCAP_BUTT		0	/* square end at endpoint*/
+#define MWCAP_ROUND		1	/* semicircle end*/
+#define MWCAP_SQUARE		2	/* square end half width past endpoint*/
+
+/* Wide line join styles*/
+#define MWJOIN_MITER		0	/* pointed, bevel past miter limit*/
+#define MWJOIN_ROUND		1	/* circular*/
+#define MWJOIN_BEVEL		2	/* corner cut off*/
+
 /* Fill mode  */
 #define MWFILL_SOLID          0  
 #define MWFILL_STIPPLE        1  
@@ -801,6 +811,16 @@ typedef struct {
 	MWPALENTRY 	palette[256];	/* palette*/
 } MWIMAGEINFO, *PMWIMAGEINFO;
 
+/* decoded image cache statistics - returned by GdGetImageCacheStats*/
+typedef struct {
+	uint32_t hits;		/* draws satisfied from cache*/
+	uint32_t misses;	/* draws requiring image decode*/
+	uint32_t evictions;	/* entries freed to stay within budget*/
+	uint32_t entries;	/* images currently cached*/
+	uint32_t bytes;		/* bytes currently cached*/
+	uint32_t maxbytes;	/* cache budget in bytes, 0 if disabled*/
+} MWIMAGECACHESTATS, *PMWIMAGECACHESTATS;
+
 #define	MWMAX_CURSOR_SIZE	32		/* maximum cursor x and y size*/
 #define	MWMAX_CURSOR_BUFLEN	MWIMAGE_SIZE(MWMAX_CURSOR_SIZE,MWMAX_CURSOR_SIZE)
 
@@ -30,6 +30,7 @@ typedef MWKEYMOD	GR_KEYMOD;	/* keystroke modifiers */
 typedef MWSCREENINFO	GR_SCREEN_INFO;	/* screen information */
 typedef MWFONTINFO	GR_FONT_INFO;	/* font information */
 typedef MWIMAGEINFO	GR_IMAGE_INFO;	/* image information */
+typedef MWIMAGECACHESTATS GR_IMAGE_CACHE_STATS; /* image cache statistics */
 typedef MWIMAGEHDR	GR_IMAGE_HDR;	/* multicolor image representation */
 typedef MWLOGFONT	GR_LOGFONT;	/* logical font descriptor */
 typedef MWPALENTRY	GR_PALENTRY;	/* palette entry */
@@ -72,6 +73,14 @@ typedef struct {
 	GR_SIZE  height;	/**< rectangle height*/
 } GR_RECT;
 
+/** Nano-X line segment, used by GrSegments */
+typedef struct {
+	GR_COORD x1;		/**< start x coordinate*/
+	GR_COORD y1;		/**< start y coordinate*/
+	GR_COORD x2;		/**< end x coordinate*/
+	GR_COORD y2;		/**< end y coordinate*/
+} GR_SEGMENT;
+
 /* The root window id. */
 #define	GR_ROOT_WINDOW_ID	((GR_WINDOW_ID) 1)
 
@@ -104,6 +113,14 @@ typedef struct {
 #define GR_LINE_SOLID           MWLINE_SOLID
 #define GR_LINE_ONOFF_DASH      MWLINE_ONOFF_DASH
 
+/* Wide line cap and join styles */
+#define GR_CAP_BUTT             MWCAP_BUTT
+#define GR_CAP_ROUND            MWCAP_ROUND
+#define GR_CAP_SQUARE           MWCAP_SQUARE
+#define GR_JOIN_MITER           MWJOIN_MITER
+#define GR_JOIN_ROUND           MWJOIN_ROUND
+#define GR_JOIN_BEVEL           MWJOIN_BEVEL
+
 #define GR_FILL_SOLID           MWFILL_SOLID
 #define GR_FILL_STIPPLE         MWFILL_STIPPLE
 #define GR_FILL_OPAQUE_STIPPLE  MWFILL_OPAQUE_STIPPLE
@@ -289,6 +306,43 @@ typedef struct {
   GR_BOOL exposure;		/**< send exposure events on GrCopyArea */
 } GR_GC_INFO;
 
+/**
+ * Graphics context values set by GrChangeGC(), selected by GR_GC_MASK_* bits.
+ */
+typedef struct {
+  int mode;			/**< drawing mode */
+  GR_COLOR foreground;		/**< foreground RGB color or pixel value */
+  GR_COLOR background;		/**< background RGB color or pixel value */
+  GR_BOOL fgispixelval;		/**< TRUE if 'foreground' is actually a GR_PIXELVAL */
+  GR_BOOL bgispixelval;		/**< TRUE if 'background' is actually a GR_PIXELVAL */
+  GR_BOOL usebackground;	/**< use background in bitmaps */
+  GR_BOOL exposure;		/**< send exposure events on GrCopyArea */
+  GR_FONT_ID font;		/**< font number */
+  int linestyle;		/**< GR_LINE_* line style */
+  GR_SIZE linewidth;		/**< line width, 0 or 1 for thin lines */
+  int capstyle;			/**< GR_CAP_* wide line cap style */
+  int joinstyle;		/**< GR_JOIN_* wide line join style */
+  int fillmode;			/**< GR_FILL_* fill mode */
+  GR_COORD ts_xoff;		/**< tile/stipple x origin */
+  GR_COORD ts_yoff;		/**< tile/stipple y origin */
+  GR_COORD xoff;		/**< x offset of user region */
+  GR_COORD yoff;		/**< y offset of user region */
+} GR_GC_VALUES;
+
+/* GrChangeGC value mask bits*/
+#define GR_GC_MASK_MODE		0x0001	/* mode*/
+#define GR_GC_MASK_FOREGROUND	0x0002	/* foreground, fgispixelval*/
+#define GR_GC_MASK_BACKGROUND	0x0004	/* background, bgispixelval*/
+#define GR_GC_MASK_USEBACKGROUND 0x0008	/* usebackground*/
+#define GR_GC_MASK_EXPOSURE	0x0010	/* exposure*/
+#define GR_GC_MASK_FONT		0x0020	/* font*/
+#define GR_GC_MASK_LINESTYLE	0x0040	/* linestyle*/
+#define GR_GC_MASK_FILLMODE	0x0080	/* fillmode*/
+#define GR_GC_MASK_TSOFFSET	0x0100	/* ts_xoff, ts_yoff*/
+#define GR_GC_MASK_CLIPORIGIN	0x0200	/* xoff, yoff*/
+#define GR_GC_MASK_LINEWIDTH	0x0400	/* linewidth, capstyle, joinstyle*/
+#define GR_GC_MASK_ALL		0x07FF
+
 /**
  * color palette
  */
@@ -358,6 +412,7 @@ typedef struct {
 #define GR_EVENT_TYPE_SELECTION_CHANGED 20
 #define GR_EVENT_TYPE_TIMER             21
 #define GR_EVENT_TYPE_PORTRAIT_CHANGED  22
+#define GR_EVENT_TYPE_IMAGE_LOADED      23
 
 /* Event masks */
 #define	GR_EVENTMASK(n)			(((GR_EVENT_MASK) 1) << (n))
@@ -388,6 +443,8 @@ typedef struct {
 #define GR_EVENT_MASK_PORTRAIT_CHANGED  GR_EVENTMASK(GR_EVENT_TYPE_PORTRAIT_CHANGED)
 /* Event mask does not affect GR_EVENT_TYPE_HOTKEY_DOWN and
  * GR_EVENT_TYPE_HOTKEY_UP, hence no masks for those events. */
+/* GR_EVENT_TYPE_IMAGE_LOADED is always sent to the client that
+ * called GrLoadImageFromFileAsync, hence no mask. */
 
 #define	GR_EVENT_MASK_ALL		((GR_EVENT_MASK) -1L)
 
@@ -571,6 +628,16 @@ typedef struct {
   GR_TIMER_ID    tid;		/**< ID of expired timer */
 } GR_EVENT_TIMER;
 
+/**
+ * GR_EVENT_TYPE_IMAGE_LOADED
+ */
+typedef struct {
+  GR_EVENT_TYPE  type;		/**< event type, GR_EVENT_TYPE_IMAGE_LOADED */
+  GR_IMAGE_ID    id;		/**< ID returned by GrLoadImageFromFileAsync */
+  GR_SIZE        width;		/**< image width, 0 if load failed */
+  GR_SIZE        height;	/**< image height, 0 if load failed */
+} GR_EVENT_IMAGE_LOADED;
+
 /**
  * Union of all possible event structures.
  * This is the structure returned by GrGetNextEvent() and similar routines.
@@ -590,8 +657,46 @@ typedef union {
   GR_EVENT_CLIENT_DATA clientdata;	/**< Client data events */
   GR_EVENT_SELECTION_CHANGED selectionchanged; /**< Selection owner changed */
   GR_EVENT_TIMER timer;                 /**< Timer events */
+  GR_EVENT_IMAGE_LOADED imageloaded;	/**< Async image loaded events */
 } GR_EVENT;
 
+/**
+ * Server event queue statistics for the calling client, from GrGetEventQueueStats().
+ */
+typedef struct {
+  int count;			/**< events currently queued in server */
+  int highwater;		/**< most events ever queued */
+  int coalesced;		/**< motion, update and exposure events merged into a queued event */
+  int dropped;			/**< motion events discarded because the queue was full */
+  int limit;			/**< queue depth at which motion events are discarded, 0 if unlimited */
+} GR_EVENT_QUEUE_STATS;
+
+#define GR_PROFILE_BUCKETS	16	/* latency histogram buckets, n holds requests under 2^n us*/
+
+/**
+ * Server request profile for one request type, from GrGetRequestProfile().
+ * Requires server built with NANOX_PROFILE=1.
+ */
+typedef struct {
+  char name[32];		/**< request name, empty if never received */
+  uint32_t count;		/**< requests received */
+  uint64_t maxns;		/**< longest request time in nanoseconds */
+  uint64_t bytes;		/**< total request bytes */
+  uint64_t totalns;		/**< total request time in nanoseconds */
+  uint32_t hist[GR_PROFILE_BUCKETS]; /**< latency histogram, hist[n] counts requests under 2^n us */
+} GR_REQUEST_PROFILE;
+
+/**
+ * Server request profile for one client, from GrGetClientProfile().
+ */
+typedef struct {
+  int id;			/**< client id */
+  int processid;		/**< client process id */
+  uint32_t count;		/**< requests received */
+  uint64_t bytes;		/**< total request bytes */
+  uint64_t totalns;		/**< total request time in nanoseconds */
+} GR_CLIENT_PROFILE;
+
 typedef void (*GR_FNCALLBACKEVENT)(GR_EVENT *);
 
 /* GR_BITMAP macros*/
@@ -830,6 +935,10 @@ void		GrFreeEvent(GR_EVENT *ev);
 void		GrLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x1, GR_COORD y1, GR_COORD x2, GR_COORD y2);
 void		GrPoint(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y);
 void		GrPoints(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable);
+void		GrPolyLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable);
+void		GrSegments(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_SEGMENT *segtable);
+void		GrRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable);
+void		GrFillRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable);
 void		GrRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height);
 void		GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height);
@@ -837,6 +946,10 @@ void		GrPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable);
 void		GrFillPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable);
 void		GrEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_SIZE ry);
 void		GrFillEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_SIZE ry);
+void		GrRoundRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
+			GR_SIZE height, GR_SIZE rx, GR_SIZE ry);
+void		GrFillRoundRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
+			GR_SIZE height, GR_SIZE rx, GR_SIZE ry);
 void		GrArc(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_SIZE ry,
 				GR_COORD ax, GR_COORD ay, GR_COORD bx, GR_COORD by, int type);
 void		GrArcAngle(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_SIZE ry,
@@ -848,6 +961,8 @@ void		GrSetGCBackgroundPixelVal(GR_GC_ID gc, GR_PIXELVAL background);
 void		GrSetGCUseBackground(GR_GC_ID gc, GR_BOOL flag);
 void		GrSetGCMode(GR_GC_ID gc, int mode);
 void		GrSetGCLineAttributes(GR_GC_ID, int);
+void		GrSetGCLineAttributesEx(GR_GC_ID gc, GR_SIZE linewidth, int linestyle,
+			int capstyle, int joinstyle);
 void		GrSetGCDash(GR_GC_ID, char *, int);
 void		GrSetGCFillMode(GR_GC_ID, int);
 void		GrSetGCStipple(GR_GC_ID, GR_BITMAP *, GR_SIZE, GR_SIZE);
@@ -855,6 +970,7 @@ void		GrSetGCTile(GR_GC_ID, GR_WINDOW_ID, GR_SIZE, GR_SIZE);
 void		GrSetGCTSOffset(GR_GC_ID, GR_COORD, GR_COORD);
 void		GrSetGCGraphicsExposure(GR_GC_ID gc, GR_BOOL exposure);
 void		GrSetGCFont(GR_GC_ID gc, GR_FONT_ID font);
+void		GrChangeGC(GR_GC_ID gc, unsigned long mask, GR_GC_VALUES *values);
 void		GrGetGCTextSize(GR_GC_ID gc, void *str, int count, GR_TEXTFLAGS flags,
 				GR_SIZE *retwidth, GR_SIZE *retheight,GR_SIZE *retbase);
 void		GrReadArea(GR_DRAW_ID id, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height,
@@ -872,6 +988,8 @@ void		GrDrawImageBits(GR_DRAW_ID id,GR_GC_ID gc,GR_COORD x,GR_COORD y, GR_IMAGE_
 void		GrDrawImageFromFile(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height, char *path, int flags);
 GR_IMAGE_ID	GrLoadImageFromFile(char *path, int flags);
+GR_IMAGE_ID	GrLoadImageFromFileScaled(char *path, GR_SIZE width, GR_SIZE height, int flags);
+GR_IMAGE_ID	GrLoadImageFromFileAsync(char *path, GR_SIZE width, GR_SIZE height, int flags);
 void		GrDrawImageFromBuffer(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height, void *buffer, int size, int flags);
 GR_IMAGE_ID	GrLoadImageFromBuffer(void *buffer, int size, int flags);
@@ -882,6 +1000,8 @@ void		GrDrawImagePartToFit(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD dx, GR_COORD dy,
 				GR_SIZE swidth, GR_SIZE sheight, GR_IMAGE_ID imageid);
 void		GrFreeImage(GR_IMAGE_ID id);
 void		GrGetImageInfo(GR_IMAGE_ID id, GR_IMAGE_INFO *iip);
+void		GrSetImageCacheSize(int maxbytes);
+void		GrGetImageCacheStats(GR_IMAGE_CACHE_STATS *stats);
 void		GrText(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 				void *str, GR_COUNT count, GR_TEXTFLAGS flags);
 GR_CURSOR_ID GrNewCursor(GR_SIZE width, GR_SIZE height, GR_COORD hotx, GR_COORD hoty,
@@ -933,6 +1053,9 @@ void		GrServiceSelect(void *rfdset, GR_FNCALLBACKEVENT fncb);
 
 /* Client side queue count - available only with client/server */
 int			GrQueueLength(void);
+void		GrGetEventQueueStats(GR_EVENT_QUEUE_STATS *stats);
+GR_BOOL		GrGetRequestProfile(int reqtype, GR_REQUEST_PROFILE *prof);
+GR_BOOL		GrGetClientProfile(int index, GR_CLIENT_PROFILE *prof);
 
 void		GrSetTransform(GR_TRANSFORM *);
 
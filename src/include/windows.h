@@ -126,6 +126,7 @@ struct hdc {
 	MWFONTOBJ *	font;		/* current font*/
 	MWBITMAPOBJ *	bitmap;		/* current bitmap (mem dc's only)*/
 	MWRGNOBJ *	region;		/* user specified clip region*/
+	MWCLIPREGION *	paintrgn;	/* BeginPaint update region*/
 	MWPALOBJ *	palette;
 	int		drawmode;	/* rop2 drawing mode */
 	POINT		pt;		/* current pen pos in client coords*/
@@ -177,6 +178,7 @@ struct hwnd {
 	int		id;		/* window id */
 	LPTSTR		szTitle;	/* window title*/
 	int		gotPaintMsg;	/* window had WM_PAINT PostMessage*/
+	MWLIST		paintlink;	/* mwPaintHead link if gotPaintMsg set*/
 	int		paintSerial;	/* experimental serial # for alphblend*/
 	int		paintNC;	/* experimental NC paint handling*/
 	int		nEraseBkGnd;	/* for InvalidateXX erase bkgnd flag */
@@ -127,6 +127,8 @@ BOOL WINAPI	Polyline(HDC hdc, CONST POINT *lppt, int cPoints);
 BOOL WINAPI	PolyPolygon(HDC hdc, CONST POINT *lpPoints, LPINT lpPolyCounts,
 			int nCount);
 BOOL WINAPI	Rectangle(HDC hdc, int nLeft, int nTop, int nRight,int nBottom);
+BOOL WINAPI	RoundRect(HDC hdc, int nLeft, int nTop, int nRight, int nBottom,
+			int nWidth, int nHeight);
 BOOL WINAPI	Ellipse(HDC hdc, int nLeftRect, int nTopRect, int nRightRect,
 			int nBottomRect);
 BOOL WINAPI	Arc(HDC hdc, int nLeftRect, int nTopRect, int nRightRect,
@@ -273,6 +275,8 @@ int WINAPI	SelectClipRgn(HDC hdc, HRGN hrgn);
 int WINAPI	ExtSelectClipRgn(HDC hdc, HRGN hrgn, int fnMode);
 int WINAPI	GetUpdateRgn(HWND hwnd, HRGN hrgn, BOOL bErase);
 BOOL WINAPI	GetUpdateRect(HWND hwnd, LPRECT lpRect, BOOL bErase);
+BOOL WINAPI	RectVisible(HDC hdc, CONST RECT *lprc);
+BOOL WINAPI	PtVisible(HDC hdc, int x, int y);
 
 /* Brush Styles */
 #define BS_SOLID            0
@@ -21,6 +21,8 @@ HWND		MwGetTopWindow(HWND hwnd);
 void		MwCalcClientRect(HWND hwnd);
 void		MwSendSizeMove(HWND hwnd, BOOL bSize, BOOL bMove);
 void		MwSetCursor(HWND wp, PMWCURSOR pcursor);
+void		MwSetPaintState(HWND hwnd, int state);
+void		MwRestackPaintState(HWND hwnd);
 
 /* wingdi.c*/
 #define MwIsClientDC(hdc)	(((hdc)->flags & DCX_WINDOW) == 0)
@@ -88,6 +90,7 @@ int		MwInitialize(void);
 void	MwTerminate(void);
 
 extern	HWND	listwp;			/* list of all windows */
+extern	MWLISTHEAD mwPaintHead;		/* windows with pending or delayed paint*/
 extern	HWND	rootwp;			/* root window pointer */
 extern	HWND	focuswp;		/* focus window for keyboard */
 extern	HWND	mousewp;		/* window mouse is currently in */
@@ -144,6 +144,12 @@ MwSetClipWindow(HDC hdc)
 	 */
 	if(!(hdc->flags & DCX_EXCLUDEUPDATE))
 		GdIntersectRegion(vis, vis, wp->update);
+
+	/*
+	 * Intersect with update region saved by BeginPaint.
+	 */
+	if (hdc->paintrgn)
+		GdIntersectRegion(vis, vis, hdc->paintrgn);
 #endif
 	/*
 	 * Intersect with user region, if set.
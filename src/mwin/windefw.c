@@ -286,9 +286,13 @@ DefWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				 * User stopped moving window, repaint 
 				 * windows previously queued for painting.
 				 */
-				for(wp=listwp; wp; wp=wp->next)
+				PMWLIST p;
+
+				for(p=mwPaintHead.head; p; p=p->next) {
+					wp = MwItemAddr(p, struct hwnd, paintlink);
 					if(wp->gotPaintMsg == PAINT_DELAYPAINT)
-					    wp->gotPaintMsg = PAINT_NEEDSPAINT;
+					    MwSetPaintState(wp, PAINT_NEEDSPAINT);
+				}
 			} else {
 				POINTSTOPOINT(curpt, lParam);
 				x = curpt.x - startpt.x;
@@ -360,6 +364,11 @@ DefWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		hbr = (HBRUSH)(LONG_PTR)GetClassLongPtr(hwnd, GCL_HBRBACKGROUND);
 		if(!hbr)
 			return 0;
+		/* use BeginPaint dc if passed, already clipped to update region*/
+		if(wParam) {
+			FillRect((HDC)wParam, NULL, hbr);
+			return 1;
+		}
 		/* don't exclude update region*/
 		hdc = GetDCEx(hwnd, NULL, DCX_DEFAULTCLIP);
 		FillRect(hdc, NULL, hbr);
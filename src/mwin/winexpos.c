@@ -176,6 +176,7 @@ MwRaiseWindow(HWND hwnd)
 	prevwp->siblings = wp->siblings;
 	wp->siblings = wp->parent->children;
 	wp->parent->children = wp;
+	MwRestackPaintState(wp);
 
 	/*
 	 * Finally redraw the window if necessary.
@@ -235,6 +236,7 @@ MwLowerWindow(HWND hwnd)
 	sibwp->siblings = wp;
 
 	wp->siblings = NULL;
+	MwRestackPaintState(wp);
 
 	/*
 	 * Finally redraw the sibling windows which this window covered
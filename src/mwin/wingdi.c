@@ -207,6 +207,29 @@ MwPaintNCArea(HWND hwnd)
 	MwPaintNCScrollbars(hwnd, NULL);
 }
 
+#if UPDATEREGIONS
+/*
+ * Clip a BeginPaint DC to the window's update region.  An empty
+ * update region, as from UpdateWindow or a sent WM_PAINT, paints
+ * the whole client area.
+ */
+static void
+MwSetPaintRegion(HDC hdc, LPRECT lprcPaint)
+{
+	HWND	hwnd = hdc->hwnd;
+
+	if(hwnd->update->numRects == 0) {
+		GetClientRect(hwnd, lprcPaint);
+		return;
+	}
+
+	hdc->paintrgn = GdAllocRegion();
+	GdCopyRegion(hdc->paintrgn, hwnd->update);
+	if(hdc == cliphdc)
+		cliphdc = NULL;		/* force reclip of private DC*/
+}
+#endif
+
 HDC WINAPI 
 BeginPaint(HWND hwnd, LPPAINTSTRUCT lpPaint)
 {
@@ -227,13 +250,18 @@ BeginPaint(HWND hwnd, LPPAINTSTRUCT lpPaint)
 	if(mwERASEMOVE && dragwp && hwnd != rootwp) {	/* don't prohibit root window wallpaper*/
 		hdc = NULL;
 		lpPaint->fErase = !DefWindowProc(hwnd, WM_ERASEBKGND, (WPARAM)0, (LPARAM)0);
-		hwnd->gotPaintMsg = PAINT_DELAYPAINT;
+		MwSetPaintState(hwnd, PAINT_DELAYPAINT);
+		GetUpdateRect(hwnd, &lpPaint->rcPaint, FALSE);
 	} else {
 		HideCaret(hwnd);
 
-		/* FIXME: mdemo requires update excluded or draw errors occur*/
-		hdc = GetDCEx(hwnd, NULL, DCX_DEFAULTCLIP
-				|DCX_EXCLUDEUPDATE);	/* FIXME - bug*/
+		/* update region is applied through hdc->paintrgn below*/
+		hdc = GetDCEx(hwnd, NULL, DCX_DEFAULTCLIP|DCX_EXCLUDEUPDATE);
+		GetUpdateRect(hwnd, &lpPaint->rcPaint, FALSE);
+#if UPDATEREGIONS
+		if(hdc)
+			MwSetPaintRegion(hdc, &lpPaint->rcPaint);
+#endif
 
 		/* erase client background, always w/alpha blending*/
 		if(hwnd->nEraseBkGnd > 0 || mwforceNCpaint)
@@ -242,6 +270,11 @@ BeginPaint(HWND hwnd, LPPAINTSTRUCT lpPaint)
 			lpPaint->fErase = 0;
 
 		hwnd->nEraseBkGnd = 0;
+#if UPDATEREGIONS
+		/* validate, invalidations while painting generate another WM_PAINT*/
+		if(hdc)
+			GdSetRectRegion(hwnd->update, 0, 0, 0, 0);
+#endif
 	}
 	lpPaint->hdc = hdc;
 
@@ -251,8 +284,6 @@ BeginPaint(HWND hwnd, LPPAINTSTRUCT lpPaint)
 		DeleteObject ( hwnd->paintPen );
 	hwnd->paintBrush = NULL;
 	hwnd->paintPen = NULL;
-
-	GetUpdateRect(hwnd, &lpPaint->rcPaint, FALSE);
 	return hdc;
 }
 
@@ -271,12 +302,16 @@ EndPaint(HWND hwnd, CONST PAINTSTRUCT *lpPaint)
 		DeleteObject ( hwnd->paintPen );
 		hwnd->paintPen = NULL;
 		}
-	ReleaseDC(hwnd, lpPaint->hdc);
 #if UPDATEREGIONS
-	/* don't clear update region until done dragging*/
-	if(mwERASEMOVE && !dragwp)
-		GdSetRectRegion(hwnd->update, 0, 0, 0, 0);
+	/* private DC's outlive EndPaint, remove paint clipping*/
+	if(lpPaint->hdc && lpPaint->hdc->paintrgn) {
+		GdDestroyRegion(lpPaint->hdc->paintrgn);
+		lpPaint->hdc->paintrgn = NULL;
+		if(lpPaint->hdc == cliphdc)
+			cliphdc = NULL;
+	}
 #endif
+	ReleaseDC(hwnd, lpPaint->hdc);
 	ShowCaret(hwnd);
 	return TRUE;
 }
@@ -536,12 +571,34 @@ LineTo(HDC hdc, int x, int y)
 	return TRUE;
 }
 
+/* return passed points in screen coords, allocating if required*/
+static LPPOINT
+mappoints(HDC hdc, HWND hwnd, CONST POINT *lpPoints, int nCount, LPPOINT *ppAlloc)
+{
+	LPPOINT	pp;
+	int	i;
+
+	*ppAlloc = NULL;
+	if(!MwIsClientDC(hdc))
+		return (LPPOINT)lpPoints;
+
+	/* convert points to screen coords*/
+	*ppAlloc = (LPPOINT)malloc(nCount * sizeof(POINT));
+	if(!*ppAlloc)
+		return NULL;
+	memcpy(*ppAlloc, lpPoints, nCount*sizeof(POINT));
+	pp = *ppAlloc;
+	for(i=0; i<nCount; ++i)
+		ClientToScreen(hwnd, pp++);
+	return *ppAlloc;
+}
+
 /* draw line segments by connecting passed points*/
 BOOL WINAPI
 Polyline(HDC hdc, CONST POINT *lppt, int cPoints)
 {
 	HWND		hwnd;
-	POINT		beg, end;
+	LPPOINT		pp, ppAlloc;
 
 	if(cPoints <= 1)
 		return FALSE;
@@ -553,22 +610,17 @@ Polyline(HDC hdc, CONST POINT *lppt, int cPoints)
 	if(hdc->pen->style == PS_NULL)
 		return TRUE;
 
-	/* draw line in current pen color*/
-	GdSetForegroundColor(hdc->psd, hdc->pen->color);
+	pp = mappoints(hdc, hwnd, lppt, cPoints, &ppAlloc);
+	if(!pp)
+		return FALSE;
 
-	beg = *lppt++;
-	if(MwIsClientDC(hdc))
-		ClientToScreen(hwnd, &beg);
-	while(--cPoints > 0) {
-		end = *lppt++;
-		if(MwIsClientDC(hdc))
-			ClientToScreen(hwnd, &end);
-		MwSetPenStyle(hdc);
-		/* don't draw last point*/
-		GdLine(hdc->psd, beg.x, beg.y, end.x, end.y, FALSE);
+	/* draw line in current pen color, don't draw last point*/
+	GdSetForegroundColor(hdc->psd, hdc->pen->color);
+	MwSetPenStyle(hdc);
+	GdPolyLine(hdc->psd, cPoints, pp, FALSE);
 
-		beg = end;
-	}
+	if(ppAlloc)
+		free(ppAlloc);
 	return TRUE;
 }
 
@@ -605,6 +657,44 @@ Rectangle(HDC hdc, int nLeft, int nTop, int nRight, int nBottom)
 	return TRUE;
 }
 
+BOOL WINAPI
+RoundRect(HDC hdc, int nLeft, int nTop, int nRight, int nBottom, int nWidth,
+	int nHeight)
+{
+	HWND	hwnd;
+	int	rx, ry;
+	RECT	rc;
+
+	hwnd = MwPrepareDC(hdc);
+	if(!hwnd)
+		return FALSE;
+
+	SetRect(&rc, nLeft, nTop, nRight, nBottom);
+	if(MwIsClientDC(hdc))
+		MapWindowPoints(hwnd, NULL, (LPPOINT)&rc, 2);
+
+	/* corner ellipse width and height to radii*/
+	rx = nWidth/2;
+	ry = nHeight/2;
+
+	/* fill inside outline in current brush color*/
+	if(hdc->brush->style != BS_NULL) {
+		GdSetForegroundColor(hdc->psd, hdc->brush->color);
+		GdRoundRect(hdc->psd, rc.left + 1, rc.top + 1, rc.right - rc.left - 2,
+			rc.bottom - rc.top - 2, rx - 1, ry - 1, TRUE);
+	}
+
+	/* draw outline in current pen color*/
+	if(hdc->pen->style != PS_NULL) {
+		GdSetForegroundColor(hdc->psd, hdc->pen->color);
+		MwSetPenStyle(hdc);
+		GdRoundRect(hdc->psd, rc.left, rc.top, rc.right - rc.left,
+			rc.bottom - rc.top, rx, ry, FALSE);
+	}
+
+	return TRUE;
+}
+
 #if MW_FEATURE_SHAPES
 BOOL WINAPI
 Ellipse(HDC hdc, int nLeftRect, int nTopRect, int nRightRect, int nBottomRect)
@@ -705,29 +795,10 @@ Pie(HDC hdc, int nLeftRect, int nTopRect, int nRightRect, int nBottomRect,
 	return TRUE;
 }
 
-BOOL WINAPI
-Polygon(HDC hdc, CONST POINT *lpPoints, int nCount)
+/* fill and outline polygon, points in screen coords*/
+static void
+dopolygon(HDC hdc, LPPOINT pp, int nCount)
 {
-	HWND	hwnd;
-	int	i;
-	LPPOINT	pp, ppAlloc = NULL;
-
-	hwnd = MwPrepareDC(hdc);
-	if(!hwnd)
-		return FALSE;
-
-	if(MwIsClientDC(hdc)) {
-		/* convert points to client coords*/
-		ppAlloc = (LPPOINT)malloc(nCount * sizeof(POINT));
-		if(!ppAlloc)
-			return FALSE;
-		memcpy(ppAlloc, lpPoints, nCount*sizeof(POINT));
-		pp = ppAlloc;
-		for(i=0; i<nCount; ++i)
-			ClientToScreen(hwnd, pp++);
-		pp = ppAlloc;
-	} else pp = (LPPOINT)lpPoints;
-
 	/* fill polygon in current brush color*/
 	if(hdc->brush->style != BS_NULL) {
 		GdSetForegroundColor(hdc->psd, hdc->brush->color);
@@ -738,23 +809,56 @@ Polygon(HDC hdc, CONST POINT *lpPoints, int nCount)
 	if(hdc->pen->style != PS_NULL) {
 		GdSetForegroundColor(hdc->psd, hdc->pen->color);
 		MwSetPenStyle(hdc);
-		GdPoly(hdc->psd, nCount, pp);
+		GdPolyLine(hdc->psd, nCount, pp, TRUE);
 	}
+}
+
+BOOL WINAPI
+Polygon(HDC hdc, CONST POINT *lpPoints, int nCount)
+{
+	HWND	hwnd;
+	LPPOINT	pp, ppAlloc;
+
+	hwnd = MwPrepareDC(hdc);
+	if(!hwnd)
+		return FALSE;
+
+	pp = mappoints(hdc, hwnd, lpPoints, nCount, &ppAlloc);
+	if(!pp)
+		return FALSE;
+
+	dopolygon(hdc, pp, nCount);
 
 	if(ppAlloc)
 		free(ppAlloc);
 	return TRUE;
 }
 
-/* draw nCount polygons*/
+/* draw nCount polygons, preparing DC and converting points once*/
 BOOL WINAPI
 PolyPolygon(HDC hdc, CONST POINT *lpPoints, LPINT lpPolyCounts, int nCount)
 {
-	while(--nCount >= 0) {
-		if (!Polygon(hdc, lpPoints, *lpPolyCounts))
-			return FALSE;
-		lpPoints += *lpPolyCounts++;
+	HWND	hwnd;
+	LPPOINT	pp, ppAlloc;
+	int	i, total = 0;
+
+	hwnd = MwPrepareDC(hdc);
+	if(!hwnd)
+		return FALSE;
+
+	for(i=0; i<nCount; ++i)
+		total += lpPolyCounts[i];
+	pp = mappoints(hdc, hwnd, lpPoints, total, &ppAlloc);
+	if(!pp)
+		return FALSE;
+
+	for(i=0; i<nCount; ++i) {
+		dopolygon(hdc, pp, lpPolyCounts[i]);
+		pp += lpPolyCounts[i];
 	}
+
+	if(ppAlloc)
+		free(ppAlloc);
 	return TRUE;
 }
 #endif /* MW_FEATURE_SHAPES*/
@@ -1735,6 +1839,50 @@ GetUpdateRect(HWND hwnd, LPRECT lpRect, BOOL bErase)
 #endif
 }
 
+/* return TRUE if any part of rectangle is within DC clip region*/
+BOOL WINAPI
+RectVisible(HDC hdc, CONST RECT *lprc)
+{
+	HWND	hwnd;
+	BOOL	visible;
+	RECT	rc;
+
+	hwnd = MwPrepareDC(hdc);
+	if(!hwnd || !lprc)
+		return FALSE;
+
+	rc = *lprc;
+	if(MwIsClientDC(hdc))
+		MapWindowPoints(hwnd, NULL, (LPPOINT)&rc, 2);
+	if(rc.left >= rc.right || rc.top >= rc.bottom)
+		return FALSE;
+	visible = GdClipArea(hdc->psd, rc.left, rc.top, rc.right-1, rc.bottom-1)
+		!= CLIP_INVISIBLE;
+	GdFixCursor(hdc->psd);		/* nothing drawn, undo clip cursor check*/
+	return visible;
+}
+
+/* return TRUE if point is within DC clip region*/
+BOOL WINAPI
+PtVisible(HDC hdc, int x, int y)
+{
+	HWND	hwnd;
+	BOOL	visible;
+	POINT	pt;
+
+	hwnd = MwPrepareDC(hdc);
+	if(!hwnd)
+		return FALSE;
+
+	pt.x = x;
+	pt.y = y;
+	if(MwIsClientDC(hdc))
+		ClientToScreen(hwnd, &pt);
+	visible = GdClipPoint(hdc->psd, pt.x, pt.y);
+	GdFixCursor(hdc->psd);
+	return visible;
+}
+
 HBRUSH WINAPI
 CreateSolidBrush(COLORREF crColor)
 {
@@ -268,6 +268,10 @@ MwSelect(BOOL canBlock)
 		if (fd > setsize) setsize = fd;
 		fd = userregfd[fd].next;
 	}
+#if MW_FEATURE_RFBSERVER
+	/* handle VNC viewer connections*/
+	setsize = GdRFBPrepareSelect(setsize, &rfds, &wfds);
+#endif
 
 	++setsize;
 
@@ -327,6 +331,16 @@ MwSelect(BOOL canBlock)
 			while (MwCheckKeyboardEvent())
 				continue;
 
+#if MW_FEATURE_RFBSERVER
+		/* service VNC viewers and any pointer or key input they sent*/
+		if (GdRFBServiceSelect(&rfds, &wfds)) {
+			while (MwCheckMouseEvent())
+				continue;
+			while (MwCheckKeyboardEvent())
+				continue;
+		}
+#endif
+
 		/* If registered descriptor, handle it */
 		fd = userregfd_head;
 		while (fd != -1)
@@ -523,6 +537,11 @@ MwInitialize(void)
 		return -1;
 	}
 
+#if MW_FEATURE_RFBSERVER
+	/* returns -1 if VNC viewers can't connect, run without them*/
+	GdOpenRFBServer(psd);
+#endif
+
 	/*
 	 * Initialize the root window.
 	 */
@@ -623,6 +642,9 @@ MwInitialize(void)
 void
 MwTerminate(void)
 {
+#if MW_FEATURE_RFBSERVER
+	GdCloseRFBServer();
+#endif
 	GdCloseScreen(&scrdev);
 	GdCloseMouse();
 	GdCloseKeyboard();
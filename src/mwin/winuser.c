@@ -28,8 +28,11 @@
 
 #define PAINTONCE	1	/* =1 to queue paint msgs only once*/
 #define MOUSETEST	1
+#define MSGPOOLSIZE	64	/* messages allocated at once for msg queue*/
 
 MWLISTHEAD mwMsgHead;		/* application msg queue*/
+MWLISTHEAD mwPaintHead;		/* windows with pending or delayed paint*/
+static MWLISTHEAD mwMsgFree;	/* unused msg pool*/
 MWLISTHEAD mwClassHead;		/* register class list*/
 MWLISTHEAD mwHotkeyHead={0};/* Hotkey table list */
 
@@ -97,6 +100,106 @@ SendMessage(HWND hwnd, UINT Msg,WPARAM wParam,LPARAM lParam)
 	return 0;
 }
 
+/* get msg from pool, allocating MSGPOOLSIZE msgs when empty*/
+static PMSG
+MwAllocMsg(void)
+{
+	PMSG	pMsg;
+	int	i;
+
+	if(mwMsgFree.head == NULL) {
+		/* pool is never freed, it's sized by the largest queue seen*/
+		pMsg = (PMSG)malloc(MSGPOOLSIZE * sizeof(MSG));
+		if(!pMsg)
+			return NULL;
+		for(i=0; i<MSGPOOLSIZE; i++)
+			GdListAdd(&mwMsgFree, &pMsg[i].link);
+	}
+	pMsg = MwItemAddr(mwMsgFree.head, MSG, link);
+	GdListRemove(&mwMsgFree, &pMsg->link);
+	return pMsg;
+}
+
+/* return msg to pool*/
+static void
+MwFreeMsg(PMSG pMsg)
+{
+	GdListInsert(&mwMsgFree, &pMsg->link);
+}
+
+/*
+ * Link a top level window on mwPaintHead in stacking order, after the
+ * pending top level windows above it and ahead of all child windows.
+ */
+static void
+MwLinkPaintTopLevel(HWND hwnd)
+{
+	HWND	wp;
+	PMWLIST	p;
+	PMWLIST	prev = NULL;
+	PMWLIST	pItem = &hwnd->paintlink;
+
+	if(hwnd->parent) {
+		/* last pending sibling stacked above us*/
+		for(wp=hwnd->parent->children; wp && wp != hwnd; wp=wp->siblings)
+			if(wp->gotPaintMsg != PAINT_PAINTED && !(wp->style & WS_CHILD))
+				prev = &wp->paintlink;
+	} else {
+		/* root window is below all top level windows*/
+		for(p=mwPaintHead.head; p; p=p->next) {
+			wp = MwItemAddr(p, struct hwnd, paintlink);
+			if(wp->style & WS_CHILD)
+				break;
+			prev = p;
+		}
+	}
+
+	if(!prev) {
+		GdListInsert(&mwPaintHead, pItem);
+		return;
+	}
+	pItem->prev = prev;
+	pItem->next = prev->next;
+	if(prev->next)
+		prev->next->prev = pItem;
+	else mwPaintHead.tail = pItem;
+	prev->next = pItem;
+}
+
+/*
+ * Set window paint status, keeping windows that need painting
+ * on mwPaintHead so PeekMessage doesn't search all windows.
+ * Top level windows are painted in stacking order, topmost first,
+ * before child windows.
+ */
+void
+MwSetPaintState(HWND hwnd, int state)
+{
+	if(hwnd->gotPaintMsg == state)
+		return;
+
+	if(hwnd->gotPaintMsg == PAINT_PAINTED) {
+		if(hwnd->style & WS_CHILD)
+			GdListAdd(&mwPaintHead, &hwnd->paintlink);
+		else MwLinkPaintTopLevel(hwnd);
+	} else if(state == PAINT_PAINTED)
+		GdListRemove(&mwPaintHead, &hwnd->paintlink);
+	hwnd->gotPaintMsg = state;
+}
+
+/*
+ * Relink a pending top level window after it is raised or lowered,
+ * so mwPaintHead stays in stacking order.
+ */
+void
+MwRestackPaintState(HWND hwnd)
+{
+	if(hwnd->gotPaintMsg == PAINT_PAINTED || (hwnd->style & WS_CHILD))
+		return;
+	GdListRemove(&mwPaintHead, &hwnd->paintlink);
+	MwLinkPaintTopLevel(hwnd);
+}
+
 BOOL WINAPI
 PostMessage(HWND hwnd, UINT Msg, WPARAM wParam, LPARAM lParam)
 {
@@ -105,28 +208,29 @@ PostMessage(HWND hwnd, UINT Msg, WPARAM wParam, LPARAM lParam)
 #if PAINTONCE
 	/* don't queue paint msgs, set window paint status instead*/
 	if(Msg == WM_PAINT) {
-		hwnd->gotPaintMsg = PAINT_NEEDSPAINT;
+		MwSetPaintState(hwnd, PAINT_NEEDSPAINT);
 		return TRUE;
 	}
 #endif
 #if MOUSETEST
-	/* replace multiple mouse messages with one for better mouse handling*/
-	if(Msg == WM_MOUSEMOVE) {
-		PMWLIST	p;
-		for(p=mwMsgHead.head; p; p=p->next) {
-			pMsg = MwItemAddr(p, MSG, link);
-			if(pMsg->hwnd == hwnd && pMsg->message == Msg) {
-				pMsg->wParam = wParam;
-				pMsg->lParam = lParam;
-				pMsg->time = GetTickCount();
-				pMsg->pt.x = cursorx;
-				pMsg->pt.y = cursory;
-				return TRUE;
-			}
+	/*
+	 * Replace multiple mouse messages with one for better mouse handling.
+	 * Only the last queued msg is checked, so moves aren't reordered
+	 * past button messages.
+	 */
+	if(Msg == WM_MOUSEMOVE && mwMsgHead.tail) {
+		pMsg = MwItemAddr(mwMsgHead.tail, MSG, link);
+		if(pMsg->hwnd == hwnd && pMsg->message == Msg) {
+			pMsg->wParam = wParam;
+			pMsg->lParam = lParam;
+			pMsg->time = GetTickCount();
+			pMsg->pt.x = cursorx;
+			pMsg->pt.y = cursory;
+			return TRUE;
 		}
 	}
 #endif
-	pMsg = GdItemNew(MSG);
+	pMsg = MwAllocMsg();
 	if(!pMsg)
 		return FALSE;
 	pMsg->hwnd = hwnd;
@@ -164,7 +268,7 @@ chkPaintMsg(HWND wp, LPMSG lpMsg)
 		if(wp->gotPaintMsg == PAINT_NEEDSPAINT &&
 		    (!dragwp || dragwp == wp || wp == rootwp)) {
 	paint:
-			wp->gotPaintMsg = PAINT_PAINTED;
+			MwSetPaintState(wp, PAINT_PAINTED);
 			lpMsg->hwnd = wp;
 			lpMsg->message = WM_PAINT;
 			lpMsg->wParam = 0;
@@ -184,42 +288,76 @@ chkPaintMsg(HWND wp, LPMSG lpMsg)
 	return FALSE;
 }
 
+/*
+ * Check msg against PeekMessage window and msg range filters.
+ * A window filter matches its child windows, -1 matches NULL hwnd msgs.
+ */
+static BOOL
+chkMsgFilter(HWND wp, UINT msg, HWND hwnd, UINT uMsgFilterMin,
+	UINT uMsgFilterMax)
+{
+	if((uMsgFilterMin || uMsgFilterMax) &&
+	    (msg < uMsgFilterMin || msg > uMsgFilterMax))
+		return FALSE;
+	if(hwnd == (HWND)-1)
+		return wp == NULL;
+	if(hwnd) {
+		while(wp && wp != hwnd)
+			wp = wp->parent;
+		return wp != NULL;
+	}
+	return TRUE;
+}
+
+/* return first queued msg matching filters*/
+static PMSG
+findMsg(HWND hwnd, UINT uMsgFilterMin, UINT uMsgFilterMax)
+{
+	PMWLIST	p;
+	PMSG	pMsg;
+
+	for(p=mwMsgHead.head; p; p=p->next) {
+		pMsg = MwItemAddr(p, MSG, link);
+		if(chkMsgFilter(pMsg->hwnd, pMsg->message, hwnd, uMsgFilterMin,
+		    uMsgFilterMax))
+			return pMsg;
+	}
+	return NULL;
+}
+
 BOOL WINAPI
 PeekMessage(LPMSG lpMsg, HWND hwnd, UINT uMsgFilterMin, UINT uMsgFilterMax,
 	UINT wRemoveMsg)
 {
-	HWND	wp;
 	PMSG	pNxtMsg;
 
-	/* check if no messages in queue*/
-	if(mwMsgHead.head == NULL) {
+	/* check if no matching messages in queue*/
+	if((pNxtMsg = findMsg(hwnd, uMsgFilterMin, uMsgFilterMax)) == NULL) {
 #if PAINTONCE
-		/* check all windows for pending paint messages*/
-		for(wp=listwp; wp; wp=wp->next) {
-			if(!(wp->style & WS_CHILD)) {
-				if(chkPaintMsg(wp, lpMsg))
-					return TRUE;
-			}
-		}
-		for(wp=listwp; wp; wp=wp->next) {
-			if(wp->style & WS_CHILD) {
-				if(chkPaintMsg(wp, lpMsg))
-					return TRUE;
-			}
+		PMWLIST	p, pnext;
+		HWND	wp;
+
+		/* check windows with pending paint messages*/
+		for(p=mwPaintHead.head; p; p=pnext) {
+			pnext = p->next;
+			wp = MwItemAddr(p, struct hwnd, paintlink);
+			if(chkMsgFilter(wp, WM_PAINT, hwnd, uMsgFilterMin, uMsgFilterMax)
+			    && chkPaintMsg(wp, lpMsg))
+				return TRUE;
 		}
 #endif
 		MwSelect(FALSE);
-	}
 
-	if(mwMsgHead.head == NULL)
-		return FALSE;
+		pNxtMsg = findMsg(hwnd, uMsgFilterMin, uMsgFilterMax);
+		if(pNxtMsg == NULL)
+			return FALSE;
+	}
 
-	pNxtMsg = (PMSG)mwMsgHead.head;
-	if(wRemoveMsg & PM_REMOVE)
-		GdListRemove(&mwMsgHead, &pNxtMsg->link);
 	*lpMsg = *pNxtMsg;
-	if(wRemoveMsg & PM_REMOVE)
-		GdItemFree(pNxtMsg);
+	if(wRemoveMsg & PM_REMOVE) {
+		GdListRemove(&mwMsgHead, &pNxtMsg->link);
+		MwFreeMsg(pNxtMsg);
+	}
 	return TRUE;
 }
 
@@ -636,6 +774,9 @@ MwDestroyWindow(HWND hwnd,BOOL bSendMsg)
 	}
 	wp->next = NULL;
 
+	/* Remove from pending paint list*/
+	MwSetPaintState(wp, PAINT_PAINTED);
+
 	/*
 	 * Forget various information related to this window.
 	 * Then finally free the structure.
@@ -647,7 +788,7 @@ MwDestroyWindow(HWND hwnd,BOOL bSendMsg)
 		if(pmsg->hwnd == wp) {
 			p = p->next;
 			GdListRemove(&mwMsgHead, &pmsg->link);
-			GdItemFree(pmsg);
+			MwFreeMsg(pmsg);
 		} else
 			p = p->next;
 	}
@@ -781,7 +922,7 @@ InvalidateRect(HWND hwnd, CONST RECT *lpRect, BOOL bErase)
 #endif
 
 			if(hwnd->gotPaintMsg == PAINT_PAINTED)
-				hwnd->gotPaintMsg = PAINT_NEEDSPAINT;
+				MwSetPaintState(hwnd, PAINT_NEEDSPAINT);
 		if( bErase )
 			hwnd->nEraseBkGnd++;
 	}
@@ -809,7 +950,7 @@ InvalidateRgn(HWND hwnd, HRGN hrgn, BOOL bErase)
 		/* if update region not empty, mark as needing painting*/
 		if(hwnd->update->numRects != 0)
 			if(hwnd->gotPaintMsg == PAINT_PAINTED)
-				hwnd->gotPaintMsg = PAINT_NEEDSPAINT;
+				MwSetPaintState(hwnd, PAINT_NEEDSPAINT);
 		if( bErase )
 			hwnd->nEraseBkGnd++;
 	}
@@ -842,7 +983,7 @@ ValidateRect(HWND hwnd, CONST RECT *lprc)
 		/* if update region empty, mark window as painted*/
 		if(hwnd->update->numRects == 0)
 			if(hwnd->gotPaintMsg == PAINT_NEEDSPAINT)
-				hwnd->gotPaintMsg = PAINT_PAINTED;
+				MwSetPaintState(hwnd, PAINT_PAINTED);
 	}
 	return TRUE;
 }
@@ -867,7 +1008,7 @@ ValidateRgn(HWND hwnd, HRGN hrgn)
 		/* if update region empty, mark window as painted*/
 		if(hwnd->update->numRects == 0)
 			if(hwnd->gotPaintMsg == PAINT_NEEDSPAINT)
-				hwnd->gotPaintMsg = PAINT_PAINTED;
+				MwSetPaintState(hwnd, PAINT_PAINTED);
 	}
 	return TRUE;
 }
@@ -879,7 +1020,7 @@ UpdateWindow(HWND hwnd)
 #if PAINTONCE
 	if(hwnd && hwnd->gotPaintMsg == PAINT_NEEDSPAINT) {
 		SendMessage(hwnd, WM_PAINT, 0, 0L);
-		hwnd->gotPaintMsg = PAINT_PAINTED;
+		MwSetPaintState(hwnd, PAINT_PAINTED);
 		return TRUE;
 	}
 	return FALSE;
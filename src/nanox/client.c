@@ -110,7 +110,9 @@ int ecos_nanox_client_data_index = CYGNUM_KERNEL_THREADS_DATA_MAX;
 
 static void QueueEvent(GR_EVENT *ep);
 static void GetNextQueuedEvent(GR_EVENT *ep);
+static void ReadEvents(void);
 static void _GrGetNextEventTimeout(GR_EVENT *ep, GR_TIMEOUT timeout);
+static void FreeAllGCShadows(void);
 
 /**
  * Read n bytes of data from the server into block *b.  Make sure the data
@@ -229,6 +231,9 @@ CheckBlockType(short packettype)
 			ReadBlock(&event, sizeof(event));
 			CheckForClientData(&event);
 			QueueEvent(&event);
+		} else if (b == GrNumGetEvents) {
+			/* queue events from earlier GetEvents request*/
+			ReadEvents();
 		} else {
 			EPRINTF("nxclient %d: Wrong packet type %d (expected %d)\n",
 				getpid(),b, packettype);
@@ -261,6 +266,68 @@ TypedReadBlock(void *b, int n, int type)
 	return ReadBlock(b, n);
 }
 
+/**
+ * Read the body of a GrNumGetEvents reply and add the events
+ * to the local event queue.
+ *
+ * @internal
+ */
+static void
+ReadEvents(void)
+{
+	INT16		count;
+	GR_EVENT	event;
+
+	if (ReadBlock(&count, sizeof(count)) == -1)
+		return;
+	while (count-- > 0) {
+		if (ReadBlock(&event, sizeof(event)) == -1)
+			return;
+		CheckForClientData(&event);
+		QueueEvent(&event);
+	}
+}
+
+/**
+ * Ask the server for up to MAXEVENTSREPLY queued events in one reply.
+ * The events are read later by GetEventsReply.
+ *
+ * @param block GR_TRUE to have the server wait for at least one event.
+ *
+ * @internal
+ */
+static void
+SendGetEvents(GR_BOOL block)
+{
+	nxGetEventsReq *req;
+
+	req = AllocReq(GetEvents);
+	req->maxevents = MAXEVENTSREPLY;
+	req->block = block;
+}
+
+/**
+ * Read the reply to SendGetEvents into the local event queue and return
+ * the first queued event, or GR_EVENT_TYPE_NONE if no events were queued.
+ * Later GrGetNextEvent calls are served from the local queue.
+ *
+ * @param ep Destination for event.
+ *
+ * @internal
+ */
+static void
+GetEventsReply(GR_EVENT *ep)
+{
+	ACCESS_PER_THREAD_DATA()
+
+	if (CheckBlockType(GrNumGetEvents) == GrNumGetEvents)
+		ReadEvents();
+	if (evlist)
+		GetNextQueuedEvent(ep);
+	else
+		ep->type = GR_EVENT_TYPE_NONE;
+}
+
 /**
  * Check if the passed event is an error event, and call the error handler if
  * there is one. After calling the handler (if it returns), the event type is
@@ -433,6 +500,7 @@ GrClose(void)
 	LOCK(&nxGlobalLock);
 	AllocReq(Close);
 	GrFlush();
+	FreeAllGCShadows();
 	UNLOCK(&nxGlobalLock);
 
 #if GR_CLOSE_FIX
@@ -744,7 +812,7 @@ GrPrepareSelect(int *maxfd,void *rfdset)
 	ACCESS_PER_THREAD_DATA()
 
 	LOCK(&nxGlobalLock);
-	AllocReq(GetNextEvent);
+	SendGetEvents(GR_TRUE);
 	GrFlush();
 
 	FD_SET(nxSocket, rfds);
@@ -791,20 +859,22 @@ GrServiceSelect(void *rfdset, GR_FNCALLBACKEVENT fncb)
 	 * an event is generated in Nano-X at the same time as the
 	 * client wakes up for some reason and calls Nano-X functions.
 	 */
-	if (evlist) {
+	if (!evlist && FD_ISSET(nxSocket, rfds)) {
+		GetEventsReply(&ev);
+		CheckErrorEvent(&ev);
+		fncb(&ev);
+	}
+
+	/*
+	 * Handle all queued events, including the rest of a
+	 * GetEvents reply, as select() won't return for them.
+	 */
+	while (evlist) {
 		/*DPRINTF("nxclient: Handling queued event\n");*/
 		GetNextQueuedEvent(&ev);
 		CheckErrorEvent(&ev);
 		fncb(&ev);
 	}
-	else {
-		if(FD_ISSET(nxSocket, rfds)) {
-			TypedReadBlock(&ev, sizeof(ev),GrNumGetNextEvent);
-			CheckForClientData(&ev);
-			CheckErrorEvent(&ev);
-			fncb(&ev);
-		}
-	}
 
 	/* check for input on registered file descriptors */
 	for (fd = 0; fd < regfdmax; fd++) {
@@ -996,10 +1066,10 @@ _GrGetNextEventTimeout(GR_EVENT *ep, GR_TIMEOUT timeout)
 		if(FD_ISSET(nxSocket, &rfds)) {
 			/*
 			 * This will never be GR_EVENT_NONE with the current
-			 * implementation.
+			 * implementation.  Any further events in the reply
+			 * are queued for the next GrGetNextEvent.
 			 */
-		        TypedReadBlock(ep, sizeof(*ep),GrNumGetNextEvent);
-			CheckForClientData(ep);
+			GetEventsReply(ep);
 			CheckErrorEvent(ep);
 			return;
 		}
@@ -1135,9 +1205,8 @@ GrCheckNextEvent(GR_EVENT *ep)
 		return;
 	}
 
-	AllocReq(CheckNextEvent);
-	TypedReadBlock(ep, sizeof(*ep),GrNumGetNextEvent);
-	CheckForClientData(ep);
+	SendGetEvents(GR_FALSE);
+	GetEventsReply(ep);
 	CheckErrorEvent(ep);
 	UNLOCK(&nxGlobalLock);
 }
@@ -1425,6 +1494,168 @@ GrGetWindowInfo(GR_WINDOW_ID wid, GR_WINDOW_INFO *infoptr)
 	UNLOCK(&nxGlobalLock);
 }
 
+/*
+ * Client-side shadow of graphics context values, used to drop GrSetGC*
+ * requests that wouldn't change the GC, and to send only the changed
+ * values in GrChangeGC.  Only GCs created or copied by this client are
+ * shadowed, requests for other GCs are always sent.
+ */
+#define GCSHADOW_HASH	64	/* shadow hash table size, power of 2*/
+
+typedef struct gcshadow {
+	struct gcshadow *next;
+	GR_GC_ID	gc;
+	GR_GC_VALUES	values;
+} GCSHADOW;
+
+static GCSHADOW *gcshadow[GCSHADOW_HASH];
+
+/* server defaults for a new GC*/
+static const GR_GC_VALUES gcdefaults = {
+	GR_MODE_COPY,		/* mode*/
+	WHITE,			/* foreground*/
+	BLACK,			/* background*/
+	GR_FALSE,		/* fgispixelval*/
+	GR_FALSE,		/* bgispixelval*/
+	GR_TRUE,		/* usebackground*/
+	GR_TRUE,		/* exposure*/
+	0,			/* font*/
+	GR_LINE_SOLID,		/* linestyle*/
+	0,			/* linewidth*/
+	GR_CAP_BUTT,		/* capstyle*/
+	GR_JOIN_MITER,		/* joinstyle*/
+	GR_FILL_SOLID,		/* fillmode*/
+	0, 0,			/* ts_xoff, ts_yoff*/
+	0, 0			/* xoff, yoff*/
+};
+
+static GCSHADOW *
+FindGCShadow(GR_GC_ID gc)
+{
+	GCSHADOW *sp;
+
+	for (sp = gcshadow[gc & (GCSHADOW_HASH-1)]; sp; sp = sp->next)
+		if (sp->gc == gc)
+			return sp;
+	return NULL;
+}
+
+static void
+AddGCShadow(GR_GC_ID gc, const GR_GC_VALUES *values)
+{
+	GCSHADOW *sp;
+
+	if (!gc || (sp = (GCSHADOW *)malloc(sizeof(GCSHADOW))) == NULL)
+		return;		/* unshadowed GCs just send all requests*/
+	sp->gc = gc;
+	sp->values = *values;
+	sp->next = gcshadow[gc & (GCSHADOW_HASH-1)];
+	gcshadow[gc & (GCSHADOW_HASH-1)] = sp;
+}
+
+static void
+FreeGCShadow(GR_GC_ID gc)
+{
+	GCSHADOW **spp;
+	GCSHADOW *sp;
+
+	for (spp = &gcshadow[gc & (GCSHADOW_HASH-1)]; (sp = *spp) != NULL; spp = &sp->next) {
+		if (sp->gc == gc) {
+			*spp = sp->next;
+			free(sp);
+			return;
+		}
+	}
+}
+
+static void
+FreeAllGCShadows(void)
+{
+	GCSHADOW *sp;
+	int i;
+
+	for (i = 0; i < GCSHADOW_HASH; i++) {
+		while ((sp = gcshadow[i]) != NULL) {
+			gcshadow[i] = sp->next;
+			free(sp);
+		}
+	}
+}
+
+/*
+ * Update the shadow of gc with the values selected by mask,
+ * and return the mask of values that actually changed.
+ * Unshadowed GCs return mask unchanged.
+ */
+static unsigned long
+UpdateGCShadow(GR_GC_ID gc, unsigned long mask, GR_GC_VALUES *values)
+{
+	GCSHADOW *sp = FindGCShadow(gc);
+	GR_GC_VALUES *vp;
+	unsigned long changed = 0;
+
+	if (!sp)
+		return mask;
+	vp = &sp->values;
+
+	if ((mask & GR_GC_MASK_MODE) && vp->mode != values->mode) {
+		vp->mode = values->mode;
+		changed |= GR_GC_MASK_MODE;
+	}
+	if ((mask & GR_GC_MASK_FOREGROUND) && (vp->foreground != values->foreground ||
+	    vp->fgispixelval != values->fgispixelval)) {
+		vp->foreground = values->foreground;
+		vp->fgispixelval = values->fgispixelval;
+		changed |= GR_GC_MASK_FOREGROUND;
+	}
+	if ((mask & GR_GC_MASK_BACKGROUND) && (vp->background != values->background ||
+	    vp->bgispixelval != values->bgispixelval)) {
+		vp->background = values->background;
+		vp->bgispixelval = values->bgispixelval;
+		changed |= GR_GC_MASK_BACKGROUND;
+	}
+	if ((mask & GR_GC_MASK_USEBACKGROUND) && vp->usebackground != values->usebackground) {
+		vp->usebackground = values->usebackground;
+		changed |= GR_GC_MASK_USEBACKGROUND;
+	}
+	if ((mask & GR_GC_MASK_EXPOSURE) && vp->exposure != values->exposure) {
+		vp->exposure = values->exposure;
+		changed |= GR_GC_MASK_EXPOSURE;
+	}
+	if ((mask & GR_GC_MASK_FONT) && vp->font != values->font) {
+		vp->font = values->font;
+		changed |= GR_GC_MASK_FONT;
+	}
+	if ((mask & GR_GC_MASK_LINESTYLE) && vp->linestyle != values->linestyle) {
+		vp->linestyle = values->linestyle;
+		changed |= GR_GC_MASK_LINESTYLE;
+	}
+	if ((mask & GR_GC_MASK_LINEWIDTH) && (vp->linewidth != values->linewidth ||
+	    vp->capstyle != values->capstyle || vp->joinstyle != values->joinstyle)) {
+		vp->linewidth = values->linewidth;
+		vp->capstyle = values->capstyle;
+		vp->joinstyle = values->joinstyle;
+		changed |= GR_GC_MASK_LINEWIDTH;
+	}
+	if ((mask & GR_GC_MASK_FILLMODE) && vp->fillmode != values->fillmode) {
+		vp->fillmode = values->fillmode;
+		changed |= GR_GC_MASK_FILLMODE;
+	}
+	if ((mask & GR_GC_MASK_TSOFFSET) && (vp->ts_xoff != values->ts_xoff ||
+	    vp->ts_yoff != values->ts_yoff)) {
+		vp->ts_xoff = values->ts_xoff;
+		vp->ts_yoff = values->ts_yoff;
+		changed |= GR_GC_MASK_TSOFFSET;
+	}
+	if ((mask & GR_GC_MASK_CLIPORIGIN) && (vp->xoff != values->xoff ||
+	    vp->yoff != values->yoff)) {
+		vp->xoff = values->xoff;
+		vp->yoff = values->yoff;
+		changed |= GR_GC_MASK_CLIPORIGIN;
+	}
+	return changed;
+}
+
 /**
  * Creates a new graphics context structure. The structure is initialised
  * with a set of default parameters.
@@ -1442,6 +1673,7 @@ GrNewGC(void)
 	AllocReq(NewGC);
 	if(TypedReadBlock(&gc, sizeof(gc),GrNumNewGC) == -1)
 		gc = 0;
+	AddGCShadow(gc, &gcdefaults);
 	UNLOCK(&nxGlobalLock);
 	return gc;
 }
@@ -1466,6 +1698,11 @@ GrCopyGC(GR_GC_ID gc)
 	req->gcid = gc;
 	if(TypedReadBlock(&newgc, sizeof(newgc),GrNumCopyGC) == -1)
 		newgc = 0;
+	else {
+		GCSHADOW *sp = FindGCShadow(gc);
+		if (sp)
+			AddGCShadow(newgc, &sp->values);
+	}
 	UNLOCK(&nxGlobalLock);
 	return newgc;
 }
@@ -1485,6 +1722,7 @@ GrDestroyGC(GR_GC_ID gc)
 	LOCK(&nxGlobalLock);
 	req = AllocReq(DestroyGC);
 	req->gcid = gc;
+	FreeGCShadow(gc);
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -1685,12 +1923,18 @@ void
 GrSetGCClipOrigin(GR_GC_ID gc, int xoff, int yoff)
 {
 	nxSetGCClipOriginReq *req;
+	GR_GC_VALUES values;
+
+	values.xoff = xoff;
+	values.yoff = yoff;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCClipOrigin);
-	req->gcid = gc;
-	req->xoff = xoff;
-	req->yoff = yoff;
+	if (UpdateGCShadow(gc, GR_GC_MASK_CLIPORIGIN, &values)) {
+		req = AllocReq(SetGCClipOrigin);
+		req->gcid = gc;
+		req->xoff = xoff;
+		req->yoff = yoff;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -1707,11 +1951,16 @@ void
 GrSetGCGraphicsExposure(GR_GC_ID gc, GR_BOOL exposure)
 {
 	nxSetGCGraphicsExposureReq *req;
+	GR_GC_VALUES values;
+
+	values.exposure = exposure;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCGraphicsExposure);
-	req->gcid = gc;
-	req->exposure = exposure;
+	if (UpdateGCShadow(gc, GR_GC_MASK_EXPOSURE, &values)) {
+		req = AllocReq(SetGCGraphicsExposure);
+		req->gcid = gc;
+		req->exposure = exposure;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2252,11 +2501,17 @@ void
 GrSetGCForeground(GR_GC_ID gc, GR_COLOR foreground)
 {
 	nxSetGCForegroundReq *req;
+	GR_GC_VALUES values;
+
+	values.foreground = foreground;
+	values.fgispixelval = GR_FALSE;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCForeground);
-	req->gcid = gc;
-	req->color = foreground;
+	if (UpdateGCShadow(gc, GR_GC_MASK_FOREGROUND, &values)) {
+		req = AllocReq(SetGCForeground);
+		req->gcid = gc;
+		req->color = foreground;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2273,11 +2528,17 @@ void
 GrSetGCBackground(GR_GC_ID gc, GR_COLOR background)
 {
 	nxSetGCBackgroundReq *req;
+	GR_GC_VALUES values;
+
+	values.background = background;
+	values.bgispixelval = GR_FALSE;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCBackground);
-	req->gcid = gc;
-	req->color = background;
+	if (UpdateGCShadow(gc, GR_GC_MASK_BACKGROUND, &values)) {
+		req = AllocReq(SetGCBackground);
+		req->gcid = gc;
+		req->color = background;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2295,11 +2556,17 @@ void
 GrSetGCForegroundPixelVal(GR_GC_ID gc, GR_PIXELVAL foreground)
 {
 	nxSetGCForegroundPixelValReq *req;
+	GR_GC_VALUES values;
+
+	values.foreground = foreground;
+	values.fgispixelval = GR_TRUE;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCForegroundPixelVal);
-	req->gcid = gc;
-	req->pixelval = foreground;
+	if (UpdateGCShadow(gc, GR_GC_MASK_FOREGROUND, &values)) {
+		req = AllocReq(SetGCForegroundPixelVal);
+		req->gcid = gc;
+		req->pixelval = foreground;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2317,11 +2584,17 @@ void
 GrSetGCBackgroundPixelVal(GR_GC_ID gc, GR_PIXELVAL background)
 {
 	nxSetGCBackgroundPixelValReq *req;
+	GR_GC_VALUES values;
+
+	values.background = background;
+	values.bgispixelval = GR_TRUE;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCBackgroundPixelVal);
-	req->gcid = gc;
-	req->pixelval = background;
+	if (UpdateGCShadow(gc, GR_GC_MASK_BACKGROUND, &values)) {
+		req = AllocReq(SetGCBackgroundPixelVal);
+		req->gcid = gc;
+		req->pixelval = background;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2338,11 +2611,16 @@ void
 GrSetGCMode(GR_GC_ID gc, int mode)
 {
 	nxSetGCModeReq *req;
+	GR_GC_VALUES values;
+
+	values.mode = mode;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCMode);
-	req->gcid = gc;
-	req->mode = mode;
+	if (UpdateGCShadow(gc, GR_GC_MASK_MODE, &values)) {
+		req = AllocReq(SetGCMode);
+		req->gcid = gc;
+		req->mode = mode;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2358,11 +2636,56 @@ void
 GrSetGCLineAttributes(GR_GC_ID gc, int linestyle)
 {
 	nxSetGCLineAttributesReq *req;
+	GR_GC_VALUES values;
+
+	values.linestyle = linestyle;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCLineAttributes);
-	req->gcid = gc;
-	req->linestyle = linestyle;
+	if (UpdateGCShadow(gc, GR_GC_MASK_LINESTYLE, &values)) {
+		req = AllocReq(SetGCLineAttributes);
+		req->gcid = gc;
+		req->linestyle = linestyle;
+	}
+	UNLOCK(&nxGlobalLock);
+}
+
+/**
+ * Sets the line style, width, cap and join style of the specified
+ * graphics context. Lines wider than one pixel are drawn by the server
+ * with the given cap style at their ends and join style between the
+ * segments of a polyline or polygon. A width of 0 or 1 draws thin lines.
+ *
+ * @param gc         the ID of the graphics context to set the line attributes of
+ * @param linewidth  the line width in pixels
+ * @param linestyle  GR_LINE_SOLID or GR_LINE_ONOFF_DASH
+ * @param capstyle   GR_CAP_BUTT, GR_CAP_ROUND or GR_CAP_SQUARE
+ * @param joinstyle  GR_JOIN_MITER, GR_JOIN_ROUND or GR_JOIN_BEVEL
+ *
+ * @ingroup nanox_draw
+ */
+void 
+GrSetGCLineAttributesEx(GR_GC_ID gc, GR_SIZE linewidth, int linestyle,
+	int capstyle, int joinstyle)
+{
+	nxSetGCLineAttributesExReq *req;
+	GR_GC_VALUES values;
+	unsigned long changed;
+
+	values.linestyle = linestyle;
+	values.linewidth = linewidth;
+	values.capstyle = capstyle;
+	values.joinstyle = joinstyle;
+
+	LOCK(&nxGlobalLock);
+	changed = UpdateGCShadow(gc, GR_GC_MASK_LINESTYLE|GR_GC_MASK_LINEWIDTH, &values);
+	if (changed) {
+		req = AllocReq(SetGCLineAttributesEx);
+		req->gcid = gc;
+		req->linewidth = linewidth;
+		req->linestyle = linestyle;
+		req->capstyle = capstyle;
+		req->joinstyle = joinstyle;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2407,11 +2730,16 @@ void
 GrSetGCFillMode(GR_GC_ID gc, int fillmode)
 {
   	nxSetGCFillModeReq *req;
+	GR_GC_VALUES values;
+
+	values.fillmode = fillmode;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCFillMode);
-	req->gcid = gc;
-	req->fillmode = fillmode;
+	if (UpdateGCShadow(gc, GR_GC_MASK_FILLMODE, &values)) {
+		req = AllocReq(SetGCFillMode);
+		req->gcid = gc;
+		req->fillmode = fillmode;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2484,12 +2812,18 @@ void
 GrSetGCTSOffset(GR_GC_ID gc, int xoff, int yoff)
 {
 	nxSetGCTSOffsetReq *req;
+	GR_GC_VALUES values;
+
+	values.ts_xoff = xoff;
+	values.ts_yoff = yoff;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCTSOffset);
-	req->gcid = gc;
-	req->xoffset = xoff;
-	req->yoffset = yoff;
+	if (UpdateGCShadow(gc, GR_GC_MASK_TSOFFSET, &values)) {
+		req = AllocReq(SetGCTSOffset);
+		req->gcid = gc;
+		req->xoffset = xoff;
+		req->yoffset = yoff;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 #endif
@@ -2508,11 +2842,16 @@ void
 GrSetGCUseBackground(GR_GC_ID gc, GR_BOOL flag)
 {
 	nxSetGCUseBackgroundReq *req;
+	GR_GC_VALUES values;
+
+	values.usebackground = flag;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCUseBackground);
-	req->gcid = gc;
-	req->flag = flag;
+	if (UpdateGCShadow(gc, GR_GC_MASK_USEBACKGROUND, &values)) {
+		req = AllocReq(SetGCUseBackground);
+		req->gcid = gc;
+		req->flag = flag;
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2749,11 +3088,43 @@ void
 GrSetGCFont(GR_GC_ID gc, GR_FONT_ID font)
 {
 	nxSetGCFontReq *req;
+	GR_GC_VALUES values;
+
+	values.font = font;
 
 	LOCK(&nxGlobalLock);
-	req = AllocReq(SetGCFont);
-	req->gcid = gc;
-	req->fontid = font;
+	if (UpdateGCShadow(gc, GR_GC_MASK_FONT, &values)) {
+		req = AllocReq(SetGCFont);
+		req->gcid = gc;
+		req->fontid = font;
+	}
+	UNLOCK(&nxGlobalLock);
+}
+
+/**
+ * Changes several values of the specified graphics context in a single
+ * request.  Only the values selected by the mask bits are used, and values
+ * that wouldn't change a graphics context created by this client aren't sent.
+ *
+ * @param gc  the ID of the graphics context to change
+ * @param mask  GR_GC_MASK_* bits selecting the values to change
+ * @param values  the new graphics context values
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrChangeGC(GR_GC_ID gc, unsigned long mask, GR_GC_VALUES *values)
+{
+	nxChangeGCReq *req;
+
+	LOCK(&nxGlobalLock);
+	mask = UpdateGCShadow(gc, mask & GR_GC_MASK_ALL, values);
+	if (mask) {
+		req = AllocReqExtra(ChangeGC, sizeof(GR_GC_VALUES));
+		req->gcid = gc;
+		req->mask = mask;
+		memcpy(GetReqData(req), values, sizeof(GR_GC_VALUES));
+	}
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -2907,6 +3278,77 @@ GrFillEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	UNLOCK(&nxGlobalLock);
 }
 
+/**
+ * Draws the boundary of a rectangle with rounded corners at the specified
+ * position using the specified dimensions and graphics context on the
+ * specified drawable.  The corners are quarter ellipses, and the boundary
+ * is drawn with the line width of the graphics context.
+ *
+ * @param id  the ID of the drawable to draw the rectangle on
+ * @param gc  the ID of the graphics context to use when drawing the rectangle
+ * @param x  the X coordinate of the rectangle relative to the drawable
+ * @param y  the Y coordinate of the rectangle relative to the drawable
+ * @param width  the width of the rectangle
+ * @param height  the height of the rectangle
+ * @param rx  the radius of the corners on the X axis
+ * @param ry  the radius of the corners on the Y axis
+ *
+ * @ingroup nanox_draw
+ */
+void 
+GrRoundRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
+	GR_SIZE height, GR_SIZE rx, GR_SIZE ry)
+{
+	nxRoundRectReq *req;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(RoundRect);
+	req->drawid = id;
+	req->gcid = gc;
+	req->x = x;
+	req->y = y;
+	req->width = width;
+	req->height = height;
+	req->rx = rx;
+	req->ry = ry;
+	UNLOCK(&nxGlobalLock);
+}
+
+/**
+ * Draws a filled rectangle with rounded corners at the specified position
+ * using the specified dimensions and graphics context on the specified
+ * drawable.  The corners are quarter ellipses.
+ *
+ * @param id  the ID of the drawable to draw the rectangle on
+ * @param gc  the ID of the graphics context to use when drawing the rectangle
+ * @param x  the X coordinate of the rectangle relative to the drawable
+ * @param y  the Y coordinate of the rectangle relative to the drawable
+ * @param width  the width of the rectangle
+ * @param height  the height of the rectangle
+ * @param rx  the radius of the corners on the X axis
+ * @param ry  the radius of the corners on the Y axis
+ *
+ * @ingroup nanox_draw
+ */
+void 
+GrFillRoundRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
+	GR_SIZE height, GR_SIZE rx, GR_SIZE ry)
+{
+	nxFillRoundRectReq *req;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(FillRoundRect);
+	req->drawid = id;
+	req->gcid = gc;
+	req->x = x;
+	req->y = y;
+	req->width = width;
+	req->height = height;
+	req->rx = rx;
+	req->ry = ry;
+	UNLOCK(&nxGlobalLock);
+}
+
 #if MW_FEATURE_SHAPES
 /**
  * Draws an arc with the specified dimensions at the specified position
@@ -3188,6 +3630,122 @@ GrLoadImageFromFile(char *path, int flags)
 	UNLOCK(&nxGlobalLock);
 	return imageid;
 }
+
+/**
+ * Loads the specified image file into a newly created server image buffer,
+ * decoding it at reduced size when the image is larger than width x height.
+ * JPEG images are decoded using DCT scaling at 1/2, 1/4 or 1/8 size and
+ * PNG images are downscaled row by row while decoding, so a large photo
+ * can be loaded as a thumbnail without the server allocating the full
+ * size image.  The returned image is never smaller than width x height,
+ * but may be larger; use GrDrawImageToFit to display it at an exact size.
+ *
+ * @param path  string containing the filename of the image to load
+ * @param width  desired minimum image width, or -1 for full size
+ * @param height  desired minimum image height, or -1 for full size
+ * @param flags  flags specific to the particular image loader
+ * @return ID of the image buffer the image was loaded into
+ *
+ * @ingroup nanox_image
+ */
+GR_IMAGE_ID
+GrLoadImageFromFileScaled(char *path, GR_SIZE width, GR_SIZE height, int flags)
+{
+	nxLoadImageFromFileScaledReq *req;
+	GR_IMAGE_ID		imageid;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReqExtra(LoadImageFromFileScaled, strlen(path)+1);
+	req->width = width;
+	req->height = height;
+	req->flags = flags;
+	memcpy(GetReqData(req), path, strlen(path)+1);
+
+	if(TypedReadBlock(&imageid, sizeof(imageid),
+	    GrNumLoadImageFromFileScaled) == -1)
+			imageid = 0;
+	UNLOCK(&nxGlobalLock);
+	return imageid;
+}
+
+/**
+ * Starts loading the specified image file into a server image buffer
+ * without waiting for it to be decoded.  The image is decoded by a server
+ * worker thread, so other clients' drawing and input aren't held up by
+ * large images.  When decoding completes a GR_EVENT_TYPE_IMAGE_LOADED
+ * event is sent to this client with the returned image ID, regardless of
+ * GrSelectEvents; its width and height are 0 if the image couldn't be
+ * loaded.  The image can't be used until the event is received, but may
+ * be freed with GrFreeImage at any time to cancel the load.
+ * If the server has no decode threads, the image is loaded immediately
+ * and the event is queued before this call returns.
+ *
+ * @param path  string containing the filename of the image to load
+ * @param width  desired minimum image width, or -1 for full size
+ * @param height  desired minimum image height, or -1 for full size
+ * @param flags  flags specific to the particular image loader
+ * @return ID of the image buffer the image will be loaded into
+ *
+ * @ingroup nanox_image
+ */
+GR_IMAGE_ID
+GrLoadImageFromFileAsync(char *path, GR_SIZE width, GR_SIZE height, int flags)
+{
+	nxLoadImageFromFileAsyncReq *req;
+	GR_IMAGE_ID		imageid;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReqExtra(LoadImageFromFileAsync, strlen(path)+1);
+	req->width = width;
+	req->height = height;
+	req->flags = flags;
+	memcpy(GetReqData(req), path, strlen(path)+1);
+
+	if(TypedReadBlock(&imageid, sizeof(imageid),
+	    GrNumLoadImageFromFileAsync) == -1)
+			imageid = 0;
+	UNLOCK(&nxGlobalLock);
+	return imageid;
+}
+
+/**
+ * Sets the memory budget of the server's decoded image cache.  Images
+ * drawn with GrDrawImageFromFile are kept decoded, resized and converted
+ * to the screen pixel format, so that later draws of the same file at the
+ * same size are a single blit.  Least recently used images are freed
+ * when the budget is exceeded.
+ *
+ * @param maxbytes  maximum bytes of decoded images to keep, 0 to disable the cache
+ *
+ * @ingroup nanox_image
+ */
+void
+GrSetImageCacheSize(int maxbytes)
+{
+	nxSetImageCacheSizeReq *req;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(SetImageCacheSize);
+	req->maxbytes = maxbytes;
+	UNLOCK(&nxGlobalLock);
+}
+
+/**
+ * Fills in the specified structure with the server's decoded image cache
+ * hit, miss and eviction counts and current memory usage.
+ *
+ * @param stats  pointer to a GR_IMAGE_CACHE_STATS structure
+ *
+ * @ingroup nanox_image
+ */
+void
+GrGetImageCacheStats(GR_IMAGE_CACHE_STATS *stats)
+{
+	LOCK(&nxGlobalLock);
+	AllocReq(GetImageCacheStats);
+	TypedReadBlock(stats, sizeof(GR_IMAGE_CACHE_STATS), GrNumGetImageCacheStats);
+	UNLOCK(&nxGlobalLock);
+}
 #endif /* MW_FEATURE_IMAGES && HAVE_FILEIO*/
 
 #if MW_FEATURE_IMAGES
@@ -3673,6 +4231,147 @@ GrPoints(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 	UNLOCK(&nxGlobalLock);
 }
 
+/**
+ * Draws an open polyline on the specified drawable using the specified
+ * graphics context, connecting each point in the point table to the next.
+ * Unlike GrPoly, each point is drawn only once, so XOR mode lines join
+ * correctly, and the last point isn't drawn if it repeats the first.
+ * Long polylines are split into several requests; in XOR mode the point
+ * joining two requests is drawn twice.
+ *
+ * @param id  the ID of the drawable to draw the polyline onto
+ * @param gc  the ID of the graphics context to use when drawing the polyline
+ * @param count  the number of points in the point table
+ * @param pointtable  pointer to a GR_POINT array which lists the points to connect
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrPolyLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
+{
+	nxPolyLineReq *req;
+	int32_t	size;
+	GR_COUNT n;
+	GR_COUNT max = (MAXREQUESTSZ - sizeof(nxPolyLineReq)) / sizeof(GR_POINT);
+
+	if (count <= 0)
+		return;
+
+	LOCK(&nxGlobalLock);
+	do {
+		/* next request starts with last point of this one*/
+		n = (count > max)? max: count;
+		size = (int32_t)n * sizeof(GR_POINT);
+		req = AllocReqExtra(PolyLine, size);
+		req->drawid = id;
+		req->gcid = gc;
+		memcpy(GetReqData(req), pointtable, size);
+		pointtable += n - 1;
+		count -= n - 1;
+	} while (count > 1);
+	UNLOCK(&nxGlobalLock);
+}
+
+/**
+ * Draws an array of unconnected lines on the specified drawable using
+ * the specified graphics context, in a single request when possible.
+ * Both endpoints of each line are drawn.
+ *
+ * @param id  the ID of the drawable to draw the lines onto
+ * @param gc  the ID of the graphics context to use when drawing the lines
+ * @param count  the number of lines in the segment table
+ * @param segtable  pointer to a GR_SEGMENT array which lists the lines to draw
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrSegments(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_SEGMENT *segtable)
+{
+	nxSegmentsReq *req;
+	int32_t	size;
+	GR_COUNT n;
+	GR_COUNT max = (MAXREQUESTSZ - sizeof(nxSegmentsReq)) / sizeof(GR_SEGMENT);
+
+	LOCK(&nxGlobalLock);
+	while (count > 0) {
+		n = (count > max)? max: count;
+		size = (int32_t)n * sizeof(GR_SEGMENT);
+		req = AllocReqExtra(Segments, size);
+		req->drawid = id;
+		req->gcid = gc;
+		memcpy(GetReqData(req), segtable, size);
+		segtable += n;
+		count -= n;
+	}
+	UNLOCK(&nxGlobalLock);
+}
+
+/**
+ * Draws the boundaries of an array of rectangles on the specified drawable
+ * using the specified graphics context, in a single request when possible.
+ *
+ * @param id  the ID of the drawable to draw the rectangles onto
+ * @param gc  the ID of the graphics context to use when drawing the rectangles
+ * @param count  the number of rectangles in the rectangle table
+ * @param recttable  pointer to a GR_RECT array which lists the rectangles to draw
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	nxRectsReq *req;
+	int32_t	size;
+	GR_COUNT n;
+	GR_COUNT max = (MAXREQUESTSZ - sizeof(nxRectsReq)) / sizeof(GR_RECT);
+
+	LOCK(&nxGlobalLock);
+	while (count > 0) {
+		n = (count > max)? max: count;
+		size = (int32_t)n * sizeof(GR_RECT);
+		req = AllocReqExtra(Rects, size);
+		req->drawid = id;
+		req->gcid = gc;
+		memcpy(GetReqData(req), recttable, size);
+		recttable += n;
+		count -= n;
+	}
+	UNLOCK(&nxGlobalLock);
+}
+
+/**
+ * Fills an array of rectangles on the specified drawable using the
+ * specified graphics context, in a single request when possible.
+ *
+ * @param id  the ID of the drawable to draw the rectangles onto
+ * @param gc  the ID of the graphics context to use when filling the rectangles
+ * @param count  the number of rectangles in the rectangle table
+ * @param recttable  pointer to a GR_RECT array which lists the rectangles to fill
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrFillRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	nxFillRectsReq *req;
+	int32_t	size;
+	GR_COUNT n;
+	GR_COUNT max = (MAXREQUESTSZ - sizeof(nxFillRectsReq)) / sizeof(GR_RECT);
+
+	LOCK(&nxGlobalLock);
+	while (count > 0) {
+		n = (count > max)? max: count;
+		size = (int32_t)n * sizeof(GR_RECT);
+		req = AllocReqExtra(FillRects, size);
+		req->drawid = id;
+		req->gcid = gc;
+		memcpy(GetReqData(req), recttable, size);
+		recttable += n;
+		count -= n;
+	}
+	UNLOCK(&nxGlobalLock);
+}
+
 #if MW_FEATURE_SHAPES
 /**
  * Draws an unfilled polygon on the specified drawable using the specified
@@ -4507,6 +5206,80 @@ GrQueueLength(void)
 	return count;
 }
 
+/**
+ * Returns statistics for this client's event queue in the server.
+ * Repeated mouse motion, update and exposure events are merged into
+ * the last queued event when possible, and events are discarded if
+ * the client lets more than the server limit build up unread.
+ *
+ * @param stats  pointer to structure to receive the queue statistics
+ *
+ * @ingroup nanox_event
+ */
+void
+GrGetEventQueueStats(GR_EVENT_QUEUE_STATS *stats)
+{
+	LOCK(&nxGlobalLock);
+	AllocReq(GetEventQueueStats);
+	TypedReadBlock(stats, sizeof(GR_EVENT_QUEUE_STATS), GrNumGetEventQueueStats);
+	UNLOCK(&nxGlobalLock);
+}
+
+/**
+ * Returns the server's profile for a request type: the number of requests
+ * received, their total size, total and maximum time taken, and a
+ * histogram of request latencies.  Request types are numbered as in
+ * nxproto.h, from 0 up to the first type for which this returns GR_FALSE.
+ * The server must be built with NANOX_PROFILE=1 to keep request profiles.
+ *
+ * @param reqtype  request type number
+ * @param prof  pointer to structure to receive the request profile
+ * @return GR_TRUE on success, GR_FALSE if reqtype is out of range or
+ * the server doesn't support profiling
+ *
+ * @ingroup nanox_misc
+ */
+GR_BOOL
+GrGetRequestProfile(int reqtype, GR_REQUEST_PROFILE *prof)
+{
+	nxGetRequestProfileReq *req;
+	GR_BOOL ret;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(GetRequestProfile);
+	req->reqtype = reqtype;
+	TypedReadBlock(&ret, sizeof(ret), GrNumGetRequestProfile);
+	ReadBlock(prof, sizeof(GR_REQUEST_PROFILE));
+	UNLOCK(&nxGlobalLock);
+	return ret;
+}
+
+/**
+ * Returns the server's request profile for a connected client: the number
+ * of requests received from it, their total size and the time taken.
+ *
+ * @param index  client number, starting at 0
+ * @param prof  pointer to structure to receive the client profile
+ * @return GR_TRUE on success, GR_FALSE if there are no more clients or
+ * the server doesn't support profiling
+ *
+ * @ingroup nanox_misc
+ */
+GR_BOOL
+GrGetClientProfile(int index, GR_CLIENT_PROFILE *prof)
+{
+	nxGetClientProfileReq *req;
+	GR_BOOL ret;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(GetClientProfile);
+	req->index = index;
+	TypedReadBlock(&ret, sizeof(ret), GrNumGetClientProfile);
+	ReadBlock(prof, sizeof(GR_CLIENT_PROFILE));
+	UNLOCK(&nxGlobalLock);
+	return ret;
+}
+
 #if DYNAMICREGIONS
 /**
  * Creates a new region structure, fills it with the region described by the
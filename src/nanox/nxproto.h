@@ -1397,4 +1397,175 @@ typedef struct {
 	IDTYPE	imageid;
 } nxDrawImagePartToFitReq;
 
-#define GrTotalNumCalls         126
+#define GrNumSetImageCacheSize	126
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	UINT32	maxbytes;
+} nxSetImageCacheSizeReq;
+
+#define GrNumGetImageCacheStats	127
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+} nxGetImageCacheStatsReq;
+
+#define GrNumLoadImageFromFileScaled	128
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	INT16	width;
+	INT16	height;
+	INT16	flags;
+	INT16	pad;
+	/*char path[];*/
+} nxLoadImageFromFileScaledReq;
+
+#define GrNumLoadImageFromFileAsync	129
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	INT16	width;
+	INT16	height;
+	INT16	flags;
+	INT16	pad;
+	/*char path[];*/
+} nxLoadImageFromFileAsyncReq;
+
+#define GrNumGetEventQueueStats	130
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+} nxGetEventQueueStatsReq;
+
+#define GrNumGetRequestProfile	131
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	INT16	reqtype;
+	INT16	pad;
+} nxGetRequestProfileReq;
+
+#define GrNumGetClientProfile	132
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	INT16	index;
+	INT16	pad;
+} nxGetClientProfileReq;
+
+#define GrNumPolyLine	133
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*INT16 pointtable[];*/
+} nxPolyLineReq;
+
+#define GrNumSegments	134
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*INT16 segtable[];*/
+} nxSegmentsReq;
+
+#define GrNumRects	135
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*INT16 recttable[];*/
+} nxRectsReq;
+
+#define GrNumFillRects	136
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*INT16 recttable[];*/
+} nxFillRectsReq;
+
+#define GrNumChangeGC	137
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	gcid;
+	UINT32	mask;
+	/*GR_GC_VALUES values;*/
+} nxChangeGCReq;
+
+/*
+ * Returns up to maxevents queued events in one reply: the INT16 count,
+ * then each GR_EVENT followed by any client data.  If block is set and
+ * no events are queued, the reply is sent when the next event arrives.
+ */
+#define GrNumGetEvents	138
+#define MAXEVENTSREPLY	64		/* max events in GrNumGetEvents reply*/
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	UINT16	maxevents;
+	UINT16	block;
+} nxGetEventsReq;
+
+#define GrNumSetGCLineAttributesEx 139
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	gcid;
+	UINT16	linewidth;
+	UINT16	linestyle;
+	UINT16	capstyle;
+	UINT16	joinstyle;
+} nxSetGCLineAttributesExReq;
+
+#define GrNumRoundRect          140
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	INT16	x;
+	INT16	y;
+	INT16	width;
+	INT16	height;
+	INT16	rx;
+	INT16	ry;
+} nxRoundRectReq;
+
+#define GrNumFillRoundRect      141
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	INT16	x;
+	INT16	y;
+	INT16	width;
+	INT16	height;
+	INT16	rx;
+	INT16	ry;
+} nxFillRoundRectReq;
+
+#define GrTotalNumCalls         142
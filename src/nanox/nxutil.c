@@ -77,21 +77,7 @@ GrNewBufferedWindow(GR_WM_PROPS props, const char *title, GR_WINDOW_ID parent,
 void
 GrDrawLines(GR_DRAW_ID w, GR_GC_ID gc, GR_POINT * points, GR_COUNT count)
 {
-	GR_POINT beg, end;
-
-	if (count < 1)
-		return;
-	if (count == 1) {
-		GrPoint(w, gc, points->x, points->y);
-		return;
-	}
-
-	beg = *points++;
-	while (--count > 0) {
-		end = *points++;
-		GrLine(w, gc, beg.x, beg.y, end.x, end.y);
-		beg = end;
-	}
+	GrPolyLine(w, gc, count, points);
 }
 
 /*
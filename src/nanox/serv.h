@@ -142,8 +142,20 @@ LOCK_EXTERN(gr_server_mutex);
 
 #define SERVER_LOCK_DECLARE   LOCK_DECLARE(gr_server_mutex);
 #define SERVER_LOCK_INIT()    LOCK_INIT(&gr_server_mutex)
+#if THREADSAFE
+/*
+ * Threaded apps each have their own engine drawing state (MWTHREADVAR), and
+ * drawing into a pixmap runs holding only that pixmap's lock, so threads
+ * rendering into separate pixmaps draw in parallel.  See GsServerLock.
+ */
+#define SERVER_LOCK()         GsServerLock()
+#define SERVER_UNLOCK()       GsServerUnlock()
+void	GsServerLock(void);
+void	GsServerUnlock(void);
+#else
 #define SERVER_LOCK()         LOCK(&gr_server_mutex)
 #define SERVER_UNLOCK()       UNLOCK(&gr_server_mutex)
+#endif
 
 #else /* !NONETWORK */
 /* The Nano-X server is single threaded, so disable the server-side mutex (for speed). */
@@ -154,6 +166,12 @@ LOCK_EXTERN(gr_server_mutex);
 #define SERVER_UNLOCK()     do {} while(0) /* no-op, but require a ";" */
 #endif /* !NONETWORK*/
 
+#if !(NONETWORK && THREADSAFE)
+/* pixmap drawing is serialized with everything else*/
+#define GsPrepareDrawingUnlocked	GsPrepareDrawing
+#define GsLockPixmap(pp)			do {} while(0)
+#endif
+
 /*
  * Drawing types.
  */
@@ -184,10 +202,23 @@ struct gr_client {
 	GR_CLIENT	*next;		/* the next client in the list */
 	GR_CLIENT	*prev;		/* the previous client in the list */
 	int		waiting_for_event; /* used to implement GrGetNextEvent*/
+	int		waitevents;	/* max events for blocked GrNumGetEvents, 0 if GrGetNextEvent */
 	char		*shm_cmds;
 	int		shm_cmds_size;
 	int		shm_cmds_shmid;
 	int		processid;	/* client process id*/
+	int		eventcount;	/* # events in queue */
+	int		eventhighwater;	/* max # events ever queued */
+	int		eventscoalesced; /* events merged into a queued event */
+	int		eventsdropped;	/* motion events discarded at MAXCLIENTEVENTS */
+	char		*reqbuf;	/* request read buffer, MAXREQUESTSZ bytes */
+	int		reqstart;	/* offset of next request in reqbuf */
+	int		reqend;		/* end of data read into reqbuf */
+#if NANOX_PROFILE
+	uint32_t	profcount;	/* requests received */
+	uint64_t	profbytes;	/* request bytes received */
+	uint64_t	profns;		/* time spent in requests */
+#endif
 };
 
 /*
@@ -219,6 +250,9 @@ struct gr_gc {
         GR_BOOL		exposure;     	/* send expose events on GrCopyArea */
 
         int             linestyle;	/* GR_LINE_SOLID, GR_LINE_ONOFF_DASH */
+        GR_SIZE         linewidth;	/* line width, 0 or 1 for thin lines */
+        int             capstyle;	/* GR_CAP_BUTT, ROUND, SQUARE */
+        int             joinstyle;	/* GR_JOIN_MITER, ROUND, BEVEL */
         unsigned long   dashmask;
         char            dashcount;
    
@@ -232,6 +266,8 @@ struct gr_gc {
         GR_POINT        ts_offset;
 
 	GR_BOOL		changed;	/* graphics context has been changed */
+	MWDRAWCTX	drawctx;	/* engine drawing state for this gc */
+	int		drawpixtype;	/* pixel format drawctx colors are for */
 	GR_CLIENT 	*owner;		/* client that created it */
 	GR_GC		*next;		/* next graphics context */
 };
@@ -293,6 +329,17 @@ struct gr_timer
 };
 #endif /* MW_FEATURE_TIMERS */
 
+/*
+ * Structure to remember images being decoded by GrLoadImageFromFileAsync.
+ */
+typedef struct gr_async_image	GR_ASYNC_IMAGE;
+struct gr_async_image
+{
+	GR_IMAGE_ID	id;		/* image ID returned to client */
+	GR_CLIENT	*owner;		/* client that requested it */
+	GR_ASYNC_IMAGE	*next;
+};
+
 /*
  * Drawable structure.  This structure must be the first
  * elements in a GR_WINDOW or GR_PIXMAP, as GrPrepareWindow
@@ -361,6 +408,11 @@ struct gr_pixmap {
 
 	GR_PIXMAP	*next;		/* next pixmap in list */
 	GR_CLIENT	*owner;		/* client that created it */
+#if NONETWORK && THREADSAFE
+	MWMUTEX		lock;		/* held while drawing without server lock*/
+	GR_PIXMAP	*locknext;	/* next pixmap locked by server lock holder*/
+	GR_BOOL		locked;		/* lock held by server lock holder*/
+#endif
 };
 
 /**
@@ -446,12 +498,41 @@ void		GsDeliverSelectionChangedEvent(GR_WINDOW_ID old_owner, GR_WINDOW_ID new_ow
 #if MW_FEATURE_TIMERS
 void		GsDeliverTimerEvent(GR_CLIENT *client, GR_WINDOW_ID wid, GR_TIMER_ID tid);
 #endif
+void		GsDeliverImageLoadedEvent(GR_CLIENT *client, GR_IMAGE_ID id,
+				GR_SIZE width, GR_SIZE height);
+GR_CLIENT	*GsRemoveAsyncImage(GR_IMAGE_ID id);
+void		GsServiceAsyncImages(void);
+
+/* srvprof.c*/
+#if NANOX_PROFILE
+uint64_t	GsProfileTime(void);
+void		GsProfileRequest(int type, const char *name, long len, uint64_t start,
+				GR_CLIENT *client);
+void		GsInitProfile(void);
+void		GsCheckProfileDump(void);
+/* time a request and charge it to the client that sent it*/
+#define PROFILE_DECLARE(t)	uint64_t t; GR_CLIENT *t##client
+#define PROFILE_START(t)	(t = GsProfileTime(), t##client = curclient)
+#define PROFILE_END(t,type,name,len) GsProfileRequest(type, name, len, t, t##client)
+#else
+#define PROFILE_DECLARE(t)
+#define PROFILE_START(t)
+#define PROFILE_END(t,type,name,len)
+#define GsInitProfile()
+#define GsCheckProfileDump()
+#endif
 
 void		GsCheckMouseWindow(void);
 void		GsCheckFocusWindow(void);
 GR_DRAW_TYPE GsPrepareDrawing(GR_DRAW_ID id, GR_GC_ID gcid, GR_DRAWABLE **retdp);
+#if NONETWORK && THREADSAFE
+GR_DRAW_TYPE GsPrepareDrawingUnlocked(GR_DRAW_ID id, GR_GC_ID gcid, GR_DRAWABLE **retdp);
+void		GsLockPixmap(GR_PIXMAP *pp);
+void		GsUnlockPixmap(GR_PIXMAP *pp);
+#endif
 GR_BOOL		GsCheckOverlap(GR_WINDOW *topwp, GR_WINDOW *botwp);
 GR_EVENT	*GsAllocEvent(GR_CLIENT *client);
+void		GsFreeEvent(GR_CLIENT *client, GR_EVENT_LIST *elp, GR_EVENT_LIST *prevelp);
 GR_WINDOW	*GsFindWindow(GR_WINDOW_ID id);
 GR_PIXMAP 	*GsFindPixmap(GR_WINDOW_ID id);
 GR_GC		*GsFindGC(GR_GC_ID gcid);
@@ -474,6 +555,7 @@ void		GsDropClient(int fd);
 int		GsRead(int fd, void *buf, int c);
 int		GsWrite(int fd, void *buf, int c);
 void		GsHandleClient(int fd);
+int		GsClientHasRequest(GR_CLIENT *client);
 void		GsResetScreenSaver(void);
 void		GsActivateScreenSaver(void *arg);
 void		GrGetNextEventWrapperFinish(int);
@@ -496,8 +578,10 @@ extern	GR_WINDOW	*cachewp;		/* cached window pointer */
 extern  GR_PIXMAP       *cachepp;		/* cached pixmap pointer */
 extern	GR_WINDOW	*listwp;		/* list of all windows */
 extern	GR_PIXMAP	*listpp;		/* list of all pixmaps */
+extern	GR_ASYNC_IMAGE	*list_asyncimage;	/* list of images being decoded */
 extern	GR_WINDOW	*rootwp;		/* root window pointer */
 extern	GR_WINDOW	*clipwp;		/* window clipping is set for */
+extern	GR_GC		*clipgcp;		/* gc whose region clipwp is clipped to */
 extern	GR_WINDOW	*focuswp;		/* focus window for keyboard */
 extern	GR_WINDOW	*mousewp;		/* window mouse is currently in */
 extern	GR_WINDOW	*grabbuttonwp;		/* window grabbed by button */
@@ -44,6 +44,7 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 		return;
 
 	clipwp = wp;
+	clipgcp = NULL;		/* no GC clip region yet, see GsPrepareDrawing*/
 
 	/*
 	 * Start with the rectangle for the complete window.
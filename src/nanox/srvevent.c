@@ -50,6 +50,8 @@ void GsError(GR_ERROR code, GR_ID id)
 
 	/* queue the error event regardless of GrSelectEvents*/
 	ep = (GR_EVENT_ERROR *)GsAllocEvent(curclient);
+	if (ep == NULL)
+		return;
 	ep->type = GR_EVENT_TYPE_ERROR;
 	ep->name[0] = 0;
 	if(curfunc)
@@ -62,13 +64,33 @@ void GsError(GR_ERROR code, GR_ID id)
  * Allocate an event to be passed back to the specified client.
  * The event is already chained onto the event queue, and only
  * needs filling out.  Returns NULL with an error generated if
- * the event cannot be allocated.
+ * the event cannot be allocated.  If the client already has
+ * MAXCLIENTEVENTS events queued, its oldest mouse motion or
+ * position event is discarded to make room.  Other events are
+ * never discarded, so button, key, error and other state changes
+ * are still delivered when there is no motion event to discard.
  */
 GR_EVENT *GsAllocEvent(GR_CLIENT *client)
 {
 	GR_EVENT_LIST	*elp;		/* current element list */
 	GR_CLIENT	*oldcurclient;	/* old current client */
 
+#if MAXCLIENTEVENTS
+	/* don't let a client that isn't reading events fill memory with motion*/
+	if (client->eventcount >= MAXCLIENTEVENTS) {
+		GR_EVENT_LIST *prevelp = NULL;
+
+		for (elp = client->eventhead; elp; prevelp = elp, elp = elp->next) {
+			if (elp->event.type == GR_EVENT_TYPE_MOUSE_MOTION ||
+			    elp->event.type == GR_EVENT_TYPE_MOUSE_POSITION) {
+				GsFreeEvent(client, elp, prevelp);
+				client->eventsdropped++;
+				break;
+			}
+		}
+	}
+#endif
+
 	/*
 	 * Get a new event structure from the free list, or else
 	 * allocate it using malloc.
@@ -101,10 +123,59 @@ GR_EVENT *GsAllocEvent(GR_CLIENT *client)
 	elp->next = NULL;
 	elp->event.type = GR_EVENT_TYPE_NONE;
 
+	if (++client->eventcount > client->eventhighwater)
+		client->eventhighwater = client->eventcount;
+
 	EVENT_UNLOCK(&eventMutex);
 	return &elp->event;
 }
 
+/*
+ * Remove an event from the specified client's event queue and
+ * put it back on the free list.  Prevelp is the event before it
+ * in the queue, or NULL if it is the first.
+ */
+void
+GsFreeEvent(GR_CLIENT *client, GR_EVENT_LIST *elp, GR_EVENT_LIST *prevelp)
+{
+	if (prevelp)
+		prevelp->next = elp->next;
+	else
+		client->eventhead = elp->next;
+	if (client->eventtail == elp)
+		client->eventtail = prevelp;
+	client->eventcount--;
+
+	elp->next = eventfree;
+	eventfree = elp;
+}
+
+#if COALESCE_EVENTS
+/*
+ * Return the last event in the specified client's event queue if
+ * it is of the passed type, so that a new event can be merged into it.
+ * Mouse position events are skipped, as they are always requeued at
+ * the tail and only report the latest position.
+ */
+static GR_EVENT *
+GsGetTailEvent(GR_CLIENT *client, GR_EVENT_TYPE type)
+{
+	GR_EVENT_LIST	*elp;
+	GR_EVENT_LIST	*lastelp = NULL;
+
+	if (client->eventtail && client->eventtail->event.type != GR_EVENT_TYPE_MOUSE_POSITION)
+		lastelp = client->eventtail;
+	else {
+		for (elp = client->eventhead; elp; elp = elp->next)
+			if (elp->event.type != GR_EVENT_TYPE_MOUSE_POSITION)
+				lastelp = elp;
+	}
+	if (lastelp && lastelp->event.type == type)
+		return &lastelp->event;
+	return NULL;
+}
+#endif
+
 /*
  * Update mouse status and issue events on it if necessary.
  * This function doesn't block, but is only called when Poll() returns TRUE
@@ -424,6 +495,27 @@ void GsDeliverMotionEvent(GR_EVENT_TYPE type, int buttons, MWKEYMOD modifiers)
 			 */
 			if (type == GR_EVENT_TYPE_MOUSE_POSITION)
 				GsFreePositionEvent(client, wp->id, subwid);
+#if COALESCE_EVENTS
+			/*
+			 * If the last queued event is motion in the same window
+			 * with the same buttons and modifiers, the client hasn't
+			 * read it yet, so just move it to the latest position.
+			 * Anything queued in between, like a button event, ends
+			 * the merge so event ordering is kept.
+			 */
+			else {
+				ep = (GR_EVENT_MOUSE *) GsGetTailEvent(client, type);
+				if (ep && ep->wid == wp->id && ep->subwid == subwid &&
+				    ep->buttons == buttons && ep->modifiers == modifiers) {
+					ep->rootx = cursorx;
+					ep->rooty = cursory;
+					ep->x = cursorx - wp->x;
+					ep->y = cursory - wp->y;
+					client->eventscoalesced++;
+					continue;
+				}
+			}
+#endif
 
 			ep = (GR_EVENT_MOUSE *) GsAllocEvent(client);
 			if (ep == NULL)
@@ -631,6 +723,31 @@ GsDeliverExposureEvent(GR_WINDOW *wp, GR_COORD x, GR_COORD y,
 
 		GsFreeExposureEvent(ecp->client, wp->id, x, y, width, height);
 
+#if COALESCE_EVENTS
+		/*
+		 * If the last queued event is an exposure for this window and
+		 * the bounding rectangle of both is no larger than their sum,
+		 * as with overlapping or adjacent areas, grow it instead.
+		 */
+		ep = (GR_EVENT_EXPOSURE *) GsGetTailEvent(ecp->client, GR_EVENT_TYPE_EXPOSURE);
+		if (ep && ep->wid == wp->id) {
+			GR_COORD x1 = MWMIN(x, ep->x);
+			GR_COORD y1 = MWMIN(y, ep->y);
+			GR_COORD x2 = MWMAX(x + width, ep->x + ep->width);
+			GR_COORD y2 = MWMAX(y + height, ep->y + ep->height);
+
+			if ((long)(x2 - x1) * (y2 - y1) <=
+			    (long)width * height + (long)ep->width * ep->height) {
+				ep->x = x1;
+				ep->y = y1;
+				ep->width = x2 - x1;
+				ep->height = y2 - y1;
+				ecp->client->eventscoalesced++;
+				continue;
+			}
+		}
+#endif
+
 		ep = (GR_EVENT_EXPOSURE *) GsAllocEvent(ecp->client);
 		if (ep == NULL)
 			continue;
@@ -670,15 +787,7 @@ GsFreeExposureEvent(GR_CLIENT *client, GR_WINDOW_ID wid, GR_COORD x,
 		/*
 		 * Found one, remove it and put it back on the free list.
 		 */
-		if (prevelp)
-			prevelp->next = elp->next;
-		else
-			client->eventhead = elp->next;
-		if (client->eventtail == elp)
-			client->eventtail = prevelp;
-
-		elp->next = eventfree;
-		eventfree = elp;
+		GsFreeEvent(client, elp, prevelp);
 		return;
 	}
 }
@@ -719,6 +828,22 @@ update_again:
 				continue;
 			}
 		}
+#endif
+#if COALESCE_EVENTS
+		/*
+		 * If the last queued event is the same kind of update for this
+		 * window, such as repeated moves while dragging, just update it.
+		 */
+		ep = (GR_EVENT_UPDATE *) GsGetTailEvent(ecp->client,
+			lcount?  GR_EVENT_TYPE_CHLD_UPDATE: GR_EVENT_TYPE_UPDATE);
+		if (ep && ep->utype == utype && ep->wid == wp->id && ep->subwid == id) {
+			ep->x = x;
+			ep->y = y;
+			ep->width = width;
+			ep->height = height;
+			ecp->client->eventscoalesced++;
+			continue;
+		}
 #endif
 		ep = (GR_EVENT_UPDATE *) GsAllocEvent(ecp->client);
 		if (ep == NULL)
@@ -935,15 +1060,7 @@ GsFreePositionEvent(GR_CLIENT *client, GR_WINDOW_ID wid, GR_WINDOW_ID subwid)
 		/*
 		 * Found one, remove it and put it back on the free list.
 		 */
-		if (prevelp)
-			prevelp->next = elp->next;
-		else
-			client->eventhead = elp->next;
-		if (client->eventtail == elp)
-			client->eventtail = prevelp;
-
-		elp->next = eventfree;
-		eventfree = elp;
+		GsFreeEvent(client, elp, prevelp);
 		break;
 	}
 	EVENT_UNLOCK(&eventMutex);
@@ -1104,3 +1221,22 @@ GsDeliverTimerEvent(GR_CLIENT * client, GR_WINDOW_ID wid, GR_TIMER_ID tid)
 		}
 	}
 }
+
+/*
+ * Deliver image loaded event to the client that called GrLoadImageFromFileAsync,
+ * regardless of GrSelectEvents.  Width and height are 0 if the load failed.
+ */
+void
+GsDeliverImageLoadedEvent(GR_CLIENT *client, GR_IMAGE_ID id, GR_SIZE width, GR_SIZE height)
+{
+	GR_EVENT_IMAGE_LOADED *event;
+
+	event = (GR_EVENT_IMAGE_LOADED *) GsAllocEvent(client);
+	if (event == NULL)
+		return;
+
+	event->type = GR_EVENT_TYPE_IMAGE_LOADED;
+	event->id = id;
+	event->width = width;
+	event->height = height;
+}
@@ -92,11 +92,7 @@ GsCheckNextEvent(GR_EVENT *ep, GR_BOOL doCheckEvent)
 #endif
 
 	/* Remove first event from queue*/
-	curclient->eventhead = elp->next;
-	if (curclient->eventtail == elp)
-		curclient->eventtail = NULL;
-	elp->next = eventfree;
-	eventfree = elp;
+	GsFreeEvent(curclient, elp, NULL);
 
 #if NANOWM
 	/* let inline window manager look at event*/
@@ -138,6 +134,21 @@ GrPeekEvent(GR_EVENT *ep)
 	return 1;
 }
 
+/*
+ * Return server event queue statistics for the current client.
+ */
+void
+GrGetEventQueueStats(GR_EVENT_QUEUE_STATS *stats)
+{
+	SERVER_LOCK();
+	stats->count = curclient->eventcount;
+	stats->highwater = curclient->eventhighwater;
+	stats->coalesced = curclient->eventscoalesced;
+	stats->dropped = curclient->eventsdropped;
+	stats->limit = MAXCLIENTEVENTS;
+	SERVER_UNLOCK();
+}
+
 /*
  * Return information about a window id.
  */
@@ -818,6 +829,9 @@ GrNewGC(void)
 	gcp->exposure = GR_TRUE;
 
 	gcp->linestyle = GR_LINE_SOLID;
+	gcp->linewidth = 0;
+	gcp->capstyle = GR_CAP_BUTT;
+	gcp->joinstyle = GR_JOIN_MITER;
 	gcp->fillmode = GR_FILL_SOLID;
 
 	gcp->dashcount = 0;
@@ -834,6 +848,7 @@ GrNewGC(void)
 	gcp->ts_offset.x = 0;
 	gcp->ts_offset.y = 0;
 
+	GdInitDrawContext(&gcp->drawctx);
 	gcp->changed = GR_TRUE;
 	gcp->owner = curclient;
 	gcp->next = listgcp;
@@ -868,6 +883,10 @@ GrDestroyGC(GR_GC_ID gc)
 	}
 	if (gcp == curgcp)
 		curgcp = NULL;
+	if (gcp == clipgcp)
+		clipgcp = NULL;
+	if (gr_drawctx == &gcp->drawctx)
+		GdSetDrawContext(NULL);
 
 	if (listgcp == gcp)
 		listgcp = gcp->next;
@@ -881,6 +900,7 @@ GrDestroyGC(GR_GC_ID gc)
 
 	if (gcp->stipple.bitmap)
 		free(gcp->stipple.bitmap);
+	GdFreeDrawContext(&gcp->drawctx);
 	free(gcp);
 
 	SERVER_UNLOCK();
@@ -919,6 +939,7 @@ GrCopyGC(GR_GC_ID gc)
 	*gcp = *oldgcp;
 	gcp->id = nextgcid++;
 	id = gcp->id;
+	GdInitDrawContext(&gcp->drawctx);
 	gcp->changed = GR_TRUE;
 	gcp->owner = curclient;
 	gcp->next = listgcp;
@@ -1913,6 +1934,10 @@ GsNewPixmap(GR_SIZE width, GR_SIZE height, int format, void *pixels)
 	pp->width = width;
 	pp->height = height;
 	pp->owner = curclient;
+#if NONETWORK && THREADSAFE
+	LOCK_INIT_DYNAMIC(&pp->lock);
+	pp->locked = GR_FALSE;
+#endif
 	pp->next = listpp;
 	listpp = pp;
 
@@ -2375,6 +2400,41 @@ GrSetGCLineAttributes(GR_GC_ID gc, int linestyle)
 	SERVER_UNLOCK();
 }
 
+/*
+ * Set the line style, width, cap and join style.
+ * Lines wider than one pixel are drawn with the cap and join styles.
+ */
+void
+GrSetGCLineAttributesEx(GR_GC_ID gc, GR_SIZE linewidth, int linestyle,
+	int capstyle, int joinstyle)
+{
+	GR_GC *gcp;
+
+	SERVER_LOCK();
+
+	gcp = GsFindGC(gc);
+	if (!gcp) {
+		SERVER_UNLOCK();
+		return;
+	}
+
+	if (linewidth < 0 ||
+	    (linestyle != GR_LINE_SOLID && linestyle != GR_LINE_ONOFF_DASH) ||
+	    capstyle < GR_CAP_BUTT || capstyle > GR_CAP_SQUARE ||
+	    joinstyle < GR_JOIN_MITER || joinstyle > GR_JOIN_BEVEL) {
+		GsError(GR_ERROR_BAD_LINE_ATTRIBUTE, gc);
+		SERVER_UNLOCK();
+		return;
+	}
+	gcp->linewidth = linewidth;
+	gcp->linestyle = linestyle;
+	gcp->capstyle = capstyle;
+	gcp->joinstyle = joinstyle;
+	gcp->changed = GR_TRUE;
+
+	SERVER_UNLOCK();
+}
+
 /*
  * Set the dash mode 
  * A series of numbers are passed indicating the on / off state 
@@ -2589,6 +2649,58 @@ GrSetGCFont(GR_GC_ID gc, GR_FONT_ID font)
 	SERVER_UNLOCK();
 }
 
+/*
+ * Change several graphics context values at once.
+ * Each bit set in mask selects the corresponding GR_GC_VALUES member(s).
+ */
+void
+GrChangeGC(GR_GC_ID gc, unsigned long mask, GR_GC_VALUES *values)
+{
+	SERVER_LOCK();
+
+	if (!GsFindGC(gc)) {
+		SERVER_UNLOCK();
+		return;
+	}
+
+	if (mask & GR_GC_MASK_MODE)
+		GrSetGCMode(gc, values->mode);
+	if (mask & GR_GC_MASK_FOREGROUND) {
+		if (values->fgispixelval)
+			GrSetGCForegroundPixelVal(gc, values->foreground);
+		else GrSetGCForeground(gc, values->foreground);
+	}
+	if (mask & GR_GC_MASK_BACKGROUND) {
+		if (values->bgispixelval)
+			GrSetGCBackgroundPixelVal(gc, values->background);
+		else GrSetGCBackground(gc, values->background);
+	}
+	if (mask & GR_GC_MASK_USEBACKGROUND)
+		GrSetGCUseBackground(gc, values->usebackground);
+	if (mask & GR_GC_MASK_EXPOSURE)
+		GrSetGCGraphicsExposure(gc, values->exposure);
+	if (mask & GR_GC_MASK_FONT)
+		GrSetGCFont(gc, values->font);
+	if (mask & GR_GC_MASK_LINESTYLE)
+		GrSetGCLineAttributes(gc, values->linestyle);
+	if (mask & GR_GC_MASK_LINEWIDTH) {
+		GR_GC *gcp = GsFindGC(gc);
+
+		GrSetGCLineAttributesEx(gc, values->linewidth, gcp->linestyle,
+			values->capstyle, values->joinstyle);
+	}
+#if MW_FEATURE_SHAPES
+	if (mask & GR_GC_MASK_FILLMODE)
+		GrSetGCFillMode(gc, values->fillmode);
+	if (mask & GR_GC_MASK_TSOFFSET)
+		GrSetGCTSOffset(gc, values->ts_xoff, values->ts_yoff);
+#endif
+	if (mask & GR_GC_MASK_CLIPORIGIN)
+		GrSetGCClipOrigin(gc, values->xoff, values->yoff);
+
+	SERVER_UNLOCK();
+}
+
 /*
  * Draw a line in the specified drawable using the specified graphics context.
  */
@@ -2601,7 +2713,7 @@ GrLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x1, GR_COORD y1, GR_COORD x2,
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdLine(dp->psd, dp->x + x1, dp->y + y1, dp->x + x2, dp->y + y2, TRUE);
@@ -2625,7 +2737,7 @@ GrRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdRect(dp->psd, dp->x + x, dp->y + y, width, height);
@@ -2647,7 +2759,7 @@ GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdFillRect(dp->psd, dp->x + x, dp->y + y, width,height);
@@ -2657,6 +2769,133 @@ GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	SERVER_UNLOCK();
 }
 
+/*
+ * Offset an array of points by dx, dy.  Used to relocate points
+ * relative to a window, and to restore the caller's points
+ * afterwards when the server isn't a separate process.
+ */
+static void
+GsOffsetPoints(GR_COUNT count, GR_POINT *pp, GR_COORD dx, GR_COORD dy)
+{
+	for (; count > 0; --count, ++pp) {
+		pp->x += dx;
+		pp->y += dy;
+	}
+}
+
+/* Offset an array of rectangles by dx, dy.*/
+static void
+GsOffsetRects(GR_COUNT count, GR_RECT *rp, GR_COORD dx, GR_COORD dy)
+{
+	for (; count > 0; --count, ++rp) {
+		rp->x += dx;
+		rp->y += dy;
+	}
+}
+
+/*
+ * Draw an open polyline in the specified drawable using the specified
+ * graphics context.  Each point is drawn once, and the last point is
+ * not drawn if it repeats the first, as with XDrawLines.
+ */
+void
+GrPolyLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
+{
+	GR_DRAWABLE	*dp;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		GsOffsetPoints(count, pointtable, dp->x, dp->y);
+		GdPolyLine(dp->psd, count, pointtable, TRUE);
+#if NONETWORK
+		/* don't change the user's arguments*/
+		GsOffsetPoints(count, pointtable, -dp->x, -dp->y);
+#endif
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
+/*
+ * Draw an array of unconnected lines in the specified drawable using
+ * the specified graphics context.  Both endpoints of each line are drawn.
+ */
+void
+GrSegments(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_SEGMENT *segtable)
+{
+	GR_DRAWABLE	*dp;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		/* a segment is a pair of points*/
+		GsOffsetPoints(count * 2, (GR_POINT *)segtable, dp->x, dp->y);
+		GdSegments(dp->psd, count, (MWPOINT *)segtable);
+#if NONETWORK
+		GsOffsetPoints(count * 2, (GR_POINT *)segtable, -dp->x, -dp->y);
+#endif
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
+/*
+ * Draw the boundaries of an array of rectangles in the specified
+ * drawable using the specified graphics context.
+ */
+void
+GrRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	GR_DRAWABLE	*dp;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		GsOffsetRects(count, recttable, dp->x, dp->y);
+		GdRects(dp->psd, count, (MWCLIPRECT *)recttable);	/* same layout as GR_RECT*/
+#if NONETWORK
+		GsOffsetRects(count, recttable, -dp->x, -dp->y);
+#endif
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
+/*
+ * Fill an array of rectangles in the specified drawable using the
+ * specified graphics context.
+ */
+void
+GrFillRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	GR_DRAWABLE	*dp;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		GsOffsetRects(count, recttable, dp->x, dp->y);
+		GdFillRects(dp->psd, count, (MWCLIPRECT *)recttable);	/* same layout as GR_RECT*/
+#if NONETWORK
+		GsOffsetRects(count, recttable, -dp->x, -dp->y);
+#endif
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
 /*
  * Draw the boundary of an ellipse in the specified drawable with
  * the specified graphics context.  Integer only.
@@ -2669,7 +2908,7 @@ GrEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx,
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdEllipse(dp->psd, dp->x + x, dp->y + y, rx, ry, FALSE);
@@ -2691,7 +2930,7 @@ GrFillEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx,
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdEllipse(dp->psd, dp->x + x, dp->y + y, rx, ry, TRUE);
@@ -2701,6 +2940,50 @@ GrFillEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx,
 	SERVER_UNLOCK();
 }
 
+/*
+ * Draw the boundary of a rectangle with rounded corners in the specified
+ * drawable with the specified graphics context.  Integer only.
+ */
+void
+GrRoundRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
+	GR_SIZE height, GR_SIZE rx, GR_SIZE ry)
+{
+	GR_DRAWABLE	*dp;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		GdRoundRect(dp->psd, dp->x + x, dp->y + y, width, height, rx, ry, FALSE);
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
+/*
+ * Fill a rectangle with rounded corners in the specified drawable
+ * using the specified graphics context.  Integer only.
+ */
+void
+GrFillRoundRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
+	GR_SIZE height, GR_SIZE rx, GR_SIZE ry)
+{
+	GR_DRAWABLE	*dp;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		GdRoundRect(dp->psd, dp->x + x, dp->y + y, width, height, rx, ry, TRUE);
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
 #if MW_FEATURE_SHAPES
 /*
  * Draw an arc, pie or ellipse in the specified drawable using
@@ -2715,7 +2998,7 @@ GrArc(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdArc(dp->psd, dp->x + x, dp->y + y, rx, ry, ax, ay, bx, by, type);
@@ -2737,7 +3020,7 @@ GrArcAngle(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdArcAngle(dp->psd, dp->x + x, dp->y + y, rx, ry, angle1, angle2, type);
@@ -2766,7 +3049,7 @@ GrBitmap(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdBitmap(dp->psd, dp->x + x, dp->y + y, width, height, imagebits);
@@ -2819,37 +3102,162 @@ GrDrawImageFromFile(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 GR_IMAGE_ID
 GrLoadImageFromFile(char *path, int flags)
 {
-	GR_PIXMAP 	*pp;
-	PSD			pmd;
-
-	SERVER_LOCK();
+	return GrLoadImageFromFileScaled(path, -1, -1, flags);
+}
 
-	pmd = GdLoadImageFromFile(path, flags);
-	if (!pmd) {
-		SERVER_UNLOCK();
-		return 0;
-	}
+/* add decoded image to pixmap list, frees image on failure*/
+static GR_PIXMAP *
+GsNewImagePixmap(PSD pmd, GR_IMAGE_ID id, GR_CLIENT *owner)
+{
+	GR_PIXMAP 	*pp;
 
 	pp = (GR_PIXMAP *)malloc(sizeof(GR_PIXMAP));
 	if (pp == NULL) {
 		pmd->FreeMemGC(pmd);
 		GsError(GR_ERROR_MALLOC_FAILED, 0);
-		SERVER_UNLOCK();
-		return 0;
+		return NULL;
 	}
 
-	pp->id = nextid++;
+	pp->id = id;
 	pp->psd = pmd;
 	pp->x = 0;
 	pp->y = 0;
 	pp->width = pmd->xvirtres;
 	pp->height = pmd->yvirtres;
-	pp->owner = curclient;
+	pp->owner = owner;
+#if NONETWORK && THREADSAFE
+	LOCK_INIT_DYNAMIC(&pp->lock);
+	pp->locked = GR_FALSE;
+#endif
 	pp->next = listpp;
 	listpp = pp;
+	return pp;
+}
+
+/* load image from file into a pixmap, decoding at reduced size if possible*/
+GR_IMAGE_ID
+GrLoadImageFromFileScaled(char *path, GR_SIZE width, GR_SIZE height, int flags)
+{
+	GR_PIXMAP 	*pp;
+	PSD			pmd;
+
+	SERVER_LOCK();
+
+	pmd = GdLoadImageFromFileScaled(path, width, height, flags);
+	if (!pmd) {
+		SERVER_UNLOCK();
+		return 0;
+	}
+
+	pp = GsNewImagePixmap(pmd, nextid++, curclient);
 
 	SERVER_UNLOCK();
-	return pp->id;
+	return pp? pp->id: 0;
+}
+
+/* remove image from list of images being decoded, return owner or NULL if not found*/
+GR_CLIENT *
+GsRemoveAsyncImage(GR_IMAGE_ID id)
+{
+	GR_ASYNC_IMAGE	*ap;
+	GR_ASYNC_IMAGE	**app;
+	GR_CLIENT	*owner;
+
+	for (app = &list_asyncimage; (ap = *app) != NULL; app = &ap->next) {
+		if (ap->id == id) {
+			*app = ap->next;
+			owner = ap->owner;
+			free(ap);
+			return owner;
+		}
+	}
+	return NULL;
+}
+
+/* async image decode complete, add pixmap and notify client*/
+static void
+GsAsyncImageDone(GR_IMAGE_ID id, PSD pmd)
+{
+	GR_CLIENT	*owner;
+	GR_PIXMAP 	*pp = NULL;
+
+	/* discard image if freed or client gone before decode finished*/
+	if ((owner = GsRemoveAsyncImage(id)) == NULL) {
+		if (pmd)
+			pmd->FreeMemGC(pmd);
+		return;
+	}
+
+	if (pmd)
+		pp = GsNewImagePixmap(pmd, id, owner);
+	if (pp)
+		GsDeliverImageLoadedEvent(owner, id, pp->width, pp->height);
+	else GsDeliverImageLoadedEvent(owner, id, 0, 0);
+}
+
+/* collect images decoded by async decode threads*/
+void
+GsServiceAsyncImages(void)
+{
+	int		id;
+	PSD		pmd;
+
+	while (GdGetAsyncImage(&id, &pmd))
+		GsAsyncImageDone(id, pmd);
+}
+
+/*
+ * Load image from file into a pixmap using a decode thread, returning image id immediately.
+ * GR_EVENT_TYPE_IMAGE_LOADED is sent when the pixmap is ready.
+ */
+GR_IMAGE_ID
+GrLoadImageFromFileAsync(char *path, GR_SIZE width, GR_SIZE height, int flags)
+{
+	GR_ASYNC_IMAGE	*ap;
+	GR_IMAGE_ID	id;
+
+	SERVER_LOCK();
+
+	ap = (GR_ASYNC_IMAGE *)malloc(sizeof(GR_ASYNC_IMAGE));
+	if (ap == NULL) {
+		GsError(GR_ERROR_MALLOC_FAILED, 0);
+		SERVER_UNLOCK();
+		return 0;
+	}
+	id = nextid++;
+	ap->id = id;
+	ap->owner = curclient;
+	ap->next = list_asyncimage;
+	list_asyncimage = ap;
+
+	/* no decode threads, decode now and send event anyway*/
+	if (!GdLoadImageFromFileAsync(id, path, width, height, flags))
+		GsAsyncImageDone(id, GdLoadImageFromFileScaled(path, width, height, flags));
+
+	SERVER_UNLOCK();
+	return id;
+}
+
+/* set decoded image cache memory budget, 0 disables cache*/
+void
+GrSetImageCacheSize(int maxbytes)
+{
+	SERVER_LOCK();
+
+	if (maxbytes < 0)
+		maxbytes = 0;
+	GdSetImageCacheSize(maxbytes);
+
+	SERVER_UNLOCK();
+}
+
+/* return decoded image cache statistics*/
+void
+GrGetImageCacheStats(GR_IMAGE_CACHE_STATS *stats)
+{
+	SERVER_LOCK();
+	GdGetImageCacheStats(stats);
+	SERVER_UNLOCK();
 }
 #endif /* MW_FEATURE_IMAGES && HAVE_FILEIO */
 
@@ -2904,6 +3312,10 @@ GrLoadImageFromBuffer(void *buffer, int size, int flags)
 	pp->width = pmd->xvirtres;
 	pp->height = pmd->yvirtres;
 	pp->owner = curclient;
+#if NONETWORK && THREADSAFE
+	LOCK_INIT_DYNAMIC(&pp->lock);
+	pp->locked = GR_FALSE;
+#endif
 	pp->next = listpp;
 	listpp = pp;
 
@@ -2926,6 +3338,7 @@ GrDrawImagePartToFit(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD dx, GR_COORD dy,
 		SERVER_UNLOCK();
 		return;
 	}
+	GsLockPixmap(pp);
 
 	switch (GsPrepareDrawing(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
@@ -2949,6 +3362,9 @@ GrFreeImage(GR_IMAGE_ID id)
 	pp = GsFindPixmap(id);
 	if (pp)
 		GsDestroyPixmap(pp);
+#if HAVE_FILEIO
+	else GsRemoveAsyncImage(id);	/* cancel async load, image discarded when decoded*/
+#endif
 
 	SERVER_UNLOCK();
 }
@@ -3004,8 +3420,10 @@ GrCopyArea(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 		srcy += swp->y;
 	} else {
 		spp = GsFindPixmap(srcid);
-		if (spp)
-		     srcpsd = spp->psd;
+		if (spp) {
+			GsLockPixmap(spp);
+			srcpsd = spp->psd;
+		}
 	}
 	if (!srcpsd) {
 		SERVER_UNLOCK();
@@ -3081,7 +3499,7 @@ GrArea(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdArea(dp->psd, dp->x + x, dp->y + y, width, height, pixels, pixtype);
@@ -3130,6 +3548,7 @@ GrReadArea(GR_DRAW_ID id,GR_COORD x,GR_COORD y,GR_SIZE width,GR_SIZE height, GR_
 			SERVER_UNLOCK();
 			return;
 		}
+		GsLockPixmap(pp);
 		GdReadArea(pp->psd, x, y, width, height, pixels);
 	}
 
@@ -3148,7 +3567,7 @@ GrPoint(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y)
 
 	SERVER_LOCK();
 
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		GdPoint(dp->psd, dp->x + x, dp->y + y);
@@ -3172,7 +3591,7 @@ GrPoints(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 
 	SERVER_LOCK();
    
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		psd = dp->psd;
@@ -3205,7 +3624,7 @@ GrPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 
 	SERVER_LOCK();
    
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		psd = dp->psd;
@@ -3259,7 +3678,7 @@ GrFillPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 
 	SERVER_LOCK();
    
-	switch (GsPrepareDrawing(id, gc, &dp)) {
+	switch (GsPrepareDrawingUnlocked(id, gc, &dp)) {
 	case GR_DRAW_TYPE_WINDOW:
 	case GR_DRAW_TYPE_PIXMAP:
 		psd = dp->psd;
@@ -3767,8 +4186,10 @@ GrStretchArea(GR_DRAW_ID dstid, GR_GC_ID gc, GR_COORD dx1, GR_COORD dy1, GR_COOR
 		sy2 += swp->y;
 	} else {
 		spp = GsFindPixmap(srcid);
-		if (spp)
+		if (spp) {
+			GsLockPixmap(spp);
 			srcpsd = spp->psd;
+		}
 	}
 	if (!srcpsd) {
 		SERVER_UNLOCK();
@@ -31,6 +31,7 @@ GR_WINDOW	*cachewp;		/* cached window pointer */
 GR_GC		*cachegcp;		/* cached graphics context */
 GR_PIXMAP	*cachepp;               /* cached pixmap */
 GR_PIXMAP	*listpp;                /* List of all pixmaps */
+GR_ASYNC_IMAGE	*list_asyncimage;	/* list of images being decoded */
 GR_WINDOW	*listwp;		/* list of all windows */
 GR_WINDOW	*rootwp;		/* root window pointer */
 GR_GC		*listgcp;		/* list of all gc */
@@ -40,6 +41,7 @@ GR_CURSOR	*listcursorp;		/* list of all cursors */
 GR_CURSOR	*stdcursor;		/* root window cursor */
 GR_GC		*curgcp;		/* currently enabled gc */
 GR_WINDOW	*clipwp;		/* window clipping is set for */
+GR_GC		*clipgcp;		/* gc whose region clipwp is clipped to */
 GR_WINDOW	*focuswp;		/* focus window for keyboard */
 GR_WINDOW	*mousewp;		/* window mouse is currently in */
 GR_WINDOW	*grabbuttonwp;		/* window grabbed by button */
@@ -60,6 +62,7 @@ char		*current_shm_cmds;
 int			current_shm_cmds_size;
 static int	keyb_fd;		/* the keyboard file descriptor */
 static int	mouse_fd;		/* the mouse file descriptor */
+static int	async_fd = -1;		/* async image decode completion descriptor */
 char		*curfunc;		/* the name of the current server func*/
 GR_BOOL		screensaver_active;	/* time before screensaver activates */
 GR_SELECTIONOWNER selection_owner;	/* the selection owner and typelist */
@@ -213,7 +216,20 @@ GsAcceptClientFd(int i)
 	client->next = NULL;
 	client->prev = NULL;
 	client->waiting_for_event = FALSE;
+	client->waitevents = 0;
 	client->shm_cmds = 0;
+	client->eventcount = 0;
+	client->eventhighwater = 0;
+	client->eventscoalesced = 0;
+	client->eventsdropped = 0;
+	client->reqbuf = NULL;
+	client->reqstart = 0;
+	client->reqend = 0;
+#if NANOX_PROFILE
+	client->profcount = 0;
+	client->profbytes = 0;
+	client->profns = 0;
+#endif
 
 	if(connectcount++ == 0)
 		root_client = client;
@@ -361,16 +377,41 @@ GsPumpEvents(void)
 }
 #endif
 
+#if !NONETWORK
+/*
+ * Handle requests from clients with input ready in rfds, or
+ * remaining in their request buffer.  rfds is NULL after a timeout.
+ */
+static void
+GsHandleClients(fd_set *rfds)
+{
+	GR_CLIENT *curclient_next;
+
+	curclient = root_client;
+	while (curclient)
+	{
+		/* curclient may be freed in GsDropClient*/
+		curclient_next = curclient->next;
+		if((rfds && FD_ISSET(curclient->id, rfds)) || GsClientHasRequest(curclient))
+			GsHandleClient(curclient->id);
+		curclient = curclient_next;
+	}
+}
+#endif
+
 void
 GsSelect(GR_TIMEOUT timeout)
 {
 	fd_set	rfds;
+	fd_set	wfds;
 	int 	e;
 	int	setsize = 0;
 	struct timeval tout;
 	struct timeval *to;
 #if NONETWORK
 	int	fd;
+#else
+	int	pending = FALSE;	/* client has buffered requests*/
 #endif
 
 #if CONFIG_ARCH_PC98
@@ -412,6 +453,7 @@ GsSelect(GR_TIMEOUT timeout)
 
 	/* Set up the FDs for use in the main select(): */
 	FD_ZERO(&rfds);
+	FD_ZERO(&wfds);
 	if(mouse_fd >= 0)
 	{
 		FD_SET(mouse_fd, &rfds);
@@ -424,6 +466,12 @@ GsSelect(GR_TIMEOUT timeout)
 		if (keyb_fd > setsize)
 			setsize = keyb_fd;
 	}
+	if(async_fd >= 0)
+	{
+		FD_SET(async_fd, &rfds);
+		if (async_fd > setsize)
+			setsize = async_fd;
+	}
 #if NONETWORK
 	/* handle registered input file descriptors*/
 	for (fd = 0; fd < regfdmax; fd++)
@@ -446,11 +494,17 @@ GsSelect(GR_TIMEOUT timeout)
 			GrGetNextEventWrapperFinish(curclient->id);
 			return;
 		}
+		if(GsClientHasRequest(curclient))
+			pending = TRUE;
 		FD_SET(curclient->id, &rfds);
 		if(curclient->id > setsize) setsize = curclient->id;
 		curclient = curclient->next;
 	}
 #endif /* NONETWORK */
+#if MW_FEATURE_RFBSERVER
+	/* handle VNC viewer connections*/
+	setsize = GdRFBPrepareSelect(setsize, &rfds, &wfds);
+#endif
 
 #if CONFIG_ARCH_PC98
 	if (timeout == GR_TIMEOUT_BLOCK)
@@ -478,6 +532,14 @@ GsSelect(GR_TIMEOUT timeout)
 			to = NULL;			/* no timers, block*/
 		}
 	}
+#if !NONETWORK
+	/* don't block if clients have requests left from last GsHandleClient*/
+	if (pending)
+	{
+		to = &tout;
+		tout.tv_sec = tout.tv_usec = 0;
+	}
+#endif
 
 	/* some drivers can't block in select as backend is poll based (SDL)*/
 	if (scrdev.flags & PSF_CANTBLOCK)
@@ -498,10 +560,14 @@ GsSelect(GR_TIMEOUT timeout)
 again:
 	SERVER_UNLOCK();	        /* allow other threads to run*/
 #endif
-	e = select(setsize+1, &rfds, NULL, NULL, to);
+	e = select(setsize+1, &rfds, &wfds, NULL, to);
 #if NONETWORK
 	SERVER_LOCK();
 #endif
+
+	/* print request profile if SIGUSR1 received*/
+	GsCheckProfileDump();
+
 	if(e > 0)			/* input ready*/
 	{
 		/* service mouse file descriptor*/
@@ -514,6 +580,22 @@ again:
 			while(GsCheckKeyboardEvent())
 				continue;
 
+#if MW_FEATURE_IMAGES && HAVE_FILEIO
+		/* add decoded images and send image loaded events*/
+		if(async_fd >= 0 && FD_ISSET(async_fd, &rfds))
+			GsServiceAsyncImages();
+#endif
+
+#if MW_FEATURE_RFBSERVER
+		/* service VNC viewers and any pointer or key input they sent*/
+		if (GdRFBServiceSelect(&rfds, &wfds)) {
+			while(GsCheckMouseEvent())
+				continue;
+			while(GsCheckKeyboardEvent())
+				continue;
+		}
+#endif
+
 #if NONETWORK
 		/* check for input on registered file descriptors */
 		for (fd = 0; fd < regfdmax; fd++)
@@ -536,17 +618,7 @@ again:
 			GsAcceptClient();
 
 		/* If a client is sending us a command, handle it: */
-		curclient = root_client;
-		while (curclient)
-		{
-			GR_CLIENT *curclient_next;
-
-			/* curclient may be freed in GsDropClient*/
-			curclient_next = curclient->next;
-			if(FD_ISSET(curclient->id, &rfds))
-				GsHandleClient(curclient->id);
-			curclient = curclient_next;
-		}
+		GsHandleClients(&rfds);
 #endif /* NONETWORK */
 	} 
 	else if (e == 0)		/* timeout*/
@@ -577,6 +649,9 @@ again:
 		/* check for timer timeouts and service if found*/
 		GdTimeout();
 #endif
+		/* continue clients with buffered requests*/
+		if (pending)
+			GsHandleClients(NULL);
 #endif /* NONETWORK */
 	} /*else if(errno != EINTR)
 		EPRINTF("Select() call in main failed: %d\n", errno);*/
@@ -786,6 +861,11 @@ GrPrepareSelect(int *maxfd, void *rfdset)
 		if (keyb_fd > *maxfd)
 			*maxfd = keyb_fd;
 	}
+	if(async_fd >= 0) {
+		FD_SET(async_fd, rfds);
+		if (async_fd > *maxfd)
+			*maxfd = async_fd;
+	}
 
 	/* handle registered input file descriptors*/
 	for (fd = 0; fd < regfdmax; fd++) {
@@ -797,6 +877,11 @@ GrPrepareSelect(int *maxfd, void *rfdset)
 			*maxfd = fd;
 	}
 
+#if MW_FEATURE_RFBSERVER
+	/* handle VNC viewer connections*/
+	*maxfd = GdRFBPrepareSelect(*maxfd, rfds, NULL);
+#endif
+
 	SERVER_UNLOCK();
 }
 
@@ -832,18 +917,29 @@ GrServiceSelect(void *rfdset, GR_FNCALLBACKEVENT fncb)
 		while(GsCheckKeyboardEvent())
 			continue;
 
+#if MW_FEATURE_IMAGES && HAVE_FILEIO
+	/* If async images have been decoded, queue their events: */
+	if(async_fd >= 0 && FD_ISSET(async_fd, rfds))
+		GsServiceAsyncImages();
+#endif
+
+#if MW_FEATURE_RFBSERVER
+	/* If VNC viewers sent pointer or key input, service it: */
+	if (GdRFBServiceSelect(rfds, NULL)) {
+		while(GsCheckMouseEvent())
+			continue;
+		while(GsCheckKeyboardEvent())
+			continue;
+	}
+#endif
+
 	/* Dispatch all queued events */
 	while((elp = curclient->eventhead) != NULL) {
 
 		ev = elp->event;
 
 		/* Remove first event from queue*/
-		curclient->eventhead = elp->next;
-		if (curclient->eventtail == elp)
-			curclient->eventtail = NULL;
-
-		elp->next = eventfree;
-		eventfree = elp;
+		GsFreeEvent(curclient, elp, NULL);
 
 		fncb(&ev);
 	}
@@ -943,6 +1039,9 @@ GsInitialize(void)
 #if HAVE_SIGNAL
 	/* catch terminate signal to restore tty state*/
 	signal(SIGTERM, (void *)GsTerminate);
+
+	/* catch SIGUSR1 to print request profile*/
+	GsInitProfile();
 #endif
 
 #if MW_FEATURE_TIMERS
@@ -996,6 +1095,16 @@ GsInitialize(void)
 		return -1;
 	}
 
+#if MW_FEATURE_IMAGES
+	/* returns -1 if async image decoding unavailable, images are then decoded synchronously*/
+	async_fd = GdOpenAsyncImage();
+#endif
+
+#if MW_FEATURE_RFBSERVER
+	/* returns -1 if VNC viewers can't connect, server runs without them*/
+	GdOpenRFBServer(psd);
+#endif
+
 	/*
 	 * Create std font.
 	 */
@@ -1098,6 +1207,12 @@ GsTerminate(void)
 	GsCloseSocket();
 #endif
 
+#if MW_FEATURE_IMAGES
+	GdCloseAsyncImage();
+#endif
+#if MW_FEATURE_RFBSERVER
+	GdCloseRFBServer();
+#endif
 	GdCloseScreen(rootwp->psd);
 	GdCloseMouse();
 	GdCloseKeyboard();
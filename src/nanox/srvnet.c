@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #if HAVE_SHAREDMEM_SUPPORT
 #include <sys/types.h>
 #include <sys/ipc.h>
@@ -40,6 +41,7 @@ extern	GR_CLIENT	*root_client;
 extern	int		current_fd;
 
 static int GsWriteType(int,short);
+static void GsWriteEvents(int fd, int maxevents);
 
 /*
  * Wrapper functions called after full packet read
@@ -495,6 +497,7 @@ GrGetNextEventWrapper(void *r)
 #if 1
 	/* tell main loop to call Finish routine on event*/
 	curclient->waiting_for_event = TRUE;
+	curclient->waitevents = 0;
 #else
 	GR_EVENT evt;
 
@@ -524,6 +527,13 @@ GrGetNextEventWrapperFinish(int fd)
 	GR_EVENT evt;
 	GR_EVENT_CLIENT_DATA *cde;
 
+	/* complete blocked GrNumGetEvents*/
+	if(curclient->waitevents) {
+		GsWriteEvents(fd, curclient->waitevents);
+		curclient->waitevents = 0;
+		return;
+	}
+
 	/* get the event and pass it to client*/
 	/* this will never be GR_EVENT_TYPE_NONE*/
 	GrCheckNextEvent(&evt);
@@ -582,7 +592,58 @@ GrPeekEventWrapper(void *r)
 	if (ret == 0) {
 		/* tell main loop to call Finish routine on event*/
 		curclient->waiting_for_event = TRUE;
+		curclient->waitevents = 0;
+	}
+}
+
+static void
+GrGetEventsWrapper(void *r)
+{
+	nxGetEventsReq *req = r;
+
+	if(req->block && !curclient->eventhead) {
+		/* tell main loop to call Finish routine on event*/
+		curclient->waiting_for_event = TRUE;
+		curclient->waitevents = req->maxevents? req->maxevents: 1;
+		return;
 	}
+	GsWriteEvents(current_fd, req->maxevents);
+}
+
+static void
+GrGetEventQueueStatsWrapper(void *r)
+{
+	GR_EVENT_QUEUE_STATS stats;
+
+	GrGetEventQueueStats(&stats);
+	GsWriteType(current_fd, GrNumGetEventQueueStats);
+	GsWrite(current_fd, &stats, sizeof(stats));
+}
+
+static void
+GrGetRequestProfileWrapper(void *r)
+{
+	nxGetRequestProfileReq *req = r;
+	GR_REQUEST_PROFILE prof;
+	GR_BOOL ret;
+
+	ret = GrGetRequestProfile(req->reqtype, &prof);
+	GsWriteType(current_fd, GrNumGetRequestProfile);
+	GsWrite(current_fd, &ret, sizeof(ret));
+	GsWrite(current_fd, &prof, sizeof(prof));
+}
+
+static void
+GrGetClientProfileWrapper(void *r)
+{
+	nxGetClientProfileReq *req = r;
+	GR_CLIENT_PROFILE prof;
+	GR_BOOL ret;
+
+	ret = GrGetClientProfile(req->index, &prof);
+	GsWriteType(current_fd, GrNumGetClientProfile);
+	GsWrite(current_fd, &ret, sizeof(ret));
+	GsWrite(current_fd, &prof, sizeof(prof));
 }
 
 static void
@@ -612,6 +673,46 @@ GrPointsWrapper(void *r)
 	GrPoints(req->drawid, req->gcid, count, (GR_POINT *)GetReqData(req));
 }
 
+static void
+GrPolyLineWrapper(void *r)
+{
+	nxPolyLineReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / sizeof(GR_POINT);
+	GrPolyLine(req->drawid, req->gcid, count, (GR_POINT *)GetReqData(req));
+}
+
+static void
+GrSegmentsWrapper(void *r)
+{
+	nxSegmentsReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / sizeof(GR_SEGMENT);
+	GrSegments(req->drawid, req->gcid, count, (GR_SEGMENT *)GetReqData(req));
+}
+
+static void
+GrRectsWrapper(void *r)
+{
+	nxRectsReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / sizeof(GR_RECT);
+	GrRects(req->drawid, req->gcid, count, (GR_RECT *)GetReqData(req));
+}
+
+static void
+GrFillRectsWrapper(void *r)
+{
+	nxFillRectsReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / sizeof(GR_RECT);
+	GrFillRects(req->drawid, req->gcid, count, (GR_RECT *)GetReqData(req));
+}
+
 static void
 GrRectWrapper(void *r)
 {
@@ -670,6 +771,24 @@ GrFillEllipseWrapper(void *r)
 	GrFillEllipse(req->drawid, req->gcid, req->x, req->y, req->rx, req->ry);
 }
 
+static void
+GrRoundRectWrapper(void *r)
+{
+	nxRoundRectReq *req = r;
+
+	GrRoundRect(req->drawid, req->gcid, req->x, req->y, req->width,
+		req->height, req->rx, req->ry);
+}
+
+static void
+GrFillRoundRectWrapper(void *r)
+{
+	nxFillRoundRectReq *req = r;
+
+	GrFillRoundRect(req->drawid, req->gcid, req->x, req->y, req->width,
+		req->height, req->rx, req->ry);
+}
+
 static void
 GrArcWrapper(void *r)
 {
@@ -748,6 +867,15 @@ GrSetGCLineAttributesWrapper(void *r)
 	GrSetGCLineAttributes(req->gcid, req->linestyle);
 }
 
+static void
+GrSetGCLineAttributesExWrapper(void *r)
+{
+	nxSetGCLineAttributesExReq *req = r;
+
+	GrSetGCLineAttributesEx(req->gcid, req->linewidth, req->linestyle,
+		req->capstyle, req->joinstyle);
+}
+
 static void
 GrSetGCDashWrapper(void *r)
 {
@@ -872,6 +1000,14 @@ GrSetGCFontWrapper(void *r)
 	GrSetGCFont(req->gcid, req->fontid);
 }
 
+static void
+GrChangeGCWrapper(void *r)
+{
+	nxChangeGCReq *req = r;
+
+	GrChangeGC(req->gcid, req->mask, (GR_GC_VALUES *)GetReqData(req));
+}
+
 static void
 GrGetGCTextSizeWrapper(void *r)
 {
@@ -1134,9 +1270,53 @@ GrLoadImageFromFileWrapper(void *r)
 	GsWriteType(current_fd, GrNumLoadImageFromFile);
 	GsWrite(current_fd, &id, sizeof(id));
 }
+
+static void
+GrLoadImageFromFileScaledWrapper(void *r)
+{
+	nxLoadImageFromFileScaledReq *req = r;
+	GR_IMAGE_ID		id;
+
+	id = GrLoadImageFromFileScaled(GetReqData(req), req->width, req->height, req->flags);
+	GsWriteType(current_fd, GrNumLoadImageFromFileScaled);
+	GsWrite(current_fd, &id, sizeof(id));
+}
+
+static void
+GrLoadImageFromFileAsyncWrapper(void *r)
+{
+	nxLoadImageFromFileAsyncReq *req = r;
+	GR_IMAGE_ID		id;
+
+	id = GrLoadImageFromFileAsync(GetReqData(req), req->width, req->height, req->flags);
+	GsWriteType(current_fd, GrNumLoadImageFromFileAsync);
+	GsWrite(current_fd, &id, sizeof(id));
+}
+
+static void
+GrSetImageCacheSizeWrapper(void *r)
+{
+	nxSetImageCacheSizeReq *req = r;
+
+	GrSetImageCacheSize(req->maxbytes);
+}
+
+static void
+GrGetImageCacheStatsWrapper(void *r)
+{
+	GR_IMAGE_CACHE_STATS stats;
+
+	GrGetImageCacheStats(&stats);
+	GsWriteType(current_fd, GrNumGetImageCacheStats);
+	GsWrite(current_fd, &stats, sizeof(stats));
+}
 #else /* if ! (MW_FEATURE_IMAGES && HAVE_FILEIO) */
 #define GrDrawImageFromFileWrapper GrNotImplementedWrapper
 #define GrLoadImageFromFileWrapper GrNotImplementedWrapper
+#define GrSetImageCacheSizeWrapper GrNotImplementedWrapper
+#define GrGetImageCacheStatsWrapper GrNotImplementedWrapper
+#define GrLoadImageFromFileScaledWrapper GrNotImplementedWrapper
+#define GrLoadImageFromFileAsyncWrapper GrNotImplementedWrapper
 #endif
 
 #if MW_FEATURE_IMAGES
@@ -1800,6 +1980,22 @@ static const struct GrFunction GrFunctions[] = {
 	/* 123 */ {GrCreateFontFromBufferWrapper, "GrCreateFontFromBuffer"},
 	/* 124 */ {GrCopyFontWrapper, "GrCopyFont"},
 	/* 125 */ {GrDrawImagePartToFitWrapper, "GrDrawImagePartToFit"},
+	/* 126 */ {GrSetImageCacheSizeWrapper, "GrSetImageCacheSize"},
+	/* 127 */ {GrGetImageCacheStatsWrapper, "GrGetImageCacheStats"},
+	/* 128 */ {GrLoadImageFromFileScaledWrapper, "GrLoadImageFromFileScaled"},
+	/* 129 */ {GrLoadImageFromFileAsyncWrapper, "GrLoadImageFromFileAsync"},
+	/* 130 */ {GrGetEventQueueStatsWrapper, "GrGetEventQueueStats"},
+	/* 131 */ {GrGetRequestProfileWrapper, "GrGetRequestProfile"},
+	/* 132 */ {GrGetClientProfileWrapper, "GrGetClientProfile"},
+	/* 133 */ {GrPolyLineWrapper, "GrPolyLine"},
+	/* 134 */ {GrSegmentsWrapper, "GrSegments"},
+	/* 135 */ {GrRectsWrapper, "GrRects"},
+	/* 136 */ {GrFillRectsWrapper, "GrFillRects"},
+	/* 137 */ {GrChangeGCWrapper, "GrChangeGC"},
+	/* 138 */ {GrGetEventsWrapper, "GrGetEvents"},
+	/* 139 */ {GrSetGCLineAttributesExWrapper, "GrSetGCLineAttributesEx"},
+	/* 140 */ {GrRoundRectWrapper, "GrRoundRect"},
+	/* 141 */ {GrFillRoundRectWrapper, "GrFillRoundRect"},
 };
 
 void
@@ -1809,8 +2005,10 @@ GrShmCmdsFlushWrapper(void *r)
 	unsigned char 	reply;
 #if HAVE_SHAREDMEM_SUPPORT
 	nxReq 		*pr;
-	int 		length;
+	int 		length, type;
 	unsigned char 	*do_req, *do_req_last;
+	GR_CLIENT	*client = curclient;
+	PROFILE_DECLARE(t);
 
 	if ( current_shm_cmds == 0 || current_shm_cmds_size < req->size ) {
 		/* No or short shm present serverside, bug or mischief */
@@ -1828,8 +2026,15 @@ GrShmCmdsFlushWrapper(void *r)
 	while ( do_req < do_req_last ) {
 		pr = (nxReq *)do_req;
 		length = GetReqAlignedLen(pr);
-		if ( pr->reqType < GrTotalNumCalls ) {
-			GrFunctions[pr->reqType].func(pr);
+		type = pr->reqType;
+		if ( type < GrTotalNumCalls ) {
+			PROFILE_START(t);
+			GrFunctions[type].func(pr);
+			PROFILE_END(t, type, GrFunctions[type].name, length);
+
+			/* shm segment and req are freed if client dropped*/
+			if (curclient != client)
+				return;
 		} else {
 			EPRINTF("nano-X: Error bad shm function!\n");
 		}
@@ -1958,6 +2163,9 @@ GsDestroyClientResources(GR_CLIENT * client)
 {
 	GR_WINDOW     * wp, *nwp;
 	GR_PIXMAP     * pp, *npp;
+#if MW_FEATURE_IMAGES && HAVE_FILEIO
+	GR_ASYNC_IMAGE* ap, *nap;
+#endif
 	GR_GC 	      * gp, *ngp;
 	GR_REGION     * rp, *nrp;
 	GR_FONT       * fp, *nfp;
@@ -2012,6 +2220,17 @@ again:
 		}
 	}
 
+#if MW_FEATURE_IMAGES && HAVE_FILEIO
+	/* forget images still being decoded for client, discarded when decoded*/
+	for(ap=list_asyncimage; ap; ap=nap) {
+		nap = ap->next;
+		if (ap->owner == client) {
+			DPRINTF("  Cancel async image %d\n", ap->id);
+			GsRemoveAsyncImage(ap->id);
+		}
+	}
+#endif
+
 	/* free gc's owned by client*/
 	for(gp=listgcp; gp; gp=ngp) {
 		ngp = gp->next;
@@ -2082,6 +2301,7 @@ again:
 		evp = client->eventhead;
 	}
 	client->eventtail = NULL;
+	client->eventcount = 0;
 }
 
 /*
@@ -2167,6 +2387,7 @@ GsDropClient(int fd)
 
 		if (curclient == client)
 			curclient = root_client;
+		free(client->reqbuf);
 		free(client);	/* Free the structure */
 
 		clipwp = NULL;	/* reset clip window*/
@@ -2222,51 +2443,194 @@ int GsWrite(int fd, void *buf, int c)
 	return 0;
 }
 
+/*
+ * This is a wrapper to writev(), handling partial writes.
+ * The passed iovec array is modified.
+ */
+static int
+GsWritev(int fd, struct iovec *iov, int niov)
+{
+	ssize_t	e;
+
+	while(niov > 0) {
+		e = writev(fd, iov, niov);
+		if(e <= 0) {
+			GsClose(fd);
+			return -1;
+		}
+		while(niov > 0 && e >= (ssize_t)iov->iov_len) {
+			e -= iov->iov_len;
+			iov++;
+			niov--;
+		}
+		if(niov > 0) {
+			iov->iov_base = (char *)iov->iov_base + e;
+			iov->iov_len -= e;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Send a GrNumGetEvents reply of up to maxevents queued events for
+ * curclient with a single writev, and free any client data sent.
+ */
+static void
+GsWriteEvents(int fd, int maxevents)
+{
+	int	i, n, niov;
+	INT16	hdr[2];
+	GR_EVENT_CLIENT_DATA *cde;
+	GR_EVENT evts[MAXEVENTSREPLY];
+	struct iovec iov[MAXEVENTSREPLY*2 + 1];
+
+	if(maxevents < 1)
+		maxevents = 1;
+	if(maxevents > MAXEVENTSREPLY)
+		maxevents = MAXEVENTSREPLY;
+	for(n = 0; n < maxevents; n++) {
+		GrCheckNextEvent(&evts[n]);
+		if(evts[n].type == GR_EVENT_TYPE_NONE)
+			break;
+	}
+
+	hdr[0] = GrNumGetEvents;
+	hdr[1] = n;
+	iov[0].iov_base = hdr;
+	iov[0].iov_len = sizeof(hdr);
+	niov = 1;
+	for(i = 0; i < n; i++) {
+		/* extend previous iovec for consecutive events*/
+		if(niov > 1 && (char *)iov[niov-1].iov_base + iov[niov-1].iov_len == (char *)&evts[i])
+			iov[niov-1].iov_len += sizeof(GR_EVENT);
+		else {
+			iov[niov].iov_base = &evts[i];
+			iov[niov].iov_len = sizeof(GR_EVENT);
+			niov++;
+		}
+		if(evts[i].type == GR_EVENT_TYPE_CLIENT_DATA) {
+			cde = (GR_EVENT_CLIENT_DATA *)&evts[i];
+			if(!cde->data)
+				cde->datalen = 0;
+			else if(cde->datalen) {
+				iov[niov].iov_base = cde->data;
+				iov[niov].iov_len = cde->datalen;
+				niov++;
+			}
+		}
+	}
+
+	GsWritev(fd, iov, niov);
+
+	for(i = 0; i < n; i++) {
+		if(evts[i].type == GR_EVENT_TYPE_CLIENT_DATA) {
+			cde = (GR_EVENT_CLIENT_DATA *)&evts[i];
+			free(cde->data);
+		}
+	}
+}
+
 int GsWriteType(int fd, short type)
 {
 	return GsWrite(fd,&type,sizeof(type));
 }
 
+/*
+ * Return length of next complete request in client read buffer, or 0.
+ * Used by GsSelect to continue clients stopped by MAXCLIENTREQUESTS.
+ */
+int
+GsClientHasRequest(GR_CLIENT *client)
+{
+	long	len;
+
+	if(client->reqend - client->reqstart < sizeof(nxReq))
+		return 0;
+	len = GetReqAlignedLen((nxReq *)&client->reqbuf[client->reqstart]);
+	if(len > MAXREQUESTSZ) {
+		EPRINTF("nano-X: GsHandleClient request too large: %ld > %d\n",
+			len, MAXREQUESTSZ);
+		exit(1);
+	}
+	if(client->reqend - client->reqstart < len)
+		return 0;
+	return len;
+}
+
 /*
  * This function is used to parse and dispatch requests from the clients.
- * Note that the maximum request size is allocated from the stack
- * in this function.
+ * Each call does a single read of all available client data into the
+ * client's request buffer, then dispatches up to MAXCLIENTREQUESTS
+ * complete requests.  Partial requests are kept for the next call.
  */
 void
 GsHandleClient(int fd)
 {
+	GR_CLIENT *client = curclient;
 	nxReq *	req;
 	long	len;
-	char	buf[MAXREQUESTSZ];
+	int	n, type;
+	PROFILE_DECLARE(t);
 
 	current_fd = fd;
 #if HAVE_SHAREDMEM_SUPPORT
 	current_shm_cmds = curclient->shm_cmds;
 	current_shm_cmds_size = curclient->shm_cmds_size;
 #endif
-	/* read request header*/
-	if(GsRead(fd, buf, sizeof(nxReq)))
-		return;
+	/*
+	 * Read only when no complete request is buffered, as we may be
+	 * called to continue a client whose socket has no data.
+	 */
+	if(!GsClientHasRequest(client)) {
+		if(!client->reqbuf && !(client->reqbuf = malloc(MAXREQUESTSZ))) {
+			EPRINTF("nano-X: GsHandleClient no memory\n");
+			GsClose(fd);
+			return;
+		}
 
-#pragma GCC diagnostic ignored "-Wstrict-aliasing"
-	len = GetReqAlignedLen((nxReq *)&buf[0]);
-	if(len > sizeof(nxReq)) {
-		if(len > MAXREQUESTSZ) {
-			EPRINTF("nano-X: GsHandleClient request too large: %ld > %d\n",
-				len, MAXREQUESTSZ);
-			exit(1);
+		/* move partial request to start of buffer*/
+		if(client->reqstart) {
+			client->reqend -= client->reqstart;
+			memmove(client->reqbuf, &client->reqbuf[client->reqstart],
+				client->reqend);
+			client->reqstart = 0;
 		}
-		/* read additional request data*/
-		if(GsRead(fd, &buf[sizeof(nxReq)], len-sizeof(nxReq)))
+
+		n = read(fd, &client->reqbuf[client->reqend],
+			MAXREQUESTSZ - client->reqend);
+		if(n <= 0) {
+			if (n == 0)
+				EPRINTF("nano-X: client closed socket: %d\n", fd);
+			else EPRINTF("nano-X: GsHandleClient read failed %d: %d\n", fd, errno);
+			GsClose(fd);
 			return;
+		}
+		client->reqend += n;
 	}
-	req = (nxReq *)&buf[0];
 
-	if(req->reqType < GrTotalNumCalls) {
-		curfunc = (char *)GrFunctions[req->reqType].name;
-		/*DPRINTF("HandleClient %s\n", curfunc);*/
-		GrFunctions[req->reqType].func(req);
-	} else {
-		EPRINTF("nano-X: GsHandleClient bad function\n");
+	/* dispatch complete requests, the quantum stops one client starving others*/
+	for(n = 0; n < MAXCLIENTREQUESTS; n++) {
+		if((len = GsClientHasRequest(client)) == 0)
+			break;
+		req = (nxReq *)&client->reqbuf[client->reqstart];
+		client->reqstart += len;
+
+		/* req and reqbuf are freed if the request drops the client*/
+		type = req->reqType;
+		if(type < GrTotalNumCalls) {
+			curfunc = (char *)GrFunctions[type].name;
+			/*DPRINTF("HandleClient %s\n", curfunc);*/
+			PROFILE_START(t);
+			GrFunctions[type].func(req);
+			PROFILE_END(t, type, curfunc, len);
+		} else {
+			EPRINTF("nano-X: GsHandleClient bad function\n");
+		}
+
+		/* stop if client dropped by request*/
+		if(curclient != client)
+			return;
 	}
+	if(client->reqstart == client->reqend)
+		client->reqstart = client->reqend = 0;
 }
@@ -98,12 +98,10 @@ GrPeekWaitEvent(GR_EVENT *ep)
 int 
 GrQueueLength(void)
 {
-	int count = 0;
-	GR_EVENT_LIST *elp;
+	int count;
 
 	SERVER_LOCK();
-	for (elp=curclient->eventhead; elp; elp=elp->next)
-		++count;
+	count = curclient->eventcount;
 	SERVER_UNLOCK();
 	return count;
 }
@@ -194,13 +192,7 @@ getevent:
 	while (elp) {
 		if (matchfn(wid, mask, update, &elp->event, arg)) {
 			/* remove event from queue, return it*/
-			if (prevelp == NULL)
-				curclient->eventhead = elp->next;
-			else prevelp->next = elp->next;
-			if (curclient->eventtail == elp)
-				curclient->eventtail = prevelp;
-			elp->next = eventfree;
-			eventfree = elp;
+			GsFreeEvent(curclient, elp, prevelp);
 
 			*ep = elp->event;
 			SERVER_UNLOCK();
@@ -0,0 +1,214 @@
+/*
+ * Nano-X server request profiler.
+ *
+ * When compiled with NANOX_PROFILE=1, GsHandleClient times each request
+ * it dispatches, and the count, bytes, total and maximum time and a
+ * latency histogram are kept for each request type, along with count,
+ * bytes and time totals for each client.
+ *
+ * The profile is printed to stderr when the server receives SIGUSR1,
+ * and can be read by clients using GrGetRequestProfile and
+ * GrGetClientProfile, as the nxtop demo does.
+ *
+ * When compiled out, there is no cost in the request dispatcher and
+ * the query functions return GR_FALSE.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "serv.h"
+#include "nxproto.h"
+
+#if NANOX_PROFILE
+#include <time.h>
+#include <signal.h>
+
+typedef struct {
+	const char *name;		/* request name*/
+	uint32_t	count;		/* number of requests*/
+	uint64_t	maxns;		/* longest request*/
+	uint64_t	bytes;		/* total request bytes*/
+	uint64_t	totalns;	/* total time*/
+	uint32_t	hist[GR_PROFILE_BUCKETS];	/* bucket n counts requests under 2^n us*/
+} REQPROFILE;
+
+extern	GR_CLIENT	*root_client;
+
+static REQPROFILE reqprofile[GrTotalNumCalls];
+static volatile sig_atomic_t profiledump;	/* set by SIGUSR1*/
+
+/* return monotonic time in nanoseconds*/
+uint64_t
+GsProfileTime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Record a request dispatched by GsHandleClient.
+ * Called with the request type and name, length in bytes, the
+ * GsProfileTime when the request started and the requesting client.
+ */
+void
+GsProfileRequest(int type, const char *name, long len, uint64_t start, GR_CLIENT *client)
+{
+	REQPROFILE *rp = &reqprofile[type];
+	uint64_t	ns = GsProfileTime() - start;
+	uint32_t	us = ns / 1000;
+	int			bucket = 0;
+
+	/* bucket n holds latencies under 2^n microseconds*/
+	while (us && bucket < GR_PROFILE_BUCKETS-1) {
+		us >>= 1;
+		bucket++;
+	}
+
+	rp->name = name;
+	rp->count++;
+	rp->bytes += len;
+	rp->totalns += ns;
+	if (ns > rp->maxns)
+		rp->maxns = ns;
+	rp->hist[bucket]++;
+
+	/* client is freed if request was GrClose or the connection dropped*/
+	if (client && client == curclient) {
+		client->profcount++;
+		client->profbytes += len;
+		client->profns += ns;
+	}
+}
+
+/* return latency in microseconds below which pct percent of requests completed*/
+static unsigned long
+GsProfilePercentile(REQPROFILE *rp, int pct)
+{
+	uint32_t	n = 0;
+	uint32_t	want = ((uint64_t)rp->count * pct + 99) / 100;
+	int			i;
+
+	for (i = 0; i < GR_PROFILE_BUCKETS-1; i++) {
+		n += rp->hist[i];
+		if (n >= want)
+			break;
+	}
+	return 1UL << i;
+}
+
+static void
+GsProfileSignal(int sig)
+{
+	profiledump = 1;
+}
+
+/* catch SIGUSR1 to dump profile*/
+void
+GsInitProfile(void)
+{
+	signal(SIGUSR1, GsProfileSignal);
+}
+
+/* print request and client profile to stderr if SIGUSR1 received*/
+void
+GsCheckProfileDump(void)
+{
+	REQPROFILE *rp;
+	GR_CLIENT  *cp;
+	int			i;
+
+	if (!profiledump)
+		return;
+	profiledump = 0;
+
+	fprintf(stderr, "nano-X request profile:\n");
+	fprintf(stderr, "%-28s %9s %11s %9s %9s %7s %7s %10s\n",
+		"request", "count", "bytes", "avg us", "max us", "p50 <us", "p99 <us", "total ms");
+	for (i = 0; i < GrTotalNumCalls; i++) {
+		rp = &reqprofile[i];
+		if (!rp->count)
+			continue;
+		fprintf(stderr, "%-28s %9lu %11llu %9.1f %9.1f %7lu %7lu %10.1f\n",
+			rp->name, (unsigned long)rp->count, (unsigned long long)rp->bytes,
+			rp->totalns / 1000.0 / rp->count, rp->maxns / 1000.0,
+			GsProfilePercentile(rp, 50), GsProfilePercentile(rp, 99),
+			rp->totalns / 1000000.0);
+	}
+
+	fprintf(stderr, "%-8s %8s %9s %11s %10s\n", "client", "pid", "count", "bytes", "total ms");
+	for (cp = root_client; cp; cp = cp->next)
+		fprintf(stderr, "%-8d %8d %9lu %11llu %10.1f\n", cp->id, cp->processid,
+			(unsigned long)cp->profcount, (unsigned long long)cp->profbytes,
+			cp->profns / 1000000.0);
+}
+
+/*
+ * Return profile for a request type.
+ * Returns GR_FALSE if reqtype is out of range or profiling not compiled in.
+ */
+GR_BOOL
+GrGetRequestProfile(int reqtype, GR_REQUEST_PROFILE *prof)
+{
+	REQPROFILE *rp;
+
+	memset(prof, 0, sizeof(*prof));
+	if (reqtype < 0 || reqtype >= GrTotalNumCalls)
+		return GR_FALSE;
+
+	SERVER_LOCK();
+	rp = &reqprofile[reqtype];
+	if (rp->name)
+		strncpy(prof->name, rp->name, sizeof(prof->name)-1);
+	prof->count = rp->count;
+	prof->maxns = rp->maxns;
+	prof->bytes = rp->bytes;
+	prof->totalns = rp->totalns;
+	memcpy(prof->hist, rp->hist, sizeof(prof->hist));
+	SERVER_UNLOCK();
+	return GR_TRUE;
+}
+
+/*
+ * Return profile for the index'th connected client.
+ * Returns GR_FALSE if there aren't that many clients or profiling not compiled in.
+ */
+GR_BOOL
+GrGetClientProfile(int index, GR_CLIENT_PROFILE *prof)
+{
+	GR_CLIENT *cp;
+
+	memset(prof, 0, sizeof(*prof));
+
+	SERVER_LOCK();
+	for (cp = root_client; cp && index > 0; cp = cp->next)
+		index--;
+	if (!cp || index < 0) {
+		SERVER_UNLOCK();
+		return GR_FALSE;
+	}
+	prof->id = cp->id;
+	prof->processid = cp->processid;
+	prof->count = cp->profcount;
+	prof->bytes = cp->profbytes;
+	prof->totalns = cp->profns;
+	SERVER_UNLOCK();
+	return GR_TRUE;
+}
+
+#else /* !NANOX_PROFILE*/
+
+GR_BOOL
+GrGetRequestProfile(int reqtype, GR_REQUEST_PROFILE *prof)
+{
+	memset(prof, 0, sizeof(*prof));
+	return GR_FALSE;
+}
+
+GR_BOOL
+GrGetClientProfile(int index, GR_CLIENT_PROFILE *prof)
+{
+	memset(prof, 0, sizeof(*prof));
+	return GR_FALSE;
+}
+#endif /* NANOX_PROFILE*/
@@ -356,6 +356,14 @@ GsDestroyPixmap(GR_PIXMAP *pp)
 	GR_PIXMAP	*prevpp;
 	PSD			psd = pp->psd;
 
+#if NONETWORK && THREADSAFE
+	/* wait for any thread still drawing into it, none can start with server locked*/
+	GsUnlockPixmap(pp);
+	LOCK(&pp->lock);
+	UNLOCK(&pp->lock);
+	LOCK_FREE(&pp->lock);
+#endif
+
 	/* deallocate mem gc*/
 	psd->FreeMemGC(psd);
 
@@ -658,7 +666,8 @@ GsInitWindowBuffer(GR_WINDOW *wp, GR_SIZE width, GR_SIZE height)
 		GdSetClipRects(pp->psd, 1, &cliprect);
 #endif
 		clipwp = NULL;			/* reset clip cache for next window draw*/
-		curgcp = NULL;			/* invalidate gc cache since we're changing color and mode*/
+		curgcp = NULL;			/* draw with the default context, not the current gc's*/
+		GdSetDrawContext(NULL);
 		GdSetFillMode(GR_FILL_SOLID);
 		GdSetMode(GR_MODE_COPY);
 		GdSetForegroundColor(pp->psd, wp->background);
@@ -748,6 +757,7 @@ GsClearWindow(GR_WINDOW *wp, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE  hei
 
 #if DEBUG_EXPOSE
 curgcp = NULL;
+GdSetDrawContext(NULL);
 GdSetFillMode(GR_FILL_SOLID);
 GdSetMode(GR_MODE_COPY);
 GdSetForegroundColor(wp->psd, MWRGB(255,255,0)); /* yellow*/
@@ -784,6 +794,7 @@ usleep(500000);
 #endif
 
 		curgcp = NULL;
+		GdSetDrawContext(NULL);
 		GdSetFillMode(GR_FILL_SOLID);
 		GdSetMode(GR_MODE_COPY);
 		GdSetForegroundColor(wp->psd, wp->background);
@@ -895,9 +906,11 @@ GsDrawBorder(GR_WINDOW *wp)
 	/* FIXME: window clipregion will fail here */
 	GsSetClipWindow(wp, NULL, 0);
 	curgcp = NULL;
+	GdSetDrawContext(NULL);
 	GdSetMode(GR_MODE_COPY);
 	GdSetForegroundColor(wp->psd, wp->bordercolor);
 	GdSetDash(0, 0);
+	GdSetLineAttributes(0, GR_CAP_BUTT, GR_JOIN_MITER);
 	GdSetFillMode(GR_FILL_SOLID);
 
 	if (bs == 1) {
@@ -1095,6 +1108,23 @@ GsFindCursor(GR_CURSOR_ID cursorid)
 	return NULL;
 }
 
+/*
+ * Return TRUE if the clip region of clipwp must be rebuilt for drawing
+ * with the specified graphics context, because its region or clip
+ * mode may differ from the graphics context the window was clipped for.
+ */
+static GR_BOOL
+GsGCClipChanged(GR_GC *gcp)
+{
+	if (gcp->changed)
+		return GR_TRUE;
+	if (gcp == clipgcp)
+		return GR_FALSE;
+	return !clipgcp || gcp->regionid != clipgcp->regionid ||
+		gcp->xoff != clipgcp->xoff || gcp->yoff != clipgcp->yoff ||
+		((gcp->mode ^ clipgcp->mode) & ~GR_MODE_DRAWMASK);
+}
+
 /*
  * Prepare to do drawing in a window or pixmap using the specified
  * graphics context.  Returns the drawable pointer if successful,
@@ -1117,12 +1147,12 @@ GsPrepareDrawing(GR_DRAW_ID id, GR_GC_ID gcid, GR_DRAWABLE **retdp)
 		return GR_DRAW_TYPE_NONE;
 
 	/*
-	 * If the graphics context is not the current one, then
-	 * make it the current one and remember to update it.
+	 * If the graphics context is not the current one, then make
+	 * its draw context current, which holds the state set for it.
 	 */
 	if (gcp != curgcp) {
 		curgcp = gcp;
-		gcp->changed = GR_TRUE;
+		GdSetDrawContext(&gcp->drawctx);
 	}
 
 	/*
@@ -1167,6 +1197,9 @@ havepixmap:
 #endif
 		/* reset clip cache for next window draw*/
 		clipwp = NULL;
+
+		/* keep threads drawing without the server lock out until unlocked*/
+		GsLockPixmap(pp);
 	} else {
 		if (!wp->output) {
 				GsError(GR_ERROR_INPUT_ONLY_WINDOW, id);
@@ -1184,10 +1217,11 @@ havepixmap:
 				return GR_DRAW_TYPE_NONE;
 
 		/*
-		 * If the window is not the currently clipped one,
-		 * then make it the current one and define its clip rectangles.
+		 * If the window is not the currently clipped one, or the
+		 * gc's region or clip mode differ from those it is clipped
+		 * with, then make it the current one and define its clip rectangles.
 		 */
-		if (wp != clipwp || gcp->changed) {
+		if (wp != clipwp || GsGCClipChanged(gcp)) {
 #if DYNAMICREGIONS
 			/* find user region for intersect*/
 			regionp = gcp->regionid? GsFindRegion(gcp->regionid): NULL;
@@ -1206,14 +1240,16 @@ havepixmap:
 #else
 				GsSetClipWindow(wp, NULL, gcp->mode & ~GR_MODE_DRAWMASK);
 #endif /* DYNAMICREGIONS*/
+			clipgcp = gcp;
 		}
 	}
 
 	/*
-	 * If the graphics context has been changed, then tell the
+	 * If the graphics context has been changed, or its colors were
+	 * set for a drawable of another pixel format, then tell the
 	 * device driver about it.
 	 */
-	if (gcp->changed) {
+	if (gcp->changed || gcp->drawpixtype != (wp ? wp->psd : pp->psd)->pixtype) {
 		PSD			psd = (wp ? wp->psd : pp->psd);
 		uint32_t	mask;
 		int			count;
@@ -1238,6 +1274,7 @@ havepixmap:
 
 		GdSetMode(gcp->mode & GR_MODE_DRAWMASK);
 		GdSetUseBackground(gcp->usebackground);
+		GdSetLineAttributes(gcp->linewidth, gcp->capstyle, gcp->joinstyle);
 		
 #if MW_FEATURE_SHAPES
 		GdSetDash(&mask, &count);
@@ -1254,6 +1291,7 @@ havepixmap:
 			break;
 		}
 #endif
+		gcp->drawpixtype = psd->pixtype;
 		gcp->changed = GR_FALSE;
 	}
 
@@ -1261,6 +1299,130 @@ havepixmap:
 	return wp? GR_DRAW_TYPE_WINDOW: GR_DRAW_TYPE_PIXMAP;
 }
 
+#if NONETWORK && THREADSAFE
+/*
+ * Server locking for threaded applications linked with the server.
+ *
+ * The engine's current draw context and clipping are per thread, so
+ * curgcp and clipwp only describe the state of the last thread that
+ * held the server lock, and are reset when another thread takes it.
+ * SERVER_UNLOCK releases the pixmap lock instead of the server lock
+ * after GsPrepareDrawingUnlocked has exchanged them.  Pixmaps drawn
+ * into or copied from while holding the server lock are also locked, and
+ * unlocked with the outermost SERVER_UNLOCK.  A thread drawing
+ * without the server lock uses its own copy of the GC's draw context,
+ * as other threads may change or free the GC's while it draws.
+ */
+static MWTHREADVAR int lockdepth;			/* server lock nesting in this thread*/
+static MWTHREADVAR unsigned long threadserial;	/* this thread's number, 0 if not yet*/
+static MWTHREADVAR GR_PIXMAP *drawpixmap;	/* pixmap locked instead of server*/
+static MWTHREADVAR MWDRAWCTX drawctx;		/* copy of GC draw context for drawpixmap*/
+static unsigned long lastthreadserial;		/* last thread number assigned*/
+static unsigned long drawthreadserial;		/* thread curgcp and clipwp are valid for*/
+static GR_PIXMAP *lockedpixmaps;			/* pixmaps locked by server lock holder*/
+
+/*
+ * Lock a pixmap until the outermost SERVER_UNLOCK, waiting for any thread
+ * drawing into it without the server lock.  Must hold the server lock.
+ */
+void
+GsLockPixmap(GR_PIXMAP *pp)
+{
+	if (pp->locked)
+		return;
+	LOCK(&pp->lock);
+	pp->locked = GR_TRUE;
+	pp->locknext = lockedpixmaps;
+	lockedpixmaps = pp;
+}
+
+/* unlock a pixmap locked by GsLockPixmap, if it is*/
+void
+GsUnlockPixmap(GR_PIXMAP *pp)
+{
+	GR_PIXMAP **ppp;
+
+	for (ppp = &lockedpixmaps; *ppp; ppp = &(*ppp)->locknext) {
+		if (*ppp == pp) {
+			*ppp = pp->locknext;
+			pp->locked = GR_FALSE;
+			UNLOCK(&pp->lock);
+			return;
+		}
+	}
+}
+
+void
+GsServerLock(void)
+{
+	LOCK(&gr_server_mutex);
+	if (lockdepth++ == 0) {
+		/* thread ids can be reused, so number threads on first lock*/
+		if (!threadserial)
+			threadserial = ++lastthreadserial;
+		if (threadserial != drawthreadserial) {
+			drawthreadserial = threadserial;
+			curgcp = NULL;
+			GdSetDrawContext(NULL);
+			clipwp = NULL;
+		}
+	}
+}
+
+void
+GsServerUnlock(void)
+{
+	if (drawpixmap) {
+		GR_PIXMAP *pp = drawpixmap;
+
+		drawpixmap = NULL;
+		UNLOCK(&pp->lock);
+		GdSetDrawContext(NULL);
+		GdFreeDrawContext(&drawctx);
+		return;
+	}
+	if (--lockdepth == 0) {
+		while (lockedpixmaps)
+			GsUnlockPixmap(lockedpixmaps);
+	}
+	UNLOCK(&gr_server_mutex);
+}
+
+/*
+ * Prepare drawing as GsPrepareDrawing, and if drawing into a pixmap
+ * from the outermost server lock, exchange the server lock for the
+ * pixmap's lock, letting other threads use the server while this one
+ * draws.  Window buffers are composited by the server and are never
+ * unlocked.  The caller must draw only into the returned pixmap using
+ * the engine, then call SERVER_UNLOCK.
+ */
+GR_DRAW_TYPE
+GsPrepareDrawingUnlocked(GR_DRAW_ID id, GR_GC_ID gcid, GR_DRAWABLE **retdp)
+{
+	GR_DRAW_TYPE type;
+	GR_PIXMAP *pp;
+
+	type = GsPrepareDrawing(id, gcid, retdp);
+	if (type == GR_DRAW_TYPE_PIXMAP && lockdepth == 1 && (*retdp)->id == id) {
+		pp = (GR_PIXMAP *)*retdp;
+
+		/* keep the pixmap lock GsPrepareDrawing took, release any others*/
+		LOCK(&pp->lock);
+		while (lockedpixmaps)
+			GsUnlockPixmap(lockedpixmaps);
+		drawpixmap = pp;
+
+		/* draw with a private copy, the GC's context is only safe with the server lock*/
+		GdCopyDrawContext(&drawctx, gr_drawctx);
+		GdSetDrawContext(&drawctx);
+		curgcp = NULL;
+		--lockdepth;
+		UNLOCK(&gr_server_mutex);
+	}
+	return type;
+}
+#endif /* NONETWORK && THREADSAFE*/
+
 /*
  * Prepare the specified window for drawing into it.
  * This sets up the clipping regions to just allow drawing into it.
@@ -42,35 +42,92 @@ static XGCValues initial_GC = {
 	4			/* dashes (list [4,4]) */
 };
 
+/* convert an X11 fill style to NX fill mode*/
+static int
+convertFillStyle(int fill_style)
+{
+	switch (fill_style) {
+	case FillTiled:
+		return GR_FILL_TILE;
+	case FillStippled:
+		return GR_FILL_STIPPLE;
+	case FillOpaqueStippled:
+		return GR_FILL_OPAQUE_STIPPLE;
+	default:
+		return GR_FILL_SOLID;
+	}
+}
+
+/*
+ * Save X values and send those with NX equivalents in a single GrChangeGC,
+ * along with any NX values already set in gv/grmask by the caller.
+ * The NX client library drops values which don't change the GC.
+ */
 static void
-setupGC(Display * dpy, GC gc, unsigned long valuemask, XGCValues * values)
+setupGC(Display * dpy, GC gc, unsigned long valuemask, XGCValues * values,
+	GR_GC_VALUES *gv, unsigned long grmask)
 {
+	XGCValues *vp = (XGCValues *)gc->ext_data;
+
 	if (valuemask & GCFunction)
-		XSetFunction(dpy, gc, values->function);
+		vp->function = values->function;
+	if (valuemask & GCSubwindowMode)
+		vp->subwindow_mode = values->subwindow_mode;
+	if (valuemask & (GCFunction | GCSubwindowMode)) {
+		/* must OR in clip mode with draw mode*/
+		gv->mode = _nxConvertROP(vp->function);
+		if (vp->subwindow_mode == IncludeInferiors)
+			gv->mode |= GR_MODE_EXCLUDECHILDREN;
+		grmask |= GR_GC_MASK_MODE;
+	}
+
+	if (valuemask & GCForeground) {
+		vp->foreground = values->foreground;
+		gv->foreground = _nxColorvalFromPixelval(dpy, values->foreground);
+		gv->fgispixelval = GR_FALSE;
+		grmask |= GR_GC_MASK_FOREGROUND;
+	}
+
+	if (valuemask & GCBackground) {
+		vp->background = values->background;
+		gv->background = _nxColorvalFromPixelval(dpy, values->background);
+		gv->bgispixelval = GR_FALSE;
+		grmask |= GR_GC_MASK_BACKGROUND;
+	}
 
-	if (valuemask & GCForeground)
-		XSetForeground(dpy, gc, values->foreground);
+	if (valuemask & GCFont) {
+		vp->font = values->font;
+		gv->font = values->font;
+		grmask |= GR_GC_MASK_FONT;
+	}
 
-	if (valuemask & GCBackground)
-		XSetBackground(dpy, gc, values->background);
+	if (valuemask & GCGraphicsExposures) {
+		vp->graphics_exposures = values->graphics_exposures;
+		gv->exposure = values->graphics_exposures;
+		grmask |= GR_GC_MASK_EXPOSURE;
+	}
 
-	//FIXME add save gc->ext_data values for each of these...
-	if (valuemask & GCFont)
-		XSetFont(dpy, gc, values->font);
+	if ((valuemask & GCClipXOrigin) && (valuemask & GCClipYOrigin)) {
+		vp->clip_x_origin = values->clip_x_origin;
+		vp->clip_y_origin = values->clip_y_origin;
+		gv->xoff = values->clip_x_origin;
+		gv->yoff = values->clip_y_origin;
+		grmask |= GR_GC_MASK_CLIPORIGIN;
+	}
 
-	if (valuemask & GCGraphicsExposures)
-		XSetGraphicsExposures(dpy, gc, values->graphics_exposures);
+	if (valuemask & GCFillStyle) {
+		vp->fill_style = values->fill_style;
+		gv->fillmode = convertFillStyle(values->fill_style);
+		grmask |= GR_GC_MASK_FILLMODE;
+	}
 
-	if ((valuemask & GCClipXOrigin) && (valuemask & GCClipYOrigin))
-		XSetClipOrigin(dpy, gc, values->clip_x_origin,
-		    values->clip_y_origin);
+	if (grmask)
+		GrChangeGC(gc->gid, grmask, gv);
 
+	/* values without NX equivalents or requiring other requests*/
 	if (valuemask & GCClipMask)
 		XSetClipMask(dpy, gc, values->clip_mask);
 
-	if (valuemask & GCFillStyle)
-		XSetFillStyle(dpy, gc, values->fill_style);
-
 	if ((valuemask & GCTileStipXOrigin) && (valuemask & GCTileStipYOrigin))
 		XSetTSOrigin(dpy, gc, values->ts_x_origin, values->ts_y_origin);
 
@@ -79,9 +136,6 @@ setupGC(Display * dpy, GC gc, unsigned long valuemask, XGCValues * values)
 		XSetLineAttributes(dpy, gc, values->line_width,
 		    values->line_style, values->cap_style, values->join_style);
 
-	if (valuemask & GCFillRule)
-		XSetFillStyle(dpy, gc, values->fill_rule);
-
 	if (valuemask & GCTile)
 		XSetTile(dpy, gc, values->tile);
 
@@ -97,8 +151,8 @@ setupGC(Display * dpy, GC gc, unsigned long valuemask, XGCValues * values)
 		}
 	}
 
-	if (valuemask & GCSubwindowMode)
-		XSetSubwindowMode(dpy, gc, values->subwindow_mode);
+	if (valuemask & GCFillRule)
+		DPRINTF("XCreateGC: GCFillRule not implemented\n");
 
 	if (valuemask & GCPlaneMask)
 		DPRINTF("XCreateGC: GCPlaneMask not implemented\n");
@@ -113,6 +167,8 @@ XCreateGC(Display *dpy, Drawable d, unsigned long valuemask, XGCValues *values)
 {
 	GC gc;
 	XGCValues *vp;
+	XGCValues xv;
+	GR_GC_VALUES gv;
 
 	if ((gc = (GC) Xmalloc(sizeof(struct _XGC))) == NULL)
 		return NULL;
@@ -124,23 +180,31 @@ XCreateGC(Display *dpy, Drawable d, unsigned long valuemask, XGCValues *values)
 	memcpy(vp, &initial_GC, sizeof(initial_GC));
 	gc->gid = GrNewGC();
 
-	/* X11 doesn't draw background, must set on all GrNewGC's*/
-	GrSetGCUseBackground(gc->gid, GR_FALSE);
+	if (values)
+		xv = *values;
+	else
+		xv = initial_GC;
 
 	/* X11 defaults to fg=black, bg=white, NX is opposite...*/
 	if (!(valuemask & GCForeground))
-		XSetForeground(dpy, gc, 0L);	/* black*/
+		xv.foreground = 0L;		/* black*/
 	if (!(valuemask & GCBackground))
-		XSetBackground(dpy, gc, ~0L);	/* white*/
+		xv.background = ~0L;		/* white*/
+	valuemask |= GCForeground | GCBackground;
+
+	/* X11 doesn't draw background, must set on all GrNewGC's*/
+	gv.usebackground = GR_FALSE;
 
-	setupGC(dpy, gc, valuemask, values);
+	setupGC(dpy, gc, valuemask, &xv, &gv, GR_GC_MASK_USEBACKGROUND);
 	return gc;
 }
 
 int
 XChangeGC(Display *display, GC gc, unsigned long valuemask, XGCValues *values)
 {
-	setupGC(display, gc, valuemask, values);
+	GR_GC_VALUES gv;
+
+	setupGC(display, gc, valuemask, values, &gv, 0);
 	return 1;
 }
 
@@ -254,6 +318,9 @@ XSetBackground(Display *dpy, GC gc, unsigned long background)
 int
 XSetFont(Display *dpy, GC gc, Font font)
 {
+	XGCValues *vp = (XGCValues *)gc->ext_data;
+
+	vp->font = font;
 	GrSetGCFont(gc->gid, font);
 	return 1;
 }
@@ -261,33 +328,19 @@ XSetFont(Display *dpy, GC gc, Font font)
 int
 XSetFillStyle(Display * dpy, GC gc, int fill_style)
 {
-	unsigned long mode = 0;
-
-	switch (fill_style) {
-	case FillTiled:
-		mode = GR_FILL_TILE;
-		break;
-
-	case FillStippled:
-		mode = GR_FILL_STIPPLE;
-		break;
-
-	case FillOpaqueStippled:
-		mode = GR_FILL_OPAQUE_STIPPLE;
-		break;
-
-	default:
-		mode = GR_FILL_SOLID;
-		break;
-	}
+	XGCValues *vp = (XGCValues *)gc->ext_data;
 
-	GrSetGCFillMode(gc->gid, mode);
+	vp->fill_style = fill_style;
+	GrSetGCFillMode(gc->gid, convertFillStyle(fill_style));
 	return 1;
 }
 
 int
 XSetGraphicsExposures(Display * display, GC gc, int graphics)
 {
+	XGCValues *vp = (XGCValues *)gc->ext_data;
+
+	vp->graphics_exposures = graphics;
 	GrSetGCGraphicsExposure(gc->gid, graphics);
 	return 1;
 }
@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include "nxlib.h"
 
 int
@@ -5,38 +6,55 @@ XDrawSegments(Display * dpy,
 	      Drawable d, GC gc, XSegment * segments, int nsegments)
 {
 	int i;
+	GR_SEGMENT *gr_segs;
 
+	if (nsegments <= 0)
+		return 1;
+
+	/* must copy since X coords are shorts, Nano-X are MWCOORDs (int) */
+	gr_segs = ALLOCA(nsegments * sizeof(GR_SEGMENT));
 	for (i = 0; i < nsegments; i++) {
-		GrLine(d, gc->gid, segments[i].x1, segments[i].y1,
-			segments[i].x2, segments[i].y2);
+		gr_segs[i].x1 = segments[i].x1;
+		gr_segs[i].y1 = segments[i].y1;
+		gr_segs[i].x2 = segments[i].x2;
+		gr_segs[i].y2 = segments[i].y2;
 	}
 
+	GrSegments(d, gc->gid, nsegments, gr_segs);
+
+	FREEA(gr_segs);
 	return 1;
 }
 
 int
 XDrawLines(Display * dpy, Drawable d, GC gc, XPoint * points, int npoints,
-	int mode)	// FIXME: mode ignored
+	int mode)
 {
-	GR_POINT beg, end;
+	int i;
+	GR_POINT *gr_points;
 
 	if (npoints < 1)
 		return 1;
-	if (npoints == 1) {
-		GrPoint(d, gc->gid, points->x, points->y);
-		return 1;
-	}
 
 	/* must copy since X points are shorts, Nano-X are MWCOORDs (int) */
-	beg.x = points->x;
-	beg.y = points->y;
-	++points;
-	while (--npoints > 0) {
-		end.x = points->x;
-		end.y = points->y;
-		++points;
-		GrLine(d, gc->gid, beg.x, beg.y, end.x, end.y);
-		beg = end;
+	gr_points = ALLOCA(npoints * sizeof(GR_POINT));
+	if (mode == CoordModeOrigin) {
+		for (i = 0; i < npoints; i++) {
+			gr_points[i].x = points[i].x;
+			gr_points[i].y = points[i].y;
+		}
+	} else {		/* CoordModePrevious */
+		int px = 0, py = 0;
+		for (i = 0; i < npoints; i++) {
+			px += points[i].x;
+			py += points[i].y;
+			gr_points[i].x = px;
+			gr_points[i].y = py;
+		}
 	}
+
+	GrPolyLine(d, gc->gid, npoints, gr_points);
+
+	FREEA(gr_points);
 	return 1;
 }
@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include "nxlib.h"
 
 int
@@ -14,12 +15,22 @@ XDrawRectangles(Display *display, Drawable d, GC gc, XRectangle *rect,
 	int nrect)
 {
 	int i;
+	GR_RECT *gr_rects;
 
+	if (nrect <= 0)
+		return 1;
+
+	gr_rects = ALLOCA(nrect * sizeof(GR_RECT));
 	for (i = 0; i < nrect; i++) {
+		gr_rects[i].x = rect[i].x;
+		gr_rects[i].y = rect[i].y;
 		/* X11 width/height is one less than Nano-X width/height*/
-		GrRect(d, gc->gid, rect->x, rect->y, rect->width+1,
-		       rect->height+1);
-		++rect;
+		gr_rects[i].width = rect[i].width + 1;
+		gr_rects[i].height = rect[i].height + 1;
 	}
+
+	GrRects(d, gc->gid, nrect, gr_rects);
+
+	FREEA(gr_rects);
 	return 1;
 }
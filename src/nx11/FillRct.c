@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include "nxlib.h"
 #include <stdio.h>
 
@@ -13,12 +14,21 @@ XFillRectangle(Display *xdpy, Drawable d, GC gc, int x, int y,
 int 
 XFillRectangles(Display *dpy, Drawable d, GC gc, XRectangle *rects, int nrects) {
 	int i;
+	GR_RECT *gr_rects;
 
-	for(i = 0; i < nrects; i++) {
-		XFillRectangle(dpy, d, gc, rects->x, rects->y,
-				rects->width, rects->height);
-		++rects;
+	if (nrects <= 0)
+		return 1;
+
+	gr_rects = ALLOCA(nrects * sizeof(GR_RECT));
+	for (i = 0; i < nrects; i++) {
+		gr_rects[i].x = rects[i].x;
+		gr_rects[i].y = rects[i].y;
+		gr_rects[i].width = rects[i].width;
+		gr_rects[i].height = rects[i].height;
 	}
 
+	GrFillRects(d, gc->gid, nrects, gr_rects);
+
+	FREEA(gr_rects);
 	return 1;
 }
@@ -55,6 +55,7 @@ XSetLineAttributes(Display * display, GC gc, unsigned int line_width,
 		   int line_style, int cap_style, int join_style)
 {
 	unsigned long ls;
+	int cs, js;
 
 	switch (line_style) {
 	case LineOnOffDash:
@@ -67,12 +68,30 @@ XSetLineAttributes(Display * display, GC gc, unsigned int line_width,
 		break;
 	}
 
-	if (line_width > 1)
-		DPRINTF("XSetLineAttributes: width %d\n", line_width);
+	switch (cap_style) {
+	case CapRound:
+		cs = GR_CAP_ROUND;
+		break;
+	case CapProjecting:
+		cs = GR_CAP_SQUARE;
+		break;
+	default:		/* CapNotLast, CapButt*/
+		cs = GR_CAP_BUTT;
+		break;
+	}
 
-	if (join_style != JoinMiter)
-		DPRINTF("XSetLineAttributes: We don't support join style yet\n");
+	switch (join_style) {
+	case JoinRound:
+		js = GR_JOIN_ROUND;
+		break;
+	case JoinBevel:
+		js = GR_JOIN_BEVEL;
+		break;
+	default:
+		js = GR_JOIN_MITER;
+		break;
+	}
 
-	GrSetGCLineAttributes(gc->gid, ls);
+	GrSetGCLineAttributesEx(gc->gid, line_width, ls, cs, js);
 	return 1;
 }
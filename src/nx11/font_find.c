@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <sys/stat.h>
 #include "uni_std.h"
 #include "nxlib.h"
 #include "X11/Xatom.h"
@@ -22,39 +24,71 @@ char **font_enumfonts(char *pattern, int maxnames, int *count_return, int chkali
 void font_freefontnames(char **fontlist);
 
 static char **findXLFDfont(char *pattern, int maxnames, int *count, int chkalias);
-static FILE * _nxOpenFontDir(char *str);
 static void _nxSetDefaultFontDir(void);
 static void _nxSetFontDir(char **directories, int ndirs);
 static void _nxFreeFontDir(char ***list);
+static void freefontindex(void);
+static void checkfontindex(void);
+static int dashcount(char *name);
+static int xlfdheight(const char *xlfd);
 
 /* nxlib font.c*/
 static char **_nxfontlist = NULL;
 static int _nxfontcount = 0;
 
-static FILE *
-_nxOpenFontDir(char *str)
-{
-	char path[256];
-
-	sprintf(path, "%s/fonts.dir", str);
-	return fopen(path, "r");
-}
-
-
-static FILE *
-openfontalias(char *str)
-{
-	char path[256];
-
-	sprintf(path, "%s/fonts.alias", str);
-	FILE *f = fopen(path, "r");
-	if (f == NULL) {
-		sprintf(path, "%s/fonts.ali", str); //try this for short file name support
-		f = fopen(path, "r");
-	}
-	return f;
-}
-
+/*
+ * Font directory index.
+ *
+ * The fonts.dir and fonts.alias files in each font directory are read once
+ * into memory, rather than on each font lookup.  Fonts are chained by hash of
+ * XLFD, by hash of XLFD family name and scaleable fonts are chained together,
+ * and aliases chained by hash of alias name, all in font path and file order.
+ * The index is rebuilt when the font path changes, or when a fonts.dir or
+ * fonts.alias modification time changes, which is checked at most once a second.
+ */
+#define XLFD_DASHES	14			/* dashes in complete XLFD*/
+
+typedef struct {
+	char *	file;				/* font filename, first fonts.dir field*/
+	char *	xlfd;				/* XLFD, second fonts.dir field*/
+	int		dashes;				/* dashes in XLFD*/
+	int		height;				/* XLFD pixel height, 0 if scaleable*/
+	int		nextxlfd;			/* next entry with same XLFD hash or -1*/
+	int		nextfamily;			/* next complete XLFD with same family hash or -1*/
+	int		nextother;			/* next incomplete XLFD or -1*/
+	int		nextscale;			/* next scaleable XLFD or -1*/
+} FONTENTRY;
+
+typedef struct {
+	char *	name;				/* alias name, first fonts.alias field*/
+	char *	alias;				/* aliased font name, second field*/
+	int		next;				/* next alias with same hash or -1*/
+} FONTALIAS;
+
+typedef struct {
+	int		havefontsdir;		/* fonts.dir exists*/
+	time_t	dirtime;			/* fonts.dir modification time, 0 if none*/
+	time_t	aliastime;			/* fonts.alias modification time, 0 if none*/
+	int		first;				/* first index in fontentries*/
+	int		count;				/* number of fonts in fonts.dir*/
+	int		afirst;				/* first index in fontaliases*/
+	int		acount;				/* number of aliases in fonts.alias*/
+} FONTDIRINDEX;
+
+static FONTDIRINDEX *fontdirs;	/* index for each _nxfontlist dir, NULL if not built*/
+static FONTENTRY *fontentries;
+static int nfontentries;
+static int nfontalloc;			/* fontentries allocated*/
+static FONTALIAS *fontaliases;
+static int nfontaliases;
+static int naliasalloc;			/* fontaliases allocated*/
+static int *xlfdhash;			/* XLFD hash chain heads*/
+static int *familyhash;			/* family hash chain heads*/
+static int *aliashash;			/* alias hash chain heads*/
+static int hashsize;			/* size of hash tables, power of two*/
+static int firstother = -1;		/* first incomplete XLFD*/
+static int firstscale = -1;		/* first scaleable XLFD*/
+static time_t lastcheck;		/* time index last checked for changes*/
 
 static void
 _nxSetDefaultFontDir(void)
@@ -99,6 +133,321 @@ _nxFreeFontDir(char ***addrlist)
 	if (addrlist == &_nxfontlist) {
 		_nxfontlist = 0;
 		_nxfontcount = 0;
+		freefontindex();
+	}
+}
+
+static unsigned int
+hashstring(const char *str, int len)
+{
+	unsigned int h = 0;
+
+	while (len-- > 0 && *str)
+		h = h * 31 + (unsigned char)*str++;
+	return h;
+}
+
+/* return pointer to and length of XLFD family field: -foundry-family-...*/
+static const char *
+xlfdfamily(const char *xlfd, int *len)
+{
+	const char *p;
+
+	if (xlfd[0] != '-' || (xlfd = strchr(xlfd+1, '-')) == NULL) {
+		*len = 0;
+		return NULL;
+	}
+	xlfd++;
+	p = strchr(xlfd, '-');
+	*len = p? p - xlfd: (int)strlen(xlfd);
+	return xlfd;
+}
+
+/* return modification time of dir/file, or 0 if it doesn't exist*/
+static time_t
+fontfiletime(const char *dir, const char *file)
+{
+	struct stat st;
+	char path[256];
+
+	sprintf(path, "%s/%s", dir, file);
+	if (stat(path, &st) < 0)
+		return 0;
+	return st.st_mtime;
+}
+
+static FILE *
+openfontalias(const char *dir, time_t *mtime)
+{
+	char path[256];
+	FILE *f;
+
+	sprintf(path, "%s/fonts.alias", dir);
+	f = fopen(path, "r");
+	if (f == NULL) {
+		sprintf(path, "%s/fonts.ali", dir); //try this for short file name support
+		f = fopen(path, "r");
+	}
+	if (f) {
+		struct stat st;
+
+		*mtime = (fstat(fileno(f), &st) == 0)? st.st_mtime: 1;
+	} else *mtime = 0;
+	return f;
+}
+
+static void
+freefontindex(void)
+{
+	int i;
+
+	for (i = 0; i < nfontentries; i++)
+		free(fontentries[i].file);		/* xlfd is in same allocation*/
+	for (i = 0; i < nfontaliases; i++)
+		free(fontaliases[i].name);
+	free(fontentries);
+	free(fontaliases);
+	free(xlfdhash);
+	free(familyhash);
+	free(aliashash);
+	free(fontdirs);
+	fontentries = NULL;
+	fontaliases = NULL;
+	xlfdhash = familyhash = aliashash = NULL;
+	fontdirs = NULL;
+	nfontentries = nfontaliases = hashsize = 0;
+	nfontalloc = naliasalloc = 0;
+	firstother = firstscale = -1;
+}
+
+/* remove trailing newline, return 0 if nothing left*/
+static int
+chopline(char *buffer)
+{
+	int len = strlen(buffer);
+
+	while (len > 0 && (buffer[len-1] == '\n' || buffer[len-1] == '\r'))
+		buffer[--len] = '\0';
+	return len;
+}
+
+/* read fonts.dir entries for font directory f*/
+static void
+indexfontsdir(int f)
+{
+	FONTDIRINDEX *dp = &fontdirs[f];
+	FILE *fontdir;
+	int i, fcount;
+	char path[256];
+	char buffer[512];
+
+	dp->first = nfontentries;
+	dp->count = 0;
+
+	sprintf(path, "%s/fonts.dir", _nxfontlist[f]);
+	fontdir = fopen(path, "r");
+	dp->havefontsdir = (fontdir != NULL);
+	if (!fontdir)
+		return;
+	DPRINTF("font index %s\n", path);
+
+	/* get fonts.dir linecount*/
+	if (!fgets(buffer, sizeof(buffer), fontdir) || !(fcount = atoi(buffer))) {
+		fclose(fontdir);
+		return;
+	}
+
+	for (i = 0; i < fcount; i++) {
+		FONTENTRY *fp;
+		char *xlfd;
+
+		if (!fgets(buffer, sizeof(buffer), fontdir))
+			break;
+		chopline(buffer);
+
+		/* font filename is first field, XLFD is second field*/
+		xlfd = strchr(buffer, ' ');
+		if (!xlfd)
+			continue;
+		*xlfd++ = '\0';
+
+		if (nfontentries >= nfontalloc) {
+			int n = nfontalloc? nfontalloc * 2: 256;
+			FONTENTRY *newentries = realloc(fontentries, n * sizeof(FONTENTRY));
+
+			if (!newentries)
+				break;
+			fontentries = newentries;
+			nfontalloc = n;
+		}
+		fp = &fontentries[nfontentries];
+		fp->file = malloc(strlen(buffer) + strlen(xlfd) + 2);
+		if (!fp->file)
+			break;
+		strcpy(fp->file, buffer);
+		fp->xlfd = fp->file + strlen(buffer) + 1;
+		strcpy(fp->xlfd, xlfd);
+		fp->dashes = dashcount(xlfd);
+		fp->height = xlfdheight(xlfd);
+		nfontentries++;
+	}
+	dp->count = nfontentries - dp->first;
+	fclose(fontdir);
+}
+
+/* read fonts.alias entries for font directory f*/
+static void
+indexfontalias(int f)
+{
+	FONTDIRINDEX *dp = &fontdirs[f];
+	FILE *aliasfile;
+	char *p;
+	char buffer[256];
+
+	dp->afirst = nfontaliases;
+	dp->acount = 0;
+
+	aliasfile = openfontalias(_nxfontlist[f], &dp->aliastime);
+	if (!aliasfile)
+		return;
+
+	while (fgets(buffer, sizeof(buffer), aliasfile)) {
+		FONTALIAS *ap;
+
+		/* ignore blank and ! comments*/
+		if (!chopline(buffer) || buffer[0] == '!')
+			continue;
+
+		/* fontname is first space separated field*/
+		/* check for tab first as filename may have spaces*/
+		p = strchr(buffer, '\t');
+		if (!p)
+			p = strchr(buffer, ' ');
+		if (!p)
+			continue;
+		*p = '\0';
+
+		/* alias is second space separated field*/
+		do ++p; while (*p == ' ' || *p == '\t');
+
+		if (nfontaliases >= naliasalloc) {
+			int n = naliasalloc? naliasalloc * 2: 64;
+			FONTALIAS *newaliases = realloc(fontaliases, n * sizeof(FONTALIAS));
+
+			if (!newaliases)
+				break;
+			fontaliases = newaliases;
+			naliasalloc = n;
+		}
+		ap = &fontaliases[nfontaliases];
+		ap->name = malloc(strlen(buffer) + strlen(p) + 2);
+		if (!ap->name)
+			break;
+		strcpy(ap->name, buffer);
+		ap->alias = ap->name + strlen(buffer) + 1;
+		strcpy(ap->alias, p);
+		nfontaliases++;
+	}
+	dp->acount = nfontaliases - dp->afirst;
+	fclose(aliasfile);
+}
+
+/* read all font directories and build hash chains*/
+static void
+buildfontindex(void)
+{
+	int f, i, len;
+	const char *family;
+
+	freefontindex();
+	fontdirs = (FONTDIRINDEX *)calloc(_nxfontcount+1, sizeof(FONTDIRINDEX));
+	if (!fontdirs)
+		return;
+
+	for (f = 0; f < _nxfontcount; f++) {
+		fontdirs[f].dirtime = fontfiletime(_nxfontlist[f], "fonts.dir");
+		indexfontsdir(f);
+		indexfontalias(f);
+	}
+
+	for (hashsize = 64; hashsize < nfontentries || hashsize < nfontaliases; hashsize <<= 1)
+		continue;
+	xlfdhash = (int *)malloc(hashsize * sizeof(int));
+	familyhash = (int *)malloc(hashsize * sizeof(int));
+	aliashash = (int *)malloc(hashsize * sizeof(int));
+	if (!xlfdhash || !familyhash || !aliashash) {
+		freefontindex();
+		return;
+	}
+	memset(xlfdhash, -1, hashsize * sizeof(int));
+	memset(familyhash, -1, hashsize * sizeof(int));
+	memset(aliashash, -1, hashsize * sizeof(int));
+
+	/* build chains in reverse so each is in font path and file order*/
+	for (i = nfontentries - 1; i >= 0; i--) {
+		FONTENTRY *fp = &fontentries[i];
+		unsigned int h = hashstring(fp->xlfd, strlen(fp->xlfd)) & (hashsize-1);
+
+		fp->nextxlfd = xlfdhash[h];
+		xlfdhash[h] = i;
+
+		fp->nextfamily = fp->nextother = -1;
+		if (fp->dashes == XLFD_DASHES && (family = xlfdfamily(fp->xlfd, &len)) != NULL) {
+			h = hashstring(family, len) & (hashsize-1);
+			fp->nextfamily = familyhash[h];
+			familyhash[h] = i;
+		} else {
+			fp->nextother = firstother;
+			firstother = i;
+		}
+
+		fp->nextscale = -1;
+		if (fp->xlfd[0] == '-' && fp->height == 0) {
+			fp->nextscale = firstscale;
+			firstscale = i;
+		}
+	}
+	for (i = nfontaliases - 1; i >= 0; i--) {
+		unsigned int h = hashstring(fontaliases[i].name, strlen(fontaliases[i].name)) & (hashsize-1);
+
+		fontaliases[i].next = aliashash[h];
+		aliashash[h] = i;
+	}
+	DPRINTF("font index: %d fonts %d aliases in %d dirs\n", nfontentries, nfontaliases, _nxfontcount);
+}
+
+/* build font index if needed, or rebuild if any font directory changed*/
+static void
+checkfontindex(void)
+{
+	time_t now;
+	int f;
+
+	if (!_nxfontcount)
+		_nxSetDefaultFontDir();
+
+	if (!fontdirs) {
+		buildfontindex();
+		lastcheck = time(NULL);
+		return;
+	}
+
+	now = time(NULL);
+	if (now == lastcheck)
+		return;
+	lastcheck = now;
+
+	for (f = 0; f < _nxfontcount; f++) {
+		time_t aliastime = fontfiletime(_nxfontlist[f], "fonts.alias");
+
+		if (!aliastime)
+			aliastime = fontfiletime(_nxfontlist[f], "fonts.ali");
+		if (fontfiletime(_nxfontlist[f], "fonts.dir") != fontdirs[f].dirtime ||
+		    aliastime != fontdirs[f].aliastime) {
+			DPRINTF("font index: %s changed, rebuilding\n", _nxfontlist[f]);
+			buildfontindex();
+			return;
+		}
 	}
 }
 
@@ -263,60 +612,81 @@ patternmatch(char *pat, int patdashes, char *string, int stringdashes)
 	}
 }
 
+#if HAVE_STATICFONTS
 static int
 match(char *pat, char *string)
 {
 	return patternmatch(pat, dashcount(pat), string, dashcount(string));
 }
+#endif
 
 /*
  * Search font directory fonts.dir files and return list of XLFD's that match wildchars.
  * fonts.alias is not used with this function.
+ *
+ * When the pattern has all XLFD fields, '*' can't match across fields, so if
+ * the family field has no wildcards only fonts in that family are checked.
  */
 static void
 findfont_wildcard(char *pattern, int maxnames, struct _list *fontlist)
 {
-	int f, i;
+	int i, other, len;
+	int patdashes = dashcount(pattern);
+	const char *family = NULL;
 
 	DPRINTF("findfont_wildcard: '%s' maxnames %d\n", pattern, maxnames);
-	/* loop through each font dir and read fonts.dir*/
-	for (f = 0; f < _nxfontcount; f++) {
-		FILE *fontdir = _nxOpenFontDir(_nxfontlist[f]);
-		int fcount;
-		char buffer[128];
-
-		DPRINTF("nxopenfontdir %s\n", _nxfontlist[f]);
-		if (!fontdir)
-			continue;
+	checkfontindex();
+	if (maxnames <= 0)
+		return;
 
-		/* get fonts.dir linecount*/
-		if (!fgets(buffer, sizeof(buffer), fontdir) || !(fcount = atoi(buffer))) {
-			fclose(fontdir);
-			continue;
+	if (patdashes == XLFD_DASHES && (family = xlfdfamily(pattern, &len)) != NULL) {
+		for (i = 0; i < len; i++) {
+			if (family[i] == '*' || family[i] == '?') {
+				family = NULL;
+				break;
+			}
 		}
+	}
 
-		/* read XLFD and add to list if matches wildcard pattern*/
-		for (i = 0; i < fcount; i++) {
-			char *xlfd;
+	if (family && hashsize) {
+		/* merge family chain with incomplete XLFDs in font path order*/
+		i = familyhash[hashstring(family, len) & (hashsize-1)];
+		other = firstother;
+		while (i >= 0 || other >= 0) {
+			FONTENTRY *fp;
 
-			if (!(fgets(buffer, sizeof(buffer), fontdir)))
-				continue;
-			buffer[strlen(buffer) - 1] = '\0';
+			if (other >= 0 && (i < 0 || other < i)) {
+				fp = &fontentries[other];
+				other = fp->nextother;
+			} else {
+				const char *fam;
+				int flen;
 
-			/* XLFD is second field*/
-			xlfd = strchr(buffer, ' ');
-			if (!xlfd)
-				continue;
-			*xlfd++ = '\0';
+				fp = &fontentries[i];
+				i = fp->nextfamily;
+				fam = xlfdfamily(fp->xlfd, &flen);
+				if (fam == NULL || flen != len || strncmp(fam, family, len) != 0)
+					continue;
+			}
 
 			/* if XLFD matches pattern, add to fontlist*/
-			if (match(pattern, xlfd)) {
-				DPRINTF("enumfont add: %s\n", xlfd);
-				if (_addFontToList(fontlist, xlfd) == maxnames)
-					break;
+			if (patternmatch(pattern, patdashes, fp->xlfd, fp->dashes)) {
+				DPRINTF("enumfont add: %s\n", fp->xlfd);
+				if (_addFontToList(fontlist, fp->xlfd) == maxnames)
+					return;
+			}
+		}
+	} else {
+		for (i = 0; i < nfontentries; i++) {
+			FONTENTRY *fp = &fontentries[i];
+
+			/* if XLFD matches pattern, add to fontlist*/
+			if (patternmatch(pattern, patdashes, fp->xlfd, fp->dashes)) {
+				DPRINTF("enumfont add: %s\n", fp->xlfd);
+				if (_addFontToList(fontlist, fp->xlfd) == maxnames)
+					return;
 			}
 		}
-		fclose(fontdir);
 	}
 
 #if ANDROID // FIXME broken, segfaults in strlen code below
@@ -436,48 +806,50 @@ any(int c, const char *str)
 int
 font_findalias(int index, const char *fontspec, char *alias)
 {
-	FILE *aliasfile;
-	int match = 0;
-	char *p;
-	char buffer[256];
+	FONTDIRINDEX *dp;
+	int i;
 
-	/* loop through each line in the fonts.alias file for match*/
-	aliasfile = openfontalias(_nxfontlist[index]);
-	if (aliasfile) {
-		for (;;) {
-			if (!fgets(buffer, sizeof(buffer), aliasfile))
-				break;
-			buffer[strlen(buffer) - 1] = '\0';
-
-			/* ignore blank and ! comments*/
-			if (buffer[0] == '\0' || buffer[0] == '!')
-				continue;
-
-			/* fontname is first space separated field*/
-			/* check for tab first as filename may have spaces*/
-			p = strchr(buffer, '\t');
-			if (!p)
-				p = strchr(buffer, ' ');
-			if (!p)
-				continue;
-			*p = '\0';
-
-			/* check exact match*/
-			if (strcmp(fontspec, buffer) == 0) {
-
-				/* alias is second space separated field*/
-				do ++p; while (*p == ' ' || *p == '\t');
-
-				strcpy(alias, p);
-				DPRINTF("font_findalias: replacing %s with %s\n", fontspec, alias);
-				match = 1;
-				break;
-			}
+	checkfontindex();
+	if (!fontdirs || !hashsize || index < 0 || index >= _nxfontcount)
+		return 0;
+	dp = &fontdirs[index];
+
+	for (i = aliashash[hashstring(fontspec, strlen(fontspec)) & (hashsize-1)]; i >= 0;
+	     i = fontaliases[i].next) {
+		if (i < dp->afirst)
+			continue;
+		if (i >= dp->afirst + dp->acount)
+			break;
+
+		/* check exact match*/
+		if (strcmp(fontspec, fontaliases[i].name) == 0) {
+			strcpy(alias, fontaliases[i].alias);
+			DPRINTF("font_findalias: replacing %s with %s\n", fontspec, alias);
+			return 1;
 		}
-		fclose(aliasfile);
 	}
+	return 0;
+}
+
+/* check if passed fontspec is aliased in any font directory, first found wins*/
+static int
+findanyalias(const char *fontspec, char *alias)
+{
+	int i;
+
+	checkfontindex();
+	if (!hashsize)
+		return 0;
 
-	return match;
+	for (i = aliashash[hashstring(fontspec, strlen(fontspec)) & (hashsize-1)]; i >= 0;
+	     i = fontaliases[i].next) {
+		if (strcmp(fontspec, fontaliases[i].name) == 0) {
+			strcpy(alias, fontaliases[i].alias);
+			DPRINTF("font_findalias: replacing %s with %s\n", fontspec, alias);
+			return 1;
+		}
+	}
+	return 0;
 }
 
 /* return height component of XLFD: ...--height-...*/
@@ -499,6 +871,40 @@ xlfdheight(const char *xlfd)
 	return height;
 }
 
+/*
+ * Check for scaleable font XLFD match with passed pixel size, that is:
+ *     match XLFD  "...normal--0-0-0-0-0-..."
+ * with passed     "...normal--12-0-0-0-0-..."
+ * for height 12.
+ */
+static int
+scalematch(const char *xlfd, const char *fontspec)
+{
+	int j;
+	int dashcount = 0;
+	int len = MWMIN(strlen(xlfd), strlen(fontspec));
+
+	/* match before and after height at '--0-' in XLFD string*/
+	for (j = 0; j < len && dashcount < 8; j++) {
+		if (xlfd[j] == '-')
+			dashcount++;
+		if (xlfd[j] != fontspec[j]) {
+			if (dashcount == 7 && xlfd[j] == '0') {
+				int st = j;
+
+				/* pass over passed height*/
+				while (fontspec[j] >= '0' && fontspec[j] <= '9')
+					j++;
+
+				/* and check that rest of XLFD line matches*/
+				return strcmp(&fontspec[j], &xlfd[st+1]) == 0;
+			}
+			break;
+		}
+	}
+	return 0;
+}
+
 /*
  * Search font directory fonts.dir files and return full font pathname matching
  * fontspec, no wildcards allowed.
@@ -524,11 +930,10 @@ static char *
 findfont_nowildcard(const char *fontspec, int *height)
 {
 	int i, f;
-	char buffer[128];
+	int match = -1;
 	char path[256];
 
-	if (!_nxfontcount)
-		_nxSetDefaultFontDir();
+	checkfontindex();
 
 	DPRINTF("findfont_nowildcard: '%s'\n", fontspec);
 
@@ -539,20 +944,39 @@ findfont_nowildcard(const char *fontspec, int *height)
 	if (fontspec[0] == '/')
 		return strdup(fontspec);
 
-	/* loop through each font dir and read fonts.dir*/
-	for (f = 0; f < _nxfontcount; f++) {
-		FILE *fontdir = _nxOpenFontDir(_nxfontlist[f]);
-		int fcount;
+	if (fontspec[0] == '-' && hashsize) {
+		/* Fontspec is XLFD: find first exact match, then first -0- height match before it*/
+		for (i = xlfdhash[hashstring(fontspec, strlen(fontspec)) & (hashsize-1)]; i >= 0;
+		     i = fontentries[i].nextxlfd) {
+			if (strcmp(fontspec, fontentries[i].xlfd) == 0) {
+				match = i;
+				*height = fontentries[i].height;
+				break;
+			}
+		}
+		for (i = firstscale; i >= 0 && (match < 0 || i < match); i = fontentries[i].nextscale) {
+			if (scalematch(fontentries[i].xlfd, fontspec)) {
+				match = i;
+				*height = xlfdheight(fontspec);
+				break;
+			}
+		}
+	}
+
+	/* loop through each font dir in order for match*/
+	for (f = 0; fontdirs && f < _nxfontcount; f++) {
+		FONTDIRINDEX *dp = &fontdirs[f];
 
 		/*
 		 * If no fonts.dir file, check fontspec as filename.
 		 * This allows .ttf files to be found in typical font directory
 		 * installations for non-X11/XLFD fonts.
 		 */
-		if (!fontdir) {
+		if (!dp->havefontsdir) {
 			sprintf(path, "%s/%s", _nxfontlist[f], fontspec);
 			if (access(path, F_OK) == 0) {
 				DPRINTF("findfont_nowild: partial path match %s = %s\n", fontspec, path);
+				*height = 0;
 				return strdup(path);
 			}
 
@@ -560,117 +984,32 @@ findfont_nowildcard(const char *fontspec, int *height)
 			continue;
 		}
 
-		/* get fonts.dir linecount*/
-		if (!fgets(buffer, sizeof(buffer), fontdir) || !(fcount = atoi(buffer))) {
-			fclose(fontdir);
-			continue;
-		}
-
 		if (fontspec[0] == '-') {
-			/* Fontspec is XLFD: loop throuch each line in the fonts.dir file for XLFD match*/
-			for (i = 0; i < fcount; i++) {
-				char *xlfd;
-
-				/* font filename is first field*/
-				if (!fgets(buffer, sizeof(buffer), fontdir))
-					continue;
-				buffer[strlen(buffer) - 1] = '\0';
-
-				/* XLFD is second field*/
-				xlfd = strchr(buffer, ' ');
-				if (!xlfd)
-					continue;
-				*xlfd++ = '\0';
-
-				/* if XLFD matches fontspec, return full font pathname*/
-				if (strcmp(fontspec, xlfd) == 0) {
-
-					/* return full font pathname and height*/
-					sprintf(path, "%s/%s", _nxfontlist[f], buffer);
-					*height = xlfdheight(xlfd);
-					DPRINTF("findfont_nowild: exact XLFD match %s %s = %s (%d)\n",
-						fontspec, xlfd, path, *height);
-					fclose(fontdir);
-					return strdup(path);
-				} else {
-					int j;
-					int dashcount = 0;
-					int len;
-
-					/* no exact match, check for match with -0- height*/
-					if (xlfdheight(xlfd) != 0)
-						continue;		/* not scaleable, try next fonts.dir line*/
-
-					/* otherwise check for scaleable font match spec
-				 	 * with passed pixel size, that is:
-				 	 *     match XLFD  "...normal--0-0-0-0-0-..."
-				 	 * with passed     "...normal--12-0-0-0-0-..."
-				 	 * for height 12.
-				 	 */
-					len = MWMIN(strlen(xlfd), strlen(fontspec));
-
-					/* match before and after height at '--0-' in XLFD string*/
-					for (j = 0; j < len && dashcount < 8; j++) {
-						if (xlfd[j] == '-')
-							dashcount++;
-						if (xlfd[j] != fontspec[j]) {
-							if (dashcount == 7 && xlfd[j] == '0') {
-								int st = j;
-
-								/* pass over passed height*/
-								while (fontspec[j] >= '0' && fontspec[j] <= '9')
-									j++;
-
-								/* and check that rest of XLFD line matches*/
-								if (strcmp(&fontspec[j], &xlfd[st+1]) == 0) {
-
-									/* match - return full font pathname and height*/
-									sprintf(path, "%s/%s", _nxfontlist[f], buffer);
-									*height = xlfdheight(fontspec);
-									DPRINTF("findfont_nowild: XLFD -0- match %s %s = '%s' height %d\n", fontspec, xlfd, path, *height);
-									fclose(fontdir);
-									return strdup(path);
-								}
-							}
-							break;
-						}
-					}
-				}
+			/* return full font pathname and height if XLFD match in this fonts.dir*/
+			if (match >= dp->first && match < dp->first + dp->count) {
+				sprintf(path, "%s/%s", _nxfontlist[f], fontentries[match].file);
+				DPRINTF("findfont_nowild: XLFD match %s %s = %s (%d)\n",
+					fontspec, fontentries[match].xlfd, path, *height);
+				return strdup(path);
 			}
 		} else {	/* fontspec[0] != '-'*/
 			/*
 		 	 * Fontspec is not XLFD.  Loop through each fonts.dir line and look
 		 	 * for fontspec being a prefix of the font filename.
 		 	 */
-			for (i = 0; i < fcount; i++) {
-				char *p;
-
-				/* font filename is first field*/
-				if (!fgets(buffer, sizeof(buffer), fontdir))
-					continue;
-				buffer[strlen(buffer) - 1] = '\0';
-				p = strchr(buffer, ' ');
-				if (!p)
-					continue;
-				*p = '\0';
-
+			for (i = dp->first; i < dp->first + dp->count; i++) {
 				/* prefix allows font.pcf to match font.pcf.gz for example*/
-				if (prefix(fontspec, buffer)) {
-					char path[256];
-
+				if (prefix(fontspec, fontentries[i].file)) {
 					/* return full font pathname*/
-					sprintf(path, "%s/%s", _nxfontlist[f], buffer);
+					sprintf(path, "%s/%s", _nxfontlist[f], fontentries[i].file);
 					DPRINTF("findfont_nowild: non-XLFD prefix match %s %s = '%s'\n",
-						fontspec, buffer, path);
-					fclose(fontdir);
+						fontspec, fontentries[i].file, path);
 					return strdup(path);
 				}
 			}
 		}
-
-		if (fontdir)
-			fclose(fontdir);
 	}
+	*height = 0;
 
 #if HAVE_STATICFONTS
 		/* repeat code from above but search static font list for match*/
@@ -686,47 +1025,14 @@ findfont_nowildcard(const char *fontspec, int *height)
 					DPRINTF("findfont_nowild: exact XLFD match %s %s = %s (%d)\n",
 						xlfd, fontspec, staticFontList[i].file, *height);
 					return strdup(staticFontList[i].file);
-				} else {
-					int j;
-					int dashcount = 0;
-					int len;
-
-					/* no exact match, check for match with -0- height*/
-					if (xlfdheight(xlfd) != 0)
-						continue;		/* not scaleable, try next fonts.dir line*/
-
-					/* otherwise check for scaleable font match spec
-				 	 * with passed pixel size, that is:
-				 	 *     match XLFD  "...normal--0-0-0-0-0-..."
-				 	 * with passed     "...normal--12-0-0-0-0-..."
-				 	 * for height 12.
-				 	 */
-					len = MWMIN(strlen(xlfd), strlen(fontspec));
-
-					/* match before and after height at '--0-' in XLFD string*/
-					for (j = 0; j < len && dashcount < 8; j++) {
-						if (xlfd[j] == '-')
-							dashcount++;
-						if (xlfd[j] != fontspec[j]) {
-							if (dashcount == 7 && xlfd[j] == '0') {
-								int st = j;
-
-								/* pass over passed height*/
-								while (fontspec[j] >= '0' && fontspec[j] <= '9')
-									j++;
-
-								/* and check that rest of XLFD line matches*/
-								if (strcmp(&fontspec[j], &xlfd[st+1]) == 0) {
-
-									/* match - return full font pathname and height*/
-									*height = xlfdheight(fontspec);
-									DPRINTF("findfont_nowild: exact XLFD match %s %s = %s (%d)\n", xlfd, fontspec, staticFontList[i].file, *height);
-									return strdup(staticFontList[i].file);
-								}
-							}
-							break;
-						}
-					}
+				}
+
+				/* no exact match, check for match with -0- height*/
+				if (xlfdheight(xlfd) == 0 && scalematch(xlfd, fontspec)) {
+					/* match - return full font pathname and height*/
+					*height = xlfdheight(fontspec);
+					DPRINTF("findfont_nowild: exact XLFD match %s %s = %s (%d)\n", xlfd, fontspec, staticFontList[i].file, *height);
+					return strdup(staticFontList[i].file);
 				}
 			}
 		}
@@ -750,24 +1056,20 @@ findfont_nowildcard(const char *fontspec, int *height)
 static char **
 findXLFDfont(char *pattern, int maxnames, int *count, int chkalias)
 {
-	struct _list *fontlist = _createFontList();
-	int f;
-
-	if (!_nxfontlist)
-		_nxSetDefaultFontDir();
+	struct _list *fontlist;
 
-	/* loop through each font dir and read fonts.alias*/
+	/* check fonts.alias in each font dir*/
 	if (chkalias) {
-		for (f = 0; f < _nxfontcount; f++) {
-			char alias[256];
+		char alias[256];
 
-			/* rewrite pattern if aliased and start over*/
-			//FIXME infinite recursion!
-			if (font_findalias(f, pattern, alias))
-				return findXLFDfont(alias, maxnames, count, chkalias);
-		}
+		/* rewrite pattern if aliased and start over*/
+		//FIXME infinite recursion!
+		if (findanyalias(pattern, alias))
+			return findXLFDfont(alias, maxnames, count, chkalias);
 	}
 
+	fontlist = _createFontList();
+
 	if (pattern[0] == '-' && (any('*', pattern) || any('?', pattern))) {
 		findfont_wildcard(pattern, maxnames, fontlist);
 	} else {
@@ -833,22 +1135,14 @@ font_findfont(char *name, int height, int width, int *return_height)
 {
 	char *	   fontpath = NULL;
 	char **	   fontlist = NULL;
-	int f;
+	char alias[256];
 
 	DPRINTF("findfont: start %s h/w %d,%d\n", name, height, width);
-	if (!_nxfontcount)
-		_nxSetDefaultFontDir();
 
-	/* loop through each font dir and read fonts.alias*/
-	for (f = 0; f < _nxfontcount; f++)
-	{
-		char alias[256];
-
-		/* rewrite fontspec if aliased and start over*/
-		//FIXME infinite recursion!
-		if (font_findalias(f, name, alias))
-			return font_findfont(alias, height, width, return_height);
-	}
+	/* check fonts.alias in each font dir, rewrite fontspec if aliased and start over*/
+	//FIXME infinite recursion!
+	if (findanyalias(name, alias))
+		return font_findfont(alias, height, width, return_height);
 
 	/* check if XLFD wildcard specified and enumerate XLFD fonts if so*/
 	if (name[0] == '-' && (any('*', name) || any('?', name))) {